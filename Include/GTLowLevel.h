@@ -15,6 +15,7 @@
 #include <LowLevel/GteComputeModel.h>
 #include <LowLevel/GteLexicoArray2.h>
 #include <LowLevel/GteMinHeap.h>
+#include <LowLevel/GteParallelFor.h>
 #include <LowLevel/GteRangeIteration.h>
 #include <LowLevel/GteSharedPtrCompare.h>
 #include <LowLevel/GteStringUtility.h>
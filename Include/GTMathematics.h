@@ -26,6 +26,7 @@
 // Algebra
 #include <Mathematics/GteAxisAngle.h>
 #include <Mathematics/GteBandedMatrix.h>
+#include <Mathematics/GteBlockReflector.h>
 #include <Mathematics/GteConvertCoordinates.h>
 #include <Mathematics/GteEulerAngles.h>
 #include <Mathematics/GteGMatrix.h>
@@ -71,6 +72,7 @@
 #include <Mathematics/GteApprTorus3.h>
 
 // ComputationalGeometry
+#include <Mathematics/GteAABBTreeOfTriangles.h>
 #include <Mathematics/GteBSPPolygon2.h>
 #include <Mathematics/GteCLODPolyline.h>
 #include <Mathematics/GteConformalMapGenus0.h>
@@ -88,6 +90,7 @@
 #include <Mathematics/GteETNonmanifoldMesh.h>
 #include <Mathematics/GteFeatureKey.h>
 #include <Mathematics/GteGenerateMeshUV.h>
+#include <Mathematics/GteHalfEdgeMesh.h>
 #include <Mathematics/GteIsPlanarGraph.h>
 #include <Mathematics/GteMeshCurvature.h>
 #include <Mathematics/GteMinimalCycleBasis.h>
@@ -102,6 +105,7 @@
 #include <Mathematics/GtePrimalQuery3.h>
 #include <Mathematics/GteSeparatePoints2.h>
 #include <Mathematics/GteSeparatePoints3.h>
+#include <Mathematics/GteSliceMeshByPlanes.h>
 #include <Mathematics/GteSplitMeshByPlane.h>
 #include <Mathematics/GteTetrahedronKey.h>
 #include <Mathematics/GteTriangleKey.h>
@@ -129,6 +133,7 @@
 #include <Mathematics/GteContOrientedBox3.h>
 #include <Mathematics/GteContPointInPolygon2.h>
 #include <Mathematics/GteContPointInPolyhedron3.h>
+#include <Mathematics/GteContPointInTriangleMesh3.h>
 #include <Mathematics/GteContScribeCircle2.h>
 #include <Mathematics/GteContScribeCircle3Sphere3.h>
 #include <Mathematics/GteContSphere3.h>
@@ -383,11 +388,15 @@
 #include <Mathematics/GteGaussNewtonMinimizer.h>
 #include <Mathematics/GteGaussianElimination.h>
 #include <Mathematics/GteIntegration.h>
+#include <Mathematics/GteLCPBatchSolver.h>
 #include <Mathematics/GteLCPSolver.h>
 #include <Mathematics/GteLevenbergMarquardtMinimizer.h>
 #include <Mathematics/GteLinearSystem.h>
 #include <Mathematics/GteMinimize1.h>
 #include <Mathematics/GteMinimizeN.h>
+#include <Mathematics/GteOdeEnsembleDormandPrince.h>
+#include <Mathematics/GteOdeEnsembleRungeKutta4.h>
+#include <Mathematics/GteOdeEnsembleSolver.h>
 #include <Mathematics/GteOdeEuler.h>
 #include <Mathematics/GteOdeImplicitEuler.h>
 #include <Mathematics/GteOdeMidpoint.h>
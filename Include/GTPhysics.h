@@ -11,6 +11,7 @@
 #include <Physics/GteFluid2.h>
 #include <Physics/GteFluid2AdjustVelocity.h>
 #include <Physics/GteFluid2ComputeDivergence.h>
+#include <Physics/GteFluid2CPU.h>
 #include <Physics/GteFluid2EnforceStateBoundary.h>
 #include <Physics/GteFluid2InitializeSource.h>
 #include <Physics/GteFluid2InitializeState.h>
@@ -22,16 +23,20 @@
 #include <Physics/GteFluid3.h>
 #include <Physics/GteFluid3AdjustVelocity.h>
 #include <Physics/GteFluid3ComputeDivergence.h>
+#include <Physics/GteFluid3CPU.h>
 #include <Physics/GteFluid3EnforceStateBoundary.h>
 #include <Physics/GteFluid3InitializeSource.h>
 #include <Physics/GteFluid3InitializeState.h>
 #include <Physics/GteFluid3Parameters.h>
 #include <Physics/GteFluid3SolvePoisson.h>
 #include <Physics/GteFluid3UpdateState.h>
+#include <Physics/GtePoissonMultigrid.h>
 
 // Intersection
 #include <Physics/GteBoxManager.h>
+#include <Physics/GteContinuousCollision.h>
 #include <Physics/GteExtremalQuery3.h>
+#include <Physics/GteExtremalQuery3ADJ.h>
 #include <Physics/GteExtremalQuery3BSP.h>
 #include <Physics/GteExtremalQuery3PRJ.h>
 #include <Physics/GteRectangleManager.h>
@@ -39,10 +44,13 @@
 // ParticleSystems
 #include <Physics/GteMassSpringArbitrary.h>
 #include <Physics/GteMassSpringCurve.h>
+#include <Physics/GteMassSpringImplicitSolver.h>
 #include <Physics/GteMassSpringSurface.h>
 #include <Physics/GteMassSpringVolume.h>
 #include <Physics/GteParticleSystem.h>
 
 // RigidBody
+#include <Physics/GtePhysicsScheduler.h>
 #include <Physics/GtePolyhedralMassProperties.h>
 #include <Physics/GteRigidBody.h>
+#include <Physics/GteRigidBodyWorld.h>
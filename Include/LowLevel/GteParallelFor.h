@@ -0,0 +1,68 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/07)
+
+#pragma once
+
+#include <GTEngineDEF.h>
+#include <thread>
+#include <vector>
+
+// The function gte::ParallelFor partitions the index range [0,numItems) into
+// contiguous subranges, one per thread, and calls function(t, imin, imax)
+// for subrange t, which is [imin,imax).  The last thread receives the
+// remainder when numItems is not a multiple of numThreads.  The threads are
+// launched on entry and joined before the function returns.  When
+// numThreads <= 1 or numItems < numThreads, the function is called once in
+// the calling thread with t = 0 and the full range.  For example,
+//
+//   std::vector<float> values(n);
+//   gte::ParallelFor(numThreads, n, [&values](unsigned int, int imin, int imax)
+//   {
+//       for (int i = imin; i < imax; ++i)
+//       {
+//           values[i] = std::sqrt(static_cast<float>(i));
+//       }
+//   });
+//
+// The thread index t allows the callers to maintain per-thread workspace or
+// per-thread partial results that are reduced after the call.
+
+namespace gte
+{
+
+template <typename Function>
+void ParallelFor(unsigned int numThreads, int numItems, Function const& function)
+{
+    int const iNumThreads = static_cast<int>(numThreads);
+    if (iNumThreads > 1 && numItems >= iNumThreads)
+    {
+        // Partition the data for multiple threads.
+        int const numItemsPerThread = numItems / iNumThreads;
+        std::vector<std::thread> process(iNumThreads);
+        for (int t = 0; t < iNumThreads; ++t)
+        {
+            int imin = t * numItemsPerThread;
+            int imax = (t + 1 < iNumThreads ? imin + numItemsPerThread : numItems);
+            process[t] = std::thread([t, imin, imax, &function]()
+            {
+                function(static_cast<unsigned int>(t), imin, imax);
+            });
+        }
+
+        // Wait for all threads to finish.
+        for (int t = 0; t < iNumThreads; ++t)
+        {
+            process[t].join();
+        }
+    }
+    else if (numItems > 0)
+    {
+        function(0u, 0, numItems);
+    }
+}
+
+}
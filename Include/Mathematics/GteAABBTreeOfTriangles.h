@@ -0,0 +1,941 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/10)
+
+#pragma once
+
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteDistPointTriangle.h>
+#include <Mathematics/GteIntrRay3Triangle3.h>
+#include <Mathematics/GteIntrTriangle3OrientedBox3.h>
+#include <Mathematics/GteAlignedBox.h>
+#include <Mathematics/GteHypersphere.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+// A bounding volume hierarchy of axis-aligned boxes for an indexed triangle
+// mesh.  The tree is built top-down using the surface area heuristic (SAH)
+// with binned split candidates, as described in "On fast Construction of
+// SAH-based Bounding Volume Hierarchies" by I. Wald, IEEE Symposium on
+// Interactive Ray Tracing, 2007.  The nodes are stored in depth-first
+// order, so the left child of an interior node immediately follows the
+// node in the array.  For 'float' a node occupies 32 bytes.  The triangles
+// are copied into an array ordered by leaf, which improves the locality of
+// the queries.
+//
+// The queries are const member functions that do not modify the tree, so
+// they may be called concurrently from multiple threads.  The batch
+// versions partition the queries among the threads specified in the
+// constructor.  The query results are the Result types of the
+// corresponding single-primitive queries, DCPQuery for point-triangle
+// distance and FIQuery for ray-triangle intersection.  The triangle
+// indices returned by the queries are those of the input index array,
+// triangle t having vertices indices[3*t], indices[3*t+1] and
+// indices[3*t+2].
+
+namespace gte
+{
+
+template <typename Real>
+class AABBTreeOfTriangles
+{
+public:
+    // For an interior node, 'count' is 0 and 'offset' is the index of the
+    // right child; the left child is the next node in the array.  For a
+    // leaf node, 'count' is the number of triangles and 'offset' is the
+    // index of the first of them in the leaf-ordered triangle array.
+    struct Node
+    {
+        AlignedBox3<Real> box;
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    typedef DCPQuery<Real, Vector3<Real>, Triangle3<Real>> PTQuery;
+    typedef FIQuery<Real, Ray3<Real>, Triangle3<Real>> RTQuery;
+
+    // Construction.  The mesh has 'numTriangles' triangles whose vertex
+    // indices are stored in 'indices' (3 per triangle).  The caller is
+    // responsible for ensuring the indices are valid for the 'vertices'
+    // array.  A leaf is created when the SAH cost of splitting exceeds the
+    // cost of the leaf and the number of triangles is at most
+    // 'maxLeafTriangles'.  The tree is built and the batch queries are
+    // processed with the specified number of threads, subject to
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    AABBTreeOfTriangles(int numVertices, Vector3<Real> const* vertices,
+        int numTriangles, int const* indices, int maxLeafTriangles = 4,
+        unsigned int numThreads = 1);
+
+    // Member access.
+    inline int GetNumTriangles() const;
+    inline std::vector<Node> const& GetNodes() const;
+    inline std::vector<Triangle3<Real>> const& GetTriangles() const;
+    inline std::vector<int> const& GetPartition() const;
+    inline uint32_t GetHeight() const;
+
+    // Compute the triangle closest to 'point'.  The return value is the
+    // index of the triangle, or -1 when the mesh is empty or the closest
+    // triangle is farther than 'maxDistance'.  The 'result' is valid only
+    // when the return value is not -1.
+    int GetClosest(Vector3<Real> const& point, typename PTQuery::Result& result,
+        Real maxDistance = std::numeric_limits<Real>::max()) const;
+
+    // Compute the first triangle hit by the ray with ray parameter
+    // t <= tMax.  The return value is the index of the triangle, or -1 when
+    // there is no such triangle.  The 'result' is valid only when the
+    // return value is not -1.
+    int GetFirstHit(Ray3<Real> const& ray, typename RTQuery::Result& result,
+        Real tMax = std::numeric_limits<Real>::max()) const;
+
+    // Determine whether the ray hits any triangle with ray parameter
+    // t <= tMax, which is faster than GetFirstHit because the search stops
+    // at the first intersection found.  The return value is the index of
+    // a triangle that is hit, or -1 when there is no such triangle.
+    int GetAnyHit(Ray3<Real> const& ray, typename RTQuery::Result& result,
+        Real tMax = std::numeric_limits<Real>::max()) const;
+
+    // Compute the indices of the triangles that intersect the sphere or
+    // the box.  The output is cleared before the search, so it may be
+    // reused across calls to avoid memory allocations.
+    void GetOverlapping(Sphere3<Real> const& sphere, std::vector<int>& triangles) const;
+    void GetOverlapping(AlignedBox3<Real> const& box, std::vector<int>& triangles) const;
+
+    // Batch versions of the queries.  The output arrays have 'numQueries'
+    // elements.
+    void GetClosest(int numQueries, Vector3<Real> const* points,
+        int* triangles, typename PTQuery::Result* results,
+        Real maxDistance = std::numeric_limits<Real>::max()) const;
+
+    void GetFirstHit(int numQueries, Ray3<Real> const* rays,
+        int* triangles, typename RTQuery::Result* results,
+        Real tMax = std::numeric_limits<Real>::max()) const;
+
+    void GetAnyHit(int numQueries, Ray3<Real> const* rays,
+        int* triangles, typename RTQuery::Result* results,
+        Real tMax = std::numeric_limits<Real>::max()) const;
+
+private:
+    // Parameters for the SAH build.  The costs are relative to that of a
+    // triangle query.  Beyond the maximum SAH depth, the triangles are split
+    // at the median, which bounds the height of the tree.  The traversal
+    // stacks have a fixed size that is larger than the bound.
+    enum
+    {
+        NUM_BINS = 16,
+        MAX_SAH_DEPTH = 56,
+        MAX_STACK = 96,
+        MIN_PARALLEL_BINNING = 16384,
+        MIN_PARALLEL_SUBTREE = 4096
+    };
+
+    struct Bin
+    {
+        Bin();
+        void Include(AlignedBox3<Real> const& box);
+
+        AlignedBox3<Real> box;
+        int count;
+    };
+
+    typedef std::array<Bin, NUM_BINS> BinArray;
+
+    // Build the subtree for the triangles mPartition[i0] through
+    // mPartition[i1-1], appending the nodes to 'nodes'.  The child indices
+    // are relative to the start of 'nodes'.  The triangles are partitioned
+    // in place.  The function returns the height of the subtree.
+    uint32_t BuildSubtree(int i0, int i1, uint32_t depth,
+        unsigned int numThreads, std::vector<Node>& nodes);
+
+    void ComputeBounds(int i0, int i1, unsigned int numThreads,
+        AlignedBox3<Real>& box, AlignedBox3<Real>& centroidBox) const;
+
+    void ComputeBins(int i0, int i1, int axis, Real cmin, Real scale,
+        unsigned int numThreads, BinArray& bins) const;
+
+    inline int GetBinIndex(int t, int axis, Real cmin, Real scale) const;
+
+    static void Include(AlignedBox3<Real> const& box, AlignedBox3<Real>& total);
+    static Real GetHalfArea(AlignedBox3<Real> const& box);
+    static Real GetSqrDistance(Vector3<Real> const& point, AlignedBox3<Real> const& box);
+    static bool Overlaps(AlignedBox3<Real> const& box0, AlignedBox3<Real> const& box1);
+
+    // The parametric interval of the ray-box intersection, clipped to
+    // [0,tMax].  The return value is 'false' when the interval is empty.
+    static bool Clip(Vector3<Real> const& origin, Vector3<Real> const& direction,
+        Vector3<Real> const& invDirection, AlignedBox3<Real> const& box,
+        Real tMax, Real& tEnter);
+
+    int GetHit(Ray3<Real> const& ray, typename RTQuery::Result& result,
+        Real tMax, bool anyHit) const;
+
+    unsigned int mNumThreads;
+    int mMaxLeafTriangles;
+    uint32_t mHeight;
+    std::vector<Node> mNodes;
+    std::vector<Triangle3<Real>> mTriangles;
+    std::vector<int> mPartition;
+
+    // Build-time data, indexed by triangle; released after construction.
+    std::vector<AlignedBox3<Real>> mBoxes;
+    std::vector<Vector3<Real>> mCentroids;
+};
+
+
+template <typename Real>
+AABBTreeOfTriangles<Real>::Bin::Bin()
+    :
+    box(Vector3<Real>{ std::numeric_limits<Real>::max(),
+        std::numeric_limits<Real>::max(), std::numeric_limits<Real>::max() },
+        Vector3<Real>{ -std::numeric_limits<Real>::max(),
+        -std::numeric_limits<Real>::max(), -std::numeric_limits<Real>::max() }),
+    count(0)
+{
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::Bin::Include(AlignedBox3<Real> const& inBox)
+{
+    AABBTreeOfTriangles<Real>::Include(inBox, box);
+    ++count;
+}
+
+template <typename Real>
+AABBTreeOfTriangles<Real>::AABBTreeOfTriangles(int numVertices,
+    Vector3<Real> const* vertices, int numTriangles, int const* indices,
+    int maxLeafTriangles, unsigned int numThreads)
+    :
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mMaxLeafTriangles(std::max(maxLeafTriangles, 1)),
+    mHeight(0)
+{
+    if (numVertices <= 0 || !vertices || numTriangles <= 0 || !indices)
+    {
+        LogError("Invalid input.");
+        return;
+    }
+
+    // Compute the bounding box and centroid of each triangle.
+    mBoxes.resize(numTriangles);
+    mCentroids.resize(numTriangles);
+    mPartition.resize(numTriangles);
+    ParallelFor(mNumThreads, numTriangles, [this, vertices, indices](
+        unsigned int, int tmin, int tmax)
+    {
+        for (int t = tmin; t < tmax; ++t)
+        {
+            Vector3<Real> const& v0 = vertices[indices[3 * t]];
+            Vector3<Real> const& v1 = vertices[indices[3 * t + 1]];
+            Vector3<Real> const& v2 = vertices[indices[3 * t + 2]];
+            AlignedBox3<Real>& box = mBoxes[t];
+            for (int i = 0; i < 3; ++i)
+            {
+                box.min[i] = std::min(std::min(v0[i], v1[i]), v2[i]);
+                box.max[i] = std::max(std::max(v0[i], v1[i]), v2[i]);
+            }
+            mCentroids[t] = (box.min + box.max) * (Real)0.5;
+            mPartition[t] = t;
+        }
+    });
+
+    // The maximum number of nodes is 2*numTriangles-1, reached when every
+    // leaf has one triangle.
+    mNodes.reserve(2 * numTriangles - 1);
+    mHeight = BuildSubtree(0, numTriangles, 0, mNumThreads, mNodes);
+
+    // Copy the triangles in leaf order.
+    mTriangles.resize(numTriangles);
+    ParallelFor(mNumThreads, numTriangles, [this, vertices, indices](
+        unsigned int, int imin, int imax)
+    {
+        for (int i = imin; i < imax; ++i)
+        {
+            int t = mPartition[i];
+            for (int j = 0; j < 3; ++j)
+            {
+                mTriangles[i].v[j] = vertices[indices[3 * t + j]];
+            }
+        }
+    });
+
+    mBoxes = std::vector<AlignedBox3<Real>>();
+    mCentroids = std::vector<Vector3<Real>>();
+}
+
+template <typename Real>
+inline int AABBTreeOfTriangles<Real>::GetNumTriangles() const
+{
+    return static_cast<int>(mTriangles.size());
+}
+
+template <typename Real>
+inline std::vector<typename AABBTreeOfTriangles<Real>::Node> const&
+AABBTreeOfTriangles<Real>::GetNodes() const
+{
+    return mNodes;
+}
+
+template <typename Real>
+inline std::vector<Triangle3<Real>> const&
+AABBTreeOfTriangles<Real>::GetTriangles() const
+{
+    return mTriangles;
+}
+
+template <typename Real>
+inline std::vector<int> const& AABBTreeOfTriangles<Real>::GetPartition() const
+{
+    return mPartition;
+}
+
+template <typename Real>
+inline uint32_t AABBTreeOfTriangles<Real>::GetHeight() const
+{
+    return mHeight;
+}
+
+template <typename Real>
+uint32_t AABBTreeOfTriangles<Real>::BuildSubtree(int i0, int i1,
+    uint32_t depth, unsigned int numThreads, std::vector<Node>& nodes)
+{
+    int const numTriangles = i1 - i0;
+    uint32_t const nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back(Node());
+
+    AlignedBox3<Real> box, centroidBox;
+    ComputeBounds(i0, i1, numThreads, box, centroidBox);
+    nodes[nodeIndex].box = box;
+
+    // Create a leaf when there is a single triangle.
+    if (numTriangles == 1)
+    {
+        nodes[nodeIndex].offset = static_cast<uint32_t>(i0);
+        nodes[nodeIndex].count = 1;
+        return 0;
+    }
+
+    // The split axis is the one of maximum centroid extent.
+    Vector3<Real> extent = centroidBox.max - centroidBox.min;
+    int axis = 0;
+    if (extent[1] > extent[axis])
+    {
+        axis = 1;
+    }
+    if (extent[2] > extent[axis])
+    {
+        axis = 2;
+    }
+
+    int imid = -1;
+    if (extent[axis] > (Real)0 && depth < MAX_SAH_DEPTH)
+    {
+        // Bin the centroids and evaluate the SAH cost of the splits
+        // between consecutive bins.  The cost of a split is
+        //   1 + (area(L)*count(L) + area(R)*count(R))/area(node)
+        // and the cost of a leaf is count(node).
+        Real const cmin = centroidBox.min[axis];
+        Real const scale = (Real)NUM_BINS / extent[axis];
+        BinArray bins;
+        ComputeBins(i0, i1, axis, cmin, scale, numThreads, bins);
+
+        std::array<Real, NUM_BINS> rightCost;
+        Bin accumulate;
+        for (int b = NUM_BINS - 1; b > 0; --b)
+        {
+            if (bins[b].count > 0)
+            {
+                Include(bins[b].box, accumulate.box);
+                accumulate.count += bins[b].count;
+            }
+            rightCost[b] = (accumulate.count > 0 ?
+                GetHalfArea(accumulate.box) * (Real)accumulate.count : (Real)0);
+        }
+
+        Real const invArea = (Real)1 / std::max(GetHalfArea(box),
+            std::numeric_limits<Real>::min());
+        Real minCost = std::numeric_limits<Real>::max();
+        int minSplit = -1;
+        accumulate = Bin();
+        for (int b = 0; b < NUM_BINS - 1; ++b)
+        {
+            if (bins[b].count > 0)
+            {
+                Include(bins[b].box, accumulate.box);
+                accumulate.count += bins[b].count;
+            }
+            if (accumulate.count > 0 && accumulate.count < numTriangles)
+            {
+                Real cost = (Real)1 + invArea * (GetHalfArea(accumulate.box) *
+                    (Real)accumulate.count + rightCost[b + 1]);
+                if (cost < minCost)
+                {
+                    minCost = cost;
+                    minSplit = b;
+                }
+            }
+        }
+
+        if (numTriangles <= mMaxLeafTriangles && minCost >= (Real)numTriangles)
+        {
+            nodes[nodeIndex].offset = static_cast<uint32_t>(i0);
+            nodes[nodeIndex].count = static_cast<uint32_t>(numTriangles);
+            return 0;
+        }
+
+        if (minSplit >= 0)
+        {
+            auto middle = std::partition(mPartition.begin() + i0,
+                mPartition.begin() + i1, [this, axis, cmin, scale, minSplit](int t)
+                {
+                    return GetBinIndex(t, axis, cmin, scale) <= minSplit;
+                });
+            imid = static_cast<int>(middle - mPartition.begin());
+        }
+    }
+
+    if (imid < 0)
+    {
+        // The centroids are coincident along the axis or the SAH depth is
+        // exceeded.  Create a leaf if possible; otherwise, split at the
+        // median of the centroids.
+        if (numTriangles <= mMaxLeafTriangles)
+        {
+            nodes[nodeIndex].offset = static_cast<uint32_t>(i0);
+            nodes[nodeIndex].count = static_cast<uint32_t>(numTriangles);
+            return 0;
+        }
+
+        imid = i0 + numTriangles / 2;
+        std::nth_element(mPartition.begin() + i0, mPartition.begin() + imid,
+            mPartition.begin() + i1, [this, axis](int t0, int t1)
+            {
+                return mCentroids[t0][axis] < mCentroids[t1][axis];
+            });
+    }
+
+    // Build the children.  When threads are available for a large subtree,
+    // the right child is built in a separate thread into its own node
+    // array, which is appended after the left subtree.
+    nodes[nodeIndex].count = 0;
+    uint32_t leftHeight, rightHeight;
+    if (numThreads > 1 && numTriangles >= MIN_PARALLEL_SUBTREE)
+    {
+        unsigned int const numLeftThreads = numThreads / 2;
+        unsigned int const numRightThreads = numThreads - numLeftThreads;
+        std::vector<Node> rightNodes;
+        rightNodes.reserve(2 * (i1 - imid) - 1);
+        std::thread rightThread([this, imid, i1, depth, numRightThreads,
+            &rightNodes, &rightHeight]()
+        {
+            rightHeight = BuildSubtree(imid, i1, depth + 1, numRightThreads,
+                rightNodes);
+        });
+        leftHeight = BuildSubtree(i0, imid, depth + 1, numLeftThreads, nodes);
+        rightThread.join();
+
+        uint32_t const rightIndex = static_cast<uint32_t>(nodes.size());
+        for (auto& node : rightNodes)
+        {
+            if (node.count == 0)
+            {
+                node.offset += rightIndex;
+            }
+        }
+        nodes.insert(nodes.end(), rightNodes.begin(), rightNodes.end());
+        nodes[nodeIndex].offset = rightIndex;
+    }
+    else
+    {
+        leftHeight = BuildSubtree(i0, imid, depth + 1, numThreads, nodes);
+        nodes[nodeIndex].offset = static_cast<uint32_t>(nodes.size());
+        rightHeight = BuildSubtree(imid, i1, depth + 1, numThreads, nodes);
+    }
+    return 1 + std::max(leftHeight, rightHeight);
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::ComputeBounds(int i0, int i1,
+    unsigned int numThreads, AlignedBox3<Real>& box,
+    AlignedBox3<Real>& centroidBox) const
+{
+    int const numTriangles = i1 - i0;
+    if (numThreads <= 1 || numTriangles < MIN_PARALLEL_BINNING)
+    {
+        numThreads = 1;
+    }
+
+    std::vector<Bin> boxes(numThreads), centroidBoxes(numThreads);
+    ParallelFor(numThreads, numTriangles, [this, i0, &boxes, &centroidBoxes](
+        unsigned int t, int imin, int imax)
+    {
+        Bin& tBox = boxes[t];
+        Bin& tCentroidBox = centroidBoxes[t];
+        for (int i = i0 + imin; i < i0 + imax; ++i)
+        {
+            int triangle = mPartition[i];
+            Include(mBoxes[triangle], tBox.box);
+            Include(AlignedBox3<Real>(mCentroids[triangle], mCentroids[triangle]),
+                tCentroidBox.box);
+        }
+    });
+
+    box = boxes[0].box;
+    centroidBox = centroidBoxes[0].box;
+    for (unsigned int t = 1; t < numThreads; ++t)
+    {
+        Include(boxes[t].box, box);
+        Include(centroidBoxes[t].box, centroidBox);
+    }
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::ComputeBins(int i0, int i1, int axis,
+    Real cmin, Real scale, unsigned int numThreads, BinArray& bins) const
+{
+    int const numTriangles = i1 - i0;
+    if (numThreads <= 1 || numTriangles < MIN_PARALLEL_BINNING)
+    {
+        numThreads = 1;
+    }
+
+    std::vector<BinArray> partial(numThreads);
+    ParallelFor(numThreads, numTriangles, [this, i0, axis, cmin, scale,
+        &partial](unsigned int t, int imin, int imax)
+    {
+        BinArray& tBins = partial[t];
+        for (int i = i0 + imin; i < i0 + imax; ++i)
+        {
+            int triangle = mPartition[i];
+            tBins[GetBinIndex(triangle, axis, cmin, scale)].Include(mBoxes[triangle]);
+        }
+    });
+
+    bins = partial[0];
+    for (unsigned int t = 1; t < numThreads; ++t)
+    {
+        for (int b = 0; b < NUM_BINS; ++b)
+        {
+            if (partial[t][b].count > 0)
+            {
+                Include(partial[t][b].box, bins[b].box);
+                bins[b].count += partial[t][b].count;
+            }
+        }
+    }
+}
+
+template <typename Real>
+inline int AABBTreeOfTriangles<Real>::GetBinIndex(int t, int axis, Real cmin,
+    Real scale) const
+{
+    int b = static_cast<int>((mCentroids[t][axis] - cmin) * scale);
+    return std::min(std::max(b, 0), static_cast<int>(NUM_BINS) - 1);
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::Include(AlignedBox3<Real> const& box,
+    AlignedBox3<Real>& total)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        total.min[i] = std::min(total.min[i], box.min[i]);
+        total.max[i] = std::max(total.max[i], box.max[i]);
+    }
+}
+
+template <typename Real>
+Real AABBTreeOfTriangles<Real>::GetHalfArea(AlignedBox3<Real> const& box)
+{
+    Vector3<Real> d = box.max - box.min;
+    return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+}
+
+template <typename Real>
+Real AABBTreeOfTriangles<Real>::GetSqrDistance(Vector3<Real> const& point,
+    AlignedBox3<Real> const& box)
+{
+    Real sqrDistance = (Real)0;
+    for (int i = 0; i < 3; ++i)
+    {
+        Real delta = std::max(box.min[i] - point[i], (Real)0) +
+            std::max(point[i] - box.max[i], (Real)0);
+        sqrDistance += delta * delta;
+    }
+    return sqrDistance;
+}
+
+template <typename Real>
+bool AABBTreeOfTriangles<Real>::Overlaps(AlignedBox3<Real> const& box0,
+    AlignedBox3<Real> const& box1)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        if (box0.max[i] < box1.min[i] || box0.min[i] > box1.max[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename Real>
+bool AABBTreeOfTriangles<Real>::Clip(Vector3<Real> const& origin,
+    Vector3<Real> const& direction, Vector3<Real> const& invDirection,
+    AlignedBox3<Real> const& box, Real tMax, Real& tEnter)
+{
+    Real t0 = (Real)0, t1 = tMax;
+    for (int i = 0; i < 3; ++i)
+    {
+        if (direction[i] != (Real)0)
+        {
+            Real tNear = (box.min[i] - origin[i]) * invDirection[i];
+            Real tFar = (box.max[i] - origin[i]) * invDirection[i];
+            if (tNear > tFar)
+            {
+                std::swap(tNear, tFar);
+            }
+            t0 = std::max(t0, tNear);
+            t1 = std::min(t1, tFar);
+            if (t0 > t1)
+            {
+                return false;
+            }
+        }
+        else if (origin[i] < box.min[i] || origin[i] > box.max[i])
+        {
+            return false;
+        }
+    }
+    tEnter = t0;
+    return true;
+}
+
+template <typename Real>
+int AABBTreeOfTriangles<Real>::GetClosest(Vector3<Real> const& point,
+    typename PTQuery::Result& result, Real maxDistance) const
+{
+    if (mNodes.size() == 0)
+    {
+        return -1;
+    }
+
+    PTQuery query;
+    Real minSqrDistance = (maxDistance < std::numeric_limits<Real>::max() ?
+        maxDistance * maxDistance : std::numeric_limits<Real>::max());
+    int closest = -1;
+
+    // The stack stores the nodes to visit and the squared distances from
+    // the point to their boxes.  The nearer child is visited first.
+    std::array<uint32_t, MAX_STACK> stack;
+    std::array<Real, MAX_STACK> stackSqrDistance;
+    int top = 0;
+    stack[0] = 0;
+    stackSqrDistance[0] = GetSqrDistance(point, mNodes[0].box);
+    while (top >= 0)
+    {
+        uint32_t nodeIndex = stack[top];
+        Real sqrDistance = stackSqrDistance[top];
+        --top;
+        if (sqrDistance > minSqrDistance)
+        {
+            continue;
+        }
+
+        Node const& node = mNodes[nodeIndex];
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+            {
+                auto candidate = query(point, mTriangles[i]);
+                if (candidate.sqrDistance <= minSqrDistance)
+                {
+                    minSqrDistance = candidate.sqrDistance;
+                    closest = mPartition[i];
+                    result = candidate;
+                }
+            }
+        }
+        else
+        {
+            uint32_t child0 = nodeIndex + 1, child1 = node.offset;
+            Real sqrDistance0 = GetSqrDistance(point, mNodes[child0].box);
+            Real sqrDistance1 = GetSqrDistance(point, mNodes[child1].box);
+            if (sqrDistance0 > sqrDistance1)
+            {
+                std::swap(child0, child1);
+                std::swap(sqrDistance0, sqrDistance1);
+            }
+            if (sqrDistance1 <= minSqrDistance)
+            {
+                ++top;
+                stack[top] = child1;
+                stackSqrDistance[top] = sqrDistance1;
+            }
+            if (sqrDistance0 <= minSqrDistance)
+            {
+                ++top;
+                stack[top] = child0;
+                stackSqrDistance[top] = sqrDistance0;
+            }
+        }
+    }
+    return closest;
+}
+
+template <typename Real>
+int AABBTreeOfTriangles<Real>::GetFirstHit(Ray3<Real> const& ray,
+    typename RTQuery::Result& result, Real tMax) const
+{
+    return GetHit(ray, result, tMax, false);
+}
+
+template <typename Real>
+int AABBTreeOfTriangles<Real>::GetAnyHit(Ray3<Real> const& ray,
+    typename RTQuery::Result& result, Real tMax) const
+{
+    return GetHit(ray, result, tMax, true);
+}
+
+template <typename Real>
+int AABBTreeOfTriangles<Real>::GetHit(Ray3<Real> const& ray,
+    typename RTQuery::Result& result, Real tMax, bool anyHit) const
+{
+    if (mNodes.size() == 0)
+    {
+        return -1;
+    }
+
+    Vector3<Real> invDirection;
+    for (int i = 0; i < 3; ++i)
+    {
+        invDirection[i] = (ray.direction[i] != (Real)0 ?
+            (Real)1 / ray.direction[i] : (Real)0);
+    }
+
+    RTQuery query;
+    int hit = -1;
+    Real tEnter;
+    std::array<uint32_t, MAX_STACK> stack;
+    std::array<Real, MAX_STACK> stackEnter;
+    int top = -1;
+    if (Clip(ray.origin, ray.direction, invDirection, mNodes[0].box, tMax, tEnter))
+    {
+        top = 0;
+        stack[0] = 0;
+        stackEnter[0] = tEnter;
+    }
+
+    while (top >= 0)
+    {
+        uint32_t nodeIndex = stack[top];
+        tEnter = stackEnter[top];
+        --top;
+        if (tEnter > tMax)
+        {
+            continue;
+        }
+
+        Node const& node = mNodes[nodeIndex];
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+            {
+                auto candidate = query(ray, mTriangles[i]);
+                if (candidate.intersect && candidate.parameter <= tMax)
+                {
+                    tMax = candidate.parameter;
+                    hit = mPartition[i];
+                    result = candidate;
+                    if (anyHit)
+                    {
+                        return hit;
+                    }
+                }
+            }
+        }
+        else
+        {
+            uint32_t child0 = nodeIndex + 1, child1 = node.offset;
+            Real tEnter0, tEnter1;
+            bool clip0 = Clip(ray.origin, ray.direction, invDirection,
+                mNodes[child0].box, tMax, tEnter0);
+            bool clip1 = Clip(ray.origin, ray.direction, invDirection,
+                mNodes[child1].box, tMax, tEnter1);
+            if (clip0 && clip1 && tEnter0 > tEnter1)
+            {
+                std::swap(child0, child1);
+                std::swap(tEnter0, tEnter1);
+            }
+            else if (!clip0)
+            {
+                child0 = child1;
+                tEnter0 = tEnter1;
+                clip0 = clip1;
+                clip1 = false;
+            }
+
+            // Push the farther child first so that the nearer child is
+            // visited first.
+            if (clip1)
+            {
+                ++top;
+                stack[top] = child1;
+                stackEnter[top] = tEnter1;
+            }
+            if (clip0)
+            {
+                ++top;
+                stack[top] = child0;
+                stackEnter[top] = tEnter0;
+            }
+        }
+    }
+    return hit;
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::GetOverlapping(Sphere3<Real> const& sphere,
+    std::vector<int>& triangles) const
+{
+    triangles.clear();
+    if (mNodes.size() == 0)
+    {
+        return;
+    }
+
+    PTQuery query;
+    Real const sqrRadius = sphere.radius * sphere.radius;
+    std::array<uint32_t, MAX_STACK> stack;
+    int top = 0;
+    stack[0] = 0;
+    while (top >= 0)
+    {
+        uint32_t nodeIndex = stack[top--];
+        Node const& node = mNodes[nodeIndex];
+        if (GetSqrDistance(sphere.center, node.box) > sqrRadius)
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+            {
+                if (query(sphere.center, mTriangles[i]).sqrDistance <= sqrRadius)
+                {
+                    triangles.push_back(mPartition[i]);
+                }
+            }
+        }
+        else
+        {
+            stack[++top] = node.offset;
+            stack[++top] = nodeIndex + 1;
+        }
+    }
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::GetOverlapping(AlignedBox3<Real> const& box,
+    std::vector<int>& triangles) const
+{
+    triangles.clear();
+    if (mNodes.size() == 0)
+    {
+        return;
+    }
+
+    // The triangle-box test is the separating axis test for oriented boxes
+    // applied to the box with the standard coordinate axes.
+    TIQuery<Real, Triangle3<Real>, OrientedBox3<Real>> query;
+    OrientedBox3<Real> obox;
+    obox.center = (box.max + box.min) * (Real)0.5;
+    obox.extent = (box.max - box.min) * (Real)0.5;
+    for (int i = 0; i < 3; ++i)
+    {
+        obox.axis[i] = Vector3<Real>::Unit(i);
+    }
+
+    std::array<uint32_t, MAX_STACK> stack;
+    int top = 0;
+    stack[0] = 0;
+    while (top >= 0)
+    {
+        uint32_t nodeIndex = stack[top--];
+        Node const& node = mNodes[nodeIndex];
+        if (!Overlaps(box, node.box))
+        {
+            continue;
+        }
+
+        if (node.count > 0)
+        {
+            for (uint32_t i = node.offset; i < node.offset + node.count; ++i)
+            {
+                if (query(mTriangles[i], obox).intersect)
+                {
+                    triangles.push_back(mPartition[i]);
+                }
+            }
+        }
+        else
+        {
+            stack[++top] = node.offset;
+            stack[++top] = nodeIndex + 1;
+        }
+    }
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::GetClosest(int numQueries,
+    Vector3<Real> const* points, int* triangles,
+    typename PTQuery::Result* results, Real maxDistance) const
+{
+    ParallelFor(mNumThreads, numQueries, [this, points, triangles, results,
+        maxDistance](unsigned int, int qmin, int qmax)
+    {
+        for (int q = qmin; q < qmax; ++q)
+        {
+            triangles[q] = GetClosest(points[q], results[q], maxDistance);
+        }
+    });
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::GetFirstHit(int numQueries,
+    Ray3<Real> const* rays, int* triangles, typename RTQuery::Result* results,
+    Real tMax) const
+{
+    ParallelFor(mNumThreads, numQueries, [this, rays, triangles, results,
+        tMax](unsigned int, int qmin, int qmax)
+    {
+        for (int q = qmin; q < qmax; ++q)
+        {
+            triangles[q] = GetHit(rays[q], results[q], tMax, false);
+        }
+    });
+}
+
+template <typename Real>
+void AABBTreeOfTriangles<Real>::GetAnyHit(int numQueries,
+    Ray3<Real> const* rays, int* triangles, typename RTQuery::Result* results,
+    Real tMax) const
+{
+    ParallelFor(mNumThreads, numQueries, [this, rays, triangles, results,
+        tMax](unsigned int, int qmin, int qmax)
+    {
+        for (int q = qmin; q < qmax; ++q)
+        {
+            triangles[q] = GetHit(rays[q], results[q], tMax, true);
+        }
+    });
+}
+
+}
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/09)
 
 #pragma once
 
@@ -33,7 +33,7 @@ template <typename Real>
 template <int D>
 inline Real ASinEstimate<Real>::Degree(Real x)
 {
-    return (Real)GTE_C_HALF_PI - ACosEstimate<Real>::Degree<D>(x);
+    return (Real)GTE_C_HALF_PI - ACosEstimate<Real>::template Degree<D>(x);
 }
 
 
@@ -114,6 +114,18 @@ namespace gte
             return error;
         }
 
+        // The squared distance (S-P)^T*(N*N^T)*(S-P) from S to the plane.
+        // Error(S) is the squared distance from S to the line through P
+        // with direction N, which does not measure how well S fits the
+        // plane.  To classify inliers by the distance to the plane in
+        // RANSAC, derive a class that overrides Error(...) to return
+        // SquaredDistance(...).
+        Real SquaredDistance(Vector3<Real> const& point) const
+        {
+            Real dot = Dot(point - mParameters.first, mParameters.second);
+            return dot * dot;
+        }
+
         virtual void CopyParameters(ApprQuery<Real, Vector3<Real>> const* input) override
         {
             auto source = dynamic_cast<ApprOrthogonalPlane3<Real> const*>(input);
@@ -3,14 +3,18 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.2 (2019/08/08)
+// File Version: 3.0.3 (2019/09/05)
 
 #pragma once
 
 #include <GTEngineDEF.h>
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
 #include <numeric>
 #include <random>
+#include <thread>
 #include <vector>
 
 // Base class support for least-squares fitting algorithms and for RANSAC
@@ -131,6 +135,20 @@ namespace gte
         // current model parameters.
         virtual Real Error(ObservationType const& observation) const = 0;
 
+        // Compute the model errors for the indexed observations
+        // errors[i] = Error(observations[indices[i]]) for 0 <= i < numIndices.
+        // The parallel RANSAC scores candidate models with blocks of
+        // observations, so derived classes may override this function to
+        // vectorize the error computations.
+        virtual void Errors(ObservationType const* observations,
+            size_t numIndices, int const* indices, Real* errors) const
+        {
+            for (size_t i = 0; i < numIndices; ++i)
+            {
+                errors[i] = Error(observations[indices[i]]);
+            }
+        }
+
         // Copy the parameters between two models. This is used to copy the
         // candidate-model parameters to the current best-fit model.
         virtual void CopyParameters(ApprQuery const* input) = 0;
@@ -212,5 +230,252 @@ namespace gte
 
             return bestNumFittedObservations >= numRequiredForGoodFit;
         }
+
+        // A multithreaded RANSAC with an adaptive number of iterations and
+        // preemptive scoring of the candidate models.  The number of threads
+        // is candidateModels.size(); each thread fits and scores its own
+        // candidate model, so the objects must be distinct and of the same
+        // derived type as bestModel.
+        //
+        // Each thread has its own random number generator whose seed is
+        // 'seed' plus the thread index.  The minimal samples are drawn by a
+        // partial Fisher-Yates shuffle, so a sample costs O(m) rather than
+        // O(n) for m = GetMinimumRequired() and n observations.
+        //
+        // The number of iterations starts at 'maxIterations'.  When a better
+        // consensus set of size c is found, the iteration count is reduced to
+        // log(1 - confidence) / log(1 - (c/n)^m), which is the number of
+        // samples for which at least one sample consists only of inliers
+        // with probability 'confidence'.  Set 'confidence' to 1 to disable
+        // the adaptive count.
+        //
+        // When 'numPreemptive' is positive, each candidate model is first
+        // scored on a random subset of that many observations.  The full
+        // scoring is performed only when the inlier fraction on the subset is
+        // at least that of the best consensus set found so far.  Set
+        // 'numPreemptive' to 0 to score every candidate against all the
+        // observations.
+        //
+        // The best model and consensus set are shared by the threads.  The
+        // size of the best consensus set is atomic for the lock-free tests;
+        // a mutex guards the updates of bestModel and bestConsensus.  The
+        // result can depend on the thread scheduling when more than one
+        // thread is used.
+        static bool RANSAC(std::vector<ApprQuery*> const& candidateModels,
+            std::vector<ObservationType> const& observations,
+            size_t numRequiredForGoodFit, Real maxErrorForGoodFit,
+            size_t maxIterations, Real confidence, size_t numPreemptive,
+            unsigned int seed, std::vector<int>& bestConsensus,
+            ApprQuery& bestModel)
+        {
+            if (candidateModels.size() == 0)
+            {
+                return false;
+            }
+
+            size_t const numObservations = observations.size();
+            size_t const minRequired = candidateModels[0]->GetMinimumRequired();
+            if (numObservations < minRequired)
+            {
+                // Too few observations for model fitting.
+                return false;
+            }
+
+            if (numObservations == minRequired)
+            {
+                // We have the minimum number of observations to generate the
+                // model, so RANSAC cannot be used. Compute the model with the
+                // entire set of observations.
+                bestConsensus.resize(numObservations);
+                std::iota(bestConsensus.begin(), bestConsensus.end(), 0);
+                return bestModel.Fit(observations);
+            }
+
+            // The random subset used for preemptive scoring is shared by the
+            // threads so that all candidates are compared on the same data.
+            std::vector<int> preemptive;
+            if (numPreemptive > 0 && numPreemptive < numObservations)
+            {
+                preemptive.resize(numObservations);
+                std::iota(preemptive.begin(), preemptive.end(), 0);
+                std::mt19937 rng(seed);
+                for (size_t j = 0; j < numPreemptive; ++j)
+                {
+                    std::uniform_int_distribution<size_t> rnd(j, numObservations - 1);
+                    std::swap(preemptive[j], preemptive[rnd(rng)]);
+                }
+                preemptive.resize(numPreemptive);
+            }
+
+            RANSACShared shared;
+            shared.nextIteration = 0;
+            shared.numIterations = maxIterations;
+            shared.bestNumFitted = minRequired;
+
+            auto process = [&](size_t t)
+            {
+                RANSACThread(t, *candidateModels[t], observations,
+                    numRequiredForGoodFit, maxErrorForGoodFit, confidence,
+                    preemptive, seed, shared, bestConsensus, bestModel);
+            };
+
+            size_t const numThreads = candidateModels.size();
+            if (numThreads > 1)
+            {
+                std::vector<std::thread> threads(numThreads);
+                for (size_t t = 0; t < numThreads; ++t)
+                {
+                    threads[t] = std::thread(process, t);
+                }
+
+                // Wait for all threads to finish.
+                for (size_t t = 0; t < numThreads; ++t)
+                {
+                    threads[t].join();
+                }
+            }
+            else
+            {
+                process(0);
+            }
+
+            return shared.bestNumFitted.load() >= numRequiredForGoodFit;
+        }
+
+    private:
+        // The state shared by the threads of the parallel RANSAC.  The
+        // iterations are claimed by incrementing nextIteration and the loop
+        // terminates when it reaches numIterations, which is lowered as
+        // better consensus sets are found.
+        struct RANSACShared
+        {
+            std::atomic<size_t> nextIteration;
+            std::atomic<size_t> numIterations;
+            std::atomic<size_t> bestNumFitted;
+            std::mutex bestMutex;
+        };
+
+        // The size of the blocks of observations passed to Errors(...).
+        enum { RANSAC_BLOCK_SIZE = 256 };
+
+        static void RANSACThread(size_t t, ApprQuery& candidateModel,
+            std::vector<ObservationType> const& observations,
+            size_t numRequiredForGoodFit, Real maxErrorForGoodFit,
+            Real confidence, std::vector<int> const& preemptive,
+            unsigned int seed, RANSACShared& shared,
+            std::vector<int>& bestConsensus, ApprQuery& bestModel)
+        {
+            size_t const numObservations = observations.size();
+            size_t const minRequired = candidateModel.GetMinimumRequired();
+            std::mt19937 rng(seed + static_cast<unsigned int>(t) + 1);
+
+            std::vector<int> candidates(numObservations);
+            std::iota(candidates.begin(), candidates.end(), 0);
+            std::vector<int> consensus;
+            consensus.reserve(numObservations);
+            std::vector<Real> errors(RANSAC_BLOCK_SIZE);
+
+            while (shared.nextIteration++ < shared.numIterations.load())
+            {
+                // Move a random sample of minRequired indices to the front
+                // of the array (partial Fisher-Yates shuffle).
+                for (size_t j = 0; j < minRequired; ++j)
+                {
+                    std::uniform_int_distribution<size_t> rnd(j, numObservations - 1);
+                    std::swap(candidates[j], candidates[rnd(rng)]);
+                }
+
+                if (!candidateModel.FitIndexed(numObservations,
+                    observations.data(), minRequired, candidates.data()))
+                {
+                    continue;
+                }
+
+                // Score the candidate on the preemptive subset first.  The
+                // candidate is rejected when its inlier fraction is smaller
+                // than that of the best consensus set.
+                if (preemptive.size() > 0)
+                {
+                    size_t numInliers = CountInliers(candidateModel,
+                        observations, preemptive.size(), preemptive.data(),
+                        maxErrorForGoodFit, errors, nullptr);
+                    size_t bestNumFitted = shared.bestNumFitted.load();
+                    if (numInliers * numObservations < bestNumFitted * preemptive.size())
+                    {
+                        continue;
+                    }
+                }
+
+                // Score the candidate against all the observations.
+                consensus.clear();
+                size_t numFitted = CountInliers(candidateModel, observations,
+                    numObservations, candidates.data(), maxErrorForGoodFit,
+                    errors, &consensus);
+
+                if (numFitted >= numRequiredForGoodFit &&
+                    numFitted > shared.bestNumFitted.load())
+                {
+                    // Update the candidate model using the consensus set.
+                    candidateModel.FitIndexed(numObservations,
+                        observations.data(), consensus.size(), consensus.data());
+
+                    std::lock_guard<std::mutex> lock(shared.bestMutex);
+                    if (numFitted > shared.bestNumFitted.load())
+                    {
+                        bestModel.CopyParameters(&candidateModel);
+                        bestConsensus = consensus;
+                        shared.bestNumFitted = numFitted;
+
+                        // Lower the number of iterations based on the
+                        // inlier fraction of the new consensus set.
+                        if ((Real)0 < confidence && confidence < (Real)1)
+                        {
+                            double w = static_cast<double>(numFitted) / static_cast<double>(numObservations);
+                            double wm = std::pow(w, static_cast<double>(minRequired));
+                            size_t required = 0;
+                            if (wm < 1.0)
+                            {
+                                double k = std::log(1.0 - static_cast<double>(confidence)) / std::log(1.0 - wm);
+                                required = static_cast<size_t>(std::ceil(std::max(k, 0.0)));
+                            }
+                            if (required < shared.numIterations.load())
+                            {
+                                shared.numIterations = required;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // Count the indexed observations whose errors are at most
+        // maxErrorForGoodFit.  When 'inliers' is not null, their indices are
+        // appended to it.  The errors are computed in blocks by Errors(...).
+        static size_t CountInliers(ApprQuery const& model,
+            std::vector<ObservationType> const& observations,
+            size_t numIndices, int const* indices, Real maxErrorForGoodFit,
+            std::vector<Real>& errors, std::vector<int>* inliers)
+        {
+            size_t numInliers = 0;
+            for (size_t i0 = 0; i0 < numIndices; i0 += RANSAC_BLOCK_SIZE)
+            {
+                size_t numBlock = std::min(numIndices - i0,
+                    static_cast<size_t>(RANSAC_BLOCK_SIZE));
+                model.Errors(observations.data(), numBlock, indices + i0,
+                    errors.data());
+                for (size_t i = 0; i < numBlock; ++i)
+                {
+                    if (errors[i] <= maxErrorForGoodFit)
+                    {
+                        ++numInliers;
+                        if (inliers)
+                        {
+                            inliers->push_back(indices[i0 + i]);
+                        }
+                    }
+                }
+            }
+            return numInliers;
+        }
     };
 }
@@ -3,10 +3,11 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.3 (2019/07/30)
+// File Version: 3.0.4 (2019/09/07)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteBandedMatrix.h>
 #include <Mathematics/GteBasisFunction.h>
 
@@ -22,9 +23,12 @@ namespace gte
         // Construction.  The preconditions for calling the constructor are
         //   1 <= degree && degree < numControls <= numSamples
         // The samples points are contiguous blocks of 'dimension' real values
-        // stored in sampleData.
+        // stored in sampleData.  The normal equations are assembled and the
+        // right-hand side is computed using 'numThreads' threads, subject to
+        // the constraints
+        //     1 <= numThreads <= std::thread::hardware_concurrency().
         BSplineCurveFit(int dimension, int numSamples, Real const* sampleData,
-            int degree, int numControls)
+            int degree, int numControls, unsigned int numThreads = 1)
             :
             mDimension(dimension),
             mNumSamples(numSamples),
@@ -32,6 +36,10 @@ namespace gte
             mDegree(degree),
             mNumControls(numControls),
             mControlData(dimension * numControls, (Real)0),
+            mNumThreads(numThreads > 0 ? numThreads : 1),
+            mATAMat(numControls,
+                numControls > degree + 1 ? degree + 1 : degree,
+                numControls > degree + 1 ? degree + 1 : degree),
             mConstructed(false)
         {
             LogAssert(dimension >= 1, "Invalid dimension.");
@@ -62,85 +70,128 @@ namespace gte
             // Fit the data points with a B-spline curve using a least-squares
             // error metric.  The problem is of the form A^T*A*Q = A^T*P,
             // where A^T*A is a banded matrix, P contains the sample data, and
-            // Q is the unknown vector of control points.
+            // Q is the unknown vector of control points.  Row i of A has the
+            // values of the basis functions at the sample time t[i].  At most
+            // degree+1 of these are nonzero, so the nonzero values and the
+            // index of the first one are cached.  The cache and the Cholesky
+            // factorization of A^T*A depend only on the sample times, which
+            // allows Fit(...) to process new sample data without refactoring.
             Real tMultiplier = ((Real)1) / (Real)(mNumSamples - 1);
-            Real t;
-            int i0, i1, i2, imin, imax, j;
-
-            // Construct the matrix A^T*A.
             int degp1 = mDegree + 1;
-            int numBands = (mNumControls > degp1 ? degp1 : mDegree);
-            BandedMatrix<Real> ATAMat(mNumControls, numBands, numBands);
-            for (i0 = 0; i0 < mNumControls; ++i0)
+            mBasisMin.resize(mNumSamples);
+            mBasisValues.resize(mNumSamples * degp1);
+            for (int i = 0; i < mNumSamples; ++i)
             {
-                for (i1 = 0; i1 < i0; ++i1)
-                {
-                    ATAMat(i0, i1) = ATAMat(i1, i0);
-                }
-
-                int i1Max = i0 + mDegree;
-                if (i1Max >= mNumControls)
+                int imin, imax;
+                Real t = tMultiplier * (Real)i;
+                mBasis.Evaluate(t, 0, imin, imax);
+                mBasisMin[i] = imin;
+                Real* values = &mBasisValues[i * degp1];
+                for (int j = 0; j < degp1; ++j)
                 {
-                    i1Max = mNumControls - 1;
+                    values[j] = mBasis.GetValue(0, imin + j);
                 }
+            }
 
-                for (i1 = i0; i1 <= i1Max; ++i1)
+            // Construct the matrix A^T*A.  Each thread accumulates the outer
+            // products of the basis values for a range of samples into its
+            // own banded matrix.  The partial matrices are summed afterwards.
+            int numBands = static_cast<int>(mATAMat.GetLBands().size());
+            std::vector<BandedMatrix<Real>> partial(mNumThreads,
+                BandedMatrix<Real>(mNumControls, numBands, numBands));
+            ParallelFor(mNumThreads, mNumSamples, [this, degp1, &partial](
+                unsigned int t, int imin, int imax)
+            {
+                BandedMatrix<Real>& ATAMat = partial[t];
+                for (int i = imin; i < imax; ++i)
                 {
-                    Real value = (Real)0;
-                    for (i2 = 0; i2 < mNumSamples; ++i2)
+                    int bmin = mBasisMin[i];
+                    Real const* values = &mBasisValues[i * degp1];
+                    for (int j0 = 0; j0 < degp1; ++j0)
                     {
-                        t = tMultiplier * (Real)i2;
-                        mBasis.Evaluate(t, 0, imin, imax);
-                        if (imin <= i0 && i0 <= imax && imin <= i1 && i1 <= imax)
+                        Real b0 = values[j0];
+                        ATAMat(bmin + j0, bmin + j0) += b0 * b0;
+                        for (int j1 = j0 + 1; j1 < degp1; ++j1)
                         {
-                            Real b0 = mBasis.GetValue(0, i0);
-                            Real b1 = mBasis.GetValue(0, i1);
-                            value += b0 * b1;
+                            Real product = b0 * values[j1];
+                            ATAMat(bmin + j0, bmin + j1) += product;
+                            ATAMat(bmin + j1, bmin + j0) += product;
                         }
                     }
-                    ATAMat(i0, i1) = value;
                 }
+            });
+            for (auto const& matrix : partial)
+            {
+                mATAMat.AddBands(matrix);
             }
 
-            // Construct the matrix A^T.
-            Array2<Real> ATMat(mNumSamples, mNumControls);
-            std::memset(ATMat[0], 0, mNumControls * mNumSamples * sizeof(Real));
-            for (i0 = 0; i0 < mNumControls; ++i0)
+            // Factor A^T*A = L*L^T for use in all calls to Fit(...).
+            if (!mATAMat.CholeskyFactor())
             {
-                for (i1 = 0; i1 < mNumSamples; ++i1)
-                {
-                    t = tMultiplier * (Real)i1;
-                    mBasis.Evaluate(t, 0, imin, imax);
-                    if (imin <= i0 && i0 <= imax)
-                    {
-                        ATMat[i0][i1] = mBasis.GetValue(0, i0);
-                    }
-                }
+                LogWarning("Failed to factor the linear system.");
+                return;
             }
 
-            // Compute X0 = (A^T*A)^{-1}*A^T by solving the linear system
-            // A^T*A*X = A^T.
-            mConstructed = ATAMat.template SolveSystem<true>(ATMat[0], mNumSamples);
-            if (!mConstructed)
+            mConstructed = true;
+            Fit(sampleData);
+        }
+
+        // Fit new sample data using the same degree, number of controls and
+        // number of samples that were passed to the constructor.  The cached
+        // basis values and the factorization of A^T*A are reused, so only
+        // A^T*P is computed and two triangular systems are solved.  This is
+        // useful for fitting a sequence of time-varying samples.  The return
+        // value is 'false' when construction failed or 'sampleData' is null.
+        bool Fit(Real const* sampleData)
+        {
+            if (!mConstructed || !sampleData)
             {
-                LogWarning("Failed to solve linear system.");
-                return;
+                return false;
             }
 
-            // The control points for the fitted curve are stored in the
-            // vector Q = X0*P, where P is the vector of sample data.
-            for (i0 = 0; i0 < mNumControls; ++i0)
+            mSampleData = sampleData;
+
+            // Compute A^T*P.  Each thread accumulates a range of samples into
+            // its own array.  The partial arrays are summed afterwards.
+            int const degp1 = mDegree + 1;
+            int const numControlData = mDimension * mNumControls;
+            std::vector<Real> partial(mNumThreads * numControlData, (Real)0);
+            ParallelFor(mNumThreads, mNumSamples, [this, degp1, numControlData,
+                &partial](unsigned int t, int imin, int imax)
             {
-                Real* Q = &mControlData[i0 * mDimension];
-                for (i1 = 0; i1 < mNumSamples; ++i1)
+                Real* ATP = &partial[t * numControlData];
+                for (int i = imin; i < imax; ++i)
                 {
-                    Real const* P = mSampleData + i1 * mDimension;
-                    Real xValue = ATMat[i0][i1];
-                    for (j = 0; j < mDimension; ++j)
+                    Real const* P = mSampleData + i * mDimension;
+                    Real const* values = &mBasisValues[i * degp1];
+                    Real* Q = ATP + mBasisMin[i] * mDimension;
+                    for (int j0 = 0; j0 < degp1; ++j0)
                     {
-                        Q[j] += xValue * P[j];
+                        Real b = values[j0];
+                        for (int j = 0; j < mDimension; ++j)
+                        {
+                            *Q++ += b * P[j];
+                        }
                     }
                 }
+            });
+
+            std::copy(partial.begin(), partial.begin() + numControlData,
+                mControlData.begin());
+            for (unsigned int t = 1; t < mNumThreads; ++t)
+            {
+                Real const* ATP = &partial[t * numControlData];
+                for (int i = 0; i < numControlData; ++i)
+                {
+                    mControlData[i] += ATP[i];
+                }
+            }
+
+            // Solve A^T*A*Q = A^T*P for the control points Q.
+            if (!mATAMat.template SolveFactored<true>(mControlData.data(), mDimension))
+            {
+                LogWarning("Failed to solve linear system.");
+                return false;
             }
 
             // Set the first and last output control points to match the first
@@ -152,11 +203,12 @@ namespace gte
             Real const* sEnd0 = mSampleData;
             Real* cEnd1 = &mControlData[mDimension * (mNumControls - 1)];
             Real const* sEnd1 = &mSampleData[mDimension * (mNumSamples - 1)];
-            for (j = 0; j < mDimension; ++j)
+            for (int j = 0; j < mDimension; ++j)
             {
                 *cEnd0++ = *sEnd0++;
                 *cEnd1++ = *sEnd1++;
             }
+            return true;
         }
 
         // To validate construction, create an object as shown:
@@ -246,6 +298,17 @@ namespace gte
         int mNumControls;
         std::vector<Real> mControlData;
         BasisFunction<Real> mBasis;
+
+        // The number of threads for assembling the linear systems.
+        unsigned int mNumThreads;
+
+        // The nonzero basis values for each sample time, degree+1 per
+        // sample, and the index of the first control point they multiply.
+        std::vector<int> mBasisMin;
+        std::vector<Real> mBasisValues;
+
+        // The Cholesky factorization of A^T*A.
+        BandedMatrix<Real> mATAMat;
         bool mConstructed;
     };
 }
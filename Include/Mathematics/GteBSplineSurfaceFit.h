@@ -3,13 +3,16 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.2 (2019/05/03)
+// File Version: 3.0.3 (2019/09/07)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteBandedMatrix.h>
 #include <Mathematics/GteVector3.h>
 #include <Mathematics/GteBasisFunction.h>
+#include <algorithm>
+#include <array>
 
 // The algorithm implemented here is based on the document
 // https://www.geometrictools.com/Documentation/BSplineSurfaceLeastSquaresFit.pdf
@@ -24,12 +27,21 @@ namespace gte
         //   1 <= degree0 && degree0 + 1 < numControls0 <= numSamples0
         //   1 <= degree1 && degree1 + 1 < numControls1 <= numSamples1
         // The sample data must be in row-major order.  The control data is
-        // also stored in row-major order.
+        // also stored in row-major order.  The linear systems are assembled
+        // using 'numThreads' threads, subject to the constraints
+        //     1 <= numThreads <= std::thread::hardware_concurrency().
         BSplineSurfaceFit(int degree0, int numControls0, int numSamples0,
-            int degree1, int numControls1, int numSamples1, Vector3<Real> const* sampleData)
+            int degree1, int numControls1, int numSamples1, Vector3<Real> const* sampleData,
+            unsigned int numThreads = 1)
             :
             mSampleData(sampleData),
-            mControlData(numControls0 * numControls1)
+            mControlData(numControls0 * numControls1),
+            mNumThreads(numThreads > 0 ? numThreads : 1),
+            mATAMat
+            {
+                BandedMatrix<Real>(numControls0, degree0 + 1, degree0 + 1),
+                BandedMatrix<Real>(numControls1, degree1 + 1, degree1 + 1)
+            }
         {
             LogAssert(1 <= degree0 && degree0 + 1 < numControls0, "Invalid degree.");
             LogAssert(numControls0 <= numSamples0, "Invalid number of controls.");
@@ -75,105 +87,192 @@ namespace gte
             // least-squares error metric.  The problem is of the form
             // A0^T*A0*Q*A1^T*A1 = A0^T*P*A1, where A0^T*A0 and A1^T*A1 are
             // banded matrices, P contains the sample data, and Q is the
-            // unknown matrix of control points.
-            Real t;
-            int i0, i1, i2, imin, imax;
-
-            // Construct the matrices A0^T*A0 and A1^T*A1.
-            BandedMatrix<Real> ATAMat[2] =
-            {
-                BandedMatrix<Real>(mNumControls[0], mDegree[0] + 1, mDegree[0] + 1),
-                BandedMatrix<Real>(mNumControls[1], mDegree[1] + 1, mDegree[1] + 1)
-            };
-
+            // unknown matrix of control points.  Row i of A[d] has the values
+            // of the basis functions at the sample time t[i].  At most
+            // degree[d]+1 of these are nonzero, so the nonzero values and the
+            // index of the first one are cached.  The caches and the Cholesky
+            // factorizations of A[d]^T*A[d] depend only on the sample times,
+            // which allows Fit(...) to process new sample data without
+            // refactoring.
             for (dim = 0; dim < 2; ++dim)
             {
-                for (i0 = 0; i0 < mNumControls[dim]; ++i0)
+                int degp1 = mDegree[dim] + 1;
+                mBasisMin[dim].resize(mNumSamples[dim]);
+                mBasisValues[dim].resize(mNumSamples[dim] * degp1);
+                for (int i = 0; i < mNumSamples[dim]; ++i)
                 {
-                    for (i1 = 0; i1 < i0; ++i1)
-                    {
-                        ATAMat[dim](i0, i1) = ATAMat[dim](i1, i0);
-                    }
-
-                    int i1Max = i0 + mDegree[dim];
-                    if (i1Max >= mNumControls[dim])
+                    int imin, imax;
+                    Real t = tMultiplier[dim] * (Real)i;
+                    mBasis[dim].Evaluate(t, 0, imin, imax);
+                    mBasisMin[dim][i] = imin;
+                    Real* values = &mBasisValues[dim][i * degp1];
+                    for (int j = 0; j < degp1; ++j)
                     {
-                        i1Max = mNumControls[dim] - 1;
+                        values[j] = mBasis[dim].GetValue(0, imin + j);
                     }
+                }
+            }
 
-                    for (i1 = i0; i1 <= i1Max; ++i1)
+            // Construct the matrices A0^T*A0 and A1^T*A1.  Each thread
+            // accumulates the outer products of the basis values for a range
+            // of samples into its own banded matrix.  The partial matrices
+            // are summed afterwards.  Factor A[d]^T*A[d] = L[d]*L[d]^T for use
+            // in all calls to Fit(...).
+            for (dim = 0; dim < 2; ++dim)
+            {
+                int degp1 = mDegree[dim] + 1;
+                std::vector<BandedMatrix<Real>> partial(mNumThreads,
+                    BandedMatrix<Real>(mNumControls[dim], degp1, degp1));
+                ParallelFor(mNumThreads, mNumSamples[dim], [this, dim, degp1,
+                    &partial](unsigned int t, int imin, int imax)
+                {
+                    BandedMatrix<Real>& ATAMat = partial[t];
+                    for (int i = imin; i < imax; ++i)
                     {
-                        Real value = (Real)0;
-                        for (i2 = 0; i2 < mNumSamples[dim]; ++i2)
+                        int bmin = mBasisMin[dim][i];
+                        Real const* values = &mBasisValues[dim][i * degp1];
+                        for (int j0 = 0; j0 < degp1; ++j0)
                         {
-                            t = tMultiplier[dim] * (Real)i2;
-                            mBasis[dim].Evaluate(t, 0, imin, imax);
-                            if (imin <= i0 && i0 <= imax && imin <= i1 && i1 <= imax)
+                            Real b0 = values[j0];
+                            ATAMat(bmin + j0, bmin + j0) += b0 * b0;
+                            for (int j1 = j0 + 1; j1 < degp1; ++j1)
                             {
-                                Real b0 = mBasis[dim].GetValue(0, i0);
-                                Real b1 = mBasis[dim].GetValue(0, i1);
-                                value += b0 * b1;
+                                Real product = b0 * values[j1];
+                                ATAMat(bmin + j0, bmin + j1) += product;
+                                ATAMat(bmin + j1, bmin + j0) += product;
                             }
                         }
-                        ATAMat[dim](i0, i1) = value;
                     }
+                });
+                for (auto const& matrix : partial)
+                {
+                    mATAMat[dim].AddBands(matrix);
                 }
+
+                bool factored = mATAMat[dim].CholeskyFactor();
+                LogAssert(factored, "Failed to factor linear system.");
+                (void)factored;
             }
 
-            // Construct the matrices A0^T and A1^T.  A[d]^T has
-            // mNumControls[d] rows and mNumSamples[d] columns.
-            Array2<Real> ATMat[2];
-            for (dim = 0; dim < 2; dim++)
+            Fit(sampleData);
+        }
+
+        // Fit new sample data using the same degrees, numbers of controls
+        // and numbers of samples that were passed to the constructor.  The
+        // cached basis values and the factorizations of A[d]^T*A[d] are
+        // reused, so only A0^T*P*A1 is computed and the triangular systems
+        // are solved.  This is useful for fitting a sequence of time-varying
+        // samples.  The return value is 'false' when 'sampleData' is null or
+        // a linear system cannot be solved.
+        bool Fit(Vector3<Real> const* sampleData)
+        {
+            if (!sampleData)
             {
-                ATMat[dim] = Array2<Real>(mNumSamples[dim], mNumControls[dim]);
-                size_t numBytes = mNumControls[dim] * mNumSamples[dim] * sizeof(Real);
-                std::memset(ATMat[dim][0], 0, numBytes);
-                for (i0 = 0; i0 < mNumControls[dim]; ++i0)
+                return false;
+            }
+
+            mSampleData = sampleData;
+
+            // Compute B = A0^T*P*A1 in two passes, first T = P*A1 and then
+            // B = A0^T*T, exploiting the sparsity of A0 and A1.  T has
+            // numSamples0 rows and numControls1 columns.  In each pass the
+            // threads write disjoint ranges of the output, so no reduction
+            // is required.
+            int const numS0 = mNumSamples[0], numS1 = mNumSamples[1];
+            int const numC0 = mNumControls[0], numC1 = mNumControls[1];
+            int const degp1n0 = mDegree[0] + 1, degp1n1 = mDegree[1] + 1;
+            std::vector<Vector3<Real>> TMat(numS0 * numC1);
+            ParallelFor(mNumThreads, numS0, [this, numS0, numS1, numC1,
+                degp1n1, &TMat](unsigned int, int j0min, int j0max)
+            {
+                for (int j0 = j0min; j0 < j0max; ++j0)
+                {
+                    Vector3<Real>* TRow = &TMat[numC1 * j0];
+                    for (int i1 = 0; i1 < numC1; ++i1)
+                    {
+                        TRow[i1] = Vector3<Real>::Zero();
+                    }
+                }
+
+                for (int j1 = 0; j1 < numS1; ++j1)
                 {
-                    for (i1 = 0; i1 < mNumSamples[dim]; ++i1)
+                    int bmin = mBasisMin[1][j1];
+                    Real const* values = &mBasisValues[1][j1 * degp1n1];
+                    Vector3<Real> const* PRow = &mSampleData[numS0 * j1];
+                    for (int j0 = j0min; j0 < j0max; ++j0)
                     {
-                        t = tMultiplier[dim] * (Real)i1;
-                        mBasis[dim].Evaluate(t, 0, imin, imax);
-                        if (imin <= i0 && i0 <= imax)
+                        Vector3<Real> const& sample = PRow[j0];
+                        Vector3<Real>* TRow = &TMat[numC1 * j0 + bmin];
+                        for (int k = 0; k < degp1n1; ++k)
                         {
-                            ATMat[dim][i0][i1] = mBasis[dim].GetValue(0, i0);
+                            TRow[k] += values[k] * sample;
                         }
                     }
                 }
-            }
+            });
 
-            // Compute X0 = (A0^T*A0)^{-1}*A0^T and X1 = (A1^T*A1)^{-1}*A1^T
-            // by solving the linear systems A0^T*A0*X0 = A0^T and
-            // A1^T*A1*X1 = A1^T.
-            for (dim = 0; dim < 2; ++dim)
+            // The components of B are stored in separate arrays for the
+            // linear solvers.  Component c of B(i0,i1) is stored in
+            // BComp[c][i0 + numC0 * i1], which is the storage order of the
+            // control points.
+            std::array<std::vector<Real>, 3> BComp;
+            for (int c = 0; c < 3; ++c)
             {
-                bool solved = ATAMat[dim].template SolveSystem<true>(ATMat[dim][0],
-                    mNumSamples[dim]);
-                LogAssert(solved, "Failed to solve linear system.");
-                (void)solved;
+                BComp[c].resize(numC0 * numC1);
             }
-
-            // The control points for the fitted surface are stored in the matrix
-            // Q = X0*P*X1^T, where P is the matrix of sample data.
-            for (i1 = 0; i1 < mNumControls[1]; ++i1)
+            ParallelFor(mNumThreads, numC1, [this, numS0, numC0, numC1,
+                degp1n0, &TMat, &BComp](unsigned int, int i1min, int i1max)
             {
-                for (i0 = 0; i0 < mNumControls[0]; ++i0)
+                std::vector<Vector3<Real>> column(numC0);
+                for (int i1 = i1min; i1 < i1max; ++i1)
                 {
-                    Vector3<Real> sum = Vector3<Real>::Zero();
-                    for (int j1 = 0; j1 < mNumSamples[1]; ++j1)
+                    std::fill(column.begin(), column.end(), Vector3<Real>::Zero());
+                    for (int j0 = 0; j0 < numS0; ++j0)
+                    {
+                        int bmin = mBasisMin[0][j0];
+                        Real const* values = &mBasisValues[0][j0 * degp1n0];
+                        Vector3<Real> const& tValue = TMat[numC1 * j0 + i1];
+                        for (int k = 0; k < degp1n0; ++k)
+                        {
+                            column[bmin + k] += values[k] * tValue;
+                        }
+                    }
+                    for (int i0 = 0; i0 < numC0; ++i0)
                     {
-                        Real x1Value = ATMat[1][i1][j1];
-                        for (int j0 = 0; j0 < mNumSamples[0]; ++j0)
+                        for (int c = 0; c < 3; ++c)
                         {
-                            Real x0Value = ATMat[0][i0][j0];
-                            Vector3<Real> sample =
-                                mSampleData[j0 + mNumSamples[0] * j1];
-                            sum += (x0Value * x1Value) * sample;
+                            BComp[c][i0 + numC0 * i1] = column[i0][c];
                         }
                     }
-                    mControlData[i0 + mNumControls[0] * i1] = sum;
                 }
+            });
+
+            // Solve A0^T*A0*Q*A1^T*A1 = B.  In the storage order of BComp[c],
+            // the rows are indexed by i1, so Z = B*(A1^T*A1)^{-1} is computed
+            // by solving (A1^T*A1)*Z^T = B^T in row-major order.  The columns
+            // are then indexed by i0, so Q = (A0^T*A0)^{-1}*Z is computed by
+            // solving in column-major order.
+            bool solved = true;
+            for (int c = 0; c < 3; ++c)
+            {
+                solved = solved
+                    && mATAMat[1].template SolveFactored<true>(BComp[c].data(), numC0)
+                    && mATAMat[0].template SolveFactored<false>(BComp[c].data(), numC1);
+            }
+            if (!solved)
+            {
+                LogWarning("Failed to solve linear system.");
+                return false;
             }
+
+            for (int i = 0; i < numC0 * numC1; ++i)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    mControlData[i][c] = BComp[c][i];
+                }
+            }
+            return true;
         }
 
         // Access to input sample information.
@@ -241,5 +340,16 @@ namespace gte
         int mNumControls[2];
         std::vector<Vector3<Real>> mControlData;
         BasisFunction<Real> mBasis[2];
+
+        // The number of threads for assembling the linear systems.
+        unsigned int mNumThreads;
+
+        // The nonzero basis values for each sample time, degree+1 per
+        // sample, and the index of the first control point they multiply.
+        std::vector<int> mBasisMin[2];
+        std::vector<Real> mBasisValues[2];
+
+        // The Cholesky factorizations of A0^T*A0 and A1^T*A1.
+        BandedMatrix<Real> mATAMat[2];
     };
 }
@@ -3,11 +3,12 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.2 (2019/04/04)
+// File Version: 3.0.3 (2019/09/07)
 
 #pragma once
 
 #include <LowLevel/GteLexicoArray2.h>
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
@@ -171,6 +172,33 @@ namespace gte
             return mZero;
         }
 
+        // Add the bands of a matrix that has the same size and the same
+        // numbers of lower and upper bands, A = A + B.  This is used to sum
+        // partial matrices that were computed by multiple threads.
+        void AddBands(BandedMatrix const& matrix)
+        {
+            for (size_t i = 0; i < mDBand.size(); ++i)
+            {
+                mDBand[i] += matrix.mDBand[i];
+            }
+            for (size_t b = 0; b < mLBands.size(); ++b)
+            {
+                auto const& lBand = matrix.mLBands[b];
+                for (size_t i = 0; i < lBand.size(); ++i)
+                {
+                    mLBands[b][i] += lBand[i];
+                }
+            }
+            for (size_t b = 0; b < mUBands.size(); ++b)
+            {
+                auto const& uBand = matrix.mUBands[b];
+                for (size_t i = 0; i < uBand.size(); ++i)
+                {
+                    mUBands[b][i] += uBand[i];
+                }
+            }
+        }
+
         // Factor the square banded matrix A into A = L*L^T, where L is a
         // lower-triangular matrix (L^T is an upper-triangular matrix).  This is
         // an LU decomposition that allows for stable inversion of A to solve
@@ -271,6 +299,72 @@ namespace gte
                 && SolveUpper<RowMajor>(bMatrix, numBColumns);
         }
 
+        // Solve the linear system A*X = B when A already stores its Cholesky
+        // factorization, which is the case after a successful call to
+        // CholeskyFactor() or SolveSystem(...).  The matrix is not modified,
+        // so the factorization can be reused for many right-hand sides.  Only
+        // the entries in the bands of L and L^T are visited.  'bMatrix' must
+        // have the storage order specified by the template parameter.
+        template <bool RowMajor>
+        bool SolveFactored(Real* bMatrix, int numBColumns) const
+        {
+            if (mDBand.size() == 0 || mLBands.size() != mUBands.size())
+            {
+                // Invalid number of bands.
+                return false;
+            }
+
+            LexicoArray2<RowMajor, Real> data(mSize, numBColumns, bMatrix);
+            int const numBands = static_cast<int>(mLBands.size());
+
+            // Solve L*Y = B.
+            for (int r = 0; r < mSize; ++r)
+            {
+                Real lowerRR = mDBand[r];
+                if (lowerRR <= (Real)0)
+                {
+                    return false;
+                }
+
+                int cMin = std::max(r - numBands, 0);
+                for (int c = cMin; c < r; ++c)
+                {
+                    Real lowerRC = mLBands[r - c - 1][c];
+                    for (int bCol = 0; bCol < numBColumns; ++bCol)
+                    {
+                        data(r, bCol) -= lowerRC * data(c, bCol);
+                    }
+                }
+
+                Real inverse = ((Real)1) / lowerRR;
+                for (int bCol = 0; bCol < numBColumns; ++bCol)
+                {
+                    data(r, bCol) *= inverse;
+                }
+            }
+
+            // Solve L^T*X = Y.
+            for (int r = mSize - 1; r >= 0; --r)
+            {
+                int cMax = std::min(r + numBands, mSize - 1);
+                for (int c = r + 1; c <= cMax; ++c)
+                {
+                    Real upperRC = mUBands[c - r - 1][r];
+                    for (int bCol = 0; bCol < numBColumns; ++bCol)
+                    {
+                        data(r, bCol) -= upperRC * data(c, bCol);
+                    }
+                }
+
+                Real inverse = ((Real)1) / mDBand[r];
+                for (int bCol = 0; bCol < numBColumns; ++bCol)
+                {
+                    data(r, bCol) *= inverse;
+                }
+            }
+            return true;
+        }
+
         // Compute the inverse of the banded matrix.  The return value is 'true'
         // when the matrix is invertible, in which case the 'inverse' output is
         // valid.  The return value is 'false' when the matrix is not invertible,
@@ -0,0 +1,212 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/03)
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// The BlockReflector class applies a product of Householder reflections
+// H[0]*H[1]*...*H[K-1] to a square matrix using the compact WY
+// representation described in "Matrix Computations, 2nd edition" by
+// G. H. Golub and C. F. Van Loan, The Johns Hopkins University Press,
+// Baltimore MD, Fourth Printing 1993, Section 5.1.7 (Block Representation).
+// Each reflection is H[k] = I - s[k]*v[k]*v[k]^T, where s[k] = 2/Dot(v,v),
+// v[k] has zero-valued components before index lead+k, the component at
+// index lead+k is 1, and the remaining components are the essential parts
+// stored by the caller.  A block of B consecutive reflections is
+// represented as I - V*T*V^T, where V is the matrix whose columns are the
+// v[k] and T is a BxB upper-triangular matrix.  The product is applied to
+// the matrix by matrix-matrix operations, which is much more cache
+// friendly than applying the reflections one at a time.  This is the
+// backward accumulation used by SymmetricEigensolver and
+// SingularValueDecomposition to construct their orthogonal matrices.
+//
+// The reflections act on the columns of the matrix independently, so
+// multiple threads can apply the product to disjoint column ranges, each
+// thread using its own BlockReflector object for workspace.
+
+namespace gte
+{
+
+template <typename Real>
+class BlockReflector
+{
+public:
+    // The matrices to be processed are NxN with N <= 'maxSize'.  The number
+    // of reflections per block is B ('blockSize').  All workspace is
+    // allocated here so that ApplyProduct does not allocate memory.
+    BlockReflector(int maxSize = 0, int blockSize = 32);
+
+    // Compute M <- H[0]*H[1]*...*H[K-1]*M for the columns cmin <= c < cmax
+    // of the NxN row-major matrix M ('size' is N).  The inputs are K
+    // ('numReflections'), the index of the 1-valued component of v[0]
+    // ('lead'), a callable 'essential(k,r)' that returns component
+    // r > lead+k of v[k], and a callable 'scale(k)' that returns
+    // 2/Dot(v[k],v[k]).
+    template <typename Essential, typename Scale>
+    void ApplyProduct(int size, int numReflections, int lead,
+        Essential const& essential, Scale const& scale, int cmin, int cmax,
+        Real* matrix);
+
+private:
+    int mMaxSize, mBlockSize;
+
+    // The reflection vectors of the current block, stored in row-major
+    // order as an (N-rmin)xB matrix where rmin is the row of the 1-valued
+    // component of the first reflection in the block.
+    std::vector<Real> mV;  // NxB elements
+
+    // The upper-triangular matrix of the compact WY representation.
+    std::vector<Real> mT;  // BxB elements
+
+    // The product W = T*V^T*M restricted to the requested columns, stored
+    // in row-major order.
+    std::vector<Real> mW;  // BxN elements
+};
+
+
+template <typename Real>
+BlockReflector<Real>::BlockReflector(int maxSize, int blockSize)
+    :
+    mMaxSize(std::max(maxSize, 0)),
+    mBlockSize(std::max(blockSize, 1)),
+    mV(mMaxSize * mBlockSize),
+    mT(mBlockSize * mBlockSize),
+    mW(mBlockSize * mMaxSize)
+{
+}
+
+template <typename Real>
+template <typename Essential, typename Scale>
+void BlockReflector<Real>::ApplyProduct(int size, int numReflections,
+    int lead, Essential const& essential, Scale const& scale, int cmin,
+    int cmax, Real* matrix)
+{
+    int const numCols = cmax - cmin;
+    if (numReflections <= 0 || numCols <= 0 || size > mMaxSize)
+    {
+        return;
+    }
+
+    // Backward accumulation processes the blocks from last to first,
+    // M <- (H[k0]*...*H[k1-1])*M.
+    for (int k1 = numReflections; k1 > 0; k1 -= mBlockSize)
+    {
+        int const k0 = std::max(k1 - mBlockSize, 0);
+        int const numBlock = k1 - k0;
+        int const rmin = lead + k0;
+        int const numRows = size - rmin;
+
+        // Load the reflection vectors into V.  Column j of V is v[k0+j]
+        // with the rows starting at rmin.
+        for (int r = 0; r < numRows; ++r)
+        {
+            Real* vRow = &mV[numBlock * r];
+            for (int j = 0; j < numBlock; ++j)
+            {
+                int const k = k0 + j;
+                vRow[j] = (r < j ? (Real)0 : (r == j ? (Real)1 :
+                    essential(k, rmin + r)));
+            }
+        }
+
+        // Compute the upper-triangular T so that the product of the block
+        // reflections is I - V*T*V^T.  Column j is generated from the
+        // previous columns by T(0:j-1,j) = -s[j]*T(0:j-1,0:j-1)*V^T*v[j].
+        for (int j = 0; j < numBlock; ++j)
+        {
+            Real const s = scale(k0 + j);
+            Real* tCol = &mT[j];
+            for (int i = 0; i < j; ++i)
+            {
+                // Components of v[j] before row j are zero.
+                Real dot = (Real)0;
+                for (int r = j; r < numRows; ++r)
+                {
+                    Real const* vRow = &mV[numBlock * r];
+                    dot += vRow[i] * vRow[j];
+                }
+                tCol[mBlockSize * i] = dot;
+            }
+            for (int i = 0; i < j; ++i)
+            {
+                Real sum = (Real)0;
+                for (int m = i; m < j; ++m)
+                {
+                    sum += mT[m + mBlockSize * i] * tCol[mBlockSize * m];
+                }
+                tCol[mBlockSize * i] = -s * sum;
+            }
+            tCol[mBlockSize * j] = s;
+        }
+
+        // W = V^T*M.  The loops are ordered so that the rows of M are
+        // traversed contiguously.
+        std::fill(mW.begin(), mW.end(), (Real)0);
+        for (int r = 0; r < numRows; ++r)
+        {
+            Real const* vRow = &mV[numBlock * r];
+            Real const* mRow = &matrix[cmin + size * (rmin + r)];
+            for (int j = 0; j < numBlock && j <= r; ++j)
+            {
+                Real const vrj = vRow[j];
+                if (vrj != (Real)0)
+                {
+                    Real* wRow = &mW[numCols * j];
+                    for (int c = 0; c < numCols; ++c)
+                    {
+                        wRow[c] += vrj * mRow[c];
+                    }
+                }
+            }
+        }
+
+        // W <- T*W.  T is upper triangular, so row i of the product depends
+        // only on rows i and larger of W, which allows the product to be
+        // computed in place.
+        for (int i = 0; i < numBlock; ++i)
+        {
+            Real* wRow = &mW[numCols * i];
+            Real const tii = mT[i + mBlockSize * i];
+            for (int c = 0; c < numCols; ++c)
+            {
+                wRow[c] *= tii;
+            }
+            for (int m = i + 1; m < numBlock; ++m)
+            {
+                Real const tim = mT[m + mBlockSize * i];
+                Real const* wOther = &mW[numCols * m];
+                for (int c = 0; c < numCols; ++c)
+                {
+                    wRow[c] += tim * wOther[c];
+                }
+            }
+        }
+
+        // M <- M - V*W.
+        for (int r = 0; r < numRows; ++r)
+        {
+            Real const* vRow = &mV[numBlock * r];
+            Real* mRow = &matrix[cmin + size * (rmin + r)];
+            for (int j = 0; j < numBlock && j <= r; ++j)
+            {
+                Real const vrj = vRow[j];
+                if (vrj != (Real)0)
+                {
+                    Real const* wRow = &mW[numCols * j];
+                    for (int c = 0; c < numCols; ++c)
+                    {
+                        mRow[c] -= vrj * wRow[c];
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
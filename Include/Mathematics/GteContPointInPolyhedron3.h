@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.1 (2016/11/25)
+// File Version: 3.0.2 (2019/09/11)
 
 #pragma once
 
@@ -29,6 +29,11 @@
 // Whichever result occurs N+1 or more times is the "winner".  The input
 // rayQuantity is 2*N+1.  The input array Direction must have rayQuantity
 // elements.  If you are feeling lucky, choose rayQuantity to be 1.
+//
+// The queries do not modify the object, so an object may be shared by
+// multiple threads.  Each query tests every face, so for closed triangle
+// meshes with many faces or for classifying many points, use
+// PointInTriangleMesh3 instead.
 
 namespace gte
 {
@@ -154,11 +159,6 @@ private:
     unsigned int mMethod;
     int mNumRays;
     Vector3<Real> const* mDirections;
-
-    // Temporary storage for those methods that reduce the problem to 2D
-    // point-in-polygon queries.  The array stores the projections of
-    // face vertices onto the plane of the face.  It is resized as needed.
-    mutable std::vector<Vector2<Real>> mProjVertices;
 };
 
 
@@ -445,6 +445,10 @@ bool PointInPolyhedron3<Real>::ContainsC1C2(Vector3<Real> const& p,
     Ray3<Real> ray;
     ray.origin = p;
 
+    // Storage for the projections of face vertices onto the plane of the
+    // face.  It is resized as needed.
+    std::vector<Vector2<Real>> projVertices;
+
     for (int j = 0; j < mNumRays; ++j)
     {
         ray.direction = mDirections[j];
@@ -482,24 +486,24 @@ bool PointInPolyhedron3<Real>::ContainsC1C2(Vector3<Real> const& p,
                 Dot(basis[1], diff), Dot(basis[2], diff) };
 
             // Project the face vertices onto the plane of the face.
-            if (face->indices.size() > mProjVertices.size())
+            if (face->indices.size() > projVertices.size())
             {
-                mProjVertices.resize(face->indices.size());
+                projVertices.resize(face->indices.size());
             }
 
             // Project the remaining vertices.  Vertex 0 is always the origin.
             size_t numIndices = face->indices.size();
-            mProjVertices[0] = Vector2<Real>::Zero();
+            projVertices[0] = Vector2<Real>::Zero();
             for (size_t k = 1; k < numIndices; ++k)
             {
                 diff = mPoints[face->indices[k]] - V0;
-                mProjVertices[k][0] = Dot(basis[1], diff);
-                mProjVertices[k][1] = Dot(basis[2], diff);
+                projVertices[k][0] = Dot(basis[1], diff);
+                projVertices[k][1] = Dot(basis[2], diff);
             }
 
             // Test whether the intersection point is in the convex polygon.
-            PointInPolygon2<Real> PIP(static_cast<int>(mProjVertices.size()),
-                &mProjVertices[0]);
+            PointInPolygon2<Real> PIP(static_cast<int>(numIndices),
+                &projVertices[0]);
 
             if (method == 1)
             {
@@ -537,6 +541,10 @@ bool PointInPolyhedron3<Real>::ContainsS1(Vector3<Real> const& p) const
     Ray3<Real> ray;
     ray.origin = p;
 
+    // Storage for the projections of face vertices onto the plane of the
+    // face.  It is resized as needed.
+    std::vector<Vector2<Real>> projVertices;
+
     for (int j = 0; j < mNumRays; ++j)
     {
         ray.direction = mDirections[j];
@@ -574,24 +582,24 @@ bool PointInPolyhedron3<Real>::ContainsS1(Vector3<Real> const& p) const
                 Dot(basis[1], diff), Dot(basis[2], diff) };
 
             // Project the face vertices onto the plane of the face.
-            if (face->indices.size() > mProjVertices.size())
+            if (face->indices.size() > projVertices.size())
             {
-                mProjVertices.resize(face->indices.size());
+                projVertices.resize(face->indices.size());
             }
 
             // Project the remaining vertices.  Vertex 0 is always the origin.
             size_t numIndices = face->indices.size();
-            mProjVertices[0] = Vector2<Real>::Zero();
+            projVertices[0] = Vector2<Real>::Zero();
             for (size_t k = 1; k < numIndices; ++k)
             {
                 diff = mPoints[face->indices[k]] - V0;
-                mProjVertices[k][0] = Dot(basis[1], diff);
-                mProjVertices[k][1] = Dot(basis[2], diff);
+                projVertices[k][0] = Dot(basis[1], diff);
+                projVertices[k][1] = Dot(basis[2], diff);
             }
 
             // Test whether the intersection point is in the convex polygon.
-            PointInPolygon2<Real> PIP(static_cast<int>(mProjVertices.size()),
-                &mProjVertices[0]);
+            PointInPolygon2<Real> PIP(static_cast<int>(numIndices),
+                &projVertices[0]);
 
             if (PIP.Contains(projIntersect))
             {
@@ -0,0 +1,367 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/11)
+
+#pragma once
+
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteVector3.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Point-in-polyhedron queries for a closed triangle mesh, designed for
+// classifying many points, for example, when voxelizing a mesh.  A point P
+// is inside the mesh when the ray P + t*(1,0,0), t > 0, crosses the mesh an
+// odd number of times.  The orientation of the triangles does not matter.
+//
+// The triangles are stored in a uniform grid of cells over the bounding
+// rectangle of the mesh projected onto the yz-plane, so a ray is tested
+// only against the triangles whose projected bounding rectangles overlap
+// the cell containing (P.y,P.z).  When the ray passes through an edge or a
+// vertex of the mesh, the crossings are counted as if (P.y,P.z) were
+// perturbed by (epsilon,epsilon^2) for an infinitesimal epsilon > 0.  The
+// edge tests are computed identically for the triangles sharing an edge, so
+// a crossing at a shared edge or vertex is counted by exactly one of the
+// triangles sharing it, and the result is consistent for a closed mesh.
+// The result for a point on the mesh surface is either inside or outside.
+//
+// The class stores no per-query state, so a single object may be used by
+// multiple threads concurrently.  The batch queries also partition the
+// work among the threads specified in the constructor.
+
+namespace gte
+{
+
+template <typename Real>
+class PointInTriangleMesh3
+{
+public:
+    // Construction.  The mesh has 'numTriangles' triangles whose vertex
+    // indices are stored in 'indices' (3 per triangle).  The mesh must be
+    // closed for the queries to be meaningful.  The vertices are copied, so
+    // the input arrays are not needed after construction.  The batch queries
+    // use the specified number of threads, subject to the constraints
+    // 1 <= numThreads <= std::thread::hardware_concurrency().  The number of
+    // grid cells in each of the y- and z-dimensions is 'gridSize'; when it
+    // is 0, the size is chosen based on the number of triangles.
+    PointInTriangleMesh3(int numVertices, Vector3<Real> const* vertices,
+        int numTriangles, int const* indices, unsigned int numThreads = 1,
+        int gridSize = 0);
+
+    // Test whether a point is inside the mesh.
+    bool Contains(Vector3<Real> const& point) const;
+
+    // Test whether points[i] is inside the mesh, storing the result in
+    // inside[i] as 1 (inside) or 0 (outside).
+    void Contains(int numPoints, Vector3<Real> const* points, uint8_t* inside) const;
+
+    // Classify the points (x0 + i*dx, y, z) for 0 <= i < numPoints, where
+    // dx > 0.  The ray crossings for the row are computed once, sorted and
+    // then swept, so the cost is nearly independent of the number of
+    // points.  The results are stored in inside[i].
+    void ContainsRow(Real x0, Real dx, Real y, Real z, int numPoints,
+        uint8_t* inside) const;
+
+    // Classify the points origin + (i0*spacing[0], i1*spacing[1],
+    // i2*spacing[2]) of a 3D grid with dimensions size[0], size[1] and
+    // size[2].  The results are stored in inside[i0 + size[0]*(i1 +
+    // size[1]*i2)].  The rows are partitioned among the threads.
+    void ContainsGrid(Vector3<Real> const& origin, Vector3<Real> const& spacing,
+        std::array<int, 3> const& size, uint8_t* inside) const;
+
+private:
+    // The implementation of ContainsRow using the caller's storage for the
+    // crossings, which allows ContainsGrid to reuse the storage per thread.
+    void ContainsRow(Real x0, Real dx, Real y, Real z, int numPoints,
+        uint8_t* inside, std::vector<Real>& crossings) const;
+
+    // Compute the x-values of the crossings of the line (y,z) with the
+    // triangles of the cell containing (y,z).  When 'xMin' is not null,
+    // only the crossings with x > *xMin are counted, and the function
+    // returns the count without storing the crossings.
+    int GetCrossings(Real y, Real z, Real const* xMin,
+        std::vector<Real>* crossings) const;
+
+    // Determine whether the line through (y,z) parallel to the x-axis
+    // crosses the triangle.  On success, 'x' is the x-value of the crossing.
+    bool GetCrossing(std::array<Vector3<Real>, 3> const& triangle, Real y,
+        Real z, Real& x) const;
+
+    unsigned int mNumThreads;
+    std::vector<std::array<Vector3<Real>, 3>> mTriangles;
+
+    // The uniform grid over the yz-bounding rectangle.  The triangles of
+    // cell c are mCellTriangles[mCellStart[c]] through
+    // mCellTriangles[mCellStart[c+1]-1].
+    int mGridSize;
+    Real mYMin, mZMin, mYInvCellSize, mZInvCellSize;
+    std::vector<int> mCellStart;
+    std::vector<int> mCellTriangles;
+};
+
+
+template <typename Real>
+PointInTriangleMesh3<Real>::PointInTriangleMesh3(int numVertices,
+    Vector3<Real> const* vertices, int numTriangles, int const* indices,
+    unsigned int numThreads, int gridSize)
+    :
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mGridSize(1),
+    mYMin((Real)0),
+    mZMin((Real)0),
+    mYInvCellSize((Real)0),
+    mZInvCellSize((Real)0),
+    mCellStart(2, 0)
+{
+    if (numVertices <= 0 || !vertices || numTriangles <= 0 || !indices)
+    {
+        LogError("Invalid input.");
+        return;
+    }
+
+    mTriangles.resize(numTriangles);
+    Real yMax = -std::numeric_limits<Real>::max();
+    Real zMax = -std::numeric_limits<Real>::max();
+    mYMin = std::numeric_limits<Real>::max();
+    mZMin = std::numeric_limits<Real>::max();
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            Vector3<Real> const& vertex = vertices[indices[3 * t + j]];
+            mTriangles[t][j] = vertex;
+            mYMin = std::min(mYMin, vertex[1]);
+            yMax = std::max(yMax, vertex[1]);
+            mZMin = std::min(mZMin, vertex[2]);
+            zMax = std::max(zMax, vertex[2]);
+        }
+    }
+
+    // A closed surface mesh of n triangles projects to approximately n
+    // cells with a bounded number of triangles each.
+    if (gridSize <= 0)
+    {
+        gridSize = static_cast<int>(std::sqrt(static_cast<double>(numTriangles)));
+    }
+    mGridSize = std::min(std::max(gridSize, 1), 4096);
+    Real yExtent = yMax - mYMin, zExtent = zMax - mZMin;
+    mYInvCellSize = (yExtent > (Real)0 ? (Real)mGridSize / yExtent : (Real)0);
+    mZInvCellSize = (zExtent > (Real)0 ? (Real)mGridSize / zExtent : (Real)0);
+
+    // Store the triangle indices for the cells in compressed row format,
+    // first counting the triangles per cell and then filling in the
+    // indices.
+    auto getCells = [this](std::array<Vector3<Real>, 3> const& triangle,
+        int& y0, int& y1, int& z0, int& z1)
+    {
+        Real ymin = std::min(std::min(triangle[0][1], triangle[1][1]), triangle[2][1]);
+        Real ymax = std::max(std::max(triangle[0][1], triangle[1][1]), triangle[2][1]);
+        Real zmin = std::min(std::min(triangle[0][2], triangle[1][2]), triangle[2][2]);
+        Real zmax = std::max(std::max(triangle[0][2], triangle[1][2]), triangle[2][2]);
+        int const last = mGridSize - 1;
+        y0 = std::min(static_cast<int>((ymin - mYMin) * mYInvCellSize), last);
+        y1 = std::min(static_cast<int>((ymax - mYMin) * mYInvCellSize), last);
+        z0 = std::min(static_cast<int>((zmin - mZMin) * mZInvCellSize), last);
+        z1 = std::min(static_cast<int>((zmax - mZMin) * mZInvCellSize), last);
+    };
+
+    int const numCells = mGridSize * mGridSize;
+    mCellStart.assign(numCells + 1, 0);
+    int y0, y1, z0, z1;
+    for (auto const& triangle : mTriangles)
+    {
+        getCells(triangle, y0, y1, z0, z1);
+        for (int iz = z0; iz <= z1; ++iz)
+        {
+            for (int iy = y0; iy <= y1; ++iy)
+            {
+                ++mCellStart[iy + mGridSize * iz + 1];
+            }
+        }
+    }
+    for (int c = 0; c < numCells; ++c)
+    {
+        mCellStart[c + 1] += mCellStart[c];
+    }
+
+    mCellTriangles.resize(mCellStart[numCells]);
+    std::vector<int> next(mCellStart.begin(), mCellStart.end() - 1);
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        getCells(mTriangles[t], y0, y1, z0, z1);
+        for (int iz = z0; iz <= z1; ++iz)
+        {
+            for (int iy = y0; iy <= y1; ++iy)
+            {
+                mCellTriangles[next[iy + mGridSize * iz]++] = t;
+            }
+        }
+    }
+}
+
+template <typename Real>
+bool PointInTriangleMesh3<Real>::Contains(Vector3<Real> const& point) const
+{
+    return (GetCrossings(point[1], point[2], &point[0], nullptr) & 1) != 0;
+}
+
+template <typename Real>
+void PointInTriangleMesh3<Real>::Contains(int numPoints,
+    Vector3<Real> const* points, uint8_t* inside) const
+{
+    ParallelFor(mNumThreads, numPoints, [this, points, inside](unsigned int,
+        int imin, int imax)
+    {
+        for (int i = imin; i < imax; ++i)
+        {
+            inside[i] = (Contains(points[i]) ? 1 : 0);
+        }
+    });
+}
+
+template <typename Real>
+void PointInTriangleMesh3<Real>::ContainsRow(Real x0, Real dx, Real y, Real z,
+    int numPoints, uint8_t* inside) const
+{
+    std::vector<Real> crossings;
+    ContainsRow(x0, dx, y, z, numPoints, inside, crossings);
+}
+
+template <typename Real>
+void PointInTriangleMesh3<Real>::ContainsRow(Real x0, Real dx, Real y, Real z,
+    int numPoints, uint8_t* inside, std::vector<Real>& crossings) const
+{
+    crossings.clear();
+    GetCrossings(y, z, nullptr, &crossings);
+    std::sort(crossings.begin(), crossings.end());
+
+    // A point is inside when the number of crossings with x-values larger
+    // than the point's x-value is odd.
+    int const numCrossings = static_cast<int>(crossings.size());
+    int numPassed = 0;
+    for (int i = 0; i < numPoints; ++i)
+    {
+        Real x = x0 + dx * (Real)i;
+        while (numPassed < numCrossings && crossings[numPassed] <= x)
+        {
+            ++numPassed;
+        }
+        inside[i] = static_cast<uint8_t>((numCrossings - numPassed) & 1);
+    }
+}
+
+template <typename Real>
+void PointInTriangleMesh3<Real>::ContainsGrid(Vector3<Real> const& origin,
+    Vector3<Real> const& spacing, std::array<int, 3> const& size,
+    uint8_t* inside) const
+{
+    int const numRows = size[1] * size[2];
+    ParallelFor(mNumThreads, numRows, [this, &origin, &spacing, &size,
+        inside](unsigned int, int rmin, int rmax)
+    {
+        std::vector<Real> crossings;
+        for (int r = rmin; r < rmax; ++r)
+        {
+            int i1 = r % size[1];
+            int i2 = r / size[1];
+            ContainsRow(origin[0], spacing[0], origin[1] + spacing[1] * (Real)i1,
+                origin[2] + spacing[2] * (Real)i2, size[0],
+                inside + static_cast<size_t>(size[0]) * r, crossings);
+        }
+    });
+}
+
+template <typename Real>
+int PointInTriangleMesh3<Real>::GetCrossings(Real y, Real z,
+    Real const* xMin, std::vector<Real>* crossings) const
+{
+    Real fy = (y - mYMin) * mYInvCellSize;
+    Real fz = (z - mZMin) * mZInvCellSize;
+    if (fy < (Real)0 || fz < (Real)0 || fy > (Real)mGridSize || fz > (Real)mGridSize)
+    {
+        // The line does not intersect the bounding box of the mesh.
+        return 0;
+    }
+
+    int const last = mGridSize - 1;
+    int iy = std::min(static_cast<int>(fy), last);
+    int iz = std::min(static_cast<int>(fz), last);
+    int cell = iy + mGridSize * iz;
+    int numCrossings = 0;
+    Real x;
+    for (int i = mCellStart[cell]; i < mCellStart[cell + 1]; ++i)
+    {
+        if (GetCrossing(mTriangles[mCellTriangles[i]], y, z, x))
+        {
+            if (crossings)
+            {
+                crossings->push_back(x);
+                ++numCrossings;
+            }
+            else if (!xMin || x > *xMin)
+            {
+                ++numCrossings;
+            }
+        }
+    }
+    return numCrossings;
+}
+
+template <typename Real>
+bool PointInTriangleMesh3<Real>::GetCrossing(
+    std::array<Vector3<Real>, 3> const& triangle, Real y, Real z, Real& x) const
+{
+    // The edge functions are computed for the projections (y,z) of the
+    // vertices.  Each edge is processed with its endpoints in lexicographic
+    // order so that the triangles sharing the edge compute the same value,
+    // up to sign.  A zero value is replaced by the sign of the derivative
+    // of the edge function in the perturbation direction (1,epsilon).
+    std::array<Real, 3> e;
+    for (int i0 = 2, i1 = 0; i1 < 3; i0 = i1++)
+    {
+        Vector3<Real> const* a = &triangle[i0];
+        Vector3<Real> const* b = &triangle[i1];
+        Real sign = (Real)1;
+        if ((*b)[1] < (*a)[1] || ((*b)[1] == (*a)[1] && (*b)[2] < (*a)[2]))
+        {
+            std::swap(a, b);
+            sign = (Real)-1;
+        }
+
+        Real du = (*b)[1] - (*a)[1], dv = (*b)[2] - (*a)[2];
+        Real w = du * (z - (*a)[2]) - dv * (y - (*a)[1]);
+        if (w == (Real)0)
+        {
+            // The cross product of (du,dv) and the perturbation (1,epsilon)
+            // is du*epsilon - dv.  The lexicographic order guarantees du >= 0
+            // and, when du = 0, dv > 0.  For a nondegenerate edge the sign
+            // is therefore that of -dv unless dv = 0.
+            w = (dv != (Real)0 ? -dv : du);
+        }
+
+        // e[k] is the barycentric weight of the vertex opposite the edge,
+        // which is triangle[(i1+1)%3].
+        e[(i1 + 1) % 3] = sign * w;
+    }
+
+    bool positive = (e[0] > (Real)0 && e[1] > (Real)0 && e[2] > (Real)0);
+    bool negative = (e[0] < (Real)0 && e[1] < (Real)0 && e[2] < (Real)0);
+    if (!positive && !negative)
+    {
+        return false;
+    }
+
+    Real sum = e[0] + e[1] + e[2];
+    x = (e[0] * triangle[0][0] + e[1] * triangle[1][0] + e[2] * triangle[2][0]) / sum;
+    return true;
+}
+
+}
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.1 (2019/07/30)
+// File Version: 3.0.2 (2019/09/12)
 
 #pragma once
 
@@ -26,11 +26,33 @@
 //    double     | BSNumber     |  132
 //    float      | BSRational   |  214
 //    double     | BSRational   | 1587
+//
+// Most points of a dense point cloud are interior to the hull.  The optional
+// Akl-Toussaint prefilter computes the input points that are extreme in the
+// directions (1,0), (0,1), (1,1) and (1,-1) and their negatives.  These
+// points are the vertices of a convex polygon (an octagon when the points
+// are distinct) contained in the hull.  A point strictly inside the octagon
+// cannot be a hull vertex, so it is discarded before the exact computations.
+// The point-in-octagon tests use InputType arithmetic with the error bound
+// for the orientation test of J. Shewchuk, "Adaptive Precision
+// Floating-Point Arithmetic and Fast Robust Geometric Predicates."  A point
+// is discarded only when the sign of each test is certain, so the prefilter
+// does not change the hull.
+//
+// For multithreading, the prefilter, the conversion of the points to
+// ComputeType and the sorting of the points are partitioned among the
+// threads.  The divide-and-conquer hull is computed for a contiguous subset
+// of the sorted points in each thread, and the subhulls are merged by the
+// calling thread.  The hull does not depend on the number of threads, but
+// the first vertex of its counterclockwise list can.
 
 #include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GtePrimalQuery2.h>
 #include <Mathematics/GteLine.h>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <vector>
 
 // Uncomment this to assert when an infinite loop is encountered in
@@ -45,8 +67,12 @@ class ConvexHull2
 {
 public:
     // The class is a functor to support computing the convex hull of multiple
-    // data sets using the same class object.
-    ConvexHull2();
+    // data sets using the same class object.  For multithreading, choose
+    // 'numThreads' subject to the constraints
+    //     1 <= numThreads <= std::thread::hardware_concurrency().
+    // Set 'usePrefilter' to 'true' to discard points strictly inside the
+    // Akl-Toussaint octagon before the exact computations.
+    ConvexHull2(unsigned int numThreads = 1, bool usePrefilter = false);
 
     // The input is the array of points whose convex hull is required.  The
     // epsilon value is used to determine the intrinsic dimensionality of the
@@ -64,7 +90,11 @@ public:
     inline int GetDimension() const;
     inline Line2<InputType> const& GetLine() const;
 
-    // Member access.
+    // Member access.  When the prefilter is used, GetNumUniquePoints() is the
+    // number of unique points that are not discarded by the prefilter.  The
+    // query vertices are the input points converted to ComputeType; when the
+    // prefilter is used, only the vertices for points not discarded by the
+    // prefilter are converted.
     inline int GetNumPoints() const;
     inline int GetNumUniquePoints() const;
     inline Vector2<InputType> const* GetPoints() const;
@@ -75,6 +105,13 @@ public:
     inline std::vector<int> const& GetHull() const;
 
 private:
+    // Store in mHull the indices of the points not discarded by the
+    // Akl-Toussaint prefilter.
+    void Prefilter();
+
+    // Sort mHull by the lexicographic order of the points.
+    void SortHull();
+
     // Support for divide-and-conquer.
     void GetHull(int& i0, int& i1);
     void Merge(int j0, int j1, int j2, int j3, int& i0, int& i1);
@@ -101,18 +138,23 @@ private:
     int mNumUniquePoints;
     Vector2<InputType> const* mPoints;
     std::vector<int> mMerged, mHull;
+    unsigned int mNumThreads;
+    bool mUsePrefilter;
 };
 
 
 template <typename InputType, typename ComputeType>
-ConvexHull2<InputType, ComputeType>::ConvexHull2()
+ConvexHull2<InputType, ComputeType>::ConvexHull2(unsigned int numThreads,
+    bool usePrefilter)
     :
     mEpsilon((InputType)0),
     mDimension(0),
     mLine(Vector2<InputType>::Zero(), Vector2<InputType>::Zero()),
     mNumPoints(0),
     mNumUniquePoints(0),
-    mPoints(nullptr)
+    mPoints(nullptr),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mUsePrefilter(usePrefilter)
 {
 }
 
@@ -130,7 +172,7 @@ bool ConvexHull2<InputType, ComputeType>::operator()(int numPoints,
     mMerged.clear();
     mHull.clear();
 
-    int i, j;
+    int i;
     if (mNumPoints < 3)
     {
         // ConvexHull2 should be called with at least three points.
@@ -154,32 +196,40 @@ bool ConvexHull2<InputType, ComputeType>::operator()(int numPoints,
 
     mDimension = 2;
 
-    // Compute the points for the queries.
-    mComputePoints.resize(mNumPoints);
-    mQuery.Set(mNumPoints, &mComputePoints[0]);
-    for (i = 0; i < mNumPoints; ++i)
+    // Select the points to be processed.
+    if (mUsePrefilter)
     {
-        for (j = 0; j < 2; ++j)
+        Prefilter();
+    }
+    else
+    {
+        mHull.resize(mNumPoints);
+        for (i = 0; i < mNumPoints; ++i)
         {
-            mComputePoints[i][j] = points[i][j];
+            mHull[i] = i;
         }
     }
 
-    // Sort the points.
-    mHull.resize(mNumPoints);
-    for (i = 0; i < mNumPoints; ++i)
-    {
-        mHull[i] = i;
-    }
-    std::sort(mHull.begin(), mHull.end(),
-        [points](int i0, int i1)
+    // Compute the points for the queries.
+    mComputePoints.resize(mNumPoints);
+    mQuery.Set(mNumPoints, &mComputePoints[0]);
+    ParallelFor(mNumThreads, static_cast<int>(mHull.size()),
+        [this, points](unsigned int, int kmin, int kmax)
         {
-            if (points[i0][0] < points[i1][0]) { return true; }
-            if (points[i0][0] > points[i1][0]) { return false; }
-            return points[i0][1] < points[i1][1];
+            for (int k = kmin; k < kmax; ++k)
+            {
+                int h = mHull[k];
+                for (int c = 0; c < 2; ++c)
+                {
+                    mComputePoints[h][c] = points[h][c];
+                }
+            }
         }
     );
 
+    // Sort the points.
+    SortHull();
+
     // Remove duplicates.
     auto newEnd = std::unique(mHull.begin(), mHull.end(),
         [points](int i0, int i1)
@@ -191,10 +241,34 @@ bool ConvexHull2<InputType, ComputeType>::operator()(int numPoints,
     mNumUniquePoints = static_cast<int>(mHull.size());
 
     // Use a divide-and-conquer algorithm.  The merge step computes the
-    // convex hull of two convex polygons.
+    // convex hull of two convex polygons.  Each thread computes the hull of
+    // a contiguous subset of the sorted points.  The subhulls are stored at
+    // the beginning of their subsets, so they are moved to be contiguous
+    // and then merged in left-to-right order.
     mMerged.resize(mNumUniquePoints);
-    int i0 = 0, i1 = mNumUniquePoints - 1;
-    GetHull(i0, i1);
+    std::vector<std::pair<int, int>> subhull(mNumThreads,
+        std::make_pair(0, -1));
+    ParallelFor(mNumThreads, mNumUniquePoints,
+        [this, &subhull](unsigned int t, int kmin, int kmax)
+        {
+            int k0 = kmin, k1 = kmax - 1;
+            GetHull(k0, k1);
+            subhull[t] = std::make_pair(k0, k1);
+        }
+    );
+
+    int i0 = subhull[0].first, i1 = subhull[0].second;
+    for (unsigned int t = 1; t < mNumThreads; ++t)
+    {
+        int j0 = subhull[t].first, j1 = subhull[t].second;
+        if (j0 <= j1)
+        {
+            int j2 = i1 + 1, j3 = j2 + (j1 - j0);
+            std::copy(mHull.begin() + j0, mHull.begin() + j1 + 1,
+                mHull.begin() + j2);
+            Merge(i0, i1, j2, j3, i0, i1);
+        }
+    }
     mHull.resize(i1 - i0 + 1);
     return true;
 }
@@ -247,6 +321,197 @@ std::vector<int> const& ConvexHull2<InputType, ComputeType>::GetHull() const
     return mHull;
 }
 
+template <typename InputType, typename ComputeType>
+void ConvexHull2<InputType, ComputeType>::Prefilter()
+{
+    // Compute the indices of the extreme points for the directions
+    // D[k] = (dx[k],dy[k]), which are -(0,1), (1,-1), (1,0), (1,1), (0,1),
+    // -(1,-1), -(1,0) and -(1,1).  The extreme points are in
+    // counterclockwise order.
+    Vector2<InputType> const* points = mPoints;
+    std::vector<std::array<int, 8>> threadExtreme(mNumThreads);
+    std::vector<std::array<InputType, 8>> threadValue(mNumThreads);
+    ParallelFor(mNumThreads, mNumPoints,
+        [points, &threadExtreme, &threadValue](unsigned int t, int imin,
+        int imax)
+        {
+            InputType const dx[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+            InputType const dy[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+            std::array<int, 8>& extreme = threadExtreme[t];
+            std::array<InputType, 8>& value = threadValue[t];
+            for (int k = 0; k < 8; ++k)
+            {
+                extreme[k] = imin;
+                value[k] = dx[k] * points[imin][0] + dy[k] * points[imin][1];
+            }
+            for (int i = imin + 1; i < imax; ++i)
+            {
+                for (int k = 0; k < 8; ++k)
+                {
+                    InputType v = dx[k] * points[i][0] + dy[k] * points[i][1];
+                    if (v > value[k])
+                    {
+                        extreme[k] = i;
+                        value[k] = v;
+                    }
+                }
+            }
+        }
+    );
+
+    // Reduce the per-thread extremes.  When the number of points is smaller
+    // than the number of threads, only thread 0 is used.
+    std::array<int, 8> extreme = threadExtreme[0];
+    std::array<InputType, 8> value = threadValue[0];
+    unsigned int const numUsed = (mNumPoints >= static_cast<int>(mNumThreads) ?
+        mNumThreads : 1);
+    for (unsigned int t = 1; t < numUsed; ++t)
+    {
+        for (int k = 0; k < 8; ++k)
+        {
+            if (threadValue[t][k] > value[k])
+            {
+                extreme[k] = threadExtreme[t][k];
+                value[k] = threadValue[t][k];
+            }
+        }
+    }
+
+    // Remove consecutive duplicate points from the polygon.
+    std::vector<int> polygon;
+    for (int k = 0; k < 8; ++k)
+    {
+        if (polygon.size() == 0 || points[polygon.back()] != points[extreme[k]])
+        {
+            polygon.push_back(extreme[k]);
+        }
+    }
+    while (polygon.size() > 1 && points[polygon.back()] == points[polygon[0]])
+    {
+        polygon.pop_back();
+    }
+
+    mHull.clear();
+    if (polygon.size() < 3)
+    {
+        // The polygon is degenerate and no point is strictly inside it.
+        mHull.resize(mNumPoints);
+        for (int i = 0; i < mNumPoints; ++i)
+        {
+            mHull[i] = i;
+        }
+        return;
+    }
+
+    // A point Q is strictly inside the polygon when it is strictly left of
+    // each directed edge <A,B>, which is the case when the orientation
+    // determinant (A-Q)x(B-Q) is positive.  Because the polygon vertices are
+    // input points, the point is then strictly inside the hull.  The sign of
+    // the determinant computed with InputType arithmetic is certain when
+    // its magnitude exceeds the error bound.
+    InputType const errorFactor = (InputType)4 *
+        std::numeric_limits<InputType>::epsilon();
+    int const numPolygon = static_cast<int>(polygon.size());
+    std::vector<std::vector<int>> threadKeep(mNumThreads);
+    ParallelFor(mNumThreads, mNumPoints,
+        [points, errorFactor, numPolygon, &polygon, &threadKeep](
+        unsigned int t, int imin, int imax)
+        {
+            std::vector<int>& keep = threadKeep[t];
+            for (int i = imin; i < imax; ++i)
+            {
+                InputType qx = points[i][0], qy = points[i][1];
+                bool inside = true;
+                for (int k0 = numPolygon - 1, k1 = 0; k1 < numPolygon;
+                    k0 = k1++)
+                {
+                    Vector2<InputType> const& A = points[polygon[k0]];
+                    Vector2<InputType> const& B = points[polygon[k1]];
+                    InputType detLeft = (A[0] - qx) * (B[1] - qy);
+                    InputType detRight = (A[1] - qy) * (B[0] - qx);
+                    InputType det = detLeft - detRight;
+                    if (det <= errorFactor *
+                        (std::abs(detLeft) + std::abs(detRight)))
+                    {
+                        inside = false;
+                        break;
+                    }
+                }
+                if (!inside)
+                {
+                    keep.push_back(i);
+                }
+            }
+        }
+    );
+
+    for (auto const& keep : threadKeep)
+    {
+        mHull.insert(mHull.end(), keep.begin(), keep.end());
+    }
+}
+
+template <typename InputType, typename ComputeType>
+void ConvexHull2<InputType, ComputeType>::SortHull()
+{
+    // Duplicate points are ordered by index, so the index that is kept by
+    // the removal of duplicates does not depend on the number of threads.
+    Vector2<InputType> const* points = mPoints;
+    auto lessThan = [points](int i0, int i1)
+    {
+        if (points[i0][0] < points[i1][0]) { return true; }
+        if (points[i0][0] > points[i1][0]) { return false; }
+        if (points[i0][1] < points[i1][1]) { return true; }
+        if (points[i0][1] > points[i1][1]) { return false; }
+        return i0 < i1;
+    };
+
+    // Sort contiguous subsets of the indices in the threads.
+    int const numIndices = static_cast<int>(mHull.size());
+    std::vector<std::pair<int, int>> range(mNumThreads,
+        std::make_pair(numIndices, numIndices));
+    ParallelFor(mNumThreads, numIndices,
+        [this, &lessThan, &range](unsigned int t, int kmin, int kmax)
+        {
+            std::sort(mHull.begin() + kmin, mHull.begin() + kmax, lessThan);
+            range[t] = std::make_pair(kmin, kmax);
+        }
+    );
+
+    // Merge pairs of adjacent sorted subsets until one subset remains.  The
+    // merges of each pass are executed concurrently.
+    range.erase(std::remove_if(range.begin(), range.end(),
+        [](std::pair<int, int> const& r) { return r.first >= r.second; }),
+        range.end());
+    while (range.size() > 1)
+    {
+        int const numPairs = static_cast<int>(range.size() / 2);
+        ParallelFor(static_cast<unsigned int>(numPairs), numPairs,
+            [this, &lessThan, &range](unsigned int, int pmin, int pmax)
+            {
+                for (int p = pmin; p < pmax; ++p)
+                {
+                    std::inplace_merge(mHull.begin() + range[2 * p].first,
+                        mHull.begin() + range[2 * p].second,
+                        mHull.begin() + range[2 * p + 1].second, lessThan);
+                }
+            }
+        );
+
+        std::vector<std::pair<int, int>> merged;
+        for (int p = 0; p < numPairs; ++p)
+        {
+            merged.push_back(std::make_pair(range[2 * p].first,
+                range[2 * p + 1].second));
+        }
+        if (range.size() % 2 == 1)
+        {
+            merged.push_back(range.back());
+        }
+        range = std::move(merged);
+    }
+}
+
 template <typename InputType, typename ComputeType> inline
 void ConvexHull2<InputType, ComputeType>::GetHull(int& i0, int& i1)
 {
@@ -273,7 +538,9 @@ void ConvexHull2<InputType, ComputeType>::Merge(int j0, int j1, int j2, int j3,
 {
     // Subhull0 is to the left of subhull1 because of the initial sorting of
     // the points by x-components.  We need to find two mutually visible
-    // points, one on the left subhull and one on the right subhull.
+    // points, one on the left subhull and one on the right subhull.  The
+    // merged hull is stored in mMerged[] starting at index j0, so the
+    // merges of disjoint subsets can be executed concurrently.
     int size0 = j1 - j0 + 1;
     int size1 = j3 - j2 + 1;
 
@@ -321,7 +588,7 @@ void ConvexHull2<InputType, ComputeType>::Merge(int j0, int j1, int j2, int j3,
     i = iUL;
     for (k = 0; k < size0; ++k)
     {
-        mMerged[numMerged++] = mHull[i];
+        mMerged[j0 + numMerged++] = mHull[i];
         if (i == iLL)
         {
             break;
@@ -333,7 +600,7 @@ void ConvexHull2<InputType, ComputeType>::Merge(int j0, int j1, int j2, int j3,
     i = iLR;
     for (k = 0; k < size1; ++k)
     {
-        mMerged[numMerged++] = mHull[i];
+        mMerged[j0 + numMerged++] = mHull[i];
         if (i == iUR)
         {
             break;
@@ -345,7 +612,7 @@ void ConvexHull2<InputType, ComputeType>::Merge(int j0, int j1, int j2, int j3,
     int next = j0;
     for (k = 0; k < numMerged; ++k)
     {
-        mHull[next] = mMerged[k];
+        mHull[next] = mMerged[j0 + k];
         ++next;
     }
 
@@ -3,16 +3,39 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/12)
 
 #pragma once
 
-// Compute the convex hull of 3D points using incremental insertion.  The only
-// way to ensure a correct result for the input vertices (assumed to be exact)
-// is to choose ComputeType for exact rational arithmetic.  You may use
+// Compute the convex hull of 3D points using the QuickHull algorithm.  The
+// only way to ensure a correct result for the input vertices (assumed to be
+// exact) is to choose ComputeType for exact rational arithmetic.  You may use
 // BSNumber.  No divisions are performed in this computation, so you do not
 // have to use BSRational.
 //
+// Each face of the current hull stores a conflict list, which is the set of
+// points not yet processed that are strictly on the positive side of the
+// face plane.  The point of a conflict list that is farthest from its face
+// is inserted, the faces visible to it are replaced by faces connecting the
+// point to the horizon edges, and the conflict points of the removed faces
+// are assigned to the new faces; points that are not assigned are inside the
+// hull and are discarded.  The visibility tests use the exact sign
+// PrimalQuery3<ComputeType>::ToPlane.  The farthest point is selected using
+// InputType arithmetic, which affects only the order of insertion, not the
+// correctness of the hull.  The point-plane tests for the initial assignment
+// of all points and for reassignments of large conflict lists are
+// partitioned among the threads.
+//
+// A point that lies on the boundary of the hull, inside a planar face or on
+// an edge, is a vertex of the hull.  Each face stores the points that are
+// exactly on its plane and not outside the current hull.  These lists are
+// passed to the new faces when a face is removed.  After the last insertion,
+// each of the points is located by a walk over the triangles of its planar
+// face, and the triangle that contains it, or the two triangles that share
+// the edge that contains it, are split.  Duplicates of hull vertices are
+// discarded.  The hull is a triangulation of the convex polyhedron, and
+// planar faces with more than three vertices are triangulated.
+//
 // The worst-case choices of N for Real of type BSNumber or BSRational with
 // integer storage UIntegerFP32<N> are listed in the next table.  The numerical
 // computations are encapsulated in PrimalQuery3<Real>::ToPlane.  We recommend
@@ -26,13 +49,13 @@
 //    float      | BSRational   |  2882
 //    double     | BSRational   | 21688
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteETManifoldMesh.h>
 #include <Mathematics/GtePrimalQuery3.h>
 #include <Mathematics/GteLine.h>
 #include <Mathematics/GteHyperplane.h>
-#include <functional>
-#include <set>
-#include <thread>
+#include <algorithm>
+#include <limits>
 #include <vector>
 
 namespace gte
@@ -43,8 +66,8 @@ class ConvexHull3
 {
 public:
     // The class is a functor to support computing the convex hull of multiple
-    // data sets using the same class object.  For multithreading in Update,
-    // choose 'numThreads' subject to the constraints
+    // data sets using the same class object.  For multithreading of the
+    // point-plane tests, choose 'numThreads' subject to the constraints
     //     1 <= numThreads <= std::thread::hardware_concurrency().
     ConvexHull3(unsigned int numThreads = 1);
 
@@ -80,8 +103,45 @@ public:
     ETManifoldMesh const& GetHullMesh() const;
 
 private:
-    // Support for incremental insertion.
-    void Update(int i);
+    // A face of the hull.  The vertices are counterclockwise when viewed
+    // from outside the hull.  The face adjacent[j] shares the edge
+    // <vertex[j],vertex[(j+1)%3]>.  The conflict list stores the indices of
+    // the points that are strictly outside the face plane; the point
+    // 'farthest' has the largest (approximate) height above the plane.  The
+    // coplanar list stores the indices of the points on the face plane that
+    // are not outside the hull.
+    struct Face
+    {
+        int vertex[3];
+        int adjacent[3];
+        std::vector<int> conflict;
+        std::vector<int> coplanar;
+        int farthest;
+        InputType height;
+        int mark;
+        bool alive;
+    };
+
+    // Support for QuickHull.
+    int CreateFace(int v0, int v1, int v2);
+    void Assign(std::vector<int> const& points, std::vector<int> const& faces);
+    void Insert(int f);
+
+    // Support for the points on the boundary of the hull.  Locate returns
+    // the face that contains point p, starting the walk at face f, and sets
+    // 'edge' to the index of the face edge that contains p, or to -1 when p
+    // is inside the face, or to -2 when p is a vertex of the face.  The
+    // point d must be off the plane of face f.
+    void InsertCoplanar();
+    int Locate(int p, int f, int d, int& edge);
+    int SideOfEdge(int p, int f, int j, int d) const;
+    void Split(int p, int f, int edge);
+    void Replace(int f, int oldAdjacent, int newAdjacent);
+
+    // The number of points for which the point-plane tests of Assign are
+    // partitioned among the threads.  Smaller sets are processed by the
+    // calling thread to avoid the cost of launching the threads.
+    enum { MIN_POINTS_PER_THREAD = 1024 };
 
     // The epsilon value is used for fuzzy determination of intrinsic
     // dimensionality.  If the dimension is 0, 1, or 2, the constructor
@@ -109,6 +169,20 @@ private:
     std::vector<TriangleKey<true>> mHullUnordered;
     mutable ETManifoldMesh mHullMesh;
     unsigned int mNumThreads;
+
+    // Storage for QuickHull.  The array mHorizonFace[v] stores the new face
+    // whose horizon edge starts at vertex v.  The mAssign* arrays store the
+    // face, the height and the coplanar face computed for each point by
+    // Assign.  The mExtreme array stores the vertices of the initial
+    // tetrahedron; at least one of them is off the plane of any face.
+    std::vector<Face> mFaces;
+    std::vector<int> mHorizonFace;
+    std::vector<int> mAssignFace;
+    std::vector<InputType> mAssignHeight;
+    std::vector<int> mAssignCoplanar;
+    int mExtreme[4];
+    int mMark;
+    unsigned int mWalk;
 };
 
 
@@ -122,7 +196,9 @@ ConvexHull3<InputType, ComputeType>::ConvexHull3(unsigned int numThreads)
     mNumPoints(0),
     mNumUniquePoints(0),
     mPoints(nullptr),
-    mNumThreads(numThreads)
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mMark(0),
+    mWalk(0)
 {
 }
 
@@ -175,6 +251,14 @@ bool ConvexHull3<InputType, ComputeType>::operator()(int numPoints,
 
     mDimension = 3;
 
+    // Count the unique points, as the incremental algorithm did.
+    std::vector<Vector3<InputType>> sorted(mPoints, mPoints + mNumPoints);
+    std::sort(sorted.begin(), sorted.end());
+    mNumUniquePoints = static_cast<int>(
+        std::unique(sorted.begin(), sorted.end()) - sorted.begin());
+    sorted.clear();
+    sorted.shrink_to_fit();
+
     // Compute the vertices for the queries.
     mComputePoints.resize(mNumPoints);
     mQuery.Set(mNumPoints, &mComputePoints[0]);
@@ -193,32 +277,97 @@ bool ConvexHull3<InputType, ComputeType>::operator()(int numPoints,
         std::swap(info.extreme[2], info.extreme[3]);
     }
 
-    mHullUnordered.push_back(TriangleKey<true>(info.extreme[1],
-        info.extreme[2], info.extreme[3]));
-    mHullUnordered.push_back(TriangleKey<true>(info.extreme[0],
-        info.extreme[3], info.extreme[2]));
-    mHullUnordered.push_back(TriangleKey<true>(info.extreme[0],
-        info.extreme[1], info.extreme[3]));
-    mHullUnordered.push_back(TriangleKey<true>(info.extreme[0],
-        info.extreme[2], info.extreme[1]));
-
-    // Incrementally update the hull.  The set of processed points is
-    // maintained to eliminate duplicates, either in the original input
-    // points or in the points obtained by snap rounding.
-    std::set<Vector3<InputType>> processed;
+    mFaces.clear();
+    mMark = 0;
+    mWalk = 0;
     for (i = 0; i < 4; ++i)
     {
-        processed.insert(points[info.extreme[i]]);
+        mExtreme[i] = info.extreme[i];
     }
+    int const extreme[4][3] =
+    {
+        { info.extreme[1], info.extreme[2], info.extreme[3] },
+        { info.extreme[0], info.extreme[3], info.extreme[2] },
+        { info.extreme[0], info.extreme[1], info.extreme[3] },
+        { info.extreme[0], info.extreme[2], info.extreme[1] }
+    };
+    std::vector<int> faces(4);
+    for (i = 0; i < 4; ++i)
+    {
+        faces[i] = CreateFace(extreme[i][0], extreme[i][1], extreme[i][2]);
+    }
+
+    // Each edge <a,b> of a tetrahedron face is shared with the face that
+    // has the edge <b,a>.
+    for (auto& face : mFaces)
+    {
+        for (int j0 = 0, j1 = 1; j0 < 3; ++j0, j1 = (j1 + 1) % 3)
+        {
+            for (int f = 0; f < 4; ++f)
+            {
+                for (int k0 = 0, k1 = 1; k0 < 3; ++k0, k1 = (k1 + 1) % 3)
+                {
+                    if (mFaces[f].vertex[k0] == face.vertex[j1]
+                        && mFaces[f].vertex[k1] == face.vertex[j0])
+                    {
+                        face.adjacent[j0] = f;
+                    }
+                }
+            }
+        }
+    }
+
+    // Assign the remaining points to the conflict lists.  Points that are
+    // duplicates of processed points are never strictly outside a face, so
+    // they are assigned to coplanar lists and discarded by InsertCoplanar.
+    std::vector<int> remaining;
+    remaining.reserve(mNumPoints);
     for (i = 0; i < mNumPoints; ++i)
     {
-        if (processed.find(points[i]) == processed.end())
+        if (i != info.extreme[0] && i != info.extreme[1]
+            && i != info.extreme[2] && i != info.extreme[3])
+        {
+            remaining.push_back(i);
+        }
+    }
+    mHorizonFace.resize(mNumPoints);
+    Assign(remaining, faces);
+
+    // Insert the farthest point of each conflict list until all conflict
+    // lists are empty.  The faces are processed in the order of a stack;
+    // the new faces of an insertion are pushed by Insert.
+    std::vector<int> pending = faces;
+    while (pending.size() > 0)
+    {
+        int f = pending.back();
+        pending.pop_back();
+        if (mFaces[f].alive && mFaces[f].conflict.size() > 0)
+        {
+            int const first = static_cast<int>(mFaces.size());
+            Insert(f);
+            for (int k = first; k < static_cast<int>(mFaces.size()); ++k)
+            {
+                if (mFaces[k].conflict.size() > 0)
+                {
+                    pending.push_back(k);
+                }
+            }
+        }
+    }
+
+    InsertCoplanar();
+
+    for (auto const& face : mFaces)
+    {
+        if (face.alive)
         {
-            Update(i);
-            processed.insert(points[i]);
+            mHullUnordered.push_back(TriangleKey<true>(face.vertex[0],
+                face.vertex[1], face.vertex[2]));
         }
     }
-    mNumUniquePoints = static_cast<int>(processed.size());
+
+    // Release the faces.
+    mFaces.clear();
     return true;
 }
 
@@ -292,139 +441,374 @@ ETManifoldMesh const& ConvexHull3<InputType, ComputeType>::GetHullMesh() const
 }
 
 template <typename InputType, typename ComputeType>
-void ConvexHull3<InputType, ComputeType>::Update(int i)
+int ConvexHull3<InputType, ComputeType>::CreateFace(int v0, int v1, int v2)
 {
-    // The terminator that separates visible faces from nonvisible faces is
-    // constructed by this code.  Visible faces for the incoming hull are
-    // removed, and the boundary of that set of triangles is the terminator.
-    // New visible faces are added using the incoming point and the edges of
-    // the terminator.
-    //
-    // A simple algorithm for computing terminator edges is the following.
-    // Back-facing triangles are located and the three edges are processed.
-    // The first time an edge is visited, insert it into the terminator.  If
-    // it is visited a second time, the edge is removed because it is shared
-    // by another back-facing triangle and, therefore, cannot be a terminator
-    // edge.  After visiting all back-facing triangles, the only remaining
-    // edges in the map are the terminator edges.
-    //
-    // The order of vertices of an edge is important for adding new faces with
-    // the correct vertex winding.  However, the edge "toggle" (insert edge,
-    // remove edge) should use edges with unordered vertices, because the
-    // edge shared by one triangle has opposite ordering relative to that of
-    // the other triangle.  The map uses unordered edges as the keys but
-    // stores the ordered edge as the value.  This avoids having to look up
-    // an edge twice in a map with ordered edge keys.
-
-    unsigned int numFaces = static_cast<unsigned int>(mHullUnordered.size());
-    std::vector<int> queryResult(numFaces);
-    if (mNumThreads > 1 && numFaces >= mNumThreads)
+    Face face;
+    face.vertex[0] = v0;
+    face.vertex[1] = v1;
+    face.vertex[2] = v2;
+    face.adjacent[0] = -1;
+    face.adjacent[1] = -1;
+    face.adjacent[2] = -1;
+    face.farthest = -1;
+    face.height = (InputType)0;
+    face.mark = 0;
+    face.alive = true;
+    mFaces.push_back(std::move(face));
+    return static_cast<int>(mFaces.size()) - 1;
+}
+
+template <typename InputType, typename ComputeType>
+void ConvexHull3<InputType, ComputeType>::Assign(std::vector<int> const& points,
+    std::vector<int> const& faces)
+{
+    // Each point is assigned to the first face for which it is strictly on
+    // the positive side of the plane.  The heights are used only to select
+    // the farthest point of a conflict list.  A point that is on the
+    // positive side of no face is inside or on the hull.  It is assigned to
+    // the coplanar list of the first face whose plane contains it, if any.
+    int const numPoints = static_cast<int>(points.size());
+    mAssignFace.resize(numPoints);
+    mAssignHeight.resize(numPoints);
+    mAssignCoplanar.resize(numPoints);
+    unsigned int numThreads = mNumThreads;
+    if (static_cast<long long>(numPoints) <
+        static_cast<long long>(MIN_POINTS_PER_THREAD) * numThreads)
+    {
+        numThreads = 1;
+    }
+
+    ParallelFor(numThreads, numPoints, [this, &points, &faces](
+        unsigned int, int imin, int imax)
     {
-        // Partition the data for multiple threads.
-        unsigned int numFacesPerThread = numFaces / mNumThreads;
-        std::vector<unsigned int> jmin(mNumThreads), jmax(mNumThreads);
-        for (unsigned int t = 0; t < mNumThreads; ++t)
+        for (int i = imin; i < imax; ++i)
         {
-            jmin[t] = t * numFacesPerThread;
-            jmax[t] = jmin[t] + numFacesPerThread - 1;
+            int p = points[i];
+            mAssignFace[i] = -1;
+            mAssignCoplanar[i] = -1;
+            for (auto f : faces)
+            {
+                int const* v = mFaces[f].vertex;
+                int sign = mQuery.ToPlane(p, v[0], v[1], v[2]);
+                if (sign == 0 && mAssignCoplanar[i] == -1)
+                {
+                    mAssignCoplanar[i] = f;
+                }
+                else if (sign > 0)
+                {
+                    Vector3<InputType> const& P0 = mPoints[v[0]];
+                    Vector3<InputType> normal = Cross(mPoints[v[1]] - P0,
+                        mPoints[v[2]] - P0);
+                    mAssignFace[i] = f;
+                    mAssignHeight[i] = Dot(normal, mPoints[p] - P0);
+                    break;
+                }
+            }
+        }
+    });
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        int f = mAssignFace[i];
+        if (f >= 0)
+        {
+            Face& face = mFaces[f];
+            if (face.farthest == -1 || mAssignHeight[i] > face.height)
+            {
+                face.farthest = points[i];
+                face.height = mAssignHeight[i];
+            }
+            face.conflict.push_back(points[i]);
+        }
+        else if (mAssignCoplanar[i] >= 0)
+        {
+            mFaces[mAssignCoplanar[i]].coplanar.push_back(points[i]);
         }
-        jmax[mNumThreads - 1] = numFaces - 1;
+    }
+}
 
-        // Execute the point-plane queries in multiple threads.
-        std::vector<std::thread> process(mNumThreads);
-        for (unsigned int t = 0; t < mNumThreads; ++t)
+template <typename InputType, typename ComputeType>
+void ConvexHull3<InputType, ComputeType>::Insert(int f)
+{
+    // The faces visible to the point are those for which the point is
+    // strictly on the positive side of the plane.  These include face f,
+    // and the visible faces form a connected set.  Its boundary is the
+    // horizon, which is the set of edges shared by a visible face and a
+    // nonvisible face.  The faces whose planes contain the point are not
+    // visible.
+    int const p = mFaces[f].farthest;
+    int const visibleMark = ++mMark;
+    int const hiddenMark = ++mMark;
+
+    // The horizon edges are stored as (visible face, edge index).
+    std::vector<int> visible;
+    std::vector<std::pair<int, int>> horizon;
+    std::vector<int> stack;
+    mFaces[f].mark = visibleMark;
+    stack.push_back(f);
+    while (stack.size() > 0)
+    {
+        int g = stack.back();
+        stack.pop_back();
+        visible.push_back(g);
+        for (int j = 0; j < 3; ++j)
         {
-            process[t] = std::thread([this, i, t, &jmin, &jmax, 
-                &queryResult]()
+            int h = mFaces[g].adjacent[j];
+            Face& adj = mFaces[h];
+            if (adj.mark != visibleMark)
             {
-                for (unsigned int j = jmin[t]; j <= jmax[t]; ++j)
+                if (adj.mark != hiddenMark)
                 {
-                    TriangleKey<true> const& tri = mHullUnordered[j];
-                    queryResult[j] = mQuery.ToPlane(i, tri.V[0], tri.V[1], tri.V[2]);
+                    int const* v = adj.vertex;
+                    if (mQuery.ToPlane(p, v[0], v[1], v[2]) > 0)
+                    {
+                        adj.mark = visibleMark;
+                        stack.push_back(h);
+                        continue;
+                    }
+                    adj.mark = hiddenMark;
                 }
-            });
+                horizon.push_back(std::make_pair(g, j));
+            }
         }
+    }
 
-        // Wait for all threads to finish.
-        for (unsigned int t = 0; t < mNumThreads; ++t)
+    // Create a face <p,a,b> for each horizon edge <a,b> of a visible face.
+    // The nonvisible face adjacent to <a,b> is the neighbor across the
+    // edge <a,b> of the new face.
+    std::vector<int> faces(horizon.size());
+    for (size_t k = 0; k < horizon.size(); ++k)
+    {
+        int g = horizon[k].first, j = horizon[k].second;
+        int a = mFaces[g].vertex[j];
+        int b = mFaces[g].vertex[(j + 1) % 3];
+        int h = mFaces[g].adjacent[j];
+        int n = CreateFace(p, a, b);
+        faces[k] = n;
+        mFaces[n].adjacent[1] = h;
+        for (int i = 0; i < 3; ++i)
         {
-            process[t].join();
+            if (mFaces[h].adjacent[i] == g && mFaces[h].vertex[i] == b)
+            {
+                mFaces[h].adjacent[i] = n;
+                break;
+            }
         }
+        mHorizonFace[a] = n;
     }
-    else
+
+    // The horizon is a simple closed polyline, so the new face <p,a,b> is
+    // adjacent across edge <b,p> to the new face <p,b,c>.
+    for (auto n : faces)
     {
-        unsigned int j = 0;
-        for (auto const& tri : mHullUnordered)
+        int next = mHorizonFace[mFaces[n].vertex[2]];
+        mFaces[n].adjacent[2] = next;
+        mFaces[next].adjacent[0] = n;
+    }
+
+    // Remove the visible faces and assign their conflict points, except p,
+    // and their coplanar points to the new faces.  The coplanar points are
+    // inside or on the new hull, so they are never assigned to a conflict
+    // list.
+    std::vector<int> points;
+    for (auto g : visible)
+    {
+        Face& face = mFaces[g];
+        for (auto i : face.conflict)
         {
-            queryResult[j++] = mQuery.ToPlane(i, tri.V[0], tri.V[1], tri.V[2]);
+            if (i != p)
+            {
+                points.push_back(i);
+            }
         }
+        points.insert(points.end(), face.coplanar.begin(), face.coplanar.end());
+        face.conflict.clear();
+        face.conflict.shrink_to_fit();
+        face.coplanar.clear();
+        face.coplanar.shrink_to_fit();
+        face.alive = false;
     }
+    Assign(points, faces);
+}
 
-    std::map<EdgeKey<false>, std::pair<int, int>> terminator;
-    std::vector<TriangleKey<true>> backFaces;
-    bool existsFrontFacingTriangle = false;
-    unsigned int j = 0;
-    for (auto const& tri : mHullUnordered)
+template <typename InputType, typename ComputeType>
+void ConvexHull3<InputType, ComputeType>::InsertCoplanar()
+{
+    // Each point is in the planar face of the hull that contains its face.
+    // The faces are split in place, so the face of a coplanar list remains
+    // a face of the same plane.  The points of a list are sorted so that
+    // each walk starts near the previous point.
+    int const numFaces = static_cast<int>(mFaces.size());
+    for (int f = 0; f < numFaces; ++f)
     {
-        if (queryResult[j++] <= 0)
+        std::vector<int> coplanar = std::move(mFaces[f].coplanar);
+        mFaces[f].coplanar.clear();
+        if (coplanar.size() == 0)
+        {
+            continue;
+        }
+
+        std::sort(coplanar.begin(), coplanar.end(), [this](int p0, int p1)
+        {
+            return mPoints[p0] < mPoints[p1];
+        });
+
+        int const* v = mFaces[f].vertex;
+        int d = mExtreme[0];
+        for (int i = 0; i < 4; ++i)
         {
-            // The triangle is back facing.  These include triangles that
-            // are coplanar with the incoming point.
-            backFaces.push_back(tri);
-
-            // The current hull is a 2-manifold watertight mesh.  The
-            // terminator edges are those shared with a front-facing triangle.
-            // The first time an edge of a back-facing triangle is visited,
-            // insert it into the terminator.  If it is visited a second time,
-            // the edge is removed because it is shared by another back-facing
-            // triangle.  After all back-facing triangles are visited, the
-            // only remaining edges are shared by a single back-facing
-            // triangle, which makes them terminator edges.
-            for (int j0 = 2, j1 = 0; j1 < 3; j0 = j1++)
+            if (mQuery.ToPlane(mExtreme[i], v[0], v[1], v[2]) != 0)
             {
-                int v0 = tri.V[j0], v1 = tri.V[j1];
-                EdgeKey<false> edge(v0, v1);
-                auto iter = terminator.find(edge);
-                if (iter == terminator.end())
-                {
-                    // The edge is visited for the first time.
-                    terminator.insert(std::make_pair(edge, std::make_pair(v0, v1)));
-                }
-                else
-                {
-                    // The edge is visited for the second time.
-                    terminator.erase(edge);
-                }
+                d = mExtreme[i];
+                break;
             }
         }
-        else
+
+        int g = f;
+        for (auto p : coplanar)
         {
-            // If there are no strictly front-facing triangles, then the
-            // incoming point is inside or on the convex hull.  If we get
-            // to this code, then the point is truly outside and we can
-            // update the hull.
-            existsFrontFacingTriangle = true;
+            int edge;
+            g = Locate(p, g, d, edge);
+            if (edge != -2)
+            {
+                Split(p, g, edge);
+            }
         }
     }
+}
 
-    if (!existsFrontFacingTriangle)
+template <typename InputType, typename ComputeType>
+void ConvexHull3<InputType, ComputeType>::Split(int p, int f, int edge)
+{
+    int const a = mFaces[f].vertex[0];
+    int const b = mFaces[f].vertex[1];
+    int const c = mFaces[f].vertex[2];
+    if (edge == -1)
     {
-        // The incoming point is inside or on the current hull, so no
-        // update of the hull is necessary.
+        // Split <a,b,c> into <a,b,p>, <b,c,p> and <c,a,p>.
+        int const adj1 = mFaces[f].adjacent[1];
+        int const adj2 = mFaces[f].adjacent[2];
+        int const f1 = CreateFace(b, c, p);
+        int const f2 = CreateFace(c, a, p);
+        mFaces[f].vertex[2] = p;
+        mFaces[f].adjacent[1] = f1;
+        mFaces[f].adjacent[2] = f2;
+        mFaces[f1].adjacent[0] = adj1;
+        mFaces[f1].adjacent[1] = f2;
+        mFaces[f1].adjacent[2] = f;
+        mFaces[f2].adjacent[0] = adj2;
+        mFaces[f2].adjacent[1] = f;
+        mFaces[f2].adjacent[2] = f1;
+        Replace(adj1, f, f1);
+        Replace(adj2, f, f2);
         return;
     }
 
-    // The updated hull contains the triangles not visible to the incoming
-    // point.
-    mHullUnordered = backFaces;
+    // The point is on the edge <v0,v1> of face f = <v0,v1,v2>, which is
+    // shared with face g = <v1,v0,w>.  Split f into <v0,p,v2> and
+    // <p,v1,v2>, and split g into <v1,p,w> and <p,v0,w>.
+    int const v[3] = { a, b, c };
+    int const v0 = v[edge], v1 = v[(edge + 1) % 3], v2 = v[(edge + 2) % 3];
+    int const g = mFaces[f].adjacent[edge];
+    int const adjF12 = mFaces[f].adjacent[(edge + 1) % 3];
+    int const adjF20 = mFaces[f].adjacent[(edge + 2) % 3];
+    int k = 0;
+    while (mFaces[g].adjacent[k] != f)
+    {
+        ++k;
+    }
+    int const w = mFaces[g].vertex[(k + 2) % 3];
+    int const adjG0w = mFaces[g].adjacent[(k + 1) % 3];
+    int const adjGw1 = mFaces[g].adjacent[(k + 2) % 3];
+
+    int const f1 = CreateFace(p, v1, v2);
+    int const g1 = CreateFace(p, v0, w);
+    Face& face = mFaces[f];
+    face.vertex[0] = v0;
+    face.vertex[1] = p;
+    face.vertex[2] = v2;
+    face.adjacent[0] = g1;
+    face.adjacent[1] = f1;
+    face.adjacent[2] = adjF20;
+    Face& other = mFaces[g];
+    other.vertex[0] = v1;
+    other.vertex[1] = p;
+    other.vertex[2] = w;
+    other.adjacent[0] = f1;
+    other.adjacent[1] = g1;
+    other.adjacent[2] = adjGw1;
+    mFaces[f1].adjacent[0] = g;
+    mFaces[f1].adjacent[1] = adjF12;
+    mFaces[f1].adjacent[2] = f;
+    mFaces[g1].adjacent[0] = f;
+    mFaces[g1].adjacent[1] = adjG0w;
+    mFaces[g1].adjacent[2] = g;
+    Replace(adjF12, f, f1);
+    Replace(adjG0w, g, g1);
+}
 
-    // Insert the triangles formed by the incoming point and the terminator
-    // edges.
-    for (auto const& edge : terminator)
+template <typename InputType, typename ComputeType>
+int ConvexHull3<InputType, ComputeType>::Locate(int p, int f, int d, int& edge)
+{
+    // Walk toward p across an edge for which p is strictly outside.  The
+    // planar face is convex, so the walk stays in it.  The first edge to
+    // test is varied to avoid the cycles that a walk with a fixed order can
+    // have in a triangulation that is not Delaunay.
+    for (;;)
     {
-        mHullUnordered.push_back(TriangleKey<true>(i, edge.second.second, edge.second.first));
+        int const start = static_cast<int>(mWalk++ % 3);
+        int sides[3], next = -1;
+        for (int k = 0; k < 3; ++k)
+        {
+            int j = (start + k) % 3;
+            sides[j] = SideOfEdge(p, f, j, d);
+            if (sides[j] < 0)
+            {
+                next = mFaces[f].adjacent[j];
+                break;
+            }
+        }
+        if (next == -1)
+        {
+            edge = -1;
+            for (int j = 0; j < 3; ++j)
+            {
+                if (sides[j] == 0)
+                {
+                    edge = (edge == -1 ? j : -2);
+                }
+            }
+            return f;
+        }
+        f = next;
     }
 }
 
+template <typename InputType, typename ComputeType>
+int ConvexHull3<InputType, ComputeType>::SideOfEdge(int p, int f, int j, int d) const
+{
+    // The point p is in the plane of face f = <a,b,c>, where <a,b> is edge
+    // j.  The plane through a, b and d contains the line through a and b,
+    // so p is on the same side of the line as c when the signs of p and c
+    // relative to that plane are the same.  The return value is +1 for the
+    // side of c, 0 for the line and -1 for the other side.
+    int const* v = mFaces[f].vertex;
+    int const a = v[j], b = v[(j + 1) % 3], c = v[(j + 2) % 3];
+    return mQuery.ToPlane(c, a, b, d) * mQuery.ToPlane(p, a, b, d);
+}
+
+template <typename InputType, typename ComputeType>
+void ConvexHull3<InputType, ComputeType>::Replace(int f, int oldAdjacent,
+    int newAdjacent)
+{
+    for (int j = 0; j < 3; ++j)
+    {
+        if (mFaces[f].adjacent[j] == oldAdjacent)
+        {
+            mFaces[f].adjacent[j] = newAdjacent;
+            return;
+        }
+    }
+}
 
 }
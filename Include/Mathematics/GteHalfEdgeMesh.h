@@ -0,0 +1,182 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/14)
+
+#pragma once
+
+#include <GTEngineDEF.h>
+#include <array>
+#include <vector>
+
+// A static, index-based triangle mesh with half-edge adjacency.  This is an
+// alternative to ETManifoldMesh and VETManifoldMesh for meshes that are
+// built once from an index buffer and then only queried.  All the data is
+// stored in contiguous arrays of integers, so the memory usage is a small
+// multiple of the size of the index buffer, and there are no allocations
+// per vertex, edge or triangle.
+//
+// Half-edge h = 3*t+i of triangle t is directed from vertex V[t][i] to
+// vertex V[t][(i+1)%3], which is the edge E[i] of the triangle in the
+// terminology of ETManifoldMesh.  The twin of h is the half-edge of the
+// adjacent triangle with the opposite direction, or -1 when the edge is on
+// the mesh boundary.  An edge is represented by the twin with the smaller
+// index; that half-edge is stored in the edge array.
+//
+// The mesh must be manifold at its edges and consistently oriented: each
+// directed edge occurs at most once and each undirected edge is shared by
+// at most two triangles.  Create(...) fails otherwise.  The mesh may be
+// nonmanifold at a vertex (for example, two cones sharing an apex), in
+// which case the vertex queries visit only one of the triangle fans at the
+// vertex.
+//
+// The construction hashes each half-edge by its smaller vertex index.  The
+// half-edges are bucketed with a counting sort, and each bucket is small
+// (the number of edges at the vertex), so the twins are found by a short
+// search of the bucket.  The buckets are partitioned among the threads.
+
+namespace gte
+{
+
+class GTE_IMPEXP HalfEdgeMesh
+{
+public:
+    // Construction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    HalfEdgeMesh(unsigned int numThreads = 1);
+
+    // Build the mesh from an index buffer of 3*numTriangles elements, each
+    // triple representing a counterclockwise-ordered triangle.  The indices
+    // must be in {0..numVertices-1}.  The function returns 'false' and the
+    // mesh is empty when an index is out of range, a triangle has repeated
+    // vertices, the mesh is not manifold at an edge or the triangles are
+    // not consistently oriented.
+    bool Create(int numVertices, int numTriangles, int const* indices);
+
+    // Destroy the mesh.
+    void Clear();
+
+    // Member access.
+    inline int GetNumVertices() const;
+    inline int GetNumTriangles() const;
+    inline int GetNumEdges() const;
+    inline std::vector<int> const& GetIndices() const;
+
+    // Half-edge queries.  The half-edge h belongs to triangle h/3.
+    inline int GetOrigin(int h) const;
+    inline int GetTarget(int h) const;
+    inline int GetTwin(int h) const;
+    inline int GetEdge(int h) const;
+    inline static int GetNext(int h);
+    inline static int GetPrev(int h);
+
+    // Edge queries.  The edge vertices are the origin and target of the
+    // representative half-edge.  The second triangle is -1 for a boundary
+    // edge.
+    inline int GetEdgeHalfEdge(int e) const;
+    std::array<int, 2> GetEdgeVertices(int e) const;
+    std::array<int, 2> GetEdgeTriangles(int e) const;
+
+    // Triangle queries.  The adjacent triangle i shares the edge
+    // <V[i],V[(i+1)%3]> and is -1 when the edge is on the boundary.
+    std::array<int, 3> GetTriangle(int t) const;
+    inline int GetAdjacentTriangle(int t, int i) const;
+
+    // Vertex queries.  The outgoing half-edge of a boundary vertex is the
+    // half-edge on the boundary; the half-edge is -1 for a vertex not used
+    // by any triangle.  The triangles and vertices adjacent to vertex v are
+    // returned in counterclockwise order.  For a boundary vertex, the
+    // vertex neighbors include both boundary neighbors, so there is one
+    // more neighbor than triangles.
+    inline int GetVertexHalfEdge(int v) const;
+    bool IsBoundaryVertex(int v) const;
+    void GetVertexTriangles(int v, std::vector<int>& triangles) const;
+    void GetVertexNeighbors(int v, std::vector<int>& neighbors) const;
+
+    // A mesh is closed if each edge is shared by two triangles.
+    bool IsClosed() const;
+
+    // Compute the connected components of the edge-triangle graph that the
+    // mesh represents.  Each component is an array of triangle indices.
+    void GetComponents(std::vector<std::vector<int>>& components) const;
+
+private:
+    unsigned int mNumThreads;
+    int mNumVertices;
+    std::vector<int> mIndices;        // 3*numTriangles, origins of half-edges
+    std::vector<int> mTwin;           // 3*numTriangles
+    std::vector<int> mHalfEdgeToEdge; // 3*numTriangles
+    std::vector<int> mEdges;          // numEdges, representative half-edges
+    std::vector<int> mVertexHalfEdge; // numVertices, outgoing half-edges
+};
+
+
+inline int HalfEdgeMesh::GetNumVertices() const
+{
+    return mNumVertices;
+}
+
+inline int HalfEdgeMesh::GetNumTriangles() const
+{
+    return static_cast<int>(mIndices.size() / 3);
+}
+
+inline int HalfEdgeMesh::GetNumEdges() const
+{
+    return static_cast<int>(mEdges.size());
+}
+
+inline std::vector<int> const& HalfEdgeMesh::GetIndices() const
+{
+    return mIndices;
+}
+
+inline int HalfEdgeMesh::GetOrigin(int h) const
+{
+    return mIndices[h];
+}
+
+inline int HalfEdgeMesh::GetTarget(int h) const
+{
+    return mIndices[GetNext(h)];
+}
+
+inline int HalfEdgeMesh::GetTwin(int h) const
+{
+    return mTwin[h];
+}
+
+inline int HalfEdgeMesh::GetEdge(int h) const
+{
+    return mHalfEdgeToEdge[h];
+}
+
+inline int HalfEdgeMesh::GetNext(int h)
+{
+    return (h % 3 == 2 ? h - 2 : h + 1);
+}
+
+inline int HalfEdgeMesh::GetPrev(int h)
+{
+    return (h % 3 == 0 ? h + 2 : h - 1);
+}
+
+inline int HalfEdgeMesh::GetEdgeHalfEdge(int e) const
+{
+    return mEdges[e];
+}
+
+inline int HalfEdgeMesh::GetAdjacentTriangle(int t, int i) const
+{
+    int twin = mTwin[3 * t + i];
+    return (twin >= 0 ? twin / 3 : -1);
+}
+
+inline int HalfEdgeMesh::GetVertexHalfEdge(int v) const
+{
+    return mVertexHalfEdge[v];
+}
+
+}
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.2 (2018/10/02)
+// File Version: 3.0.3 (2019/09/16)
 
 #pragma once
 
@@ -80,12 +80,33 @@ namespace gte
                 Dot(temp, box.axis[2])
             };
 
+            // Change signs on components, if necessary, to transform C to the
+            // first quadrant.  Adjust the velocity accordingly.
+            Real sign[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                if (C[i] >= (Real)0)
+                {
+                    sign[i] = (Real)1;
+                }
+                else
+                {
+                    C[i] = -C[i];
+                    V[i] = -V[i];
+                    sign[i] = (Real)-1;
+                }
+            }
+
             this->DoQuery(box.extent, C, sphere.radius, V, result);
 
             // Transform back to the original coordinate system.
             if (result.intersectionType != 0)
             {
                 auto& P = result.contactPoint;
+                for (int i = 0; i < 3; ++i)
+                {
+                    P[i] *= sign[i];
+                }
                 P = box.center + P[0] * box.axis[0] + P[1] * box.axis[1] + P[2] * box.axis[2];
             }
             return result;
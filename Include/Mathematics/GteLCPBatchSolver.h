@@ -0,0 +1,363 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/08)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteLCPSolver.h>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+// A class for solving many independent Linear Complementarity Problems of
+// the same dimension n, for example, the contact problems generated by a
+// collision system during one simulation step.  Each problem is
+// w = q + M * z, w^T * z = 0, w >= 0, z >= 0 as described in
+// GteLCPSolver.h.  The inputs for the problems are stored contiguously: q
+// has numProblems*n elements and M has numProblems*n*n elements, each
+// matrix stored in row-major order.  The outputs w and z each have
+// numProblems*n elements.
+//
+// The Lemke solvers and all workspace are allocated once per thread in the
+// constructor, so Solve(...) does not allocate memory.  The problems are
+// partitioned among the threads.
+//
+// Warm starting.  The optional 'basis' array has numProblems*n elements.
+// On input, basis[i + n * p] is 1 when z[i] of problem p is predicted to be
+// positive (basic) and 0 otherwise; the prediction is typically the basis
+// of the previous simulation step, which is stored in the array on output.
+// For a prediction B, the solver computes z[B] from M[B][B] * z[B] = -q[B],
+// sets the other z[i] to zero and computes w = q + M * z.  When z >= 0 and
+// w >= 0, the complementary pair is a solution and the Lemke pivoting is
+// skipped.  Otherwise, the problem is solved by the Lemke algorithm.  For
+// the first step, set all basis elements to 0; the prediction z = 0 is
+// the trivial solution when q >= 0.
+
+namespace gte
+{
+
+template <typename Real>
+class LCPBatchSolver
+{
+public:
+    typedef typename LCPSolverShared<Real>::Result Result;
+
+    // Construction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    LCPBatchSolver(int n, unsigned int numThreads = 1);
+
+    // Member access.
+    inline int GetDimension() const;
+    inline unsigned int GetNumThreads() const;
+
+    // The maximum number of Lemke iterations for each problem.  The default
+    // is n*n.  See the comments in GteLCPSolver.h.
+    void SetMaxIterations(int maxIterations);
+    inline int GetMaxIterations() const;
+
+    // Solve the problems.  The 'results' array is optional; when not null,
+    // it must have numProblems elements.  The 'basis' array is optional;
+    // see the comments at the beginning of this file.  The return value is
+    // 'true' when all problems are solved.
+    bool Solve(int numProblems, Real const* q, Real const* M, Real* w,
+        Real* z, Result* results = nullptr, uint8_t* basis = nullptr);
+
+    // The number of problems in the last call to Solve(...) for which the
+    // predicted basis was the solution.
+    inline int GetNumWarmStarts() const;
+
+private:
+    // Per-thread solver and workspace for the warm-start test.  The
+    // LCPSolver objects store pointers to their own arrays, so they are
+    // not copied after construction.
+    struct Workspace
+    {
+        Workspace(int n);
+
+        LCPSolver<Real> solver;
+        std::vector<int> indices;
+        std::vector<Real> matrix;  // at most n*n elements
+        std::vector<Real> rhs;     // at most n elements
+        int numWarmStarts;
+        bool allSolved;
+    };
+
+    // Test whether the predicted basis is the solution of the problem.
+    // On success, w and z are the solution.
+    bool SolvePredicted(Workspace& workspace, uint8_t const* basis,
+        Real const* q, Real const* M, Real* w, Real* z) const;
+
+    int mDimension;
+    unsigned int mNumThreads;
+    std::vector<std::unique_ptr<Workspace>> mWorkspace;
+    int mNumWarmStarts;
+};
+
+
+template <typename Real>
+LCPBatchSolver<Real>::Workspace::Workspace(int n)
+    :
+    solver(n),
+    indices(n),
+    matrix(n * n),
+    rhs(n),
+    numWarmStarts(0),
+    allSolved(true)
+{
+}
+
+template <typename Real>
+LCPBatchSolver<Real>::LCPBatchSolver(int n, unsigned int numThreads)
+    :
+    mDimension(n > 0 ? n : 0),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mWorkspace(mNumThreads),
+    mNumWarmStarts(0)
+{
+    for (auto& workspace : mWorkspace)
+    {
+        workspace = std::make_unique<Workspace>(mDimension);
+    }
+}
+
+template <typename Real>
+inline int LCPBatchSolver<Real>::GetDimension() const
+{
+    return mDimension;
+}
+
+template <typename Real>
+inline unsigned int LCPBatchSolver<Real>::GetNumThreads() const
+{
+    return mNumThreads;
+}
+
+template <typename Real>
+void LCPBatchSolver<Real>::SetMaxIterations(int maxIterations)
+{
+    for (auto& workspace : mWorkspace)
+    {
+        workspace->solver.SetMaxIterations(maxIterations);
+    }
+}
+
+template <typename Real>
+inline int LCPBatchSolver<Real>::GetMaxIterations() const
+{
+    return mWorkspace[0]->solver.GetMaxIterations();
+}
+
+template <typename Real>
+inline int LCPBatchSolver<Real>::GetNumWarmStarts() const
+{
+    return mNumWarmStarts;
+}
+
+template <typename Real>
+bool LCPBatchSolver<Real>::Solve(int numProblems, Real const* q,
+    Real const* M, Real* w, Real* z, Result* results, uint8_t* basis)
+{
+    mNumWarmStarts = 0;
+    if (mDimension == 0 || numProblems <= 0 || !q || !M || !w || !z)
+    {
+        if (results)
+        {
+            for (int p = 0; p < numProblems; ++p)
+            {
+                results[p] = LCPSolverShared<Real>::INVALID_INPUT;
+            }
+        }
+        return false;
+    }
+
+    for (auto& workspace : mWorkspace)
+    {
+        workspace->numWarmStarts = 0;
+        workspace->allSolved = true;
+    }
+
+    int const n = mDimension;
+    ParallelFor(mNumThreads, numProblems, [this, n, q, M, w, z, results,
+        basis](unsigned int t, int pmin, int pmax)
+    {
+        Workspace& workspace = *mWorkspace[t];
+        for (int p = pmin; p < pmax; ++p)
+        {
+            Real const* pq = &q[n * p];
+            Real const* pM = &M[n * n * p];
+            Real* pw = &w[n * p];
+            Real* pz = &z[n * p];
+            uint8_t* pBasis = (basis ? &basis[n * p] : nullptr);
+            Result result;
+            bool success;
+
+            if (pBasis && SolvePredicted(workspace, pBasis, pq, pM, pw, pz))
+            {
+                ++workspace.numWarmStarts;
+                result = (workspace.indices.size() > 0 ?
+                    LCPSolverShared<Real>::HAS_NONTRIVIAL_SOLUTION :
+                    LCPSolverShared<Real>::HAS_TRIVIAL_SOLUTION);
+                success = true;
+            }
+            else
+            {
+                success = workspace.solver.Solve(pq, pM, pw, pz, &result);
+                if (!success)
+                {
+                    workspace.allSolved = false;
+                }
+            }
+
+            if (pBasis)
+            {
+                for (int i = 0; i < n; ++i)
+                {
+                    pBasis[i] = (success && pz[i] > (Real)0 ? 1 : 0);
+                }
+            }
+
+            if (results)
+            {
+                results[p] = result;
+            }
+        }
+    });
+
+    bool allSolved = true;
+    for (auto const& workspace : mWorkspace)
+    {
+        mNumWarmStarts += workspace->numWarmStarts;
+        allSolved = allSolved && workspace->allSolved;
+    }
+    return allSolved;
+}
+
+template <typename Real>
+bool LCPBatchSolver<Real>::SolvePredicted(Workspace& workspace,
+    uint8_t const* basis, Real const* q, Real const* M, Real* w, Real* z) const
+{
+    int const n = mDimension;
+    std::vector<int>& indices = workspace.indices;
+    indices.clear();
+    for (int i = 0; i < n; ++i)
+    {
+        if (basis[i])
+        {
+            indices.push_back(i);
+        }
+    }
+
+    // Solve M[B][B] * z[B] = -q[B] using Gaussian elimination with partial
+    // pivoting.
+    int const k = static_cast<int>(indices.size());
+    Real* A = workspace.matrix.data();
+    Real* b = workspace.rhs.data();
+    for (int r = 0; r < k; ++r)
+    {
+        Real const* MRow = &M[n * indices[r]];
+        for (int c = 0; c < k; ++c)
+        {
+            A[c + k * r] = MRow[indices[c]];
+        }
+        b[r] = -q[indices[r]];
+    }
+
+    for (int c = 0; c < k; ++c)
+    {
+        int pivot = c;
+        Real maxValue = std::fabs(A[c + k * c]);
+        for (int r = c + 1; r < k; ++r)
+        {
+            Real value = std::fabs(A[c + k * r]);
+            if (value > maxValue)
+            {
+                maxValue = value;
+                pivot = r;
+            }
+        }
+
+        if (maxValue == (Real)0)
+        {
+            // The predicted submatrix is singular.
+            return false;
+        }
+
+        if (pivot != c)
+        {
+            for (int j = c; j < k; ++j)
+            {
+                std::swap(A[j + k * c], A[j + k * pivot]);
+            }
+            std::swap(b[c], b[pivot]);
+        }
+
+        Real inverse = ((Real)1) / A[c + k * c];
+        for (int r = c + 1; r < k; ++r)
+        {
+            Real multiplier = A[c + k * r] * inverse;
+            if (multiplier != (Real)0)
+            {
+                for (int j = c + 1; j < k; ++j)
+                {
+                    A[j + k * r] -= multiplier * A[j + k * c];
+                }
+                b[r] -= multiplier * b[c];
+            }
+        }
+    }
+
+    for (int r = k - 1; r >= 0; --r)
+    {
+        Real sum = b[r];
+        for (int j = r + 1; j < k; ++j)
+        {
+            sum -= A[j + k * r] * b[j];
+        }
+        b[r] = sum / A[r + k * r];
+        if (b[r] < (Real)0)
+        {
+            // The predicted basis is not feasible.
+            return false;
+        }
+    }
+
+    // Compute w = q + M*z and test for feasibility.  The complementarity
+    // w[i]*z[i] = 0 holds by construction.
+    for (int i = 0; i < n; ++i)
+    {
+        z[i] = (Real)0;
+    }
+    for (int r = 0; r < k; ++r)
+    {
+        z[indices[r]] = b[r];
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (basis[i])
+        {
+            w[i] = (Real)0;
+        }
+        else
+        {
+            Real const* MRow = &M[n * i];
+            Real sum = q[i];
+            for (int r = 0; r < k; ++r)
+            {
+                sum += MRow[indices[r]] * b[r];
+            }
+            if (sum < (Real)0)
+            {
+                return false;
+            }
+            w[i] = sum;
+        }
+    }
+    return true;
+}
+
+}
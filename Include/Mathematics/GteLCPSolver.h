@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.4.2 (2016/11/24)
+// File Version: 3.4.3 (2019/09/08)
 
 #pragma once
 
@@ -170,6 +170,15 @@ public:
         std::vector<Real>& w, std::vector<Real>& z,
         typename LCPSolverShared<Real>::Result* result = nullptr);
 
+    // The same as the previous function but without the size checks and
+    // without resizing the outputs.  The input q must have n elements, the
+    // input M must have n*n elements stored in row-major order, and the
+    // outputs w and z must have n elements.  This allows callers that solve
+    // many problems of the same size to avoid copying data into std::vector
+    // objects.
+    bool Solve(Real const* q, Real const* M, Real* w, Real* z,
+        typename LCPSolverShared<Real>::Result* result = nullptr);
+
 private:
     std::vector<typename LCPSolverShared<Real>::Variable> mVectorVarBasic;
     std::vector<typename LCPSolverShared<Real>::Variable> mVectorVarNonbasic;
@@ -613,4 +622,20 @@ bool LCPSolver<Real>::Solve(
     return LCPSolverShared<Real>::Solve(q.data(), M.data(), w.data(), z.data(), result);
 }
 
+template <typename Real>
+bool LCPSolver<Real>::Solve(Real const* q, Real const* M, Real* w, Real* z,
+    typename LCPSolverShared<Real>::Result* result)
+{
+    if (this->mDimension == 0 || !q || !M || !w || !z)
+    {
+        if (result)
+        {
+            *result = this->INVALID_INPUT;
+        }
+        return false;
+    }
+
+    return LCPSolverShared<Real>::Solve(q, M, w, z, result);
+}
+
 }
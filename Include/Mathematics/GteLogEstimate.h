@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/09)
 
 #pragma once
 
@@ -41,14 +41,14 @@ template <typename Real>
 template <int D>
 inline Real LogEstimate<Real>::Degree(Real x)
 {
-    return Log2Estimate<Real>::Degree<D>(x) * (Real)GTE_C_INV_LN_2;
+    return Log2Estimate<Real>::template Degree<D>(x) * (Real)GTE_C_LN_2;
 }
 
 template <typename Real>
 template <int D>
 inline Real LogEstimate<Real>::DegreeRR(Real x)
 {
-    return Log2Estimate<Real>::DegreeRR<D>(x) * (Real)GTE_C_INV_LN_2;
+    return Log2Estimate<Real>::template DegreeRR<D>(x) * (Real)GTE_C_LN_2;
 }
 
 
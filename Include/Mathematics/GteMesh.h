@@ -3,11 +3,12 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.3.2 (2019/04/05)
+// File Version: 3.3.3 (2019/09/15)
 
 #pragma once
 
 #include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteMath.h>
 #include <Mathematics/GteVector2.h>
 #include <Mathematics/GteVector3.h>
@@ -49,6 +50,18 @@
 // For each provided vertex attribute, a derived class can initialize
 // that attribute by overriding one of the Initialize*() functions whose
 // stubs are defined in this class.
+//
+// Update() recomputes all the vertex attributes by default.  When only part
+// of the geometry changes, call Invalidate(...) or InvalidateRows(...)
+// before Update() to restrict the work to the modified vertices and to the
+// vertices that share a triangle with them.  The normals and tangent-space
+// vectors of a partial update are computed per vertex from the triangles
+// sharing the vertex, which produces the same results as the full update.
+// If MeshDescription::numThreads is larger than 1, the per-vertex work is
+// partitioned among the threads.  The threads are launched and joined on
+// each Update() call, so multithreading is effective only for meshes with
+// many vertices; for many small meshes, update the meshes concurrently
+// instead, each mesh with a single thread.
 
 namespace gte
 {
@@ -76,6 +89,7 @@ namespace gte
             numTriangles(inNumTriangles),
             wantDynamicTangentSpaceUpdate(false),
             wantCCW(true),
+            numThreads(1),
             hasTangentSpaceVectors(false),
             allowUpdateFrame(false),
             numRows(0),
@@ -103,6 +117,7 @@ namespace gte
             topology(inTopology),
             wantDynamicTangentSpaceUpdate(false),
             wantCCW(true),
+            numThreads(1),
             hasTangentSpaceVectors(false),
             allowUpdateFrame(false),
             constructed(false)
@@ -178,6 +193,7 @@ namespace gte
         IndexAttribute indexAttribute;
         bool wantDynamicTangentSpaceUpdate;  // default: false
         bool wantCCW;  // default: true
+        unsigned int numThreads;  // default: 1
 
         // For internal use only.
         bool hasTangentSpaceVectors;
@@ -216,8 +232,11 @@ namespace gte
             mBitangentStride(0),
             mDPDUStride(0),
             mDPDVStride(0),
-            mTCoordStride(0)
+            mTCoordStride(0),
+            mDirtyMin(0),
+            mDirtyMax(0)
         {
+            mDescription.numThreads = std::max(mDescription.numThreads, 1u);
             mDescription.constructed = false;
             for (auto const& topology : validTopologies)
             {
@@ -359,9 +378,115 @@ namespace gte
             return mDescription;
         }
 
+        // Redirect the output of Update() for a vertex attribute to another
+        // buffer, for example a mapped graphics buffer, so that the vertex
+        // data is written in place without an intermediate copy.  The
+        // semantic must be one that was provided at construction and that
+        // is computed by Update(): "position", "normal", "tangent",
+        // "bitangent", "dpdu" or "dpdv".  The texture coordinates are an
+        // input to the mesh and cannot be redirected.  The next call to
+        // Update() recomputes all the vertices because the contents of the
+        // new buffer are unknown.
+        bool SetVertexAttribute(std::string const& semantic, void* source, size_t stride)
+        {
+            if (!mDescription.constructed || !source || stride == 0)
+            {
+                return false;
+            }
+
+            Vector3<Real>** data = nullptr;
+            size_t* dataStride = nullptr;
+            if (semantic == "position")
+            {
+                data = &mPositions;
+                dataStride = &mPositionStride;
+            }
+            else if (semantic == "normal")
+            {
+                data = &mNormals;
+                dataStride = &mNormalStride;
+            }
+            else if (semantic == "tangent")
+            {
+                data = &mTangents;
+                dataStride = &mTangentStride;
+            }
+            else if (semantic == "bitangent")
+            {
+                data = &mBitangents;
+                dataStride = &mBitangentStride;
+            }
+            else if (semantic == "dpdu")
+            {
+                data = &mDPDUs;
+                dataStride = &mDPDUStride;
+            }
+            else if (semantic == "dpdv")
+            {
+                data = &mDPDVs;
+                dataStride = &mDPDVStride;
+            }
+
+            if (!data || !*data)
+            {
+                return false;
+            }
+
+            *data = reinterpret_cast<Vector3<Real>*>(source);
+            *dataStride = stride;
+            for (auto& attribute : mDescription.vertexAttributes)
+            {
+                if (attribute.semantic == semantic)
+                {
+                    attribute.source = source;
+                    attribute.stride = stride;
+                }
+            }
+            mDirtyMin = 0;
+            mDirtyMax = mDescription.numVertices;
+            return true;
+        }
+
+        // Mark the vertices in [vmin,vmax) as modified.  The ranges of
+        // multiple calls are merged into the smallest range containing
+        // them.  The row version is for the non-arbitrary topologies and
+        // marks the vertices of rows [rmin,rmax), where the rows are those
+        // of the MeshDescription.  Derived classes extend the ranges when
+        // the vertices depend on each other, for example, the duplicated
+        // vertices of a closed tube.
+        void Invalidate(uint32_t vmin, uint32_t vmax)
+        {
+            vmax = std::min(vmax, mDescription.numVertices);
+            if (vmin < vmax)
+            {
+                if (mDirtyMin < mDirtyMax)
+                {
+                    mDirtyMin = std::min(mDirtyMin, vmin);
+                    mDirtyMax = std::max(mDirtyMax, vmax);
+                }
+                else
+                {
+                    mDirtyMin = vmin;
+                    mDirtyMax = vmax;
+                }
+            }
+        }
+
+        void InvalidateRows(uint32_t rmin, uint32_t rmax)
+        {
+            if (mDescription.topology == MeshTopology::ARBITRARY)
+            {
+                LogError("Rows are not defined for arbitrary topology.");
+                return;
+            }
+
+            Invalidate(rmin * mDescription.rIncrement, rmax * mDescription.rIncrement);
+        }
+
         // If the underlying geometric data varies dynamically, call this
         // function to update whatever vertex attributes are specified by
-        // the vertex pool.
+        // the vertex pool.  All the vertices are updated unless Invalidate
+        // was called since the previous update.
         void Update()
         {
             if (!mDescription.constructed)
@@ -370,17 +495,41 @@ namespace gte
                 return;
             }
 
-            UpdatePositions();
+            uint32_t vmin = mDirtyMin, vmax = mDirtyMax;
+            mDirtyMin = 0;
+            mDirtyMax = 0;
+            if (vmin >= vmax)
+            {
+                vmin = 0;
+                vmax = mDescription.numVertices;
+            }
+
+            if (vmin == 0 && vmax == mDescription.numVertices && mDescription.numThreads == 1)
+            {
+                UpdatePositions();
+
+                if (mDescription.allowUpdateFrame)
+                {
+                    UpdateFrame();
+                }
+                else if (mNormals)
+                {
+                    UpdateNormals();
+                }
+                // else: The mesh has no frame data, so there is nothing to do.
+                return;
+            }
+
+            UpdatePositionRange(vmin, vmax);
 
             if (mDescription.allowUpdateFrame)
             {
-                UpdateFrame();
+                UpdateFrameRange(vmin, vmax);
             }
             else if (mNormals)
             {
-                UpdateNormals();
+                UpdateNormalRange(vmin, vmax);
             }
-            // else: The mesh has no frame data, so there is nothing to do.
         }
 
     protected:
@@ -642,36 +791,276 @@ namespace gte
 
             for (uint32_t i = 0; i < mDescription.numVertices; ++i)
             {
-                Matrix<3, 2, Real> jacobian = mDTU[i] * Inverse(mUTU[i]);
+                SetFrame(i, mUTU[i], mDTU[i]);
+            }
+        }
 
-                Vector3<Real> basis[3];
-                basis[0] = { jacobian(0, 0), jacobian(1, 0), jacobian(2, 0) };
-                basis[1] = { jacobian(0, 1), jacobian(1, 1), jacobian(2, 1) };
+        // The range versions of the update functions are called by Update()
+        // for partial updates and for multithreaded updates.  The input
+        // [vmin,vmax) is the range of vertices whose geometry has changed.
+        // UpdatePositionRange must extend the range when it modifies other
+        // vertices.  The base-class UpdatePositionRange calls
+        // UpdatePositions(), which is correct but not incremental.  The
+        // base-class UpdateNormalRange and UpdateFrameRange recompute the
+        // attributes of the vertices that share a triangle with a modified
+        // vertex; see GetAffected(...).  A derived class that overrides UpdateNormals() or
+        // UpdateFrame() must also override the corresponding range
+        // function.
+        virtual void UpdatePositionRange(uint32_t&, uint32_t&)
+        {
+            UpdatePositions();
+        }
+
+        virtual void UpdateNormalRange(uint32_t vmin, uint32_t vmax)
+        {
+            uint32_t amin, amax, tmin, tmax;
+            GetAffected(vmin, vmax, amin, amax, tmin, tmax);
+            UpdateTriangleNormals(tmin, tmax);
+            ParallelForEach(amin, amax, [this](uint32_t i)
+            {
+                Vector3<Real> normal = GetNormalSum(i);
+                Normalize(normal, true);
+                Normal(i) = normal;
+            });
+        }
+
+        virtual void UpdateFrameRange(uint32_t vmin, uint32_t vmax)
+        {
+            // This is the computation of UpdateFrame() restricted to the
+            // triangles sharing each vertex.  The contributions of the
+            // triangles are accumulated in the same order as in
+            // UpdateFrame().
+            uint32_t amin, amax, tmin, tmax;
+            GetAffected(vmin, vmax, amin, amax, tmin, tmax);
+            if (!mTCoords)
+            {
+                UpdateTriangleNormals(tmin, tmax);
+            }
 
-                if (mDPDUs)
+            ParallelForEach(amin, amax, [this](uint32_t i)
+            {
+                Vector3<Real> basis[3];
+                if (!mTCoords)
                 {
-                    DPDU(i) = basis[0];
+                    basis[0] = GetNormalSum(i);
+                    Normalize(basis[0], true);
+                    ComputeOrthogonalComplement(1, basis, true);
                 }
-                if (mDPDVs)
+
+                Matrix<2, 2, Real> utu;  // initialized to zero
+                Matrix<3, 2, Real> dtu;  // initialized to zero
+                uint32_t const kmax = mVertexCornerOffsets[i + 1];
+                for (uint32_t k = mVertexCornerOffsets[i]; k < kmax; ++k)
                 {
-                    DPDV(i) = basis[1];
+                    // The differences D10 = V[1]-V[0], D20 = V[2]-V[0] and
+                    // D21 = V[2]-V[1] of UpdateFrame() that are incident to
+                    // the corner are D0 = V[e[1]]-V[e[0]] and
+                    // D1 = V[e[3]]-V[e[2]].
+                    static uint32_t const edges[3][4] =
+                    {
+                        { 0, 1, 0, 2 },  // D10, D20
+                        { 0, 1, 1, 2 },  // D10, D21
+                        { 0, 2, 1, 2 }   // D20, D21
+                    };
+
+                    uint32_t const corner = mVertexCorners[k];
+                    uint32_t const* e = edges[corner % 3];
+                    uint32_t v[3];
+                    mDescription.indexAttribute.GetTriangle(corner / 3, v[0], v[1], v[2]);
+                    Vector3<Real> D0 = Position(v[e[1]]) - Position(v[e[0]]);
+                    Vector3<Real> D1 = Position(v[e[3]]) - Position(v[e[2]]);
+
+                    Vector2<Real> U0, U1;
+                    if (mTCoords)
+                    {
+                        U0 = TCoord(v[e[1]]) - TCoord(v[e[0]]);
+                        U1 = TCoord(v[e[3]]) - TCoord(v[e[2]]);
+                    }
+                    else
+                    {
+                        U0 = { Dot(basis[1], D0), Dot(basis[2], D0) };
+                        U1 = { Dot(basis[1], D1), Dot(basis[2], D1) };
+                    }
+                    utu += OuterProduct(U0, U0) + OuterProduct(U1, U1);
+                    dtu += OuterProduct(D0, U0) + OuterProduct(D1, U1);
                 }
 
-                ComputeOrthogonalComplement(2, basis, true);
+                SetFrame(i, utu, dtu);
+            });
+        }
+
+        // Compute the tangent-space vectors from the least-squares sums of
+        // a vertex and store those that are requested.
+        void SetFrame(uint32_t i, Matrix<2, 2, Real> const& utu, Matrix<3, 2, Real> const& dtu)
+        {
+            Matrix<3, 2, Real> jacobian = dtu * Inverse(utu);
+
+            Vector3<Real> basis[3];
+            basis[0] = { jacobian(0, 0), jacobian(1, 0), jacobian(2, 0) };
+            basis[1] = { jacobian(0, 1), jacobian(1, 1), jacobian(2, 1) };
+
+            if (mDPDUs)
+            {
+                DPDU(i) = basis[0];
+            }
+            if (mDPDVs)
+            {
+                DPDV(i) = basis[1];
+            }
+
+            ComputeOrthogonalComplement(2, basis, true);
+
+            if (mNormals)
+            {
+                Normal(i) = basis[2];
+            }
+            if (mTangents)
+            {
+                Tangent(i) = basis[0];
+            }
+            if (mBitangents)
+            {
+                Bitangent(i) = basis[1];
+            }
+        }
+
+        // The sum of the triangle normals at a vertex, each normal having
+        // length twice the triangle area.  The triangles are visited in the
+        // order of UpdateNormals().  The triangle normals must have been
+        // computed by UpdateTriangleNormals(...).
+        Vector3<Real> GetNormalSum(uint32_t i) const
+        {
+            Vector3<Real> sum{ (Real)0, (Real)0, (Real)0 };
+            uint32_t const kmax = mVertexCornerOffsets[i + 1];
+            for (uint32_t k = mVertexCornerOffsets[i]; k < kmax; ++k)
+            {
+                sum += mTriangleNormals[mVertexCorners[k] / 3];
+            }
+            return sum;
+        }
+
+        // Compute the triangle normals for the triangles in [tmin,tmax).
+        void UpdateTriangleNormals(uint32_t tmin, uint32_t tmax)
+        {
+            ParallelForEach(tmin, tmax, [this](uint32_t t)
+            {
+                uint32_t v0, v1, v2;
+                mDescription.indexAttribute.GetTriangle(t, v0, v1, v2);
+                Vector3<Real> P0 = Position(v0);
+                Vector3<Real> E1 = Position(v1) - P0;
+                Vector3<Real> E2 = Position(v2) - P0;
+                mTriangleNormals[t] = Cross(E1, E2);
+            });
+        }
+
+        // The vertices whose attributes depend on the positions in
+        // [vmin,vmax) are those sharing a triangle with a vertex in the
+        // range.  The output [amin,amax) is the smallest range containing
+        // them and [tmin,tmax) is the smallest range containing the
+        // triangles that share a vertex with [amin,amax).  The ranges can
+        // contain vertices and triangles that are not affected, which are
+        // recomputed with unchanged results.  For the non-arbitrary
+        // topologies, the vertices and triangles are stored by rows, so the
+        // ranges are those of the neighboring rows.
+        void GetAffected(uint32_t vmin, uint32_t vmax,
+            uint32_t& amin, uint32_t& amax, uint32_t& tmin, uint32_t& tmax)
+        {
+            if (mVertexCornerOffsets.size() == 0)
+            {
+                CreateVertexCorners();
+            }
+
+            if (vmin == 0 && vmax == mDescription.numVertices)
+            {
+                amin = 0;
+                amax = mDescription.numVertices;
+                tmin = 0;
+                tmax = mDescription.numTriangles;
+                return;
+            }
 
-                if (mNormals)
+            amin = vmin;
+            amax = vmax;
+            for (uint32_t i = vmin; i < vmax; ++i)
+            {
+                uint32_t const kmax = mVertexCornerOffsets[i + 1];
+                for (uint32_t k = mVertexCornerOffsets[i]; k < kmax; ++k)
+                {
+                    uint32_t v0, v1, v2;
+                    mDescription.indexAttribute.GetTriangle(mVertexCorners[k] / 3, v0, v1, v2);
+                    amin = std::min(amin, std::min(v0, std::min(v1, v2)));
+                    amax = std::max(amax, std::max(v0, std::max(v1, v2)) + 1);
+                }
+            }
+
+            // The corners of a vertex are sorted, so only the first and last
+            // corners need to be examined.
+            tmin = mDescription.numTriangles;
+            tmax = 0;
+            for (uint32_t i = amin; i < amax; ++i)
+            {
+                uint32_t const kmin = mVertexCornerOffsets[i];
+                uint32_t const kmax = mVertexCornerOffsets[i + 1];
+                if (kmin < kmax)
                 {
-                    Normal(i) = basis[2];
+                    tmin = std::min(tmin, mVertexCorners[kmin] / 3);
+                    tmax = std::max(tmax, mVertexCorners[kmax - 1] / 3 + 1);
                 }
-                if (mTangents)
+            }
+        }
+
+        // Call function(i) for each i in [imin,imax).  The calls are
+        // partitioned among the threads, so the function may write only the
+        // data associated with i.
+        template <typename Function>
+        void ParallelForEach(uint32_t imin, uint32_t imax, Function const& function)
+        {
+            int const numItems = (imin < imax ? static_cast<int>(imax - imin) : 0);
+            ParallelFor(mDescription.numThreads, numItems,
+                [imin, &function](unsigned int, int jmin, int jmax)
+            {
+                for (int j = jmin; j < jmax; ++j)
                 {
-                    Tangent(i) = basis[0];
+                    function(imin + static_cast<uint32_t>(j));
                 }
-                if (mBitangents)
+            });
+        }
+
+        // Create the vertex-to-corner adjacency, where corner 3*t+j is the
+        // vertex j of triangle t.  The corners of a vertex are stored in
+        // increasing order, which is the order in which the triangle loops
+        // of UpdateNormals() and UpdateFrame() visit them.
+        void CreateVertexCorners()
+        {
+            uint32_t const numVertices = mDescription.numVertices;
+            uint32_t const numTriangles = mDescription.numTriangles;
+            mVertexCornerOffsets.assign(numVertices + 1, 0);
+            for (uint32_t t = 0; t < numTriangles; ++t)
+            {
+                uint32_t v0, v1, v2;
+                mDescription.indexAttribute.GetTriangle(t, v0, v1, v2);
+                ++mVertexCornerOffsets[v0 + 1];
+                ++mVertexCornerOffsets[v1 + 1];
+                ++mVertexCornerOffsets[v2 + 1];
+            }
+            for (uint32_t i = 0; i < numVertices; ++i)
+            {
+                mVertexCornerOffsets[i + 1] += mVertexCornerOffsets[i];
+            }
+
+            std::vector<uint32_t> current(mVertexCornerOffsets.begin(), mVertexCornerOffsets.end() - 1);
+            mVertexCorners.resize(3 * static_cast<size_t>(numTriangles));
+            for (uint32_t t = 0, corner = 0; t < numTriangles; ++t)
+            {
+                uint32_t v[3];
+                mDescription.indexAttribute.GetTriangle(t, v[0], v[1], v[2]);
+                for (int j = 0; j < 3; ++j, ++corner)
                 {
-                    Bitangent(i) = basis[1];
+                    mVertexCorners[current[v[j]]++] = corner;
                 }
             }
+
+            mTriangleNormals.resize(numTriangles);
         }
 
         // Constructor inputs.
@@ -707,5 +1096,13 @@ namespace gte
         // PDF for details.
         std::vector<Matrix<2, 2, Real>> mUTU;
         std::vector<Matrix<3, 2, Real>> mDTU;
+
+        // Support for partial and multithreaded updates.  The dirty range
+        // is [mDirtyMin,mDirtyMax) and is empty when mDirtyMin >= mDirtyMax.
+        // The vertex-to-corner adjacency is created on the first use.
+        uint32_t mDirtyMin, mDirtyMax;
+        std::vector<uint32_t> mVertexCornerOffsets;
+        std::vector<uint32_t> mVertexCorners;
+        std::vector<Vector3<Real>> mTriangleNormals;
     };
 }
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.2 (2018/10/05)
+// File Version: 3.0.3 (2019/09/12)
 
 #pragma once
 
@@ -40,8 +40,15 @@ class MinimumAreaBox2
 {
 public:
     // The class is a functor to support computing the minimum-area box of
-    // multiple data sets using the same class object.
-    MinimumAreaBox2();
+    // multiple data sets using the same class object.  The parameters are
+    // passed to the ConvexHull2 object that computes the hull of the points;
+    // see the comments in GteConvexHull2.h.  For multithreading, choose
+    // 'numThreads' subject to the constraints
+    //     1 <= numThreads <= std::thread::hardware_concurrency().
+    // Set 'usePrefilter' to 'true' to discard points strictly inside the
+    // Akl-Toussaint octagon before the exact hull computations, which is
+    // effective for dense point sets.
+    MinimumAreaBox2(unsigned int numThreads = 1, bool usePrefilter = false);
 
     // The points are arbitrary, so we must compute the convex hull from
     // them in order to compute the minimum-area box.  The input parameters
@@ -144,11 +151,16 @@ private:
     // Convenient values that occur regularly in the code.  When using
     // rational ComputeType, we construct these numbers only once.
     ComputeType mZero, mOne, mNegOne, mHalf;
+
+    // Parameters for the convex hull construction.
+    unsigned int mNumThreads;
+    bool mUsePrefilter;
 };
 
 
 template <typename InputType, typename ComputeType>
-MinimumAreaBox2<InputType, ComputeType>::MinimumAreaBox2()
+MinimumAreaBox2<InputType, ComputeType>::MinimumAreaBox2(
+    unsigned int numThreads, bool usePrefilter)
     :
     mNumPoints(0),
     mPoints(nullptr),
@@ -156,7 +168,9 @@ MinimumAreaBox2<InputType, ComputeType>::MinimumAreaBox2()
     mZero(0),
     mOne(1),
     mNegOne(-1),
-    mHalf((InputType)0.5)
+    mHalf((InputType)0.5),
+    mNumThreads(numThreads),
+    mUsePrefilter(usePrefilter)
 {
     mSupportIndices = { 0, 0, 0, 0 };
 }
@@ -170,7 +184,7 @@ OrientedBox2<InputType> MinimumAreaBox2<InputType, ComputeType>::operator()(
     mHull.clear();
 
     // Get the convex hull of the points.
-    ConvexHull2<InputType, ComputeType> ch2;
+    ConvexHull2<InputType, ComputeType> ch2(mNumThreads, mUsePrefilter);
     ch2(mNumPoints, mPoints, (InputType)0);
     int dimension = ch2.GetDimension();
 
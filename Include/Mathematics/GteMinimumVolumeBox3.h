@@ -3,14 +3,18 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.1 (2018/10/05)
+// File Version: 3.0.2 (2019/09/12)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteConvexHull3.h>
 #include <Mathematics/GteEdgeKey.h>
 #include <Mathematics/GteMinimumAreaBox2.h>
 #include <Mathematics/GteOrientedBox.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <thread>
 #include <type_traits>
 
@@ -37,6 +41,19 @@
 // enough for your input data sets.  If you choose ComputeType to be 'float'
 // or 'double', the output is not guaranteed to be correct.
 //
+// Two-phase search.  When 'numCandidates' is positive, the face boxes are
+// first computed for all hull faces using 'double' arithmetic.  The faces
+// of the 'numCandidates' smallest volumes are then processed again using
+// ComputeType, and only those faces are candidates for the output.  The
+// floating-point phase is much faster than the exact phase when ComputeType
+// is rational, but the rounding errors can reorder faces whose volumes are
+// nearly equal, so a small number of candidates (4 to 16) is recommended
+// rather than 1.  The output box is the exact minimum over the candidate
+// faces and the orthogonal edge triples.  The edge triples are always
+// processed exactly; when InputType is 'float' or 'double', a filtered
+// floating-point orthogonality test rejects most edge pairs without
+// computing with ComputeType.
+//
 // See GeometricTools/GTEngine/Samples/Geometrics/MinimumVolumeBox3 for an
 // example of how to use the code.
 
@@ -52,8 +69,11 @@ public:
     // in ProcessFaces, choose 'numThreads' subject to the constraints
     //     1 <= numThreads <= std::thread::hardware_concurrency()
     // To execute ProcessEdges in a thread separate from the main thrad,
-    // choose 'threadProcessEdges' to 'true'.
-    MinimumVolumeBox3(unsigned int numThreads = 1, bool threadProcessEdges = false);
+    // choose 'threadProcessEdges' to 'true'.  The edge triples are also
+    // partitioned among 'numThreads' threads.  Set 'numCandidates' to a
+    // positive number for the two-phase search described previously.
+    MinimumVolumeBox3(unsigned int numThreads = 1, bool threadProcessEdges = false,
+        int numCandidates = 0);
 
     // The points are arbitrary, so we must compute the convex hull from
     // them in order to compute the minimum-area box.  The input parameters
@@ -74,6 +94,11 @@ public:
     inline InputType GetVolume() const;
 
 private:
+    // The double-precision search of the two-phase mode is executed by a
+    // MinimumVolumeBox3<InputType, double> object that shares the mesh
+    // topology of this object.
+    template <typename, typename> friend class MinimumVolumeBox3;
+
     struct Box
     {
         Vector3<ComputeType> P, U[3];
@@ -87,18 +112,52 @@ private:
         ComputeType sqrLenU[2], area;
     };
 
+    // An edge of the hull mesh.  The vertices are those of the edge key.
+    // The face f[0] contains the directed edge <v[0],v[1]> when 'forward'
+    // is 'true'; otherwise, it contains <v[1],v[0]>.  The face f[1] has
+    // the opposite direction.
+    struct Edge
+    {
+        std::array<int, 2> v, f;
+        bool forward;
+    };
+
+    // Per-thread storage for ProcessFace.
+    struct FaceWorkspace
+    {
+        std::vector<char> negative;
+        std::vector<int> polyline;
+    };
+
+    // Copy the mesh topology to the arrays mFaces and mEdges.  The face
+    // processing visits all the edges for each face, and the arrays avoid
+    // the pointer chasing of the edge map and the triangle lookups.
+    void CreateTopology(ETManifoldMesh const& mesh);
+
+    // Compute the minimum-volume box of the faces and of the edge triples
+    // and convert it to InputType.
+    void ComputeMinimumBox(OrientedBox3<InputType>& itMinBox);
+
+    // Compute the inner-pointing normals of the hull faces.
+    void ComputeNormals(std::vector<Vector3<ComputeType>>& normal);
+
     // Compute the minimum-volume box relative to each hull face.
-    void ProcessFaces(ETManifoldMesh const& mesh, Box& minBox);
+    void ProcessFaces(Box& minBox);
+
+    // Compute the volume of the face box for each hull face.  This is the
+    // first phase of the two-phase search.
+    void ComputeFaceVolumes(std::vector<ComputeType>& volume);
+
+    // Compute the indices of the faces of the smallest volumes using a
+    // MinimumVolumeBox3<InputType, double> object.
+    void SelectCandidates(std::vector<int>& candidates);
 
     // Compute the minimum-volume box for each triple of orthgonal hull edges.
-    void ProcessEdges(ETManifoldMesh const& mesh, Box& minBox);
+    void ProcessEdges(Box& minBox);
 
     // Compute the minimum-volume box relative to a single hull face.
-    typedef ETManifoldMesh::Triangle Triangle;
-    void ProcessFace(std::shared_ptr<Triangle> const& supportTri,
-        std::vector<Vector3<ComputeType>> const& normal,
-        std::map<std::shared_ptr<Triangle>, int> const& triNormalMap,
-        ETManifoldMesh::EMap const& emap, Box& localMinBox);
+    void ProcessFace(int supportFace, std::vector<Vector3<ComputeType>> const& normal,
+        FaceWorkspace& workspace, Box& faceBox);
 
     // The rotating calipers algorithm has a loop invariant that requires
     // the convex polygon not to have collinear points.  Any such points
@@ -143,6 +202,7 @@ private:
     // the main thread).
     unsigned int mNumThreads;
     bool mThreadProcessEdges;
+    int mNumCandidates;
 
     // The input points to be bound.
     int mNumPoints;
@@ -156,11 +216,17 @@ private:
     // The indices into mPoints/mComputePoints for the convex hull vertices.
     std::vector<int> mHull;
 
-    // The unique indices in mHull.  This set allows us to compute only for
-    // the hull vertices and avoids redundant computations if the indices
-    // were to have repeated indices into mPoints/mComputePoints.  This is
-    // a performance improvement for rational ComputeType.
-    std::set<int> mUniqueIndices;
+    // The unique indices in mHull, sorted in increasing order.  This array
+    // allows us to compute only for the hull vertices and avoids redundant
+    // computations if the indices were to have repeated indices into
+    // mPoints/mComputePoints.  This is a performance improvement for
+    // rational ComputeType.
+    std::vector<int> mUniqueIndices;
+
+    // The hull mesh topology.  The faces are stored in the order of the
+    // triangle map of the mesh and the edges in the order of the edge map.
+    std::vector<std::array<int, 3>> mFaces;
+    std::vector<Edge> mEdges;
 
     // The caller can specify whether to use rotating calipers or the slower
     // all-edge processing for computing an extruded bounding box.
@@ -178,10 +244,12 @@ private:
 
 
 template <typename InputType, typename ComputeType>
-MinimumVolumeBox3<InputType, ComputeType>::MinimumVolumeBox3(unsigned int numThreads, bool threadProcessEdges)
+MinimumVolumeBox3<InputType, ComputeType>::MinimumVolumeBox3(unsigned int numThreads,
+    bool threadProcessEdges, int numCandidates)
     :
-    mNumThreads(numThreads),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
     mThreadProcessEdges(threadProcessEdges),
+    mNumCandidates(numCandidates > 0 ? numCandidates : 0),
     mNumPoints(0),
     mPoints(nullptr),
     mComputePoints(nullptr),
@@ -311,40 +379,17 @@ OrientedBox3<InputType> MinimumVolumeBox3<InputType, ComputeType>::operator()(
     {
         for (int i = 0; i < 3; ++i, ++h)
         {
-            int index = element.first.V[i];
-            mHull[h] = index;
-            mUniqueIndices.insert(index);
+            mHull[h] = element.first.V[i];
         }
     }
+    mUniqueIndices = mHull;
+    std::sort(mUniqueIndices.begin(), mUniqueIndices.end());
+    mUniqueIndices.erase(std::unique(mUniqueIndices.begin(),
+        mUniqueIndices.end()), mUniqueIndices.end());
+    CreateTopology(mesh);
 
     mComputePoints = ch3.GetQuery().GetVertices();
-
-    Box minBox, minBoxEdges;
-    minBox.volume = mNegOne;
-    minBoxEdges.volume = mNegOne;
-
-    if (mThreadProcessEdges)
-    {
-        std::thread doEdges([this, &mesh, &minBoxEdges]()
-        {
-            ProcessEdges(mesh, minBoxEdges);
-        });
-        ProcessFaces(mesh, minBox);
-        doEdges.join();
-    }
-    else
-    {
-        ProcessEdges(mesh, minBoxEdges);
-        ProcessFaces(mesh, minBox);
-    }
-
-    if (minBoxEdges.volume != mNegOne
-        && minBoxEdges.volume < minBox.volume)
-    {
-        minBox = minBoxEdges;
-    }
-
-    ConvertTo(minBox, itMinBox);
+    ComputeMinimumBox(itMinBox);
     mComputePoints = nullptr;
     return itMinBox;
 }
@@ -379,11 +424,14 @@ OrientedBox3<InputType> MinimumVolumeBox3<InputType, ComputeType>::operator()(
     {
         for (int i = 0; i < 3; ++i, ++h)
         {
-            int index = element.first.V[i];
-            mHull[h] = index;
-            mUniqueIndices.insert(index);
+            mHull[h] = element.first.V[i];
         }
     }
+    mUniqueIndices = mHull;
+    std::sort(mUniqueIndices.begin(), mUniqueIndices.end());
+    mUniqueIndices.erase(std::unique(mUniqueIndices.begin(),
+        mUniqueIndices.end()), mUniqueIndices.end());
+    CreateTopology(mesh);
 
     // Create the ComputeType points to be used downstream.
     std::vector<Vector3<ComputeType>> computePoints(mNumPoints);
@@ -397,32 +445,7 @@ OrientedBox3<InputType> MinimumVolumeBox3<InputType, ComputeType>::operator()(
 
     OrientedBox3<InputType> itMinBox;
     mComputePoints = &computePoints[0];
-
-    Box minBox, minBoxEdges;
-    minBox.volume = mNegOne;
-    minBoxEdges.volume = mNegOne;
-
-    if (mThreadProcessEdges)
-    {
-        std::thread doEdges([this, &mesh, &minBoxEdges]()
-        {
-            ProcessEdges(mesh, minBoxEdges);
-        });
-        ProcessFaces(mesh, minBox);
-        doEdges.join();
-    }
-    else
-    {
-        ProcessEdges(mesh, minBoxEdges);
-        ProcessFaces(mesh, minBox);
-    }
-
-    if (minBoxEdges.volume != mNegOne && minBoxEdges.volume < minBox.volume)
-    {
-        minBox = minBoxEdges;
-    }
-
-    ConvertTo(minBox, itMinBox);
+    ComputeMinimumBox(itMinBox);
     mComputePoints = nullptr;
     return itMinBox;
 }
@@ -454,276 +477,465 @@ InputType MinimumVolumeBox3<InputType, ComputeType>::GetVolume() const
 }
 
 template <typename InputType, typename ComputeType>
-void MinimumVolumeBox3<InputType, ComputeType>::ProcessFaces(ETManifoldMesh const& mesh, Box& minBox)
+void MinimumVolumeBox3<InputType, ComputeType>::CreateTopology(ETManifoldMesh const& mesh)
 {
-    // Get the mesh data structures.
     auto const& tmap = mesh.GetTriangles();
     auto const& emap = mesh.GetEdges();
 
-    // Compute inner-pointing face normals for searching boxes supported by
-    // a face and an extreme vertex.  The indirection in triNormalMap, using
-    // an integer index instead of the normal/sqrlength pair itself, avoids
-    // expensive copies when using exact arithmetic.
-    std::vector<Vector3<ComputeType>> normal(tmap.size());
-    std::map<std::shared_ptr<Triangle>, int> triNormalMap;
-    int index = 0;
+    mFaces.resize(tmap.size());
+    std::map<ETManifoldMesh::Triangle const*, int> faceIndex;
+    int f = 0;
     for (auto const& element : tmap)
     {
-        auto tri = element.second;
-        Vector3<ComputeType> const& v0 = mComputePoints[tri->V[0]];
-        Vector3<ComputeType> const& v1 = mComputePoints[tri->V[1]];
-        Vector3<ComputeType> const& v2 = mComputePoints[tri->V[2]];
-        Vector3<ComputeType> edge1 = v1 - v0;
-        Vector3<ComputeType> edge2 = v2 - v0;
-        normal[index] = Cross(edge2, edge1);  // inner-pointing normal
-        triNormalMap[tri] = index++;
+        for (int j = 0; j < 3; ++j)
+        {
+            mFaces[f][j] = element.first.V[j];
+        }
+        faceIndex[element.second.get()] = f++;
     }
 
+    mEdges.resize(emap.size());
+    int e = 0;
+    for (auto const& element : emap)
+    {
+        auto const& edge = *element.second;
+        auto const tri0 = edge.T[0].lock();
+        auto const tri1 = edge.T[1].lock();
+        Edge& current = mEdges[e++];
+        current.v = { edge.V[0], edge.V[1] };
+        current.f = { faceIndex.find(tri0.get())->second, faceIndex.find(tri1.get())->second };
+        current.forward = false;
+        for (int j0 = 2, j1 = 0; j1 < 3; j0 = j1++)
+        {
+            if (tri0->V[j0] == edge.V[0] && tri0->V[j1] == edge.V[1])
+            {
+                current.forward = true;
+                break;
+            }
+        }
+    }
+}
+
+template <typename InputType, typename ComputeType>
+void MinimumVolumeBox3<InputType, ComputeType>::ComputeMinimumBox(OrientedBox3<InputType>& itMinBox)
+{
+    Box minBox, minBoxEdges;
+    minBox.volume = mNegOne;
+    minBoxEdges.volume = mNegOne;
+
+    if (mThreadProcessEdges)
+    {
+        std::thread doEdges([this, &minBoxEdges]()
+        {
+            ProcessEdges(minBoxEdges);
+        });
+        ProcessFaces(minBox);
+        doEdges.join();
+    }
+    else
+    {
+        ProcessEdges(minBoxEdges);
+        ProcessFaces(minBox);
+    }
+
+    if (minBoxEdges.volume != mNegOne && minBoxEdges.volume < minBox.volume)
+    {
+        minBox = minBoxEdges;
+    }
+
+    ConvertTo(minBox, itMinBox);
+}
+
+template <typename InputType, typename ComputeType>
+void MinimumVolumeBox3<InputType, ComputeType>::ComputeNormals(std::vector<Vector3<ComputeType>>& normal)
+{
+    // Compute inner-pointing face normals for searching boxes supported by
+    // a face and an extreme vertex.
+    int const numFaces = static_cast<int>(mFaces.size());
+    normal.resize(numFaces);
+    ParallelFor(mNumThreads, numFaces, [this, &normal](unsigned int, int fmin, int fmax)
+    {
+        for (int f = fmin; f < fmax; ++f)
+        {
+            Vector3<ComputeType> const& v0 = mComputePoints[mFaces[f][0]];
+            Vector3<ComputeType> const& v1 = mComputePoints[mFaces[f][1]];
+            Vector3<ComputeType> const& v2 = mComputePoints[mFaces[f][2]];
+            Vector3<ComputeType> edge1 = v1 - v0;
+            Vector3<ComputeType> edge2 = v2 - v0;
+            normal[f] = Cross(edge2, edge1);  // inner-pointing normal
+        }
+    });
+}
+
+template <typename InputType, typename ComputeType>
+void MinimumVolumeBox3<InputType, ComputeType>::ProcessFaces(Box& minBox)
+{
     // Process the triangle faces.  For each face, compute the polyline of
     // edges that supports the bounding box with a face coincident to the
     // triangle face.  The projection of the polyline onto the plane of the
     // triangle face is a convex polygon, so we can use the method of rotating
     // calipers to compute its minimum-area box efficiently.
-    unsigned int numFaces = static_cast<unsigned int>(tmap.size());
-    if (mNumThreads > 1 && numFaces >= mNumThreads)
+    int const numFaces = static_cast<int>(mFaces.size());
+    std::vector<int> faces;
+    if (mNumCandidates > 0 && mNumCandidates < numFaces)
     {
-        // Repackage the triangle pointers to support the partitioning of
-        // faces for multithreaded face processing.
-        std::vector<std::shared_ptr<Triangle>> triangles;
-        triangles.reserve(numFaces);
-        for (auto const& element : tmap)
+        SelectCandidates(faces);
+    }
+    else
+    {
+        faces.resize(numFaces);
+        for (int f = 0; f < numFaces; ++f)
         {
-            triangles.push_back(element.second);
+            faces[f] = f;
         }
+    }
 
-        // Partition the data for multiple threads.
-        unsigned int numFacesPerThread = numFaces / mNumThreads;
-        std::vector<unsigned int> imin(mNumThreads), imax(mNumThreads);
-        std::vector<Box> localMinBox(mNumThreads);
-        for (unsigned int t = 0; t < mNumThreads; ++t)
-        {
-            imin[t] = t * numFacesPerThread;
-            imax[t] = imin[t] + numFacesPerThread - 1;
-            localMinBox[t].volume = mNegOne;
-        }
-        imax[mNumThreads - 1] = numFaces - 1;
+    std::vector<Vector3<ComputeType>> normal;
+    ComputeNormals(normal);
+
+    // The faces are partitioned among the threads in increasing order and
+    // the local minima are combined in thread order, so the output is the
+    // same as that of a single-threaded computation.
+    std::vector<FaceWorkspace> workspace(mNumThreads);
+    std::vector<Box> localMinBox(mNumThreads);
+    for (auto& box : localMinBox)
+    {
+        box.volume = mNegOne;
+    }
 
-        // Execute the face processing in multiple threads.
-        std::vector<std::thread> process(mNumThreads);
-        for (unsigned int t = 0; t < mNumThreads; ++t)
+    int const numProcessed = static_cast<int>(faces.size());
+    ParallelFor(mNumThreads, numProcessed, [this, &faces, &normal, &workspace,
+        &localMinBox](unsigned int t, int imin, int imax)
+    {
+        Box faceBox;
+        for (int i = imin; i < imax; ++i)
         {
-            process[t] = std::thread([this, t, &imin, &imax, &triangles,
-                &normal, &triNormalMap, &emap, &localMinBox]()
+            ProcessFace(faces[i], normal, workspace[t], faceBox);
+            if (localMinBox[t].volume == mNegOne || faceBox.volume < localMinBox[t].volume)
             {
-                for (unsigned int i = imin[t]; i <= imax[t]; ++i)
-                {
-                    auto const& supportTri = triangles[i];
-                    ProcessFace(supportTri, normal, triNormalMap, emap, localMinBox[t]);
-                }
-            });
+                localMinBox[t] = faceBox;
+            }
         }
+    });
 
-        // Wait for all threads to finish.
-        for (unsigned int t = 0; t < mNumThreads; ++t)
+    for (auto const& box : localMinBox)
+    {
+        if (box.volume != mNegOne && (minBox.volume == mNegOne || box.volume < minBox.volume))
         {
-            process[t].join();
+            minBox = box;
+        }
+    }
+}
 
-            // Update the minimum-volume box candidate.
-            if (minBox.volume == mNegOne || localMinBox[t].volume < minBox.volume)
-            {
-                minBox = localMinBox[t];
-            }
+template <typename InputType, typename ComputeType>
+void MinimumVolumeBox3<InputType, ComputeType>::ComputeFaceVolumes(std::vector<ComputeType>& volume)
+{
+    std::vector<Vector3<ComputeType>> normal;
+    ComputeNormals(normal);
+
+    int const numFaces = static_cast<int>(mFaces.size());
+    volume.resize(numFaces);
+    std::vector<FaceWorkspace> workspace(mNumThreads);
+    ParallelFor(mNumThreads, numFaces, [this, &normal, &workspace, &volume](
+        unsigned int t, int fmin, int fmax)
+    {
+        Box faceBox;
+        for (int f = fmin; f < fmax; ++f)
+        {
+            ProcessFace(f, normal, workspace[t], faceBox);
+            volume[f] = faceBox.volume;
         }
+    });
+}
+
+template <typename InputType, typename ComputeType>
+void MinimumVolumeBox3<InputType, ComputeType>::SelectCandidates(std::vector<int>& candidates)
+{
+    // The floating-point search shares the topology and the input points.
+    // Only the hull vertices are converted to 'double'.
+    MinimumVolumeBox3<InputType, double> search(mNumThreads);
+    search.mNumPoints = mNumPoints;
+    search.mPoints = mPoints;
+    search.mUseRotatingCalipers = false;
+    search.mUniqueIndices = mUniqueIndices;
+    search.mFaces = mFaces;
+    search.mEdges.resize(mEdges.size());
+    for (size_t e = 0; e < mEdges.size(); ++e)
+    {
+        search.mEdges[e].v = mEdges[e].v;
+        search.mEdges[e].f = mEdges[e].f;
+        search.mEdges[e].forward = mEdges[e].forward;
     }
-    else
+
+    std::vector<Vector3<double>> points(mNumPoints);
+    for (auto i : mUniqueIndices)
     {
-        for (auto const& element : tmap)
+        for (int j = 0; j < 3; ++j)
         {
-            auto const& supportTri = element.second;
-            ProcessFace(supportTri, normal, triNormalMap, emap, minBox);
+            points[i][j] = static_cast<double>(mPoints[i][j]);
         }
     }
+    search.mComputePoints = points.data();
+
+    std::vector<double> volume;
+    search.ComputeFaceVolumes(volume);
+
+    // Select the faces of the smallest volumes.  The candidates are then
+    // sorted by face index, which is the order of processing when all the
+    // faces are candidates.
+    int const numFaces = static_cast<int>(mFaces.size());
+    candidates.resize(numFaces);
+    for (int f = 0; f < numFaces; ++f)
+    {
+        candidates[f] = f;
+    }
+    std::partial_sort(candidates.begin(), candidates.begin() + mNumCandidates,
+        candidates.end(), [&volume](int f0, int f1)
+        {
+            return volume[f0] < volume[f1] || (volume[f0] == volume[f1] && f0 < f1);
+        });
+    candidates.resize(mNumCandidates);
+    std::sort(candidates.begin(), candidates.end());
 }
 
 template <typename InputType, typename ComputeType>
-void MinimumVolumeBox3<InputType, ComputeType>::ProcessEdges(ETManifoldMesh const& mesh, Box& minBox)
+void MinimumVolumeBox3<InputType, ComputeType>::ProcessEdges(Box& minBox)
 {
     // The minimum-volume box can also be supported by three mutually
     // orthogonal edges of the convex hull.  For each triple of orthogonal
     // edges, compute the minimum-volume box for that coordinate frame by
     // projecting the points onto the axes of the frame.  Use a hull vertex
     // as the origin.
-    int index = mesh.GetTriangles().begin()->first.V[0];
-    Vector3<ComputeType> const& origin = mComputePoints[index];
-    Vector3<ComputeType> U[3];
-    std::array<ComputeType, 3> sqrLenU;
+    int const numEdges = static_cast<int>(mEdges.size());
+    Vector3<ComputeType> const& origin = mComputePoints[mFaces[0][0]];
 
-    auto const& emap = mesh.GetEdges();
-    auto e2 = emap.begin(), end = emap.end();
-    for (/**/; e2 != end; ++e2)
+    // The edge directions use the ordered vertices of the edge keys.
+    std::vector<Vector3<ComputeType>> direction(numEdges);
+    for (int e = 0; e < numEdges; ++e)
+    {
+        int v0 = std::min(mEdges[e].v[0], mEdges[e].v[1]);
+        int v1 = std::max(mEdges[e].v[0], mEdges[e].v[1]);
+        direction[e] = mComputePoints[v1] - mComputePoints[v0];
+    }
+
+    // When the ComputeType conversions of the inputs are exact, which is
+    // the case for 'float' or 'double' inputs and rational ComputeType, the
+    // orthogonality tests are filtered using 'double' arithmetic.  A dot
+    // product is known to be nonzero when its floating-point value exceeds
+    // the bound on its rounding error, in which case the ComputeType test
+    // is skipped.
+    bool const useFilter = !std::is_floating_point<ComputeType>::value
+        && (std::is_same<InputType, float>::value || std::is_same<InputType, double>::value);
+    std::vector<Vector3<double>> filterDirection;
+    if (useFilter)
     {
-        U[2] = mComputePoints[e2->first.V[1]] - mComputePoints[e2->first.V[0]];
-        auto e1 = e2;
-        for (++e1; e1 != end; ++e1)
+        filterDirection.resize(numEdges);
+        for (int e = 0; e < numEdges; ++e)
         {
-            U[1] = mComputePoints[e1->first.V[1]] - mComputePoints[e1->first.V[0]];
-            if (Dot(U[1], U[2]) != mZero)
+            int v0 = std::min(mEdges[e].v[0], mEdges[e].v[1]);
+            int v1 = std::max(mEdges[e].v[0], mEdges[e].v[1]);
+            for (int j = 0; j < 3; ++j)
             {
-                continue;
+                filterDirection[e][j] = static_cast<double>(mPoints[v1][j])
+                    - static_cast<double>(mPoints[v0][j]);
             }
-            sqrLenU[1] = Dot(U[1], U[1]);
+        }
+    }
 
-            auto e0 = e1;
-            for (++e0; e0 != end; ++e0)
-            {
-                U[0] = mComputePoints[e0->first.V[1]] - mComputePoints[e0->first.V[0]];
-                sqrLenU[0] = Dot(U[0], U[0]);
-                if (Dot(U[0], U[1]) != mZero || Dot(U[0], U[2]) != mZero)
-                {
-                    continue;
-                }
+    auto isNonzero = [&filterDirection](int e0, int e1)
+    {
+        Vector3<double> const& d0 = filterDirection[e0];
+        Vector3<double> const& d1 = filterDirection[e1];
+        double dot = d0[0] * d1[0] + d0[1] * d1[1] + d0[2] * d1[2];
+        double bound = std::fabs(d0[0] * d1[0]) + std::fabs(d0[1] * d1[1]) + std::fabs(d0[2] * d1[2]);
+        return std::fabs(dot) > 4.0 * DBL_EPSILON * bound + DBL_MIN;
+    };
 
-                // The three edges are mutually orthogonal.  To support exact
-                // rational arithmetic for volume computation, we replace U[2]
-                // by a parallel vector.
-                U[2] = Cross(U[0], U[1]);
-                sqrLenU[2] = sqrLenU[0] * sqrLenU[1];
+    // The outer loop is partitioned among the threads.  The number of
+    // inner iterations for e2 is proportional to numEdges - e2, so each
+    // work item processes e2 and numEdges - 1 - e2 to balance the loads.
+    // The ties of volumes are resolved by the smallest (e2,e1,e0), which
+    // is the result of a single-threaded computation.
+    std::vector<Box> localMinBox(mNumThreads);
+    std::vector<std::array<int, 3>> localTriple(mNumThreads);
+    for (auto& box : localMinBox)
+    {
+        box.volume = mNegOne;
+    }
 
-                // Project the vertices onto the lines containing the edges.
-                // Use vertex 0 as the origin.
-                std::array<ComputeType, 3> umin, umax;
-                for (int j = 0; j < 3; ++j)
-                {
-                    umin[j] = mZero;
-                    umax[j] = mZero;
-                }
+    int const numItems = (numEdges + 1) / 2;
+    ParallelFor(mNumThreads, numItems, [this, numEdges, useFilter, &origin,
+        &direction, &isNonzero, &localMinBox, &localTriple](unsigned int t,
+        int imin, int imax)
+    {
+        Box& box = localMinBox[t];
+        std::array<int, 3>& triple = localTriple[t];
+        Vector3<ComputeType> U[3];
+        std::array<ComputeType, 3> sqrLenU, umin, umax;
 
-                for (auto i : mUniqueIndices)
+        for (int i = imin; i < imax; ++i)
+        {
+            int const rows[2] = { i, numEdges - 1 - i };
+            int const numRows = (rows[0] < rows[1] ? 2 : 1);
+            for (int r = 0; r < numRows; ++r)
+            {
+                int const e2 = rows[r];
+                for (int e1 = e2 + 1; e1 < numEdges; ++e1)
                 {
-                    Vector3<ComputeType> diff = mComputePoints[i] - origin;
-                    for (int j = 0; j < 3; ++j)
+                    if ((useFilter && isNonzero(e1, e2))
+                        || Dot(direction[e1], direction[e2]) != mZero)
+                    {
+                        continue;
+                    }
+
+                    for (int e0 = e1 + 1; e0 < numEdges; ++e0)
                     {
-                        ComputeType dot = Dot(diff, U[j]);
-                        if (dot < umin[j])
+                        if ((useFilter && (isNonzero(e0, e1) || isNonzero(e0, e2)))
+                            || Dot(direction[e0], direction[e1]) != mZero
+                            || Dot(direction[e0], direction[e2]) != mZero)
                         {
-                            umin[j] = dot;
+                            continue;
                         }
-                        else if (dot > umax[j])
+
+                        // The three edges are mutually orthogonal.  To
+                        // support exact rational arithmetic for volume
+                        // computation, we replace U[2] by a parallel vector.
+                        // The choice U[2] = Cross(U[0],U[1]) also makes
+                        // {U[0],U[1],U[2]} a right-handed set.
+                        U[0] = direction[e0];
+                        U[1] = direction[e1];
+                        U[2] = Cross(U[0], U[1]);
+                        sqrLenU[0] = Dot(U[0], U[0]);
+                        sqrLenU[1] = Dot(U[1], U[1]);
+                        sqrLenU[2] = sqrLenU[0] * sqrLenU[1];
+
+                        // Project the vertices onto the lines containing the
+                        // edges.  Use vertex 0 as the origin.
+                        for (int j = 0; j < 3; ++j)
                         {
-                            umax[j] = dot;
+                            umin[j] = mZero;
+                            umax[j] = mZero;
                         }
-                    }
-                }
 
-                ComputeType volume = (umax[0] - umin[0]) / sqrLenU[0];
-                volume *= (umax[1] - umin[1]) / sqrLenU[1];
-                volume *= (umax[2] - umin[2]);
+                        for (auto k : mUniqueIndices)
+                        {
+                            Vector3<ComputeType> diff = mComputePoints[k] - origin;
+                            for (int j = 0; j < 3; ++j)
+                            {
+                                ComputeType dot = Dot(diff, U[j]);
+                                if (dot < umin[j])
+                                {
+                                    umin[j] = dot;
+                                }
+                                else if (dot > umax[j])
+                                {
+                                    umax[j] = dot;
+                                }
+                            }
+                        }
 
-                // Update current minimum-volume box (if necessary).
-                if (minBox.volume == mOne || volume < minBox.volume)
-                {
-                    // The edge keys have unordered vertices, so it is
-                    // possible that {U[0],U[1],U[2]} is a left-handed set.
-                    // We need a right-handed set.
-                    if (DotCross(U[0], U[1], U[2]) < mZero)
-                    {
-                        U[2] = -U[2];
-                    }
+                        ComputeType volume = (umax[0] - umin[0]) / sqrLenU[0];
+                        volume *= (umax[1] - umin[1]) / sqrLenU[1];
+                        volume *= (umax[2] - umin[2]);
 
-                    minBox.P = origin;
-                    for (int j = 0; j < 3; ++j)
-                    {
-                        minBox.U[j] = U[j];
-                        minBox.sqrLenU[j] = sqrLenU[j];
-                        for (int k = 0; k < 3; ++k)
+                        // Update current minimum-volume box (if necessary).
+                        std::array<int, 3> current = { e2, e1, e0 };
+                        if (box.volume == mNegOne || volume < box.volume
+                            || (volume == box.volume && current < triple))
                         {
-                            minBox.range[k][0] = umin[k];
-                            minBox.range[k][1] = umax[k];
+                            box.P = origin;
+                            for (int j = 0; j < 3; ++j)
+                            {
+                                box.U[j] = U[j];
+                                box.sqrLenU[j] = sqrLenU[j];
+                                box.range[j][0] = umin[j];
+                                box.range[j][1] = umax[j];
+                            }
+                            box.volume = volume;
+                            triple = current;
                         }
                     }
-                    minBox.volume = volume;
-
                 }
             }
         }
+    });
+
+    std::array<int, 3> minTriple = { 0, 0, 0 };
+    for (unsigned int t = 0; t < mNumThreads; ++t)
+    {
+        Box const& box = localMinBox[t];
+        if (box.volume != mNegOne && (minBox.volume == mNegOne
+            || box.volume < minBox.volume
+            || (box.volume == minBox.volume && localTriple[t] < minTriple)))
+        {
+            minBox = box;
+            minTriple = localTriple[t];
+        }
     }
 }
 
 template <typename InputType, typename ComputeType>
-void MinimumVolumeBox3<InputType, ComputeType>::ProcessFace(std::shared_ptr<Triangle> const& supportTri,
-    std::vector<Vector3<ComputeType>> const& normal, std::map<std::shared_ptr<Triangle>, int> const& triNormalMap,
-    ETManifoldMesh::EMap const& emap, Box& localMinBox)
+void MinimumVolumeBox3<InputType, ComputeType>::ProcessFace(int supportFace,
+    std::vector<Vector3<ComputeType>> const& normal, FaceWorkspace& workspace,
+    Box& faceBox)
 {
     // Get the supporting triangle information.
-    Vector3<ComputeType> const& supportNormal = normal[triNormalMap.find(supportTri)->second];
+    Vector3<ComputeType> const& supportNormal = normal[supportFace];
+
+    // Classify the faces by the sign of the dot product of their normals
+    // with the supporting normal.  This is one dot product per face rather
+    // than two per edge.
+    int const numFaces = static_cast<int>(mFaces.size());
+    std::vector<char>& negative = workspace.negative;
+    negative.resize(numFaces);
+    for (int f = 0; f < numFaces; ++f)
+    {
+        negative[f] = (Dot(supportNormal, normal[f]) < mZero ? 1 : 0);
+    }
 
     // Build the polyline of supporting edges.  The pair (v,polyline[v])
     // represents an edge directed appropriately (see next set of
     // comments).
-    std::vector<int> polyline(mNumPoints);
+    std::vector<int>& polyline = workspace.polyline;
+    polyline.resize(mNumPoints);
     int polylineStart = -1;
-    for (auto const& edgeElement : emap)
+    for (auto const& edge : mEdges)
     {
-        auto const& edge = *edgeElement.second;
-        auto const& tri0 = edge.T[0].lock();
-        auto const& tri1 = edge.T[1].lock();
-        auto const& normal0 = normal[triNormalMap.find(tri0)->second];
-        auto const& normal1 = normal[triNormalMap.find(tri1)->second];
-        ComputeType dot0 = Dot(supportNormal, normal0);
-        ComputeType dot1 = Dot(supportNormal, normal1);
-
-        std::shared_ptr<Triangle> tri;
-        if (dot0 < mZero && dot1 >= mZero)
-        {
-            tri = tri0;
-        }
-        else if (dot1 < mZero && dot0 >= mZero)
-        {
-            tri = tri1;
-        }
-
-        if (tri)
+        bool negative0 = (negative[edge.f[0]] != 0);
+        bool negative1 = (negative[edge.f[1]] != 0);
+        if (negative0 != negative1)
         {
-            // The edge supports the bounding box.  Insert the edge in the
-            // list using clockwise order relative to tri.  This will lead
-            // to a polyline whose projection onto the plane of the hull
-            // face is a convex polygon that is counterclockwise oriented.
-            for (int j0 = 2, j1 = 0; j1 < 3; j0 = j1++)
+            // The edge supports the bounding box.  The triangle with
+            // negative dot product contains the edge with direction
+            // <v[0],v[1]> when it is f[0] and 'forward' is 'true' or when
+            // it is f[1] and 'forward' is 'false'.  Insert the edge in the
+            // list using this direction.  This will lead to a polyline
+            // whose projection onto the plane of the hull face is a convex
+            // polygon that is counterclockwise oriented.
+            if (negative0 == edge.forward)
             {
-                if (tri->V[j1] == edge.V[0])
-                {
-                    if (tri->V[j0] == edge.V[1])
-                    {
-                        polyline[edge.V[1]] = edge.V[0];
-                    }
-                    else
-                    {
-                        polyline[edge.V[0]] = edge.V[1];
-                    }
-                    polylineStart = edge.V[0];
-                    break;
-                }
+                polyline[edge.v[0]] = edge.v[1];
+            }
+            else
+            {
+                polyline[edge.v[1]] = edge.v[0];
             }
+            polylineStart = edge.v[0];
         }
     }
 
     // Rearrange the edges to form a closed polyline.  For M vertices, each
     // ComputeBoxFor*() function starts with the edge from closedPolyline[M-1]
     // to closedPolyline[0].
-    std::vector<int> closedPolyline(mNumPoints);
-    int numClosedPolyline = 0;
+    std::vector<int> closedPolyline;
     int v = polylineStart;
-    for (auto& cp : closedPolyline)
+    do
     {
-        cp = v;
-        ++numClosedPolyline;
+        closedPolyline.push_back(v);
         v = polyline[v];
-        if (v == polylineStart)
-        {
-            break;
-        }
     }
-    closedPolyline.resize(numClosedPolyline);
+    while (v != polylineStart
+        && closedPolyline.size() < static_cast<size_t>(mNumPoints));
 
     // This avoids redundant face testing in the O(n^2) or O(n) algorithms
     // and it simplifies the O(n) implementation.
@@ -731,7 +943,6 @@ void MinimumVolumeBox3<InputType, ComputeType>::ProcessFace(std::shared_ptr<Tria
 
     // Compute the box coincident to the hull triangle that has minimum
     // area on the face coincident with the triangle.
-    Box faceBox;
     if (mUseRotatingCalipers)
     {
         ComputeBoxForFaceOrderN(supportNormal, closedPolyline, faceBox);
@@ -740,12 +951,6 @@ void MinimumVolumeBox3<InputType, ComputeType>::ProcessFace(std::shared_ptr<Tria
     {
         ComputeBoxForFaceOrderNSqr(supportNormal, closedPolyline, faceBox);
     }
-
-    // Update the minimum-volume box candidate.
-    if (localMinBox.volume == mNegOne || faceBox.volume < localMinBox.volume)
-    {
-        localMinBox = faceBox;
-    }
 }
 
 template <typename InputType, typename ComputeType>
@@ -3,14 +3,17 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.2 (2019/07/31)
+// File Version: 3.1.0 (2019/09/15)
 
 #pragma once
 
 #include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteVector.h>
 #include <algorithm>
+#include <array>
 #include <limits>
+#include <thread>
 #include <vector>
 
 // Use a kd-tree for sorting used in a query for finding nearest neighbors of
@@ -22,6 +25,12 @@
 // 'Vector<N,Real> GetPosition () const'. The Site template parameter
 // allows the query to be applied even when it has more local information
 // than just point location.
+//
+// The tree is balanced because each node is split at its median, so the
+// tree is stored implicitly as an array of split values in breadth-first
+// order; see the comments for Build(...).  The queries visit the nearer
+// child first and skip a subtree when its half space is farther than the
+// current farthest neighbor.
 
 namespace gte
 {
@@ -70,6 +79,11 @@ namespace gte
         // Supporting data structures.
         typedef std::pair<Vector<N, Real>, int> SortedPoint;
 
+        // An explicit node of the kd-tree.  For an interior node, siteOffset
+        // is -1 and the children are nodes[left] and nodes[right].  For a
+        // leaf node, axis, left and right are -1, split is the maximum Real
+        // and the sites are sortedPoints[siteOffset + i] for
+        // 0 <= i < numSites.
         struct Node
         {
             Real split;
@@ -80,25 +94,46 @@ namespace gte
             int right;
         };
 
-        // Construction.
-        NearestNeighborQuery(std::vector<Site> const& sites, int maxLeafSize, int maxLevel)
+        // Construction.  The number of threads should satisfy
+        // 1 <= numThreads <= std::thread::hardware_concurrency().  The
+        // threads are used by the construction and by the batch queries.
+        NearestNeighborQuery(std::vector<Site> const& sites, int maxLeafSize, int maxLevel,
+            unsigned int numThreads = 1)
             :
             mMaxLeafSize(maxLeafSize),
             mMaxLevel(maxLevel),
+            mNumThreads(numThreads > 0 ? numThreads : 1),
             mSortedPoints(sites.size()),
             mDepth(0),
+            mNumNodes(0),
             mLargestNodeSize(0)
         {
             LogAssert(mMaxLevel > 0 && mMaxLevel <= 32, "Invalid max level.");
+            LogAssert(mMaxLeafSize > 0, "Invalid max leaf size.");
 
             int const numSites = static_cast<int>(sites.size());
-            for (int i = 0; i < numSites; ++i)
+            ParallelFor(mNumThreads, numSites, [this, &sites](unsigned int, int imin, int imax)
             {
-                mSortedPoints[i] = std::make_pair(sites[i].GetPosition(), i);
-            }
+                for (int i = imin; i < imax; ++i)
+                {
+                    mSortedPoints[i] = std::make_pair(sites[i].GetPosition(), i);
+                }
+            });
+
+            if (numSites > 0)
+            {
+                // The largest node at level L has ceil(numSites/2^L) sites,
+                // so the depth is the first level at which that node is a
+                // leaf.
+                for (int size = numSites; IsInterior(size, mDepth); size = size - size / 2)
+                {
+                    ++mDepth;
+                }
+                LogAssert(mDepth < 31, "Too many sites for the maximum leaf size.");
 
-            mNodes.push_back(Node());
-            Build(numSites, 0, 0, 0);
+                mSplits.resize((static_cast<size_t>(2) << mDepth) - 1);
+                Build(0, 0, numSites, 0, mNumThreads, mNumNodes, mLargestNodeSize);
+            }
         }
 
         // Member access.
@@ -124,136 +159,186 @@ namespace gte
 
         int GetNumNodes() const
         {
-            return static_cast<int>(mNodes.size());
+            return mNumNodes;
+        }
+
+        inline unsigned int GetNumThreads() const
+        {
+            return mNumThreads;
         }
 
-        inline std::vector<Node> const& GetNodes() const
+        // The tree is stored implicitly, so the explicit nodes are generated
+        // by each call in O(GetNumNodes()) time.  The root is nodes[0].
+        std::vector<Node> GetNodes() const
         {
-            return mNodes;
+            std::vector<Node> nodes;
+            if (mSortedPoints.size() > 0)
+            {
+                nodes.reserve(mNumNodes);
+                nodes.push_back(Node());
+                GetNodes(0, 0, 0, static_cast<int>(mSortedPoints.size()), 0, nodes);
+            }
+            return nodes;
         }
 
         // Compute up to MaxNeighbors nearest neighbors within the specified
         // radius of the point. The returned integer is the number of
         // neighbors found, possibly zero. The neighbors array stores indices
-        // into the array passed to the constructor.
+        // into the array passed to the constructor.  The neighbors are
+        // sorted by increasing distance, and neighbors at the same distance
+        // are sorted by increasing index.
         template <int MaxNeighbors>
         int FindNeighbors(Vector<N, Real> const& point, Real radius, std::array<int, MaxNeighbors>& neighbors) const
         {
-            Real sqrRadius = radius * radius;
-            int numNeighbors = 0;
-            std::array<int, MaxNeighbors + 1> localNeighbors;
-            std::array<Real, MaxNeighbors + 1> neighborSqrLength;
-            for (int i = 0; i <= MaxNeighbors; ++i)
+            std::array<Real, MaxNeighbors> sqrDistances;
+            return FindNeighbors(point, radius, MaxNeighbors, neighbors.data(), sqrDistances.data());
+        }
+
+        // The number of neighbors is specified at runtime.  The arrays
+        // 'neighbors' and 'sqrDistances' must have at least maxNeighbors
+        // elements.  On return, sqrDistances[i] is the squared distance from
+        // the point to the site neighbors[i].
+        int FindNeighbors(Vector<N, Real> const& point, Real radius, int maxNeighbors,
+            int* neighbors, Real* sqrDistances) const
+        {
+            if (maxNeighbors <= 0 || mSortedPoints.size() == 0)
             {
-                localNeighbors[i] = -1;
-                neighborSqrLength[i] = std::numeric_limits<Real>::max();
+                return 0;
             }
 
-            // The kd-tree construction is recursive, simulated here by using
-            // a stack. The maximum depth is limited to 32, because the number
-            // of sites is limited to 2^{32} (the number of 32-bit integer
-            // indices).
-            std::array<int, 32> stack;
+            // The search is depth first, visiting the child containing the
+            // point before its sibling.  The sibling is stored on the stack
+            // with the squared distance from the point to its half space,
+            // and it is skipped when that distance exceeds the distance to
+            // the farthest neighbor found so far.  A path from the root
+            // pushes at most one sibling per level, and the constructor
+            // ensures that the depth is smaller than 31, so the stack cannot
+            // overflow.
+            struct Item
+            {
+                int node, siteOffset, numSites, level;
+                Real sqrDistance;
+            };
+
+            std::array<Item, 64> stack;
             int top = 0;
-            stack[0] = 0;
+            stack[0] = { 0, 0, static_cast<int>(mSortedPoints.size()), 0, (Real)0 };
 
-            int maxNeighbors = MaxNeighbors;
-            if (maxNeighbors == 1)
+            Real const sqrRadius = radius * radius;
+            Real bound = sqrRadius;
+            int numNeighbors = 0;
+            while (top >= 0)
             {
-                while (top >= 0)
+                Item item = stack[top--];
+                if (item.sqrDistance > bound)
                 {
-                    Node node = mNodes[stack[top--]];
-
-                    if (node.siteOffset != -1)
-                    {
-                        for (int i = 0, j = node.siteOffset; i < node.numSites; ++i, ++j)
-                        {
-                            auto diff = mSortedPoints[j].first - point;
-                            auto sqrLength = Dot(diff, diff);
-                            if (sqrLength <= sqrRadius)
-                            {
-                                // Maintain the nearest neighbors.
-                                if (sqrLength <= neighborSqrLength[0])
-                                {
-                                    localNeighbors[0] = mSortedPoints[j].second;
-                                    neighborSqrLength[0] = sqrLength;
-                                    numNeighbors = 1;
-                                }
-                            }
-                        }
-                    }
+                    continue;
+                }
 
-                    if (node.left != -1 && point[node.axis] - radius <= node.split)
+                while (IsInterior(item.numSites, item.level))
+                {
+                    Real diff = point[item.level % N] - mSplits[item.node];
+                    int halfNumSites = item.numSites / 2;
+                    Item left = { 2 * item.node + 1, item.siteOffset, halfNumSites,
+                        item.level + 1, item.sqrDistance };
+                    Item right = { 2 * item.node + 2, item.siteOffset + halfNumSites,
+                        item.numSites - halfNumSites, item.level + 1, item.sqrDistance };
+
+                    Item& farChild = (diff <= (Real)0 ? right : left);
+                    farChild.sqrDistance = diff * diff;
+                    if (farChild.sqrDistance <= bound)
                     {
-                        stack[++top] = node.left;
+                        stack[++top] = farChild;
                     }
+                    item = (diff <= (Real)0 ? left : right);
+                }
 
-                    if (node.right != -1 && point[node.axis] + radius >= node.split)
+                for (int i = 0, j = item.siteOffset; i < item.numSites; ++i, ++j)
+                {
+                    Vector<N, Real> diff = mSortedPoints[j].first - point;
+                    Real sqrLength = Dot(diff, diff);
+                    if (sqrLength > bound)
                     {
-                        stack[++top] = node.right;
+                        continue;
                     }
-                }
-            }
-            else
-            {
-                while (top >= 0)
-                {
-                    Node node = mNodes[stack[top--]];
 
-                    if (node.siteOffset != -1)
+                    // Maintain the nearest neighbors sorted by (distance,
+                    // index).  When the array is full, the farthest neighbor
+                    // is discarded.
+                    int const index = mSortedPoints[j].second;
+                    int k = numNeighbors;
+                    if (k == maxNeighbors)
                     {
-                        for (int i = 0, j = node.siteOffset; i < node.numSites; ++i, ++j)
+                        if (sqrLength == sqrDistances[k - 1] && index > neighbors[k - 1])
                         {
-                            Vector<N, Real> diff = mSortedPoints[j].first - point;
-                            Real sqrLength = Dot(diff, diff);
-                            if (sqrLength <= sqrRadius)
-                            {
-                                // Maintain the nearest neighbors.
-                                int k;
-                                for (k = 0; k < numNeighbors; ++k)
-                                {
-                                    if (sqrLength <= neighborSqrLength[k])
-                                    {
-                                        for (int n = numNeighbors; n > k; --n)
-                                        {
-                                            localNeighbors[n] = localNeighbors[n - 1];
-                                            neighborSqrLength[n] = neighborSqrLength[n - 1];
-                                        }
-                                        break;
-                                    }
-                                }
-                                if (k < MaxNeighbors)
-                                {
-                                    localNeighbors[k] = mSortedPoints[j].second;
-                                    neighborSqrLength[k] = sqrLength;
-                                }
-                                if (numNeighbors < MaxNeighbors)
-                                {
-                                    ++numNeighbors;
-                                }
-                            }
+                            continue;
                         }
+                        --k;
+                    }
+                    else
+                    {
+                        ++numNeighbors;
                     }
 
-                    if (node.left != -1 && point[node.axis] - radius <= node.split)
+                    for (; k > 0; --k)
                     {
-                        stack[++top] = node.left;
+                        if (sqrLength > sqrDistances[k - 1]
+                            || (sqrLength == sqrDistances[k - 1] && index > neighbors[k - 1]))
+                        {
+                            break;
+                        }
+                        neighbors[k] = neighbors[k - 1];
+                        sqrDistances[k] = sqrDistances[k - 1];
                     }
+                    neighbors[k] = index;
+                    sqrDistances[k] = sqrLength;
 
-                    if (node.right != -1 && point[node.axis] + radius >= node.split)
+                    if (numNeighbors == maxNeighbors)
                     {
-                        stack[++top] = node.right;
+                        bound = sqrDistances[maxNeighbors - 1];
                     }
                 }
             }
+            return numNeighbors;
+        }
 
-
-            for (int i = 0; i < numNeighbors; ++i)
+        // Batch queries.  The neighbors of points[i] are stored in
+        // neighbors[i * maxNeighbors + j] for 0 <= j < numNeighbors[i], and
+        // the remaining elements of the block of points[i] are set to -1.
+        // The queries are processed in the order of the leaf nodes
+        // containing them, so consecutive queries visit mostly the same
+        // nodes and sites.  The sorted queries are partitioned among the
+        // threads.
+        void FindNeighbors(std::vector<Vector<N, Real>> const& points, Real radius, int maxNeighbors,
+            std::vector<int>& numNeighbors, std::vector<int>& neighbors) const
+        {
+            int const numPoints = static_cast<int>(points.size());
+            numNeighbors.resize(numPoints);
+            neighbors.resize(static_cast<size_t>(numPoints) * static_cast<size_t>(std::max(maxNeighbors, 0)));
+            if (maxNeighbors <= 0 || mSortedPoints.size() == 0)
             {
-                neighbors[i] = localNeighbors[i];
+                std::fill(numNeighbors.begin(), numNeighbors.end(), 0);
+                std::fill(neighbors.begin(), neighbors.end(), -1);
+                return;
             }
 
-            return numNeighbors;
+            std::vector<int> order;
+            GetLocalityOrder(points, order);
+
+            ParallelFor(mNumThreads, numPoints, [this, &points, radius, maxNeighbors,
+                &numNeighbors, &neighbors, &order](unsigned int, int imin, int imax)
+            {
+                std::vector<Real> sqrDistances(maxNeighbors);
+                for (int i = imin; i < imax; ++i)
+                {
+                    int const q = order[i];
+                    int* output = &neighbors[static_cast<size_t>(q) * maxNeighbors];
+                    int count = FindNeighbors(points[q], radius, maxNeighbors, output,
+                        sqrDistances.data());
+                    std::fill(output + count, output + maxNeighbors, -1);
+                    numNeighbors[q] = count;
+                }
+            });
         }
 
         inline std::vector<SortedPoint> const& GetSortedPoints() const
@@ -262,73 +347,163 @@ namespace gte
         }
 
     private:
-        // Populate the node so that it contains the points split along the
-        // coordinate axes.
-        void Build(int numSites, int siteOffset, int nodeIndex, int level)
+        // A node with the specified number of sites at the specified level
+        // is split when it has more than mMaxLeafSize sites and the level is
+        // at most mMaxLevel.
+        inline bool IsInterior(int numSites, int level) const
         {
-            LogAssert(siteOffset != -1, "Invalid site offset.");
-            LogAssert(nodeIndex != -1, "Invalid node index.");
-            LogAssert(numSites > 0, "Empty point list.");
-
-            mDepth = std::max(mDepth, level);
+            return numSites > mMaxLeafSize && level <= mMaxLevel;
+        }
 
-            Node& node = mNodes[nodeIndex];
-            node.numSites = numSites;
+        // The tree is stored implicitly.  The children of node i are nodes
+        // 2*i+1 and 2*i+2, the left child has the first half of the sites of
+        // the node and the right child has the remaining sites, and the
+        // split axis is the level modulo N.  Only the split values are
+        // stored; the site ranges and the leaf status are computed during
+        // the traversals.  The subtrees are built concurrently, the number
+        // of threads halving at each level.
+        void Build(int node, int siteOffset, int numSites, int level, unsigned int numThreads,
+            int& numNodes, int& largestNodeSize)
+        {
+            numNodes = 1;
+            if (!IsInterior(numSites, level))
+            {
+                largestNodeSize = numSites;
+                return;
+            }
 
-            if (numSites > mMaxLeafSize && level <= mMaxLevel)
+            // The point set is too large for a leaf node, so split it at
+            // the median.  The O(m log m) sort is not needed; rather, we
+            // locate the median using an order statistic construction that
+            // is expected time O(m).
+            int const halfNumSites = numSites / 2;
+            int const axis = level % N;
+            auto sorter = [axis](SortedPoint const& p0, SortedPoint const& p1)
+            {
+                return p0.first[axis] < p1.first[axis];
+            };
+
+            auto begin = mSortedPoints.begin() + siteOffset;
+            auto mid = begin + halfNumSites;
+            auto end = begin + numSites;
+            std::nth_element(begin, mid, end, sorter);
+            mSplits[node] = mid->first[axis];
+
+            // Apply a divide-and-conquer step.
+            int leftNodes = 0, rightNodes = 0, leftLargest = 0, rightLargest = 0;
+            int const nextLevel = level + 1;
+            if (numThreads > 1)
             {
-                int halfNumSites = numSites / 2;
-
-                // The point set is too large for a leaf node, so split it at
-                // the median.  The O(m log m) sort is not needed; rather, we
-                // locate the median using an order statistic construction
-                // that is expected time O(m).
-                int const axis = level % N;
-                auto sorter = [axis](SortedPoint const& p0, SortedPoint const& p1)
+                unsigned int const leftThreads = numThreads / 2;
+                std::thread leftTask([this, node, siteOffset, halfNumSites, nextLevel,
+                    leftThreads, &leftNodes, &leftLargest]()
                 {
-                    return p0.first[axis] < p1.first[axis];
-                };
-
-                auto begin = mSortedPoints.begin() + siteOffset;
-                auto mid = mSortedPoints.begin() + siteOffset + halfNumSites;
-                auto end = mSortedPoints.begin() + siteOffset + numSites;
-                std::nth_element(begin, mid, end, sorter);
-
-                // Get the median position.
-                node.split = mSortedPoints[siteOffset + halfNumSites].first[axis];
-                node.axis = axis;
-                node.siteOffset = -1;
-
-                // Apply a divide-and-conquer step.
-                int left = (int)mNodes.size(), right = left + 1;
-                node.left = left;
-                node.right = right;
-                mNodes.push_back(Node());
-                mNodes.push_back(Node());
-
-                int nextLevel = level + 1;
-                Build(halfNumSites, siteOffset, left, nextLevel);
-                Build(numSites - halfNumSites, siteOffset + halfNumSites, right, nextLevel);
+                    Build(2 * node + 1, siteOffset, halfNumSites, nextLevel, leftThreads,
+                        leftNodes, leftLargest);
+                });
+                Build(2 * node + 2, siteOffset + halfNumSites, numSites - halfNumSites,
+                    nextLevel, numThreads - leftThreads, rightNodes, rightLargest);
+                leftTask.join();
+            }
+            else
+            {
+                Build(2 * node + 1, siteOffset, halfNumSites, nextLevel, 1,
+                    leftNodes, leftLargest);
+                Build(2 * node + 2, siteOffset + halfNumSites, numSites - halfNumSites,
+                    nextLevel, 1, rightNodes, rightLargest);
+            }
+            numNodes += leftNodes + rightNodes;
+            largestNodeSize = std::max(leftLargest, rightLargest);
+        }
+
+        // Fill in nodes[index] for the implicit node and append its
+        // descendants.
+        void GetNodes(int node, int index, int siteOffset, int numSites, int level,
+            std::vector<Node>& nodes) const
+        {
+            nodes[index].numSites = numSites;
+            if (IsInterior(numSites, level))
+            {
+                int const halfNumSites = numSites / 2;
+                int const left = static_cast<int>(nodes.size()), right = left + 1;
+                nodes[index].split = mSplits[node];
+                nodes[index].axis = level % N;
+                nodes[index].siteOffset = -1;
+                nodes[index].left = left;
+                nodes[index].right = right;
+                nodes.push_back(Node());
+                nodes.push_back(Node());
+                GetNodes(2 * node + 1, left, siteOffset, halfNumSites, level + 1, nodes);
+                GetNodes(2 * node + 2, right, siteOffset + halfNumSites,
+                    numSites - halfNumSites, level + 1, nodes);
             }
             else
             {
-                // The number of points is small enough or we have run out of
-                // depth, so make this node a leaf.
-                node.split = std::numeric_limits<Real>::max();
-                node.axis = -1;
-                node.siteOffset = siteOffset;
-                node.left = -1;
-                node.right = -1;
-
-                mLargestNodeSize = std::max(mLargestNodeSize, node.numSites);
+                nodes[index].split = std::numeric_limits<Real>::max();
+                nodes[index].axis = -1;
+                nodes[index].siteOffset = siteOffset;
+                nodes[index].left = -1;
+                nodes[index].right = -1;
+            }
+        }
+
+        // Sort the query points by the site offsets of the leaf nodes
+        // containing them.  The leaves partition the sorted points, so the
+        // offsets are in [0,numSites) and a counting sort is used.
+        void GetLocalityOrder(std::vector<Vector<N, Real>> const& points, std::vector<int>& order) const
+        {
+            int const numPoints = static_cast<int>(points.size());
+            int const numSites = static_cast<int>(mSortedPoints.size());
+            std::vector<int> key(numPoints);
+            ParallelFor(mNumThreads, numPoints, [this, &points, &key, numSites](
+                unsigned int, int imin, int imax)
+            {
+                for (int i = imin; i < imax; ++i)
+                {
+                    int node = 0, siteOffset = 0, size = numSites, level = 0;
+                    while (IsInterior(size, level))
+                    {
+                        int halfSize = size / 2;
+                        if (points[i][level % N] <= mSplits[node])
+                        {
+                            node = 2 * node + 1;
+                            size = halfSize;
+                        }
+                        else
+                        {
+                            node = 2 * node + 2;
+                            siteOffset += halfSize;
+                            size -= halfSize;
+                        }
+                        ++level;
+                    }
+                    key[i] = siteOffset;
+                }
+            });
+
+            std::vector<int> first(static_cast<size_t>(numSites) + 1, 0);
+            for (int i = 0; i < numPoints; ++i)
+            {
+                ++first[key[i] + 1];
+            }
+            for (int j = 0; j < numSites; ++j)
+            {
+                first[j + 1] += first[j];
+            }
+            order.resize(numPoints);
+            for (int i = 0; i < numPoints; ++i)
+            {
+                order[first[key[i]]++] = i;
             }
         }
 
         int mMaxLeafSize;
         int mMaxLevel;
+        unsigned int mNumThreads;
         std::vector<SortedPoint> mSortedPoints;
-        std::vector<Node> mNodes;
+        std::vector<Real> mSplits;
         int mDepth;
+        int mNumNodes;
         int mLargestNodeSize;
     };
 }
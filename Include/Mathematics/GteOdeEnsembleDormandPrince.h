@@ -0,0 +1,340 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteOdeEnsembleSolver.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+// The adaptive Dormand-Prince 5(4) Runge-Kutta solver applied to all systems
+// of an ensemble, each system with its own time and step.  The layout of
+// the states and the format of the function are described in
+// GteOdeEnsembleSolver.h.
+//
+// A step of size h of system i computes the fifth-order estimate x1 of
+// x(t + h) and the difference e between x1 and the embedded fourth-order
+// estimate.  The error of the step is
+//   err = sqrt(sum_k (e[k]/(absTol + relTol*max(|x0[k]|,|x1[k]|)))^2 / N)
+// The step is accepted when err <= 1, and the next step is h times
+// 0.9*err^(-1/5) clamped to [0.2,5].  The last derivative of an accepted
+// step is the first derivative of the next step (FSAL), so a trial step
+// costs 6 evaluations.  The lanes of a block take their trial steps
+// together and the lanes that reach the final time stay in the block with
+// a zero step until all lanes of the block are finished.
+
+namespace gte
+{
+
+template <typename Real>
+class OdeEnsembleDormandPrince : public OdeEnsembleSolver<Real>
+{
+public:
+    // Construction and destruction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    virtual ~OdeEnsembleDormandPrince();
+    OdeEnsembleDormandPrince(int dimension, int numSystems,
+        typename OdeEnsembleSolver<Real>::Function const& F,
+        unsigned int numThreads = 1);
+
+    // The tolerances of the error of a step.  The defaults are 1e-6 and
+    // 1e-6.
+    void SetTolerances(Real absoluteTolerance, Real relativeTolerance);
+
+    // The maximum number of trial steps of a block in one call to Update.
+    // The default is 1000000.
+    void SetMaxSteps(int maxSteps);
+
+    // Advance each system i from time t[i] to time tFinal, where x is the
+    // ensemble state and h[i] is the first trial step of system i.  On
+    // return, t[i] is tFinal unless the maximum number of trial steps was
+    // reached, and h[i] is the step proposed for the next call.  A system
+    // with h[i] <= 0 starts with the step tFinal - t[i].
+    void Update(Real tFinal, std::vector<Real>& t, std::vector<Real>& x,
+        std::vector<Real>& h);
+
+    // The numbers of accepted and rejected steps of the systems in the last
+    // call to Update.
+    inline size_t GetNumAcceptedSteps() const;
+    inline size_t GetNumRejectedSteps() const;
+
+private:
+    // The workspace arrays, where K1 through K7 are the stage derivatives.
+    enum { X, XSTAGE, K1, K2, K3, K4, K5, K6, K7, NUM_ARRAYS };
+
+    // The workspace lane arrays.
+    enum { TIME, STEP, TRIAL, TSTAGE, SQRERROR, NUM_LANE_ARRAYS };
+
+    void UpdateBlock(Real tFinal, Real* t, Real* x, Real* h, int imin,
+        int numLanes, typename OdeEnsembleSolver<Real>::Workspace& ws,
+        size_t& numAccepted, size_t& numRejected);
+
+    Real mAbsoluteTolerance, mRelativeTolerance;
+    int mMaxSteps;
+    std::vector<size_t> mNumAccepted, mNumRejected;
+};
+
+
+template <typename Real>
+OdeEnsembleDormandPrince<Real>::~OdeEnsembleDormandPrince()
+{
+}
+
+template <typename Real>
+OdeEnsembleDormandPrince<Real>::OdeEnsembleDormandPrince(int dimension,
+    int numSystems, typename OdeEnsembleSolver<Real>::Function const& F,
+    unsigned int numThreads)
+    :
+    OdeEnsembleSolver<Real>(dimension, numSystems, F, numThreads,
+        NUM_ARRAYS, NUM_LANE_ARRAYS),
+    mAbsoluteTolerance((Real)1e-6),
+    mRelativeTolerance((Real)1e-6),
+    mMaxSteps(1000000),
+    mNumAccepted(this->mNumThreads, 0),
+    mNumRejected(this->mNumThreads, 0)
+{
+}
+
+template <typename Real>
+void OdeEnsembleDormandPrince<Real>::SetTolerances(Real absoluteTolerance,
+    Real relativeTolerance)
+{
+    mAbsoluteTolerance = absoluteTolerance;
+    mRelativeTolerance = relativeTolerance;
+}
+
+template <typename Real>
+void OdeEnsembleDormandPrince<Real>::SetMaxSteps(int maxSteps)
+{
+    mMaxSteps = maxSteps;
+}
+
+template <typename Real> inline
+size_t OdeEnsembleDormandPrince<Real>::GetNumAcceptedSteps() const
+{
+    size_t numSteps = 0;
+    for (auto n : mNumAccepted)
+    {
+        numSteps += n;
+    }
+    return numSteps;
+}
+
+template <typename Real> inline
+size_t OdeEnsembleDormandPrince<Real>::GetNumRejectedSteps() const
+{
+    size_t numSteps = 0;
+    for (auto n : mNumRejected)
+    {
+        numSteps += n;
+    }
+    return numSteps;
+}
+
+template <typename Real>
+void OdeEnsembleDormandPrince<Real>::Update(Real tFinal, std::vector<Real>& t,
+    std::vector<Real>& x, std::vector<Real>& h)
+{
+    Real* time = t.data();
+    Real* state = x.data();
+    Real* step = h.data();
+    ParallelFor(this->mNumThreads, this->mNumSystems,
+        [this, tFinal, time, state, step](unsigned int thread, int imin,
+            int imax)
+    {
+        mNumAccepted[thread] = 0;
+        mNumRejected[thread] = 0;
+        for (int bmin = imin; bmin < imax; bmin += this->BLOCK_SIZE)
+        {
+            int numLanes = std::min(static_cast<int>(this->BLOCK_SIZE),
+                imax - bmin);
+            UpdateBlock(tFinal, time, state, step, bmin, numLanes,
+                this->mWorkspace[thread], mNumAccepted[thread],
+                mNumRejected[thread]);
+        }
+    });
+}
+
+template <typename Real>
+void OdeEnsembleDormandPrince<Real>::UpdateBlock(Real tFinal, Real* t,
+    Real* x, Real* h, int imin, int numLanes,
+    typename OdeEnsembleSolver<Real>::Workspace& ws, size_t& numAccepted,
+    size_t& numRejected)
+{
+    // The Butcher tableau.  The row a[s] has the coefficients of the stage
+    // s+1 state, and a[5] has the coefficients of the fifth-order estimate.
+    // The coefficients e are those of the difference between the fifth- and
+    // fourth-order estimates.
+    static Real const c[6] =
+    {
+        (Real)(1.0 / 5.0), (Real)(3.0 / 10.0), (Real)(4.0 / 5.0),
+        (Real)(8.0 / 9.0), (Real)1, (Real)1
+    };
+    static Real const a[6][6] =
+    {
+        { (Real)(1.0 / 5.0) },
+        { (Real)(3.0 / 40.0), (Real)(9.0 / 40.0) },
+        { (Real)(44.0 / 45.0), (Real)(-56.0 / 15.0), (Real)(32.0 / 9.0) },
+        { (Real)(19372.0 / 6561.0), (Real)(-25360.0 / 2187.0),
+          (Real)(64448.0 / 6561.0), (Real)(-212.0 / 729.0) },
+        { (Real)(9017.0 / 3168.0), (Real)(-355.0 / 33.0),
+          (Real)(46732.0 / 5247.0), (Real)(49.0 / 176.0),
+          (Real)(-5103.0 / 18656.0) },
+        { (Real)(35.0 / 384.0), (Real)0, (Real)(500.0 / 1113.0),
+          (Real)(125.0 / 192.0), (Real)(-2187.0 / 6784.0),
+          (Real)(11.0 / 84.0) }
+    };
+    static Real const e[7] =
+    {
+        (Real)(71.0 / 57600.0), (Real)0, (Real)(-71.0 / 16695.0),
+        (Real)(71.0 / 1920.0), (Real)(-17253.0 / 339200.0),
+        (Real)(22.0 / 525.0), (Real)(-1.0 / 40.0)
+    };
+
+    int const N = this->mDimension;
+    Real* const* x0 = this->GetArray(ws, X);
+    Real* const* xs = this->GetArray(ws, XSTAGE);
+    Real* const* k[7];
+    for (int s = 0; s < 7; ++s)
+    {
+        k[s] = this->GetArray(ws, K1 + s);
+    }
+    Real* time = ws.lane[TIME];
+    Real* step = ws.lane[STEP];
+    Real* trial = ws.lane[TRIAL];
+    Real* tStage = ws.lane[TSTAGE];
+    Real* error = ws.lane[SQRERROR];
+
+    this->Load(x, imin, numLanes, x0);
+    for (int j = 0; j < numLanes; ++j)
+    {
+        time[j] = t[imin + j];
+        step[j] = (h[imin + j] > (Real)0 ? h[imin + j] : tFinal - time[j]);
+    }
+    this->Evaluate(imin, numLanes, time, x0, k[0]);
+
+    Real const invN = ((Real)1) / static_cast<Real>(N);
+    for (int iteration = 0; iteration < mMaxSteps; ++iteration)
+    {
+        // The trial step of a lane is limited by the final time, and it is
+        // zero for the finished lanes.
+        int numActive = 0;
+        for (int j = 0; j < numLanes; ++j)
+        {
+            Real remaining = tFinal - time[j];
+            bool active = (remaining > (Real)0);
+            trial[j] = (active ? std::min(step[j], remaining) : (Real)0);
+            numActive += (active ? 1 : 0);
+        }
+        if (numActive == 0)
+        {
+            break;
+        }
+
+        // Compute stages 2 through 7.  The state of stage 7 is the
+        // fifth-order estimate.
+        for (int s = 0; s < 6; ++s)
+        {
+            for (int i = 0; i < N; ++i)
+            {
+                for (int j = 0; j < numLanes; ++j)
+                {
+                    xs[i][j] = (Real)0;
+                }
+                for (int m = 0; m <= s; ++m)
+                {
+                    Real const coefficient = a[s][m];
+                    for (int j = 0; j < numLanes; ++j)
+                    {
+                        xs[i][j] += coefficient * k[m][i][j];
+                    }
+                }
+                for (int j = 0; j < numLanes; ++j)
+                {
+                    xs[i][j] = x0[i][j] + trial[j] * xs[i][j];
+                }
+            }
+            for (int j = 0; j < numLanes; ++j)
+            {
+                tStage[j] = time[j] + c[s] * trial[j];
+            }
+            this->Evaluate(imin, numLanes, tStage, xs, k[s + 1]);
+        }
+
+        // Compute the sum of squares of the scaled error.
+        std::fill(error, error + numLanes, (Real)0);
+        for (int i = 0; i < N; ++i)
+        {
+            for (int j = 0; j < numLanes; ++j)
+            {
+                Real difference = e[0] * k[0][i][j] + e[2] * k[2][i][j] +
+                    e[3] * k[3][i][j] + e[4] * k[4][i][j] +
+                    e[5] * k[5][i][j] + e[6] * k[6][i][j];
+                Real scale = mAbsoluteTolerance + mRelativeTolerance *
+                    std::max(std::abs(x0[i][j]), std::abs(xs[i][j]));
+                Real ratio = trial[j] * difference / scale;
+                error[j] += ratio * ratio;
+            }
+        }
+
+        // Accept or reject the trial steps and choose the next steps.  The
+        // error array is reused as the acceptance mask.
+        for (int j = 0; j < numLanes; ++j)
+        {
+            bool active = (trial[j] > (Real)0);
+            Real err = std::sqrt(error[j] * invN);
+            bool accept = (err <= (Real)1);
+            Real factor = (err > (Real)0 ?
+                ((Real)0.9) * std::pow(err, (Real)-0.2) : (Real)5);
+            factor = std::min(std::max(factor, (Real)0.2), (Real)5);
+            bool last = (trial[j] >= tFinal - time[j]);
+
+            if (active)
+            {
+                if (accept)
+                {
+                    ++numAccepted;
+                    time[j] = (last ? tFinal : time[j] + trial[j]);
+
+                    // A step limited by the final time keeps the proposed
+                    // step for the next call.
+                    if (!last || trial[j] * factor > step[j])
+                    {
+                        step[j] = trial[j] * factor;
+                    }
+                }
+                else
+                {
+                    ++numRejected;
+                    step[j] = trial[j] * factor;
+                }
+            }
+            error[j] = (accept ? (Real)1 : (Real)0);
+        }
+
+        for (int i = 0; i < N; ++i)
+        {
+            for (int j = 0; j < numLanes; ++j)
+            {
+                bool accept = (error[j] != (Real)0);
+                x0[i][j] = (accept ? xs[i][j] : x0[i][j]);
+                k[0][i][j] = (accept ? k[6][i][j] : k[0][i][j]);
+            }
+        }
+    }
+
+    this->Store(x0, imin, numLanes, x);
+    for (int j = 0; j < numLanes; ++j)
+    {
+        t[imin + j] = time[j];
+        h[imin + j] = step[j];
+    }
+}
+
+
+}
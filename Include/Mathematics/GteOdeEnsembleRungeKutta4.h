@@ -0,0 +1,169 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteOdeEnsembleSolver.h>
+#include <algorithm>
+
+// The Runge-Kutta solver of OdeRungeKutta4 applied to all systems of an
+// ensemble with a common step.  The layout of the states and the format of
+// the function are described in GteOdeEnsembleSolver.h.  The result for a
+// system is the result of OdeRungeKutta4 for that system.
+
+namespace gte
+{
+
+template <typename Real>
+class OdeEnsembleRungeKutta4 : public OdeEnsembleSolver<Real>
+{
+public:
+    // Construction and destruction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    virtual ~OdeEnsembleRungeKutta4();
+    OdeEnsembleRungeKutta4(int dimension, int numSystems, Real tDelta,
+        typename OdeEnsembleSolver<Real>::Function const& F,
+        unsigned int numThreads = 1);
+
+    // Member access.
+    inline void SetTDelta(Real tDelta);
+    inline Real GetTDelta() const;
+
+    // Estimate x(t + tDelta) from x(t) using dx/dt = F(t,x) for all systems.
+    // You may allow xIn and xOut to be the same object.
+    void Update(Real tIn, std::vector<Real> const& xIn, Real& tOut,
+        std::vector<Real>& xOut);
+
+private:
+    // The workspace arrays.
+    enum { X0, XTEMP, FTEMP1, FTEMP23, FTEMP, NUM_ARRAYS };
+
+    void UpdateBlock(Real tIn, Real const* xIn, Real* xOut, int imin,
+        int numLanes, typename OdeEnsembleSolver<Real>::Workspace& ws);
+
+    Real mTDelta;
+};
+
+
+template <typename Real>
+OdeEnsembleRungeKutta4<Real>::~OdeEnsembleRungeKutta4()
+{
+}
+
+template <typename Real>
+OdeEnsembleRungeKutta4<Real>::OdeEnsembleRungeKutta4(int dimension,
+    int numSystems, Real tDelta,
+    typename OdeEnsembleSolver<Real>::Function const& F,
+    unsigned int numThreads)
+    :
+    OdeEnsembleSolver<Real>(dimension, numSystems, F, numThreads,
+        NUM_ARRAYS, 1),
+    mTDelta(tDelta)
+{
+}
+
+template <typename Real> inline
+void OdeEnsembleRungeKutta4<Real>::SetTDelta(Real tDelta)
+{
+    mTDelta = tDelta;
+}
+
+template <typename Real> inline
+Real OdeEnsembleRungeKutta4<Real>::GetTDelta() const
+{
+    return mTDelta;
+}
+
+template <typename Real>
+void OdeEnsembleRungeKutta4<Real>::Update(Real tIn,
+    std::vector<Real> const& xIn, Real& tOut, std::vector<Real>& xOut)
+{
+    // Each block reads its lanes of xIn before it writes them to xOut, so
+    // xIn and xOut may be the same object.
+    xOut.resize(xIn.size());
+    Real const* input = xIn.data();
+    Real* output = xOut.data();
+    ParallelFor(this->mNumThreads, this->mNumSystems,
+        [this, tIn, input, output](unsigned int t, int imin, int imax)
+    {
+        for (int bmin = imin; bmin < imax; bmin += this->BLOCK_SIZE)
+        {
+            int numLanes = std::min(static_cast<int>(this->BLOCK_SIZE),
+                imax - bmin);
+            UpdateBlock(tIn, input, output, bmin, numLanes,
+                this->mWorkspace[t]);
+        }
+    });
+    tOut = tIn + mTDelta;
+}
+
+template <typename Real>
+void OdeEnsembleRungeKutta4<Real>::UpdateBlock(Real tIn, Real const* xIn,
+    Real* xOut, int imin, int numLanes,
+    typename OdeEnsembleSolver<Real>::Workspace& ws)
+{
+    int const N = this->mDimension;
+    Real* const* x0 = this->GetArray(ws, X0);
+    Real* const* xTemp = this->GetArray(ws, XTEMP);
+    Real* const* fTemp1 = this->GetArray(ws, FTEMP1);
+    Real* const* fTemp23 = this->GetArray(ws, FTEMP23);
+    Real* const* fTemp = this->GetArray(ws, FTEMP);
+    Real* time = ws.lane[0];
+    this->Load(xIn, imin, numLanes, x0);
+
+    // Compute the first step.
+    Real halfTDelta = ((Real)0.5) * mTDelta;
+    std::fill(time, time + numLanes, tIn);
+    this->Evaluate(imin, numLanes, time, x0, fTemp1);
+    for (int k = 0; k < N; ++k)
+    {
+        for (int j = 0; j < numLanes; ++j)
+        {
+            xTemp[k][j] = x0[k][j] + halfTDelta * fTemp1[k][j];
+        }
+    }
+
+    // Compute the second step.
+    Real halfT = tIn + halfTDelta;
+    std::fill(time, time + numLanes, halfT);
+    this->Evaluate(imin, numLanes, time, xTemp, fTemp23);
+    for (int k = 0; k < N; ++k)
+    {
+        for (int j = 0; j < numLanes; ++j)
+        {
+            xTemp[k][j] = x0[k][j] + halfTDelta * fTemp23[k][j];
+        }
+    }
+
+    // Compute the third step.
+    this->Evaluate(imin, numLanes, time, xTemp, fTemp);
+    for (int k = 0; k < N; ++k)
+    {
+        for (int j = 0; j < numLanes; ++j)
+        {
+            xTemp[k][j] = x0[k][j] + mTDelta * fTemp[k][j];
+            fTemp23[k][j] += fTemp[k][j];
+        }
+    }
+
+    // Compute the fourth step.
+    Real sixthTDelta = mTDelta / (Real)6;
+    std::fill(time, time + numLanes, tIn + mTDelta);
+    this->Evaluate(imin, numLanes, time, xTemp, fTemp);
+    for (int k = 0; k < N; ++k)
+    {
+        for (int j = 0; j < numLanes; ++j)
+        {
+            xTemp[k][j] = x0[k][j] + sixthTDelta * (fTemp1[k][j] +
+                ((Real)2) * fTemp23[k][j] + fTemp[k][j]);
+        }
+    }
+    this->Store(xTemp, imin, numLanes, xOut);
+}
+
+
+}
@@ -0,0 +1,180 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+// An ensemble is a collection of independent systems dx/dt = F(t,x) of the
+// same dimension N, for example the members of a parameter sweep.  The
+// states are stored as a structure of arrays:  component k of system i is
+// x[k*numSystems + i], so x has N*numSystems elements.  The solvers
+// process the systems in blocks of BLOCK_SIZE consecutive systems, called
+// lanes, and the loops over the lanes of a block have no branches and no
+// calls so that the compiler can vectorize them.  The blocks are
+// partitioned among the threads.
+//
+// The function F is evaluated for all lanes of a block by one call
+//   F(imin, imax, t, x, dxdt)
+// for the systems imin <= i < imax, where t[i - imin] is the time of system
+// i, x[k][i - imin] is component k of its state and dxdt[k][i - imin] must
+// be set to component k of its derivative.  The function is called by each
+// thread for its blocks, so it must not modify data shared by the blocks.
+
+namespace gte
+{
+
+template <typename Real>
+class OdeEnsembleSolver
+{
+public:
+    typedef std::function
+    <
+        void
+        (
+            int,                // imin
+            int,                // imax
+            Real const*,        // t[numLanes]
+            Real const* const*, // x[N][numLanes]
+            Real* const*        // dxdt[N][numLanes]
+        )
+    >
+    Function;
+
+    // Abstract base class.
+    virtual ~OdeEnsembleSolver();
+protected:
+    // The derived classes specify the number of N-dimensional arrays and of
+    // scalar arrays in the per-thread workspace.  The number of threads
+    // should satisfy 1 <= numThreads <= std::thread::hardware_concurrency().
+    OdeEnsembleSolver(int dimension, int numSystems, Function const& F,
+        unsigned int numThreads, int numArrays, int numLaneArrays);
+
+public:
+    // Member access.
+    inline int GetDimension() const;
+    inline int GetNumSystems() const;
+
+protected:
+    enum { BLOCK_SIZE = 64 };
+
+    // Array a of the workspace is the N pointers array[a*N], ...,
+    // array[a*N + N - 1], each to BLOCK_SIZE elements, and lane array a is
+    // lane[a], with BLOCK_SIZE elements.
+    struct Workspace
+    {
+        std::vector<Real> data;
+        std::vector<Real*> array;
+        std::vector<Real*> lane;
+    };
+
+    inline Real* const* GetArray(Workspace& ws, int a) const;
+
+    // Copy the lanes imin <= i < imin + numLanes of an ensemble state to a
+    // block array or from a block array.
+    void Load(Real const* x, int imin, int numLanes, Real* const* block) const;
+    void Store(Real const* const* block, int imin, int numLanes, Real* x) const;
+
+    // Call the function for the lanes imin <= i < imin + numLanes.
+    inline void Evaluate(int imin, int numLanes, Real const* t,
+        Real const* const* x, Real* const* dxdt) const;
+
+    int mDimension, mNumSystems;
+    Function mFunction;
+    unsigned int mNumThreads;
+    std::vector<Workspace> mWorkspace;
+};
+
+
+template <typename Real>
+OdeEnsembleSolver<Real>::~OdeEnsembleSolver()
+{
+}
+
+template <typename Real>
+OdeEnsembleSolver<Real>::OdeEnsembleSolver(int dimension, int numSystems,
+    Function const& F, unsigned int numThreads, int numArrays,
+    int numLaneArrays)
+    :
+    mDimension(dimension),
+    mNumSystems(numSystems),
+    mFunction(F),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mWorkspace(numThreads > 0 ? numThreads : 1)
+{
+    int const numBlocks = numArrays * dimension + numLaneArrays;
+    for (auto& ws : mWorkspace)
+    {
+        ws.data.resize(static_cast<size_t>(numBlocks) * BLOCK_SIZE);
+        ws.array.resize(static_cast<size_t>(numArrays) * dimension);
+        ws.lane.resize(numLaneArrays);
+        Real* block = ws.data.data();
+        for (auto& array : ws.array)
+        {
+            array = block;
+            block += BLOCK_SIZE;
+        }
+        for (auto& lane : ws.lane)
+        {
+            lane = block;
+            block += BLOCK_SIZE;
+        }
+    }
+}
+
+template <typename Real> inline
+int OdeEnsembleSolver<Real>::GetDimension() const
+{
+    return mDimension;
+}
+
+template <typename Real> inline
+int OdeEnsembleSolver<Real>::GetNumSystems() const
+{
+    return mNumSystems;
+}
+
+template <typename Real> inline
+Real* const* OdeEnsembleSolver<Real>::GetArray(Workspace& ws, int a) const
+{
+    return &ws.array[static_cast<size_t>(a) * mDimension];
+}
+
+template <typename Real>
+void OdeEnsembleSolver<Real>::Load(Real const* x, int imin, int numLanes,
+    Real* const* block) const
+{
+    for (int k = 0; k < mDimension; ++k)
+    {
+        Real const* source = x + static_cast<size_t>(k) * mNumSystems + imin;
+        std::copy(source, source + numLanes, block[k]);
+    }
+}
+
+template <typename Real>
+void OdeEnsembleSolver<Real>::Store(Real const* const* block, int imin,
+    int numLanes, Real* x) const
+{
+    for (int k = 0; k < mDimension; ++k)
+    {
+        Real* target = x + static_cast<size_t>(k) * mNumSystems + imin;
+        std::copy(block[k], block[k] + numLanes, target);
+    }
+}
+
+template <typename Real> inline
+void OdeEnsembleSolver<Real>::Evaluate(int imin, int numLanes,
+    Real const* t, Real const* const* x, Real* const* dxdt) const
+{
+    mFunction(imin, imin + numLanes, t, x, dxdt);
+}
+
+
+}
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.5 (2019/04/05)
+// File Version: 3.0.6 (2019/09/15)
 
 #pragma once
 
@@ -54,14 +54,15 @@ namespace gte
 
             this->ComputeIndices();
             InitializeTCoords();
-            InitializePositions();
+            uint32_t const numVertices = this->mDescription.numVertices;
+            InitializePositions(0, numVertices);
             if (this->mDescription.allowUpdateFrame)
             {
-                InitializeFrame();
+                InitializeFrame(0, numVertices);
             }
             else if (this->mNormals)
             {
-                InitializeNormals();
+                InitializeNormals(0, numVertices);
             }
         }
 
@@ -86,37 +87,41 @@ namespace gte
             }
         }
 
-        void InitializePositions()
+        // The attributes are computed for the vertices in [vmin,vmax).  Each
+        // vertex depends only on its texture coordinates, so the vertices
+        // are partitioned among the threads.
+        void InitializePositions(uint32_t vmin, uint32_t vmax)
         {
-            for (uint32_t r = 0, i = 0; r < this->mDescription.numRows; ++r)
+            ParallelFor(this->mDescription.numThreads, static_cast<int>(vmax - vmin),
+                [this, vmin](unsigned int, int imin, int imax)
             {
-                for (uint32_t c = 0; c < this->mDescription.numCols; ++c, ++i)
+                for (uint32_t i = vmin + imin; i < vmin + imax; ++i)
                 {
                     Vector2<Real> tcoord = this->TCoord(i);
                     Real w0 = ((Real)2 * tcoord[0] - (Real)1) * mRectangle.extent[0];
                     Real w1 = ((Real)2 * tcoord[1] - (Real)1) * mRectangle.extent[1];
                     this->Position(i) = mRectangle.center + w0 * mRectangle.axis[0] + w1 * mRectangle.axis[1];
                 }
-            }
+            });
         }
 
-        void InitializeNormals()
+        void InitializeNormals(uint32_t vmin, uint32_t vmax)
         {
             Vector3<Real> normal = UnitCross(mRectangle.axis[0], mRectangle.axis[1]);
-            for (uint32_t i = 0; i < this->mDescription.numVertices; ++i)
+            for (uint32_t i = vmin; i < vmax; ++i)
             {
                 this->Normal(i) = normal;
             }
         }
 
-        void InitializeFrame()
+        void InitializeFrame(uint32_t vmin, uint32_t vmax)
         {
             Vector3<Real> normal = UnitCross(mRectangle.axis[0], mRectangle.axis[1]);
             Vector3<Real> tangent{ (Real)1, (Real)0, (Real)0 };
             Vector3<Real> bitangent{ (Real)0, (Real)1, (Real)0 };
             // bitangent = Cross(normal,tangent)
             // TODO: Are tangent and bitangent correct?
-            for (uint32_t i = 0; i < this->mDescription.numVertices; ++i)
+            for (uint32_t i = vmin; i < vmax; ++i)
             {
                 if (this->mNormals)
                 {
@@ -145,6 +150,39 @@ namespace gte
             }
         }
 
+        // The rectangle is constant, so an update is necessary only after
+        // the vertex attributes are redirected to another buffer by
+        // SetVertexAttribute.
+        virtual void UpdatePositions() override
+        {
+            InitializePositions(0, this->mDescription.numVertices);
+        }
+
+        virtual void UpdateNormals() override
+        {
+            InitializeNormals(0, this->mDescription.numVertices);
+        }
+
+        virtual void UpdateFrame() override
+        {
+            InitializeFrame(0, this->mDescription.numVertices);
+        }
+
+        virtual void UpdatePositionRange(uint32_t& vmin, uint32_t& vmax) override
+        {
+            InitializePositions(vmin, vmax);
+        }
+
+        virtual void UpdateNormalRange(uint32_t vmin, uint32_t vmax) override
+        {
+            InitializeNormals(vmin, vmax);
+        }
+
+        virtual void UpdateFrameRange(uint32_t vmin, uint32_t vmax) override
+        {
+            InitializeFrame(vmin, vmax);
+        }
+
         Rectangle<3, Real> mRectangle;
 
         // If the client does not request texture coordinates, they will be
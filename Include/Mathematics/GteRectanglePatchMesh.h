@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.5 (2019/04/05)
+// File Version: 3.0.6 (2019/09/15)
 
 #pragma once
 
@@ -65,14 +65,15 @@ namespace gte
 
             this->ComputeIndices();
             InitializeTCoords();
-            InitializePositions();
+            uint32_t const numVertices = this->mDescription.numVertices;
+            InitializePositions(0, numVertices);
             if (this->mDescription.allowUpdateFrame)
             {
-                InitializeFrame();
+                InitializeFrame(0, numVertices);
             }
             else if (this->mNormals)
             {
-                InitializeNormals();
+                InitializeNormals(0, numVertices);
             }
         }
 
@@ -101,70 +102,67 @@ namespace gte
             }
         }
 
-        void InitializePositions()
+        // The attributes are computed for the vertices in [vmin,vmax).  The
+        // vertex attributes depend only on the surface at the texture
+        // coordinates of the vertex, so a partial update does not affect
+        // the neighboring vertices.  The surface is evaluated in the calling
+        // thread because the surface evaluators are not required to be
+        // thread-safe; for example, the B-spline basis functions have
+        // mutable workspace.
+        void InitializePositions(uint32_t vmin, uint32_t vmax)
         {
-            for (uint32_t r = 0, i = 0; r < this->mDescription.numRows; ++r)
+            for (uint32_t i = vmin; i < vmax; ++i)
             {
-                for (uint32_t c = 0; c < this->mDescription.numCols; ++c, ++i)
-                {
-                    Vector2<Real> tcoord = this->TCoord(i);
-                    this->Position(i) = mSurface->GetPosition(tcoord[0], tcoord[1]);
-                }
+                Vector2<Real> tcoord = this->TCoord(i);
+                this->Position(i) = mSurface->GetPosition(tcoord[0], tcoord[1]);
             }
         }
 
-        void InitializeNormals()
+        void InitializeNormals(uint32_t vmin, uint32_t vmax)
         {
-            for (uint32_t r = 0, i = 0; r < this->mDescription.numRows; ++r)
+            for (uint32_t i = vmin; i < vmax; ++i)
             {
-                for (uint32_t c = 0; c < this->mDescription.numCols; ++c, ++i)
-                {
-                    Vector2<Real> tcoord = this->TCoord(i);
-                    Vector3<Real> values[6];
-                    mSurface->Evaluate(tcoord[0], tcoord[1], 1, values);
-                    Normalize(values[1], true);
-                    Normalize(values[2], true);
-                    this->Normal(i) = UnitCross(values[1], values[2], true);
-                }
+                Vector2<Real> tcoord = this->TCoord(i);
+                Vector3<Real> values[6];
+                mSurface->Evaluate(tcoord[0], tcoord[1], 1, values);
+                Normalize(values[1], true);
+                Normalize(values[2], true);
+                this->Normal(i) = UnitCross(values[1], values[2], true);
             }
         }
 
-        void InitializeFrame()
+        void InitializeFrame(uint32_t vmin, uint32_t vmax)
         {
-            Vector3<Real> normal, tangent, bitangent;
-            for (unsigned int r = 0, i = 0; r < this->mDescription.numRows; ++r)
+            for (uint32_t i = vmin; i < vmax; ++i)
             {
-                for (unsigned int c = 0; c < this->mDescription.numCols; ++c, ++i)
-                {
-                    Vector2<Real> tcoord = this->TCoord(i);
-                    Vector3<Real> values[6];
-                    mSurface->Evaluate(tcoord[0], tcoord[1], 1, values);
-                    Normalize(values[1], true);
-                    Normalize(values[2], true);
+                Vector2<Real> tcoord = this->TCoord(i);
+                Vector3<Real> values[6];
+                mSurface->Evaluate(tcoord[0], tcoord[1], 1, values);
+                Normalize(values[1], true);
+                Normalize(values[2], true);
 
-                    if (this->mDPDUs)
-                    {
-                        this->DPDU(i) = values[1];
-                    }
-                    if (this->mDPDVs)
-                    {
-                        this->DPDV(i) = values[2];
-                    }
+                if (this->mDPDUs)
+                {
+                    this->DPDU(i) = values[1];
+                }
+                if (this->mDPDVs)
+                {
+                    this->DPDV(i) = values[2];
+                }
 
-                    ComputeOrthogonalComplement(2, &values[1], true);
+                ComputeOrthogonalComplement(2, &values[1], true);
 
-                    if (this->mNormals)
-                    {
-                        this->Normal(i) = values[3];
-                    }
-                    if (this->mTangents)
-                    {
-                        this->Tangent(i) = values[1];
-                    }
-                    if (this->mBitangents)
-                    {
-                        this->Bitangent(i) = values[2];
-                    }
+                if (this->mNormals)
+                {
+                    this->Normal(i) = values[3];
+                }
+                if (this->mTangents)
+                {
+                    this->Tangent(i) = values[1];
+                }
+                if (this->mBitangents)
+                {
+                    this->Bitangent(i) = values[2];
                 }
             }
         }
@@ -173,7 +171,7 @@ namespace gte
         {
             if (mSurface)
             {
-                InitializePositions();
+                InitializePositions(0, this->mDescription.numVertices);
             }
         }
 
@@ -181,7 +179,7 @@ namespace gte
         {
             if (mSurface)
             {
-                InitializeNormals();
+                InitializeNormals(0, this->mDescription.numVertices);
             }
         }
 
@@ -189,7 +187,31 @@ namespace gte
         {
             if (mSurface)
             {
-                InitializeFrame();
+                InitializeFrame(0, this->mDescription.numVertices);
+            }
+        }
+
+        virtual void UpdatePositionRange(uint32_t& vmin, uint32_t& vmax) override
+        {
+            if (mSurface)
+            {
+                InitializePositions(vmin, vmax);
+            }
+        }
+
+        virtual void UpdateNormalRange(uint32_t vmin, uint32_t vmax) override
+        {
+            if (mSurface)
+            {
+                InitializeNormals(vmin, vmax);
+            }
+        }
+
+        virtual void UpdateFrameRange(uint32_t vmin, uint32_t vmax) override
+        {
+            if (mSurface)
+            {
+                InitializeFrame(vmin, vmax);
             }
         }
 
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.5 (2019/04/05)
+// File Version: 3.0.6 (2019/09/15)
 
 #pragma once
 
@@ -117,6 +117,51 @@ namespace gte
             return mSampleByArcLength;
         }
 
+        // Call this function when the curve has changed only for parameters
+        // in [tmin,tmax].  The next Update() recomputes only the rows of
+        // vertices whose samples are in the interval and, for the disk and
+        // sphere topologies, the poles when their samples are in the
+        // interval.  When the curve is sampled by arclength, a local change
+        // of the curve moves all the samples, so all the rows are
+        // recomputed.
+        void InvalidateCurve(Real tmin, Real tmax)
+        {
+            uint32_t const numSamples = static_cast<uint32_t>(mSamples.size());
+            uint32_t smin = numSamples, smax = 0;
+            for (uint32_t i = 0; i < numSamples; ++i)
+            {
+                Real t = mTSampler(i);
+                if (mSampleByArcLength || (tmin <= t && t <= tmax))
+                {
+                    smin = std::min(smin, i);
+                    smax = i + 1;
+                }
+            }
+            if (smin >= smax)
+            {
+                return;
+            }
+
+            // Sample s is for row s - offset.  The first sample of the disk
+            // and sphere topologies and the last sample of the sphere
+            // topology are for the poles, which are the last vertices.
+            uint32_t const offset = GetRowSampleOffset();
+            uint32_t const rIncrement = this->mDescription.rIncrement;
+            uint32_t const numGridVertices = (this->mDescription.rMax + 1) * rIncrement;
+            uint32_t rmin = (smin > offset ? smin - offset : 0);
+            uint32_t rmax = std::min(smax - offset, this->mDescription.rMax + 1);
+            bool updatePoles = (offset > 0 && (smin == 0
+                || (this->mDescription.topology == MeshTopology::SPHERE && smax == numSamples)));
+            if (updatePoles)
+            {
+                this->Invalidate(std::min(rmin * rIncrement, numGridVertices), this->mDescription.numVertices);
+            }
+            else
+            {
+                this->InvalidateRows(rmin, rmax);
+            }
+        }
+
     private:
         void CreateSampler()
         {
@@ -225,88 +270,86 @@ namespace gte
             }
         }
 
-        virtual void UpdatePositions() override
+        // The disk and sphere topologies have a pole sample before the
+        // samples for the rows.
+        uint32_t GetRowSampleOffset() const
         {
-            unsigned int const numSamples = static_cast<unsigned int>(mSamples.size());
-            for (unsigned int i = 0; i < numSamples; ++i)
-            {
-                Real t = mTSampler(i);
-                Vector2<Real> position = mCurve->GetPosition(t);
-                mSamples[i][0] = position[0];
-                mSamples[i][1] = (Real)0;
-                mSamples[i][2] = position[1];
-            }
+            return (this->mDescription.topology == MeshTopology::DISK
+                || this->mDescription.topology == MeshTopology::SPHERE ? 1 : 0);
+        }
 
-            switch (this->mDescription.topology)
-            {
-            case MeshTopology::CYLINDER:
-                UpdateCylinderPositions();
-                break;
-            case MeshTopology::TORUS:
-                UpdateTorusPositions();
-                break;
-            case MeshTopology::DISK:
-                UpdateDiskPositions();
-                break;
-            case MeshTopology::SPHERE:
-                UpdateSpherePositions();
-                break;
-            default:
-                break;
-            }
+        virtual void UpdatePositions() override
+        {
+            uint32_t vmin = 0, vmax = this->mDescription.numVertices;
+            UpdatePositionRange(vmin, vmax);
         }
 
-        void UpdateCylinderPositions()
+        virtual void UpdatePositionRange(uint32_t& vmin, uint32_t& vmax) override
         {
-            for (unsigned int r = 0, i = 0; r <= this->mDescription.rMax; ++r)
+            // The curve is sampled in the calling thread because the curve
+            // evaluators are not required to be thread-safe.  The vertices
+            // of the rows are computed in parallel.  The vertices following
+            // the rows are the poles of the disk and sphere topologies.
+            uint32_t const offset = GetRowSampleOffset();
+            uint32_t const rIncrement = this->mDescription.rIncrement;
+            uint32_t const numGridVertices = (this->mDescription.rMax + 1) * rIncrement;
+            uint32_t const rmin = std::min(vmin, numGridVertices) / rIncrement;
+            uint32_t const rmax = (std::min(vmax, numGridVertices) + rIncrement - 1) / rIncrement;
+            bool const updatePoles = (vmax > numGridVertices);
+
+            for (uint32_t row = rmin; row < rmax; ++row)
             {
-                Real radius = mSamples[r][0];
-                for (unsigned int c = 0; c <= this->mDescription.cMax; ++c, ++i)
-                {
-                    this->Position(i) = { radius * mCosAngle[c], radius * mSinAngle[c], mSamples[r][2] };
-                }
+                UpdateSample(row + offset);
             }
-        }
 
-        void UpdateTorusPositions()
-        {
-            for (unsigned int r = 0, i = 0; r <= this->mDescription.rMax; ++r)
+            if (updatePoles)
             {
-                Real radius = mSamples[r][0];
-                for (unsigned int c = 0; c <= this->mDescription.cMax; ++c, ++i)
+                UpdateSample(0);
+                if (this->mDescription.topology == MeshTopology::SPHERE)
                 {
-                    this->Position(i) = { radius * mCosAngle[c], radius * mSinAngle[c], mSamples[r][2] };
+                    UpdateSample(static_cast<uint32_t>(mSamples.size()) - 1);
                 }
             }
-        }
 
-        void UpdateDiskPositions()
-        {
-            for (unsigned int r = 0, rp1 = 1, i = 0; r <= this->mDescription.rMax; ++r, ++rp1)
+            ParallelFor(this->mDescription.numThreads, static_cast<int>(rmax - rmin),
+                [this, rmin, offset, rIncrement](unsigned int, int imin, int imax)
             {
-                Real radius = mSamples[rp1][0];
-                for (unsigned int c = 0; c <= this->mDescription.cMax; ++c, ++i)
+                for (uint32_t r = rmin + imin; r < rmin + imax; ++r)
                 {
-                    this->Position(i) = { radius * mCosAngle[c], radius * mSinAngle[c], mSamples[rp1][2] };
+                    Vector3<Real> const& sample = mSamples[r + offset];
+                    Real radius = sample[0];
+                    uint32_t i = r * rIncrement;
+                    for (uint32_t c = 0; c <= this->mDescription.cMax; ++c, ++i)
+                    {
+                        this->Position(i) = { radius * mCosAngle[c], radius * mSinAngle[c], sample[2] };
+                    }
                 }
-            }
+            });
 
-            this->Position(this->mDescription.numVertices - 1) = { (Real)0, (Real)0, mSamples.front()[2] };
-        }
-
-        void UpdateSpherePositions()
-        {
-            for (unsigned int r = 0, rp1 = 1, i = 0; r <= this->mDescription.rMax; ++r, ++rp1)
+            vmin = rmin * rIncrement;
+            vmax = rmax * rIncrement;
+            if (updatePoles)
             {
-                Real radius = mSamples[rp1][0];
-                for (unsigned int c = 0; c <= this->mDescription.cMax; ++c, ++i)
+                if (this->mDescription.topology == MeshTopology::DISK)
+                {
+                    this->Position(this->mDescription.numVertices - 1) = { (Real)0, (Real)0, mSamples.front()[2] };
+                }
+                else if (this->mDescription.topology == MeshTopology::SPHERE)
                 {
-                    this->Position(i) = { radius * mCosAngle[c], radius * mSinAngle[c], mSamples[rp1][2] };
+                    this->Position(this->mDescription.numVertices - 2) = { (Real)0, (Real)0, mSamples.front()[2] };
+                    this->Position(this->mDescription.numVertices - 1) = { (Real)0, (Real)0, mSamples.back()[2] };
                 }
+                vmax = this->mDescription.numVertices;
             }
+        }
 
-            this->Position(this->mDescription.numVertices - 2) = { (Real)0, (Real)0, mSamples.front()[2] };
-            this->Position(this->mDescription.numVertices - 1) = { (Real)0, (Real)0, mSamples.back()[2] };
+        void UpdateSample(uint32_t i)
+        {
+            Real t = mTSampler(i);
+            Vector2<Real> position = mCurve->GetPosition(t);
+            mSamples[i][0] = position[0];
+            mSamples[i][1] = (Real)0;
+            mSamples[i][2] = position[1];
         }
 
         std::shared_ptr<ParametricCurve<2, Real>> mCurve;
@@ -3,11 +3,13 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.2 (2019/05/03)
+// File Version: 3.0.3 (2019/09/03)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <LowLevel/GteRangeIteration.h>
+#include <Mathematics/GteBlockReflector.h>
 #include <algorithm>
 #include <cmath>
 #include <cstring>
@@ -105,6 +107,22 @@
 // Householder reflections and Givens rotations to obtain the orthogonal
 // matrices of the decomposigion, and comperr is the computation E =
 // U^T*A*V - S.
+//
+// The Householder reflections are accumulated into U and V in blocks using
+// the compact WY representation (see GteBlockReflector.h), and the columns
+// of U and V are partitioned among 'numThreads' threads for that stage.
+// The Givens rotations are applied to row ranges of U and V in parallel.
+// The rank-1 updates of the bidiagonalization are partitioned by rows (and
+// the matrix-vector products by columns) when the active block is large
+// enough to amortize the cost of launching the threads.
+//
+// All workspace is allocated by the constructor.  To decompose many
+// matrices of the same size, create one object and call Solve(...) for
+// each matrix.  When numThreads is 1, no memory is allocated during the
+// calls other than for the rare decoupling rotations that exceed the
+// reserved capacity.  When numThreads > 1, each partitioned stage launches
+// and joins its threads (see GteParallelFor.h), which allocates the thread
+// objects.
 
 namespace gte
 {
@@ -120,9 +138,11 @@ public:
     // diagonal matrix.  The goal is to compute MxM orthogonal U, NxN
     // orthogonal V, and MxN matrix S for which U^T*A*V = S.  The only
     // nonzero entries of S are on the diagonal; the diagonal entries are
-    // the singular values of the original matrix.
+    // the singular values of the original matrix.  For multithreading,
+    // choose 'numThreads' subject to the constraints
+    //     1 <= numThreads <= std::thread::hardware_concurrency().
     SingularValueDecomposition(int numRows, int numCols,
-        unsigned int maxIterations);
+        unsigned int maxIterations, unsigned int numThreads = 1);
 
     // A copy of the MxN input is made internally.  The order of the singular
     // values is specified by sortType: -1 (decreasing), 0 (no sorting), or +1
@@ -187,9 +207,28 @@ private:
     // and GetOrthogonalMatrices(...).
     void ComputePermutation(int sortType);
 
+    // Execute function(t, imin, imax) for the index ranges [imin,imax) that
+    // partition [0,numItems) among the threads.  The function runs in the
+    // calling thread when multithreading is disabled or when there are too
+    // few items.
+    template <typename Function>
+    void Partition(int numItems, int minItems, Function const& function) const;
+
+    // The block size for the compact WY representation of the Householder
+    // reflections and the minimum number of rows of the active block for
+    // which the bidiagonalization is multithreaded.
+    enum
+    {
+        BLOCK_SIZE = 32,
+        MIN_PARALLEL_SIZE = 256
+    };
+
     // The number rows and columns of the matrices to be processed.
     int mNumRows, mNumCols;
 
+    // The number of threads used by Bidiagonalize, GetU and GetV.
+    unsigned int mNumThreads;
+
     // The maximum number of iterations for reducing the bidiagonal matrix
     // to a diagonal matrix.
     unsigned int mMaxIterations;
@@ -226,6 +265,11 @@ private:
     std::vector<GivensRotation> mRGivens;
     std::vector<GivensRotation> mLGivens;
 
+    // Apply the Givens rotations to the rows [rmin,rmax) of the row-major
+    // matrix with 'size' columns.
+    void ApplyGivens(std::vector<GivensRotation> const& rotations, int size,
+        int rmin, int rmax, Real* matrix) const;
+
     // The diagonal matrix that is used to convert S-entries to nonnegative.
     std::vector<Real> mFixupDiagonal;  // N elements
 
@@ -235,6 +279,19 @@ private:
     std::vector<int> mPermutation;  // N elements
     mutable std::vector<int> mVisited;  // N elements
 
+    // Storage for sorting the singular values in ComputePermutation.
+    struct SortItem
+    {
+        Real singularValue;
+        int index;
+    };
+
+    std::vector<SortItem> mSortItems;  // N elements
+
+    // Workspace for the blocked accumulation of Householder reflections,
+    // one object per thread.
+    mutable std::vector<BlockReflector<Real>> mReflectors;
+
     // Temporary storage to compute Householder reflections and to support
     // sorting of columns of the orthogonal matrices.
     std::vector<Real> mTwoInvUTU;  // N elements
@@ -247,10 +304,11 @@ private:
 
 template <typename Real>
 SingularValueDecomposition<Real>::SingularValueDecomposition(int numRows,
-    int numCols, unsigned int maxIterations)
+    int numCols, unsigned int maxIterations, unsigned int numThreads)
     :
     mNumRows(0),
     mNumCols(0),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
     mMaxIterations(0)
 {
     if (numCols > 1 && numRows >= numCols && maxIterations > 0)
@@ -271,6 +329,12 @@ SingularValueDecomposition<Real>::SingularValueDecomposition(int numRows,
         mUVector.resize(numRows);
         mVVector.resize(numCols);
         mWVector.resize(numRows);
+        mSortItems.resize(numCols);
+        mReflectors.reserve(mNumThreads);
+        for (unsigned int t = 0; t < mNumThreads; ++t)
+        {
+            mReflectors.push_back(BlockReflector<Real>(numRows, BLOCK_SIZE));
+        }
     }
 }
 
@@ -416,56 +480,34 @@ void SingularValueDecomposition<Real>::GetU(Real* uMatrix) const
     }
 
     // Multiply the Householder reflections using backward accumulation.
-    int r, c;
-    for (int i0 = mNumCols - 1, i1 = i0 + 1; i0 >= 0; --i0, --i1)
+    // Reflection i has its 1-valued component at index i and its essential
+    // components stored in column i of mMatrix below the diagonal.
+    Real const* matrix = mMatrix.data();
+    Real const* twoInvUTU = mTwoInvUTU.data();
+    int const numCols = mNumCols;
+    auto essential = [matrix, numCols](int i, int r)
     {
-        // Copy the u vector and 2/Dot(u,u) from the matrix.
-        Real twoinvudu = mTwoInvUTU[i0];
-        Real const* column = &mMatrix[i0];
-        mUVector[i0] = (Real)1;
-        for (r = i1; r < mNumRows; ++r)
-        {
-            mUVector[r] = column[mNumCols*r];
-        }
-
-        // Compute the w vector.
-        mWVector[i0] = twoinvudu;
-        for (r = i1; r < mNumRows; ++r)
-        {
-            mWVector[r] = (Real)0;
-            for (c = i1; c < mNumRows; ++c)
-            {
-                mWVector[r] += mUVector[c] * uMatrix[r + mNumRows*c];
-            }
-            mWVector[r] *= twoinvudu;
-        }
+        return matrix[i + numCols * r];
+    };
+    auto scale = [twoInvUTU](int i)
+    {
+        return twoInvUTU[i];
+    };
 
-        // Update the matrix, U <- U - u*w^T.
-        for (r = i0; r < mNumRows; ++r)
-        {
-            for (c = i0; c < mNumRows; ++c)
-            {
-                uMatrix[c + mNumRows*r] -= mUVector[r] * mWVector[c];
-            }
-        }
-    }
+    Partition(mNumRows, 1, [this, uMatrix, &essential, &scale](
+        unsigned int t, int cmin, int cmax)
+    {
+        mReflectors[t].ApplyProduct(mNumRows, mNumCols, 0, essential, scale,
+            cmin, cmax, uMatrix);
+    });
 
     // Multiply the Givens rotations.
-    for (auto const& givens : mLGivens)
+    Partition(mNumRows, 1, [this, uMatrix](unsigned int, int rmin, int rmax)
     {
-        int j0 = givens.index0;
-        int j1 = givens.index1;
-        for (r = 0; r < mNumRows; ++r, j0 += mNumRows, j1 += mNumRows)
-        {
-            Real& q0 = uMatrix[j0];
-            Real& q1 = uMatrix[j1];
-            Real prd0 = givens.cs * q0 - givens.sn * q1;
-            Real prd1 = givens.sn * q0 + givens.cs * q1;
-            q0 = prd0;
-            q1 = prd1;
-        }
-    }
+        ApplyGivens(mLGivens, mNumRows, rmin, rmax, uMatrix);
+    });
 
+    int r, c;
     if (mPermutation[0] >= 0)
     {
         // Sorting was requested.
@@ -517,58 +559,35 @@ void SingularValueDecomposition<Real>::GetV(Real* vMatrix) const
     }
 
     // Multiply the Householder reflections using backward accumulation.
-    int i0 = mNumCols - 3;
-    int i1 = i0 + 1;
-    int i2 = i0 + 2;
-    int r, c;
-    for (/**/; i0 >= 0; --i0, --i1, --i2)
+    // Reflection i has its 1-valued component at index i+1 and its
+    // essential components stored in row i of mMatrix to the right of the
+    // superdiagonal.
+    Real const* matrix = mMatrix.data();
+    Real const* twoInvVTV = mTwoInvVTV.data();
+    int const numCols = mNumCols;
+    auto essential = [matrix, numCols](int i, int c)
     {
-        // Copy the v vector and 2/Dot(v,v) from the matrix.
-        Real twoinvvdv = mTwoInvVTV[i0];
-        Real const* row = &mMatrix[mNumCols*i0];
-        mVVector[i1] = (Real)1;
-        for (r = i2; r < mNumCols; ++r)
-        {
-            mVVector[r] = row[r];
-        }
-
-        // Compute the w vector.
-        mWVector[i1] = twoinvvdv;
-        for (r = i2; r < mNumCols; ++r)
-        {
-            mWVector[r] = (Real)0;
-            for (c = i2; c < mNumCols; ++c)
-            {
-                mWVector[r] += mVVector[c] * vMatrix[r + mNumCols*c];
-            }
-            mWVector[r] *= twoinvvdv;
-        }
+        return matrix[c + numCols * i];
+    };
+    auto scale = [twoInvVTV](int i)
+    {
+        return twoInvVTV[i];
+    };
 
-        // Update the matrix, V <- V - v*w^T.
-        for (r = i1; r < mNumCols; ++r)
-        {
-            for (c = i1; c < mNumCols; ++c)
-            {
-                vMatrix[c + mNumCols*r] -= mVVector[r] * mWVector[c];
-            }
-        }
-    }
+    Partition(mNumCols, 1, [this, vMatrix, &essential, &scale](
+        unsigned int t, int cmin, int cmax)
+    {
+        mReflectors[t].ApplyProduct(mNumCols, mNumCols - 2, 1, essential,
+            scale, cmin, cmax, vMatrix);
+    });
 
     // Multiply the Givens rotations.
-    for (auto const& givens : mRGivens)
+    Partition(mNumCols, 1, [this, vMatrix](unsigned int, int rmin, int rmax)
     {
-        int j0 = givens.index0;
-        int j1 = givens.index1;
-        for (c = 0; c < mNumCols; ++c, j0 += mNumCols, j1 += mNumCols)
-        {
-            Real& q0 = vMatrix[j0];
-            Real& q1 = vMatrix[j1];
-            Real prd0 = givens.cs * q0 - givens.sn * q1;
-            Real prd1 = givens.sn * q0 + givens.cs * q1;
-            q0 = prd0;
-            q1 = prd1;
-        }
-    }
+        ApplyGivens(mRGivens, mNumCols, rmin, rmax, vMatrix);
+    });
+
+    int r, c;
 
     // Fix-up the diagonal.
     for (r = 0; r < mNumCols; ++r)
@@ -810,27 +829,48 @@ void SingularValueDecomposition<Real>::Bidiagonalize()
             }
         }
 
-        // Compute the rank-1 offset u*w^T.
+        // Compute the rank-1 offset u*w^T.  The columns of w are
+        // partitioned among the threads.  Each thread traverses the rows of
+        // the matrix contiguously.
         Real invudu = (Real)1 / udu;
         Real twoinvudu = invudu * (Real)2;
-        for (c = i; c < mNumCols; ++c)
+        Partition(mNumCols - i, MIN_PARALLEL_SIZE, [this, i, twoinvudu](
+            unsigned int, int jmin, int jmax)
         {
-            mWVector[c] = (Real)0;
-            for (r = i; r < mNumRows; ++r)
+            int const cmin = i + jmin, cmax = i + jmax;
+            for (int col = cmin; col < cmax; ++col)
             {
-                mWVector[c] += mMatrix[c + mNumCols*r] * mUVector[r];
+                mWVector[col] = (Real)0;
             }
-            mWVector[c] *= twoinvudu;
-        }
+            for (int row = i; row < mNumRows; ++row)
+            {
+                Real ur = mUVector[row];
+                Real const* mRow = &mMatrix[mNumCols*row];
+                for (int col = cmin; col < cmax; ++col)
+                {
+                    mWVector[col] += mRow[col] * ur;
+                }
+            }
+            for (int col = cmin; col < cmax; ++col)
+            {
+                mWVector[col] *= twoinvudu;
+            }
+        });
 
         // Update the input matrix.
-        for (r = i; r < mNumRows; ++r)
+        Partition(mNumRows - i, MIN_PARALLEL_SIZE, [this, i](unsigned int,
+            int jmin, int jmax)
         {
-            for (c = i; c < mNumCols; ++c)
+            for (int row = i + jmin; row < i + jmax; ++row)
             {
-                mMatrix[c + mNumCols*r] -= mUVector[r] * mWVector[c];
+                Real ur = mUVector[row];
+                Real* mRow = &mMatrix[mNumCols*row];
+                for (int col = i; col < mNumCols; ++col)
+                {
+                    mRow[col] -= ur * mWVector[col];
+                }
             }
-        }
+        });
 
         if (i < mNumCols - 2)
         {
@@ -858,27 +898,30 @@ void SingularValueDecomposition<Real>::Bidiagonalize()
                 }
             }
 
-            // Compute the rank-1 offset w*v^T.
+            // Compute the rank-1 offset w*v^T and update the input matrix.
+            // Component r of w depends only on row r of the matrix, so the
+            // rows are partitioned among the threads.
             Real invvdv = (Real)1 / vdv;
             Real twoinvvdv = invvdv * (Real)2;
-            for (r = i; r < mNumRows; ++r)
-            {
-                mWVector[r] = (Real)0;
-                for (c = ip1; c < mNumCols; ++c)
-                {
-                    mWVector[r] += mMatrix[c + mNumCols*r] * mVVector[c];
-                }
-                mWVector[r] *= twoinvvdv;
-            }
-
-            // Update the input matrix.
-            for (r = i; r < mNumRows; ++r)
+            Partition(mNumRows - i, MIN_PARALLEL_SIZE, [this, i, ip1,
+                twoinvvdv](unsigned int, int jmin, int jmax)
             {
-                for (c = ip1; c < mNumCols; ++c)
+                for (int row = i + jmin; row < i + jmax; ++row)
                 {
-                    mMatrix[c + mNumCols*r] -= mWVector[r] * mVVector[c];
+                    Real* mRow = &mMatrix[mNumCols*row];
+                    Real wr = (Real)0;
+                    for (int col = ip1; col < mNumCols; ++col)
+                    {
+                        wr += mRow[col] * mVVector[col];
+                    }
+                    wr *= twoinvvdv;
+                    mWVector[row] = wr;
+                    for (int col = ip1; col < mNumCols; ++col)
+                    {
+                        mRow[col] -= wr * mVVector[col];
+                    }
                 }
-            }
+            });
 
             mTwoInvVTV[i] = twoinvvdv;
             for (c = i + 2; c < mNumCols; ++c)
@@ -1068,13 +1111,7 @@ void SingularValueDecomposition<Real>::ComputePermutation(int sortType)
 
     // Compute the permutation induced by sorting.  Initially, we start with
     // the identity permutation I = (0,1,...,N-1).
-    struct SortItem
-    {
-        Real singularValue;
-        int index;
-    };
-
-    std::vector<SortItem> items(mNumCols);
+    std::vector<SortItem>& items = mSortItems;
     int i;
     for (i = 0; i < mNumCols; ++i)
     {
@@ -1124,6 +1161,42 @@ void SingularValueDecomposition<Real>::ComputePermutation(int sortType)
     //   singularitem[i3] = save;
 }
 
+template <typename Real>
+void SingularValueDecomposition<Real>::ApplyGivens(
+    std::vector<GivensRotation> const& rotations, int size, int rmin,
+    int rmax, Real* matrix) const
+{
+    // The rows are processed in small tiles so that the columns touched by
+    // the sequence of rotations remain in cache.
+    int const tileSize = 16;
+    for (int r0 = rmin; r0 < rmax; r0 += tileSize)
+    {
+        int const r1 = std::min(r0 + tileSize, rmax);
+        for (auto const& givens : rotations)
+        {
+            int j0 = givens.index0 + size * r0;
+            int j1 = givens.index1 + size * r0;
+            for (int r = r0; r < r1; ++r, j0 += size, j1 += size)
+            {
+                Real& q0 = matrix[j0];
+                Real& q1 = matrix[j1];
+                Real prd0 = givens.cs * q0 - givens.sn * q1;
+                Real prd1 = givens.sn * q0 + givens.cs * q1;
+                q0 = prd0;
+                q1 = prd1;
+            }
+        }
+    }
+}
+
+template <typename Real>
+template <typename Function>
+void SingularValueDecomposition<Real>::Partition(int numItems, int minItems,
+    Function const& function) const
+{
+    ParallelFor(numItems >= minItems ? mNumThreads : 1, numItems, function);
+}
+
 template <typename Real>
 SingularValueDecomposition<Real>::GivensRotation::GivensRotation()
 {
@@ -0,0 +1,449 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/13)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteSplitMeshByPlane.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Compute the contours of a triangle mesh for a family of parallel planes
+// Dot(N,X) = c[i].  This is the operation of a slicer that cuts the same
+// mesh by many planes.  The mesh is preprocessed once for the normal N:
+// the heights Dot(N,V) of the vertices are computed and the triangles are
+// sorted by their minimum heights.  The planes are processed in increasing
+// order of c[i], maintaining the set of triangles whose height intervals
+// contain c[i], so each plane visits only the triangles it intersects.
+// The planes are partitioned among the threads.
+//
+// The signed distance of a vertex V to the plane is Dot(N,V) - c[i] and
+// the edge-plane intersections are computed by SplitMeshByPlane, so the
+// classification is the same as that of SplitMeshByPlane for the plane
+// with normal N and constant c[i].  A triangle that lies in the plane is
+// rejected.  An edge that lies in the plane is a contour segment when the
+// third vertex of the triangle is on the positive side of the plane and
+// the third vertex of the adjacent triangle, if any, is not.  When both
+// triangles sharing the edge are on the same side, the plane is tangent to
+// the mesh along the edge and, as for a triangle that touches the plane
+// only at a vertex, there is no segment.
+//
+// Each contour segment is directed so that the triangle is on the positive
+// side of the plane to the left of the segment when viewed from the side
+// to which the triangle normal points.  For a consistently oriented
+// manifold mesh, the segments are joined into polylines that are closed
+// unless they end at the mesh boundary.
+
+namespace gte
+{
+    template <typename Real>
+    class SliceMeshByPlanes
+    {
+    public:
+        struct Polyline
+        {
+            // For a closed polyline, the first vertex is not repeated at
+            // the end of the array.
+            std::vector<Vector3<Real>> vertices;
+            bool closed;
+        };
+
+        // Construction.  The number of threads should satisfy
+        // 1 <= numThreads <= std::thread::hardware_concurrency().
+        SliceMeshByPlanes(unsigned int numThreads = 1)
+            :
+            mNumThreads(numThreads > 0 ? numThreads : 1)
+        {
+        }
+
+        // Preprocess the mesh for planes with the specified normal, which
+        // need not be unit length.  The 'indices' are lookups into the
+        // 'vertices' array, each triple representing a triangle.  The
+        // inputs are copied, so they may be modified or destroyed after
+        // the call.
+        void SetMesh(std::vector<Vector3<Real>> const& vertices,
+            std::vector<int> const& indices, Vector3<Real> const& normal)
+        {
+            mVertices = vertices;
+            int const numVertices = static_cast<int>(mVertices.size());
+            mHeights.resize(numVertices);
+            ParallelFor(mNumThreads, numVertices, [this, &normal](
+                unsigned int, int vmin, int vmax)
+            {
+                for (int v = vmin; v < vmax; ++v)
+                {
+                    mHeights[v] = Dot(normal, mVertices[v]);
+                }
+            });
+
+            int const numTriangles = static_cast<int>(indices.size() / 3);
+            mTriangles.resize(numTriangles);
+            ParallelFor(mNumThreads, numTriangles, [this, &indices](
+                unsigned int, int tmin, int tmax)
+            {
+                for (int t = tmin; t < tmax; ++t)
+                {
+                    Triangle& tri = mTriangles[t];
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        tri.v[j] = indices[3 * t + j];
+                    }
+                    Real h0 = mHeights[tri.v[0]];
+                    Real h1 = mHeights[tri.v[1]];
+                    Real h2 = mHeights[tri.v[2]];
+                    tri.hmin = std::min(std::min(h0, h1), h2);
+                    tri.hmax = std::max(std::max(h0, h1), h2);
+                }
+            });
+
+            std::sort(mTriangles.begin(), mTriangles.end(),
+                [](Triangle const& tri0, Triangle const& tri1)
+                {
+                    return tri0.hmin < tri1.hmin;
+                });
+        }
+
+        // Compute the contours for the planes Dot(N,X) = constants[i],
+        // where N is the normal passed to SetMesh.  The constants may be in
+        // any order; contours[i] is the set of polylines for constants[i].
+        void operator()(std::vector<Real> const& constants,
+            std::vector<std::vector<Polyline>>& contours)
+        {
+            int const numPlanes = static_cast<int>(constants.size());
+            contours.resize(numPlanes);
+
+            std::vector<int> order(numPlanes);
+            for (int i = 0; i < numPlanes; ++i)
+            {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(),
+                [&constants](int i0, int i1)
+                {
+                    return constants[i0] < constants[i1];
+                });
+
+            ParallelFor(mNumThreads, numPlanes, [this, &constants, &order,
+                &contours](unsigned int, int imin, int imax)
+            {
+                Workspace workspace;
+                int const numTriangles = static_cast<int>(mTriangles.size());
+                int next = 0;
+                for (int i = imin; i < imax; ++i)
+                {
+                    // Update the active triangles, those whose height
+                    // intervals contain the plane constant.  Triangles are
+                    // inserted in increasing order of hmin and removed
+                    // when hmax is smaller than the constant.
+                    Real const c = constants[order[i]];
+                    std::vector<int>& active = workspace.active;
+                    size_t numActive = 0;
+                    for (auto t : active)
+                    {
+                        if (mTriangles[t].hmax >= c)
+                        {
+                            active[numActive++] = t;
+                        }
+                    }
+                    active.resize(numActive);
+                    for (/**/; next < numTriangles && mTriangles[next].hmin <= c; ++next)
+                    {
+                        if (mTriangles[next].hmax >= c)
+                        {
+                            active.push_back(next);
+                        }
+                    }
+
+                    GetSegments(c, workspace);
+                    GetPolylines(c, workspace, contours[order[i]]);
+                }
+            });
+        }
+
+        // Member access.
+        inline unsigned int GetNumThreads() const
+        {
+            return mNumThreads;
+        }
+
+    private:
+        struct Triangle
+        {
+            std::array<int, 3> v;
+            Real hmin, hmax;
+        };
+
+        // A contour point is either a mesh vertex in the plane or the
+        // intersection of the plane with a transverse edge.  The point is
+        // identified by the 64-bit key (v0 << 32) | v1, where v0 <= v1 are
+        // the edge vertices; v0 = v1 for a vertex in the plane.
+        struct Segment
+        {
+            uint64_t key[2];
+        };
+
+        // Per-thread storage.
+        struct Workspace
+        {
+            std::vector<int> active;
+            std::vector<Segment> segments, edgeSegments;
+            std::vector<uint64_t> points;
+            std::vector<int> outgoing, first, incoming;
+            std::vector<char> used;
+        };
+
+        static uint64_t GetKey(int v0, int v1)
+        {
+            if (v0 > v1)
+            {
+                std::swap(v0, v1);
+            }
+            return (static_cast<uint64_t>(v0) << 32) | static_cast<uint64_t>(v1);
+        }
+
+        Vector3<Real> GetPoint(uint64_t key, Real c) const
+        {
+            int v0 = static_cast<int>(key >> 32);
+            int v1 = static_cast<int>(key & 0xFFFFFFFFull);
+            if (v0 == v1)
+            {
+                return mVertices[v0];
+            }
+            return SplitMeshByPlane<Real>::GetIntersection(mVertices[v0],
+                mVertices[v1], mHeights[v0] - c, mHeights[v1] - c);
+        }
+
+        // Compute the directed contour segments of the active triangles.
+        void GetSegments(Real c, Workspace& workspace) const
+        {
+            workspace.segments.clear();
+            workspace.edgeSegments.clear();
+            for (auto t : workspace.active)
+            {
+                std::array<int, 3> const& v = mTriangles[t].v;
+                std::array<Real, 3> sDist;
+                int numZero = 0;
+                for (int j = 0; j < 3; ++j)
+                {
+                    sDist[j] = mHeights[v[j]] - c;
+                    if (sDist[j] == (Real)0)
+                    {
+                        ++numZero;
+                    }
+                }
+
+                if (numZero == 2)
+                {
+                    // The edge opposite the nonzero vertex is in the plane.
+                    int j2 = (sDist[0] != (Real)0 ? 0 : (sDist[1] != (Real)0 ? 1 : 2));
+                    if (sDist[j2] > (Real)0)
+                    {
+                        int j0 = (j2 + 1) % 3, j1 = (j2 + 2) % 3;
+                        Segment segment;
+                        segment.key[0] = GetKey(v[j0], v[j0]);
+                        segment.key[1] = GetKey(v[j1], v[j1]);
+                        workspace.edgeSegments.push_back(segment);
+                    }
+                    continue;
+                }
+
+                if (numZero == 3)
+                {
+                    // Reject triangles lying in the plane.
+                    continue;
+                }
+
+                // Traverse the triangle boundary and find the two points
+                // where it enters and exits the positive side.  The segment
+                // is directed from the exit point to the entry point.  A vertex
+                // in the plane is visited as the start of its outgoing
+                // edge.  When the signs of the other two vertices are the
+                // same, the triangle touches the plane at a vertex or does
+                // not intersect the plane and there is no segment.
+                uint64_t enter = 0, exit = 0;
+                int numFound = 0;
+                for (int j0 = 0; j0 < 3; ++j0)
+                {
+                    int j1 = (j0 + 1) % 3;
+                    if (sDist[j0] == (Real)0)
+                    {
+                        int jm = (j0 + 2) % 3;
+                        if (SplitMeshByPlane<Real>::IsTransverse(sDist[jm], sDist[j1]))
+                        {
+                            (sDist[j1] > (Real)0 ? enter : exit) = GetKey(v[j0], v[j0]);
+                            ++numFound;
+                        }
+                    }
+                    else if (SplitMeshByPlane<Real>::IsTransverse(sDist[j0], sDist[j1]))
+                    {
+                        (sDist[j1] > (Real)0 ? enter : exit) = GetKey(v[j0], v[j1]);
+                        ++numFound;
+                    }
+                }
+
+                if (numFound == 2)
+                {
+                    Segment segment;
+                    segment.key[0] = exit;
+                    segment.key[1] = enter;
+                    workspace.segments.push_back(segment);
+                }
+            }
+
+            // An edge in the plane that is shared by two triangles on the
+            // positive side is generated by both triangles with opposite
+            // directions.  The plane is tangent to the mesh along the edge,
+            // so neither segment is kept.
+            std::vector<Segment>& edgeSegments = workspace.edgeSegments;
+            auto lessThan = [](Segment const& s0, Segment const& s1)
+            {
+                uint64_t min0 = std::min(s0.key[0], s0.key[1]);
+                uint64_t min1 = std::min(s1.key[0], s1.key[1]);
+                if (min0 != min1)
+                {
+                    return min0 < min1;
+                }
+                return std::max(s0.key[0], s0.key[1]) <
+                    std::max(s1.key[0], s1.key[1]);
+            };
+            std::sort(edgeSegments.begin(), edgeSegments.end(), lessThan);
+            size_t const numEdgeSegments = edgeSegments.size();
+            for (size_t i = 0; i < numEdgeSegments; /**/)
+            {
+                if (i + 1 < numEdgeSegments
+                    && !lessThan(edgeSegments[i], edgeSegments[i + 1]))
+                {
+                    i += 2;
+                }
+                else
+                {
+                    workspace.segments.push_back(edgeSegments[i]);
+                    ++i;
+                }
+            }
+        }
+
+        // Join the directed segments into polylines.  The walks start at
+        // the points that have more outgoing than incoming segments, which
+        // are the ends of the open polylines.  The remaining segments form
+        // closed polylines.
+        void GetPolylines(Real c, Workspace& workspace,
+            std::vector<Polyline>& polylines) const
+        {
+            polylines.clear();
+            std::vector<Segment> const& segments = workspace.segments;
+            int const numSegments = static_cast<int>(segments.size());
+            if (numSegments == 0)
+            {
+                return;
+            }
+
+            // Map the point keys to consecutive indices.
+            std::vector<uint64_t>& points = workspace.points;
+            points.resize(2 * numSegments);
+            for (int s = 0; s < numSegments; ++s)
+            {
+                points[2 * s] = segments[s].key[0];
+                points[2 * s + 1] = segments[s].key[1];
+            }
+            std::sort(points.begin(), points.end());
+            points.erase(std::unique(points.begin(), points.end()), points.end());
+            int const numPoints = static_cast<int>(points.size());
+            auto getIndex = [&points](uint64_t key)
+            {
+                return static_cast<int>(std::lower_bound(points.begin(),
+                    points.end(), key) - points.begin());
+            };
+
+            // Store the outgoing segments of each point contiguously;
+            // outgoing[first[p]] through outgoing[first[p+1]-1] are the
+            // segments that start at point p.
+            std::vector<int>& first = workspace.first;
+            std::vector<int>& incoming = workspace.incoming;
+            std::vector<int>& outgoing = workspace.outgoing;
+            first.assign(numPoints + 1, 0);
+            incoming.assign(numPoints, 0);
+            outgoing.resize(numSegments);
+            std::vector<std::array<int, 2>> ends(numSegments);
+            for (int s = 0; s < numSegments; ++s)
+            {
+                ends[s][0] = getIndex(segments[s].key[0]);
+                ends[s][1] = getIndex(segments[s].key[1]);
+                ++first[ends[s][0] + 1];
+                ++incoming[ends[s][1]];
+            }
+            for (int p = 0; p < numPoints; ++p)
+            {
+                first[p + 1] += first[p];
+            }
+            std::vector<int> current(first.begin(), first.end() - 1);
+            for (int s = 0; s < numSegments; ++s)
+            {
+                outgoing[current[ends[s][0]]++] = s;
+            }
+
+            // Walk along unused segments starting at point p.
+            std::vector<char>& used = workspace.used;
+            used.assign(numSegments, 0);
+            std::vector<int>& next = current;
+            std::copy(first.begin(), first.end() - 1, next.begin());
+            auto walk = [this, c, &points, &ends, &first, &outgoing, &used,
+                &next, &polylines](int p)
+            {
+                Polyline polyline;
+                polyline.vertices.push_back(GetPoint(points[p], c));
+                int const start = p;
+                for (;;)
+                {
+                    while (next[p] < first[p + 1] && used[outgoing[next[p]]])
+                    {
+                        ++next[p];
+                    }
+                    if (next[p] == first[p + 1])
+                    {
+                        break;
+                    }
+                    int s = outgoing[next[p]++];
+                    used[s] = 1;
+                    p = ends[s][1];
+                    polyline.vertices.push_back(GetPoint(points[p], c));
+                }
+
+                polyline.closed = (p == start && polyline.vertices.size() > 1);
+                if (polyline.closed)
+                {
+                    polyline.vertices.pop_back();
+                }
+                polylines.push_back(std::move(polyline));
+            };
+
+            for (int p = 0; p < numPoints; ++p)
+            {
+                int numOutgoing = first[p + 1] - first[p];
+                for (int k = incoming[p]; k < numOutgoing; ++k)
+                {
+                    walk(p);
+                }
+            }
+
+            for (int s = 0; s < numSegments; ++s)
+            {
+                if (!used[s])
+                {
+                    walk(ends[s][0]);
+                }
+            }
+        }
+
+        unsigned int mNumThreads;
+        std::vector<Vector3<Real>> mVertices;
+        std::vector<Real> mHeights;
+        std::vector<Triangle> mTriangles;
+    };
+}
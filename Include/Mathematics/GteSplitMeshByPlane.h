@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.24.0 (2019/04/08)
+// File Version: 3.24.1 (2019/09/13)
 
 #pragma once
 
@@ -51,6 +51,31 @@ namespace gte
             ClassifyTriangles(indices, negIndices, posIndices);
         }
 
+        // The edge <V0,V1> whose endpoints have signed distances sDist0 and
+        // sDist1 from the plane intersects the plane at a point interior to
+        // the edge when the signed distances have opposite signs.  The
+        // change-in-sign test is structured this way to avoid numerical
+        // round-off problems.  For example, sDist0 > 0 and sDist1 < 0, but
+        // both are very small and sDist0 * sDist1 = 0 because of round-off
+        // errors.  The test also guarantees consistency with the sign tests
+        // on the individual sDist values that classify the triangles.
+        static bool IsTransverse(Real sDist0, Real sDist1)
+        {
+            return (sDist0 > (Real)0 && sDist1 < (Real)0)
+                || (sDist0 < (Real)0 && sDist1 > (Real)0);
+        }
+
+        // Compute the point of intersection of a transverse edge <V0,V1>
+        // and the plane.  SliceMeshByPlanes uses this function with the
+        // edge vertices in increasing index order, so the point does not
+        // depend on the triangle that contains the edge.
+        static Vector3<Real> GetIntersection(Vector3<Real> const& V0,
+            Vector3<Real> const& V1, Real sDist0, Real sDist1)
+        {
+            Real t = sDist0 / (sDist0 - sDist1);
+            return V0 + t * (V1 - V0);
+        }
+
     private:
         void ClassifyVertices(std::vector<Vector3<Real>> const& clipVertices,
             Plane3<Real> const& plane)
@@ -77,56 +102,41 @@ namespace gte
                 Real sDist2 = mSignedDistances[v2];
 
                 EdgeKey<false> key;
-                Real t;
-                Vector3<Real> intr, diff;
-
-                // The change-in-sign tests are structured this way to avoid
-                // numerical round-off problems.  For example, sDist0 > 0 and
-                // sDist1 < 0, but both are very small and sDist0 * sDist1 = 0
-                // because of round-off errors.  The tests also guarantee
-                // consistency between this function and ClassifyTriangles,
-                // the latter function using sign tests only on the individual
-                // sDist values.
+                Vector3<Real> intr;
 
-                if ((sDist0 > (Real)0 && sDist1 < (Real)0)
-                    || (sDist0 < (Real)0 && sDist1 >(Real)0))
+                if (IsTransverse(sDist0, sDist1))
                 {
                     key = EdgeKey<false>(v0, v1);
                     if (mEMap.find(key) == mEMap.end())
                     {
-                        t = sDist0 / (sDist0 - sDist1);
-                        diff = clipVertices[v1] - clipVertices[v0];
-                        intr = clipVertices[v0] + t * diff;
+                        intr = GetIntersection(clipVertices[v0],
+                            clipVertices[v1], sDist0, sDist1);
                         clipVertices.push_back(intr);
                         mEMap[key] = std::make_pair(intr, nextIndex);
                         ++nextIndex;
                     }
                 }
 
-                if ((sDist1 > (Real)0 && sDist2 < (Real)0)
-                    || (sDist1 < (Real)0 && sDist2 >(Real)0))
+                if (IsTransverse(sDist1, sDist2))
                 {
                     key = EdgeKey<false>(v1, v2);
                     if (mEMap.find(key) == mEMap.end())
                     {
-                        t = sDist1 / (sDist1 - sDist2);
-                        diff = clipVertices[v2] - clipVertices[v1];
-                        intr = clipVertices[v1] + t * diff;
+                        intr = GetIntersection(clipVertices[v1],
+                            clipVertices[v2], sDist1, sDist2);
                         clipVertices.push_back(intr);
                         mEMap[key] = std::make_pair(intr, nextIndex);
                         ++nextIndex;
                     }
                 }
 
-                if ((sDist2 > (Real)0 && sDist0 < (Real)0)
-                    || (sDist2 < (Real)0 && sDist0 >(Real)0))
+                if (IsTransverse(sDist2, sDist0))
                 {
                     key = EdgeKey<false>(v2, v0);
                     if (mEMap.find(key) == mEMap.end())
                     {
-                        t = sDist2 / (sDist2 - sDist0);
-                        diff = clipVertices[v0] - clipVertices[v2];
-                        intr = clipVertices[v2] + t * diff;
+                        intr = GetIntersection(clipVertices[v2],
+                            clipVertices[v0], sDist2, sDist0);
                         clipVertices.push_back(intr);
                         mEMap[key] = std::make_pair(intr, nextIndex);
                         ++nextIndex;
@@ -3,11 +3,13 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.3 (2019/05/03)
+// File Version: 3.0.4 (2019/09/03)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <LowLevel/GteRangeIteration.h>
+#include <Mathematics/GteBlockReflector.h>
 #include <algorithm>
 #include <cmath>
 #include <cstring>
@@ -99,6 +101,21 @@
 // comperr is the computation E = Q^T*A*Q - D.  The construction of the full
 // eigenvector matrix is, of course, quite expensive.  If you need only a
 // small number of eigenvectors, use function GetEigenvector(int,Real*).
+//
+// The Householder reflections are accumulated in blocks using the compact
+// WY representation (see GteBlockReflector.h), which replaces the rank-1
+// updates of the eigenvector matrix by cache-friendly matrix-matrix
+// operations.  The reflections act on the columns of the eigenvector matrix
+// independently and the Givens rotations act on its rows independently, so
+// both stages are partitioned among 'numThreads' threads.  The rank-2
+// updates of the tridiagonalization are partitioned by rows when the active
+// block is large enough to amortize the cost of launching the threads.
+//
+// All workspace is allocated by the constructor.  To decompose many
+// matrices of the same size, create one solver and call Solve(...) for
+// each matrix.  When numThreads is 1, no memory is allocated during the
+// calls.  When numThreads > 1, each partitioned stage launches and joins
+// its threads (see GteParallelFor.h), which allocates the thread objects.
 
 namespace gte
 {
@@ -111,8 +128,11 @@ public:
     // and the matrix is stored in row-major order.  The maximum number of
     // iterations ('maxIterations') must be specified for the reduction of a
     // tridiagonal matrix to a diagonal matrix.  The goal is to compute
-    // NxN orthogonal Q and NxN diagonal D for which Q^T*A*Q = D.
-    SymmetricEigensolver(int size, unsigned int maxIterations);
+    // NxN orthogonal Q and NxN diagonal D for which Q^T*A*Q = D.  For
+    // multithreading, choose 'numThreads' subject to the constraints
+    //     1 <= numThreads <= std::thread::hardware_concurrency().
+    SymmetricEigensolver(int size, unsigned int maxIterations,
+        unsigned int numThreads = 1);
 
     // A copy of the NxN symmetric input is made internally.  The order of
     // the eigenvalues is specified by sortType: -1 (decreasing), 0 (no
@@ -177,9 +197,28 @@ private:
     // GetEigenvalues(...) and GetEigenvectors(...).
     void ComputePermutation(int sortType);
 
+    // Execute function(t, imin, imax) for the index ranges [imin,imax) that
+    // partition [0,numItems) among the threads.  The function runs in the
+    // calling thread when multithreading is disabled or when there are too
+    // few items.
+    template <typename Function>
+    void Partition(int numItems, int minItems, Function const& function) const;
+
+    // The block size for the compact WY representation of the Householder
+    // reflections and the minimum number of rows of the active block for
+    // which the tridiagonalization is multithreaded.
+    enum
+    {
+        BLOCK_SIZE = 32,
+        MIN_PARALLEL_SIZE = 256
+    };
+
     // The number N of rows and columns of the matrices to be processed.
     int mSize;
 
+    // The number of threads used by Tridiagonalize and GetEigenvectors.
+    unsigned int mNumThreads;
+
     // The maximum number of iterations for reducing the tridiagonal mtarix
     // to a diagonal matrix.
     unsigned int mMaxIterations;
@@ -221,6 +260,19 @@ private:
     mutable std::vector<int> mVisited;  // N elements
     mutable int mEigenvectorMatrixType;
 
+    // Storage for sorting the eigenvalues in ComputePermutation.
+    struct SortItem
+    {
+        Real eigenvalue;
+        int index;
+    };
+
+    std::vector<SortItem> mSortItems;  // N elements
+
+    // Workspace for the blocked accumulation of Householder reflections,
+    // one object per thread.
+    mutable std::vector<BlockReflector<Real>> mReflectors;
+
     // Temporary storage to compute Householder reflections and to support
     // sorting of eigenvectors.
     mutable std::vector<Real> mPVector;  // N elements
@@ -231,9 +283,10 @@ private:
 
 template <typename Real>
 SymmetricEigensolver<Real>::SymmetricEigensolver(int size,
-    unsigned int maxIterations)
+    unsigned int maxIterations, unsigned int numThreads)
     :
     mSize(0),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
     mMaxIterations(0),
     mEigenvectorMatrixType(-1)
 {
@@ -250,6 +303,12 @@ SymmetricEigensolver<Real>::SymmetricEigensolver(int size,
         mPVector.resize(size);
         mVVector.resize(size);
         mWVector.resize(size);
+        mSortItems.resize(size);
+        mReflectors.reserve(mNumThreads);
+        for (unsigned int t = 0; t < mNumThreads; ++t)
+        {
+            mReflectors.push_back(BlockReflector<Real>(size, BLOCK_SIZE));
+        }
     }
 }
 
@@ -351,57 +410,53 @@ void SymmetricEigensolver<Real>::GetEigenvectors(Real* eigenvectors) const
         }
 
         // Multiply the Householder reflections using backward accumulation.
-        int r, c;
-        for (int i = mSize - 3, rmin = i + 1; i >= 0; --i, --rmin)
+        // Reflection i has its 1-valued component at index i+1, its
+        // essential components stored in column i of mMatrix below the
+        // subdiagonal, and 2/Dot(v,v) stored on the subdiagonal.
+        Real const* matrix = mMatrix.data();
+        int const size = mSize;
+        auto essential = [matrix, size](int i, int r)
         {
-            // Copy the v vector and 2/Dot(v,v) from the matrix.
-            Real const* column = &mMatrix[i];
-            Real twoinvvdv = column[mSize*(i + 1)];
-            for (r = 0; r < i + 1; ++r)
-            {
-                mVVector[r] = (Real)0;
-            }
-            mVVector[r] = (Real)1;
-            for (++r; r < mSize; ++r)
-            {
-                mVVector[r] = column[mSize*r];
-            }
-
-            // Compute the w vector.
-            for (r = 0; r < mSize; ++r)
-            {
-                mWVector[r] = (Real)0;
-                for (c = rmin; c < mSize; ++c)
-                {
-                    mWVector[r] += mVVector[c] * eigenvectors[r + mSize*c];
-                }
-                mWVector[r] *= twoinvvdv;
-            }
+            return matrix[i + size * r];
+        };
+        auto scale = [matrix, size](int i)
+        {
+            return matrix[i + size * (i + 1)];
+        };
 
-            // Update the matrix, Q <- Q - v*w^T.
-            for (r = rmin; r < mSize; ++r)
+        Partition(mSize, 1, [this, eigenvectors, &essential, &scale](
+            unsigned int t, int cmin, int cmax)
+        {
+            mReflectors[t].ApplyProduct(mSize, mSize - 2, 1, essential, scale,
+                cmin, cmax, eigenvectors);
+        });
+
+        // Multiply the Givens rotations.  Each rotation modifies two columns
+        // of the matrix, so the rows can be processed independently.
+        // The rows are processed in small tiles so that the columns touched
+        // by the sequence of rotations remain in cache.
+        Partition(mSize, 1, [this, eigenvectors](unsigned int, int rmin,
+            int rmax)
+        {
+            int const tileSize = 16;
+            for (int r0 = rmin; r0 < rmax; r0 += tileSize)
             {
-                for (c = 0; c < mSize; ++c)
+                int const r1 = std::min(r0 + tileSize, rmax);
+                for (auto const& givens : mGivens)
                 {
-                    eigenvectors[c + mSize*r] -= mVVector[r] * mWVector[c];
+                    for (int r = r0; r < r1; ++r)
+                    {
+                        int j = givens.index + mSize*r;
+                        Real& q0 = eigenvectors[j];
+                        Real& q1 = eigenvectors[j + 1];
+                        Real prd0 = givens.cs * q0 - givens.sn * q1;
+                        Real prd1 = givens.sn * q0 + givens.cs * q1;
+                        q0 = prd0;
+                        q1 = prd1;
+                    }
                 }
             }
-        }
-
-        // Multiply the Givens rotations.
-        for (auto const& givens : mGivens)
-        {
-            for (r = 0; r < mSize; ++r)
-            {
-                int j = givens.index + mSize*r;
-                Real& q0 = eigenvectors[j];
-                Real& q1 = eigenvectors[j + 1];
-                Real prd0 = givens.cs * q0 - givens.sn * q1;
-                Real prd1 = givens.sn * q0 + givens.cs * q1;
-                q0 = prd0;
-                q1 = prd1;
-            }
-        }
+        });
 
         // The number of Householder reflections is H = mSize - 2.  If H is
         // even, the product of Householder reflections is a rotation;
@@ -550,7 +605,7 @@ Real SymmetricEigensolver<Real>::GetEigenvalue(int c) const
 template <typename Real>
 void SymmetricEigensolver<Real>::Tridiagonalize()
 {
-    int r, c;
+    int r;
     for (int i = 0, ip1 = 1; i < mSize - 2; ++i, ++ip1)
     {
         // Compute the Householder vector.  Read the initial vector from the
@@ -582,22 +637,34 @@ void SymmetricEigensolver<Real>::Tridiagonalize()
             }
         }
 
-        // Compute the rank-1 offsets v*w^T and w*v^T.
+        // Compute the rank-1 offsets v*w^T and w*v^T.  The rows of the
+        // active block are independent of each other in the matrix-vector
+        // product and in the update, so they are partitioned among the
+        // threads.
         Real invvdv = (Real)1 / vdv;
         Real twoinvvdv = invvdv * (Real)2;
-        Real pdvtvdv = (Real)0;
-        for (r = i; r < mSize; ++r)
+        Partition(mSize - i, MIN_PARALLEL_SIZE, [this, i, twoinvvdv](
+            unsigned int, int jmin, int jmax)
         {
-            mPVector[r] = (Real)0;
-            for (c = i; c < r; ++c)
+            for (int row = i + jmin; row < i + jmax; ++row)
             {
-                mPVector[r] += mMatrix[r + mSize*c] * mVVector[c];
-            }
-            for (/**/; c < mSize; ++c)
-            {
-                mPVector[r] += mMatrix[c + mSize*r] * mVVector[c];
+                Real sum = (Real)0;
+                int col;
+                for (col = i; col < row; ++col)
+                {
+                    sum += mMatrix[row + mSize*col] * mVVector[col];
+                }
+                for (/**/; col < mSize; ++col)
+                {
+                    sum += mMatrix[col + mSize*row] * mVVector[col];
+                }
+                mPVector[row] = sum * twoinvvdv;
             }
-            mPVector[r] *= twoinvvdv;
+        });
+
+        Real pdvtvdv = (Real)0;
+        for (r = i; r < mSize; ++r)
+        {
             pdvtvdv += mPVector[r] * mVVector[r];
         }
 
@@ -608,18 +675,22 @@ void SymmetricEigensolver<Real>::Tridiagonalize()
         }
 
         // Update the input matrix.
-        for (r = i; r < mSize; ++r)
+        Partition(mSize - i, MIN_PARALLEL_SIZE, [this, i](unsigned int,
+            int jmin, int jmax)
         {
-            Real vr = mVVector[r];
-            Real wr = mWVector[r];
-            Real offset = vr * wr * (Real)2;
-            mMatrix[r + mSize*r] -= offset;
-            for (c = r + 1; c < mSize; ++c)
+            for (int row = i + jmin; row < i + jmax; ++row)
             {
-                offset = vr * mWVector[c] + wr * mVVector[c];
-                mMatrix[c + mSize*r] -= offset;
+                Real vr = mVVector[row];
+                Real wr = mWVector[row];
+                Real offset = vr * wr * (Real)2;
+                mMatrix[row + mSize*row] -= offset;
+                for (int col = row + 1; col < mSize; ++col)
+                {
+                    offset = vr * mWVector[col] + wr * mVVector[col];
+                    mMatrix[col + mSize*row] -= offset;
+                }
             }
-        }
+        });
 
         // Copy the vector to column i of the matrix.  The 0-valued components
         // at indices 0 through i are not stored.  The 1-valued component at
@@ -758,13 +829,7 @@ void SymmetricEigensolver<Real>::ComputePermutation(int sortType)
 
     // Compute the permutation induced by sorting.  Initially, we start with
     // the identity permutation I = (0,1,...,N-1).
-    struct SortItem
-    {
-        Real eigenvalue;
-        int index;
-    };
-
-    std::vector<SortItem> items(mSize);
+    std::vector<SortItem>& items = mSortItems;
     int i;
     for (i = 0; i < mSize; ++i)
     {
@@ -813,6 +878,14 @@ void SymmetricEigensolver<Real>::ComputePermutation(int sortType)
     //   eigenitem[i3] = save;
 }
 
+template <typename Real>
+template <typename Function>
+void SymmetricEigensolver<Real>::Partition(int numItems, int minItems,
+    Function const& function) const
+{
+    ParallelFor(numItems >= minItems ? mNumThreads : 1, numItems, function);
+}
+
 template <typename Real>
 SymmetricEigensolver<Real>::GivensRotation::GivensRotation()
 {
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.7 (2019/04/05)
+// File Version: 3.0.8 (2019/09/15)
 
 #pragma once
 
@@ -117,6 +117,9 @@ namespace gte
                 };
             }
 
+            mRowRadius.resize(this->mDescription.numRows);
+            mRowFrame.resize(this->mDescription.numRows);
+
             if (!this->mTCoords)
             {
                 mDefaultTCoords.resize(this->mDescription.numVertices);
@@ -177,6 +180,35 @@ namespace gte
             return mUpVector;
         }
 
+        // Call this function when the medial curve has changed only for
+        // parameters in [tmin,tmax], for example after modifying a control
+        // point of a B-spline curve, or when the radial function has changed
+        // only on that interval.  The next Update() recomputes only the rows
+        // of vertices whose samples are in the interval.  When the curve is
+        // sampled by arclength, a local change of the curve moves all the
+        // samples, so all the rows are recomputed.
+        void InvalidateMedial(Real tmin, Real tmax)
+        {
+            uint32_t const numRows = this->mDescription.numRows;
+            if (mSampleByArcLength)
+            {
+                this->InvalidateRows(0, numRows);
+                return;
+            }
+
+            uint32_t rmin = numRows, rmax = 0;
+            for (uint32_t row = 0; row < numRows; ++row)
+            {
+                Real t = mTSampler(row);
+                if (tmin <= t && t <= tmax)
+                {
+                    rmin = std::min(rmin, row);
+                    rmax = row + 1;
+                }
+            }
+            this->InvalidateRows(rmin, rmax);
+        }
+
     private:
         void InitializeTCoords()
         {
@@ -194,28 +226,65 @@ namespace gte
 
         virtual void UpdatePositions() override
         {
-            uint32_t row, col, v, save;
-            for (row = 0, v = 0; row < this->mDescription.numRows; ++row, ++v)
+            uint32_t vmin = 0, vmax = this->mDescription.numVertices;
+            UpdatePositionRange(vmin, vmax);
+        }
+
+        virtual void UpdatePositionRange(uint32_t& vmin, uint32_t& vmax) override
+        {
+            // The curve is sampled in the calling thread because the curve
+            // evaluators are not required to be thread-safe; for example,
+            // the B-spline basis functions have mutable workspace.  The
+            // vertices of the rows are computed in parallel.
+            uint32_t const numRows = this->mDescription.numRows;
+            uint32_t const numCols = this->mDescription.numCols;
+            uint32_t const rIncrement = this->mDescription.rIncrement;
+            uint32_t rmin = vmin / rIncrement;
+            uint32_t rmax = std::min((vmax + rIncrement - 1) / rIncrement, numRows);
+            for (uint32_t row = rmin; row < rmax; ++row)
             {
                 Real t = mTSampler(row);
-                Real radius = mRadial(t);
+                mRowRadius[row] = mRadial(t);
                 // frame = (position, tangent, normal, binormal)
-                std::array<Vector3<Real>, 4> frame = mFSampler(t);
-                for (col = 0, save = v; col < this->mDescription.numCols; ++col, ++v)
+                mRowFrame[row] = mFSampler(t);
+            }
+
+            ParallelFor(this->mDescription.numThreads, static_cast<int>(rmax - rmin),
+                [this, rmin, numCols, rIncrement](unsigned int, int imin, int imax)
+            {
+                for (uint32_t row = rmin + imin; row < rmin + imax; ++row)
                 {
-                    this->Position(v) = frame[0] + radius * (mCosAngle[col] * frame[2] +
-                        mSinAngle[col] * frame[3]);
+                    Real radius = mRowRadius[row];
+                    std::array<Vector3<Real>, 4> const& frame = mRowFrame[row];
+                    uint32_t v = row * rIncrement, save = v;
+                    for (uint32_t col = 0; col < numCols; ++col, ++v)
+                    {
+                        this->Position(v) = frame[0] + radius * (mCosAngle[col] * frame[2] +
+                            mSinAngle[col] * frame[3]);
+                    }
+                    this->Position(v) = this->Position(save);
                 }
-                this->Position(v) = this->Position(save);
-            }
+            });
+            vmin = rmin * rIncrement;
+            vmax = rmax * rIncrement;
 
             if (mClosed)
             {
-                for (col = 0; col < this->mDescription.numCols; ++col)
+                // The positions of row 0 are copied to the vertices
+                // [i1min,i1max).  The copy is needed when the source or the
+                // destination was modified.
+                uint32_t const i1min = numCols * (numRows - 1);
+                uint32_t const i1max = i1min + numCols;
+                if (vmin < vmax && (vmin < numCols || (vmin < i1max && i1min < vmax)))
                 {
-                    uint32_t i0 = col;
-                    uint32_t i1 = col + this->mDescription.numCols * (this->mDescription.numRows - 1);
-                    this->Position(i1) = this->Position(i0);
+                    for (uint32_t col = 0; col < numCols; ++col)
+                    {
+                        uint32_t i0 = col;
+                        uint32_t i1 = col + i1min;
+                        this->Position(i1) = this->Position(i0);
+                    }
+                    vmin = std::min(vmin, i1min);
+                    vmax = std::max(vmax, i1max);
                 }
             }
         }
@@ -229,6 +298,10 @@ namespace gte
         std::function<std::array<Vector3<Real>, 4>(Real)> mFSampler;
         std::unique_ptr<FrenetFrame3<Real>> mFrenet;
 
+        // The curve samples for the rows of the most recent update.
+        std::vector<Real> mRowRadius;
+        std::vector<std::array<Vector3<Real>, 4>> mRowFrame;
+
         // If the client does not request texture coordinates, they will be
         // computed internally for use in evaluation of the surface geometry.
         std::vector<Vector2<Real>> mDefaultTCoords;
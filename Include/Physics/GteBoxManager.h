@@ -3,16 +3,40 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/12)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteIntrAlignedBox3AlignedBox3.h>
 #include <Mathematics/GteEdgeKey.h>
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <set>
 #include <vector>
 
+// The overlapping pairs of a set of axis-aligned boxes are computed by a
+// sort-and-sweep.  The sweep axis is the one for which the box centers have
+// the largest variance.  The boxes are stored in a contiguous array sorted
+// by their minimum on the sweep axis.  For coherent motion, the array is
+// nearly sorted from the previous update and an insertion sort is fast.  For
+// incoherent motion, the insertion sort is abandoned in favor of std::sort
+// when the number of element moves becomes large.
+//
+// A sweep over all the boxes tests every pair whose intervals overlap on the
+// sweep axis.  For N boxes spread through a volume, that is O(N^{5/3})
+// pairs, most of them far apart on the other two axes.  The sweep is
+// therefore done per cell of a uniform grid on the other two axes whose
+// cells are about twice the mean box size.  The boxes are distributed to
+// the cells they overlap in sorted order, so each cell is already sorted,
+// and the number of pairs tested is proportional to the number of boxes
+// times their density.  A pair of boxes that share several cells is
+// reported only by the cell that contains the minimum corner of their
+// intersection.  The cells are partitioned among the threads, each thread
+// generating pairs into its own array, and the results are merged into a
+// sorted array of pairs.
+
 namespace gte
 {
 
@@ -20,8 +44,10 @@ template <typename Real>
 class BoxManager
 {
 public:
-    // Construction.
-    BoxManager(std::vector<AlignedBox3<Real>>& boxes);
+    // Construction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    BoxManager(std::vector<AlignedBox3<Real>>& boxes,
+        unsigned int numThreads = 1);
 
     // No default construction, copy construction, or assignment are allowed.
     BoxManager() = delete;
@@ -36,56 +62,88 @@ public:
     void Initialize();
 
     // After the system is initialized, you can move the boxes using this
-    // function.  It is not enough to modify the input array of boxes
-    // since the endpoint values stored internally by this class must also
-    // change.  You can also retrieve the current rectangles information.
+    // function.  You can also retrieve the current box information.
     void SetBox(int i, AlignedBox3<Real> const& box);
     void GetBox(int i, AlignedBox3<Real>& box) const;
-    
+
     // When you are finished moving boxes, call this function to determine
-    // the overlapping boxes.  An incremental update is applied to determine
-    // the new set of overlapping boxes.
+    // the overlapping boxes.  The sorted order of the previous call is used
+    // as the starting point for the sort of the current call.
     void Update();
 
     // If (i,j) is in the overlap set, then box i and box j are
     // overlapping.  The indices are those for the the input array.  The
     // set elements (i,j) are stored so that i < j.
-    std::set<EdgeKey<false>> const& GetOverlap() const;
+    inline std::set<EdgeKey<false>> const& GetOverlap() const;
+
+    // The overlapping pairs of GetOverlap() stored in an array in the order
+    // of EdgeKey<false>::operator<, which is the iteration order of the
+    // set.  Use it when the pairs are only iterated or are partitioned
+    // among threads by index.
+    inline std::vector<EdgeKey<false>> const& GetOverlapArray() const;
+
+    // The axis used by the sweep of the last update.
+    inline int GetSweepAxis() const;
 
 private:
-    class Endpoint
+    // The boxes sorted by min[mAxis].  The box bounds are copied so that the
+    // sweep accesses contiguous memory.
+    class SortedBox
     {
     public:
-        Real value; // endpoint value
-        int type;   // '0' if interval min, '1' if interval max.
-        int index;  // index of interval containing this endpoint
+        Real min[3], max[3];
+        int index;
+    };
 
-        // Support for sorting of endpoints.
-        bool operator<(Endpoint const& endpoint) const;
+    // A box in the list of a grid cell.  The bounds on the other axes and
+    // the cell of the box minimum are copied so that the sweep of a cell
+    // accesses contiguous memory.
+    class CellBox
+    {
+    public:
+        Real min0, max0;
+        std::array<Real, 4> bounds;
+        int cellMin[2];
+        int index;
     };
 
-    void InsertionSort(std::vector<Endpoint>& endPoint, std::vector<int>& lookup);
+    void SelectAxis();
+    void InsertionSort();
+    void SelectGrid();
+    void Sweep();
+    void UpdateOverlapSet();
+
+    inline int GetCell(int j, Real value) const;
 
     std::vector<AlignedBox3<Real>>& mBoxes;
-    std::vector<Endpoint> mXEndpoints, mYEndpoints, mZEndpoints;
-    std::set<EdgeKey<false>> mOverlap;
-
-    // The intervals are indexed 0 <= i < n.  The endpoint array has 2*n
-    // entries.  The original 2*n interval values are ordered as b[0], e[0],
-    // b[1], e[1], ..., b[n-1], e[n-1].  When the endpoint array is sorted,
-    // the mapping between interval values and endpoints is lost.  In order
-    // to modify interval values that are stored in the endpoint array, we
-    // need to maintain the mapping.  This is done by the following lookup
-    // table of 2*n entries.  The value mLookup[2*i] is the index of b[i]
-    // in the endpoint array.  The value mLookup[2*i+1] is the index of
-    // e[i] in the endpoint array.
-    std::vector<int> mXLookup, mYLookup, mZLookup;
+    unsigned int mNumThreads;
+    int mAxis;
+    std::vector<SortedBox> mSorted;
+
+    // The grid on the axes (mAxis+1)%3 and (mAxis+2)%3.
+    int mNumCells[2];
+    Real mCellOrigin[2], mCellScale[2];
+    std::vector<std::array<int, 4>> mBoxCells;
+    std::vector<int> mCellStart;
+    std::vector<CellBox> mCellBoxes;
+
+    std::vector<std::vector<EdgeKey<false>>> mThreadOverlap;
+    std::vector<int> mOverlapStart;
+    std::vector<EdgeKey<false>> mOverlap;
+    std::set<EdgeKey<false>> mOverlapSet;
 };
 
 template <typename Real>
-BoxManager<Real>::BoxManager(std::vector<AlignedBox3<Real> >& boxes)
+BoxManager<Real>::BoxManager(std::vector<AlignedBox3<Real>>& boxes,
+    unsigned int numThreads)
     :
-    mBoxes(boxes)
+    mBoxes(boxes),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mAxis(-1),
+    mNumCells{ 1, 1 },
+    mCellOrigin{ (Real)0, (Real)0 },
+    mCellScale{ (Real)0, (Real)0 },
+    mThreadOverlap(mNumThreads)
 {
     Initialize();
 }
@@ -93,204 +151,385 @@ BoxManager<Real>::BoxManager(std::vector<AlignedBox3<Real> >& boxes)
 template <typename Real>
 void BoxManager<Real>::Initialize()
 {
-    // Get the box endpoints.
-    int intrSize = static_cast<int>(mBoxes.size()), endpSize = 2 * intrSize;
-    mXEndpoints.resize(endpSize);
-    mYEndpoints.resize(endpSize);
-    mZEndpoints.resize(endpSize);
-    for (int i = 0, j = 0; i < intrSize; ++i)
+    int const numBoxes = static_cast<int>(mBoxes.size());
+    mSorted.resize(numBoxes);
+    for (int i = 0; i < numBoxes; ++i)
     {
-        mXEndpoints[j].type = 0;
-        mXEndpoints[j].value = mBoxes[i].min[0];
-        mXEndpoints[j].index = i;
-        mYEndpoints[j].type = 0;
-        mYEndpoints[j].value = mBoxes[i].min[1];
-        mYEndpoints[j].index = i;
-        mZEndpoints[j].type = 0;
-        mZEndpoints[j].value = mBoxes[i].min[2];
-        mZEndpoints[j].index = i;
-        ++j;
-
-        mXEndpoints[j].type = 1;
-        mXEndpoints[j].value = mBoxes[i].max[0];
-        mXEndpoints[j].index = i;
-        mYEndpoints[j].type = 1;
-        mYEndpoints[j].value = mBoxes[i].max[1];
-        mYEndpoints[j].index = i;
-        mZEndpoints[j].type = 1;
-        mZEndpoints[j].value = mBoxes[i].max[2];
-        mZEndpoints[j].index = i;
-        ++j;
+        mSorted[i].index = i;
     }
 
-    // Sort the rectangle endpoints.
-    std::sort(mXEndpoints.begin(), mXEndpoints.end());
-    std::sort(mYEndpoints.begin(), mYEndpoints.end());
-    std::sort(mZEndpoints.begin(), mZEndpoints.end());
+    // Force a full sort in Update().
+    mAxis = -1;
+    Update();
+}
+
+template <typename Real>
+void BoxManager<Real>::SetBox(int i, AlignedBox3<Real> const& box)
+{
+    mBoxes[i] = box;
+}
 
-    // Create the interval-to-endpoint lookup tables.
-    mXLookup.resize(endpSize);
-    mYLookup.resize(endpSize);
-    mZLookup.resize(endpSize);
-    for (int j = 0; j < endpSize; ++j)
+template <typename Real>
+void BoxManager<Real>::GetBox(int i, AlignedBox3<Real>& box) const
+{
+    box = mBoxes[i];
+}
+
+template <typename Real>
+void BoxManager<Real>::Update()
+{
+    // Copy the current bounds to the sorted array, which is in the order of
+    // the previous update.
+    for (auto& sorted : mSorted)
     {
-        mXLookup[2 * mXEndpoints[j].index + mXEndpoints[j].type] = j;
-        mYLookup[2 * mYEndpoints[j].index + mYEndpoints[j].type] = j;
-        mZLookup[2 * mZEndpoints[j].index + mZEndpoints[j].type] = j;
+        AlignedBox3<Real> const& box = mBoxes[sorted.index];
+        for (int d = 0; d < 3; ++d)
+        {
+            sorted.min[d] = box.min[d];
+            sorted.max[d] = box.max[d];
+        }
     }
 
-    // Active set of rectangles (stored by index in array).
-    std::set<int> active;
+    int const previousAxis = mAxis;
+    SelectAxis();
+    if (mAxis == previousAxis)
+    {
+        InsertionSort();
+    }
+    else
+    {
+        int const axis = mAxis;
+        std::sort(mSorted.begin(), mSorted.end(),
+            [axis](SortedBox const& box0, SortedBox const& box1)
+            {
+                return box0.min[axis] < box1.min[axis];
+            });
+    }
+
+    SelectGrid();
+    Sweep();
+
+    UpdateOverlapSet();
+}
+
+template <typename Real>
+inline std::set<EdgeKey<false>> const& BoxManager<Real>::GetOverlap() const
+{
+    return mOverlapSet;
+}
+
+template <typename Real>
+inline std::vector<EdgeKey<false>> const& BoxManager<Real>::GetOverlapArray() const
+{
+    return mOverlap;
+}
+
+template <typename Real>
+inline int BoxManager<Real>::GetSweepAxis() const
+{
+    return mAxis;
+}
 
-    // set of overlapping rectangles (stored by pairs of indices in array)
-    mOverlap.clear();
+template <typename Real>
+void BoxManager<Real>::SelectAxis()
+{
+    int const numBoxes = static_cast<int>(mSorted.size());
+    if (numBoxes == 0)
+    {
+        mAxis = 0;
+        return;
+    }
 
-    // Sweep through the endpoints to determine overlapping x-intervals.
-    for (int i = 0; i < endpSize; ++i)
+    // The centers are scaled by 2 to avoid the division; this does not
+    // change which variance is the largest.
+    Real mean[3] = { (Real)0, (Real)0, (Real)0 };
+    for (auto const& sorted : mSorted)
     {
-        Endpoint& endpoint = mXEndpoints[i];
-        int index = endpoint.index;
-        if (endpoint.type == 0)  // an interval 'begin' value
+        for (int d = 0; d < 3; ++d)
         {
-            // In the 1D problem, the current interval overlaps with all the
-            // active intervals.  In 3D we also need to check for y-overlap
-            // and z-overlap.
-            for (auto activeIndex : active)
-            {
-                // Rectangles activeIndex and index overlap in the
-                // x-dimension.  Test for overlap in the y-dimension and
-                // z-dimension.
-                AlignedBox3<Real> const& b0 = mBoxes[activeIndex];
-                AlignedBox3<Real> const& b1 = mBoxes[index];
-                if (b0.max[1] >= b1.min[1] && b0.min[1] <= b1.max[1]
-                    && b0.max[2] >= b1.min[2] && b0.min[2] <= b1.max[2])
-                {
-                    if (activeIndex < index)
-                    {
-                        mOverlap.insert(EdgeKey<false>(activeIndex, index));
-                    }
-                    else
-                    {
-                        mOverlap.insert(EdgeKey<false>(index, activeIndex));
-                    }
-                }
-            }
-            active.insert(index);
+            mean[d] += sorted.min[d] + sorted.max[d];
         }
-        else  // an interval 'end' value
+    }
+    for (int d = 0; d < 3; ++d)
+    {
+        mean[d] /= static_cast<Real>(numBoxes);
+    }
+
+    Real variance[3] = { (Real)0, (Real)0, (Real)0 };
+    for (auto const& sorted : mSorted)
+    {
+        for (int d = 0; d < 3; ++d)
         {
-            active.erase(index);
+            Real diff = sorted.min[d] + sorted.max[d] - mean[d];
+            variance[d] += diff * diff;
         }
     }
+
+    // Switching axes requires a full sort, so the current axis is kept
+    // unless another axis has a substantially larger variance.  This avoids
+    // alternating between axes with nearly equal variances.
+    int axis = (mAxis >= 0 ? mAxis : 0);
+    for (int d = 0; d < 3; ++d)
+    {
+        if (variance[d] > (Real)2 * variance[axis]
+            || (mAxis < 0 && variance[d] > variance[axis]))
+        {
+            axis = d;
+        }
+    }
+    mAxis = axis;
 }
 
 template <typename Real>
-void BoxManager<Real>::SetBox(int i, AlignedBox3<Real> const& box)
+void BoxManager<Real>::InsertionSort()
 {
-    mBoxes[i] = box;
-    mXEndpoints[mXLookup[2 * i]].value = box.min[0];
-    mXEndpoints[mXLookup[2 * i + 1]].value = box.max[0];
-    mYEndpoints[mYLookup[2 * i]].value = box.min[1];
-    mYEndpoints[mYLookup[2 * i + 1]].value = box.max[1];
-    mZEndpoints[mZLookup[2 * i]].value = box.min[2];
-    mZEndpoints[mZLookup[2 * i + 1]].value = box.max[2];
+    // Under the assumption that the boxes have not moved much since the
+    // last call, the array is nearly sorted and the insertion sort is very
+    // fast.  If the number of moves exceeds a small multiple of the number
+    // of boxes, the motion is incoherent and std::sort is used instead.
+    int const axis = mAxis;
+    int const numBoxes = static_cast<int>(mSorted.size());
+    long long const maxMoves = 4 * static_cast<long long>(numBoxes);
+    long long numMoves = 0;
+    for (int j = 1; j < numBoxes; ++j)
+    {
+        SortedBox key = mSorted[j];
+        int i = j - 1;
+        while (i >= 0 && key.min[axis] < mSorted[i].min[axis])
+        {
+            mSorted[i + 1] = mSorted[i];
+            --i;
+        }
+        mSorted[i + 1] = key;
+
+        numMoves += j - 1 - i;
+        if (numMoves > maxMoves)
+        {
+            std::sort(mSorted.begin(), mSorted.end(),
+                [axis](SortedBox const& box0, SortedBox const& box1)
+                {
+                    return box0.min[axis] < box1.min[axis];
+                });
+            return;
+        }
+    }
 }
 
 template <typename Real>
-void BoxManager<Real>::GetBox(int i, AlignedBox3<Real>& box) const
+void BoxManager<Real>::SelectGrid()
 {
-    box = mBoxes[i];
+    int const numBoxes = static_cast<int>(mSorted.size());
+    int const axis[2] = { (mAxis + 1) % 3, (mAxis + 2) % 3 };
+    for (int j = 0; j < 2; ++j)
+    {
+        mNumCells[j] = 1;
+        mCellOrigin[j] = (Real)0;
+        mCellScale[j] = (Real)0;
+    }
+    if (numBoxes == 0)
+    {
+        return;
+    }
+
+    // The cell size on each axis is twice the mean box size, so a box of
+    // average size overlaps at most 4 cells.
+    Real range[2], size[2];
+    for (int j = 0; j < 2; ++j)
+    {
+        int const d = axis[j];
+        Real minValue = mSorted[0].min[d], maxValue = mSorted[0].max[d];
+        Real sumSizes = (Real)0;
+        for (auto const& sorted : mSorted)
+        {
+            minValue = std::min(minValue, sorted.min[d]);
+            maxValue = std::max(maxValue, sorted.max[d]);
+            sumSizes += sorted.max[d] - sorted.min[d];
+        }
+        mCellOrigin[j] = minValue;
+        range[j] = maxValue - minValue;
+        Real cellSize = (Real)2 * sumSizes / static_cast<Real>(numBoxes);
+        size[j] = (cellSize > (Real)0 ? range[j] / cellSize : (Real)0);
+    }
+
+    // Limit the number of cells to the number of boxes.
+    Real const maxCells = static_cast<Real>(numBoxes);
+    Real product = size[0] * size[1];
+    if (product > maxCells)
+    {
+        Real scale = std::sqrt(maxCells / product);
+        size[0] *= scale;
+        size[1] *= scale;
+    }
+    for (int j = 0; j < 2; ++j)
+    {
+        if (size[j] >= (Real)2)
+        {
+            mNumCells[j] = static_cast<int>(std::min(size[j], maxCells));
+            mCellScale[j] = static_cast<Real>(mNumCells[j]) / range[j];
+        }
+    }
 }
 
 template <typename Real>
-void BoxManager<Real>::InsertionSort(std::vector<Endpoint>& endpoint, std::vector<int>& lookup)
+inline int BoxManager<Real>::GetCell(int j, Real value) const
 {
-    // Apply an insertion sort.  Under the assumption that the rectangles
-    // have not changed much since the last call, the endpoints are nearly
-    // sorted.  The insertion sort should be very fast in this case.
+    // The cell index is a nondecreasing function of the value, so two
+    // overlapping intervals have overlapping ranges of cells.
+    int cell = static_cast<int>((value - mCellOrigin[j]) * mCellScale[j]);
+    return std::min(std::max(cell, 0), mNumCells[j] - 1);
+}
 
-    TIQuery<Real, AlignedBox3<Real>, AlignedBox3<Real>> query;
-    int endpSize = static_cast<int>(endpoint.size());
-    for (int j = 1; j < endpSize; ++j)
+template <typename Real>
+void BoxManager<Real>::Sweep()
+{
+    int const a0 = mAxis, a1 = (a0 + 1) % 3, a2 = (a0 + 2) % 3;
+    int const numBoxes = static_cast<int>(mSorted.size());
+    int const numCells = mNumCells[0] * mNumCells[1];
+    for (auto& overlap : mThreadOverlap)
     {
-        Endpoint key = endpoint[j];
-        int i = j - 1;
-        while (i >= 0 && key < endpoint[i])
-        {
-            Endpoint e0 = endpoint[i];
-            Endpoint e1 = endpoint[i + 1];
+        overlap.clear();
+    }
 
-            // Update the overlap status.
-            if (e0.type == 0)
+    // Count the boxes in each cell and distribute them in sorted order, so
+    // that the list of each cell is sorted by min[a0].
+    mBoxCells.resize(numBoxes);
+    mCellStart.assign(static_cast<size_t>(numCells) + 1, 0);
+    for (int i = 0; i < numBoxes; ++i)
+    {
+        SortedBox const& sorted = mSorted[i];
+        std::array<int, 4>& cells = mBoxCells[i];
+        cells = { GetCell(0, sorted.min[a1]), GetCell(0, sorted.max[a1]),
+            GetCell(1, sorted.min[a2]), GetCell(1, sorted.max[a2]) };
+        for (int c1 = cells[2]; c1 <= cells[3]; ++c1)
+        {
+            for (int c0 = cells[0]; c0 <= cells[1]; ++c0)
             {
-                if (e1.type == 1)
-                {
-                    // The 'b' of interval E0.mIndex was smaller than the 'e'
-                    // of interval E1.mIndex, and the intervals *might have
-                    // been* overlapping.  Now 'b' and 'e' are swapped, and
-                    // the intervals cannot overlap.  Remove the pair from
-                    // the overlap set.  The removal operation needs to find
-                    // the pair and erase it if it exists.  Finding the pair
-                    // is the expensive part of the operation, so there is no
-                    // real time savings in testing for existence first, then
-                    // deleting if it does.
-                    mOverlap.erase(EdgeKey<false>(e0.index, e1.index));
-                }
+                ++mCellStart[c0 + mNumCells[0] * c1 + 1];
+            }
+        }
+    }
+    for (int c = 0; c < numCells; ++c)
+    {
+        mCellStart[c + 1] += mCellStart[c];
+    }
+    mCellBoxes.resize(mCellStart[numCells]);
+    std::vector<int> next(mCellStart.begin(), mCellStart.end() - 1);
+    for (int i = 0; i < numBoxes; ++i)
+    {
+        SortedBox const& sorted = mSorted[i];
+        std::array<int, 4> const& cells = mBoxCells[i];
+        CellBox cellBox;
+        cellBox.min0 = sorted.min[a0];
+        cellBox.max0 = sorted.max[a0];
+        cellBox.bounds = { sorted.min[a1], sorted.max[a1], sorted.min[a2],
+            sorted.max[a2] };
+        cellBox.cellMin[0] = cells[0];
+        cellBox.cellMin[1] = cells[2];
+        cellBox.index = sorted.index;
+        for (int c1 = cells[2]; c1 <= cells[3]; ++c1)
+        {
+            for (int c0 = cells[0]; c0 <= cells[1]; ++c0)
+            {
+                mCellBoxes[next[c0 + mNumCells[0] * c1]++] = cellBox;
             }
-            else
+        }
+    }
+
+    ParallelFor(mNumThreads, numCells, [this](unsigned int t, int cmin,
+        int cmax)
+    {
+        std::vector<EdgeKey<false>>& overlap = mThreadOverlap[t];
+        for (int c = cmin; c < cmax; ++c)
+        {
+            int const c0 = c % mNumCells[0], c1 = c / mNumCells[0];
+            int const jmax = mCellStart[c + 1];
+            for (int i = mCellStart[c]; i < jmax; ++i)
             {
-                if (e1.type == 0)
+                // The boxes j > i of the cell with min0 <= max0 of box i
+                // are exactly those whose a0-intervals overlap that of
+                // box i and that follow it in the sorted order.  Test them
+                // for overlap in the other dimensions.  Most of the tests
+                // fail, and the outcome is hard to predict, so the
+                // comparisons are combined without branches.
+                CellBox const& box0 = mCellBoxes[i];
+                std::array<Real, 4> const& b0 = box0.bounds;
+                for (int j = i + 1; j < jmax && mCellBoxes[j].min0 <= box0.max0; ++j)
                 {
-                    // The 'b' of interval E1.index was larger than the 'e'
-                    // of interval E0.index, and the intervals were not
-                    // overlapping.  Now 'b' and 'e' are swapped, and the
-                    // intervals *might be* overlapping.  Determine if they
-                    // are overlapping and then insert.
-                    if (query(mBoxes[e0.index], mBoxes[e1.index]).intersect)
+                    CellBox const& box1 = mCellBoxes[j];
+                    std::array<Real, 4> const& b1 = box1.bounds;
+                    bool intersect = (b0[1] >= b1[0]) & (b0[0] <= b1[1])
+                        & (b0[3] >= b1[2]) & (b0[2] <= b1[3]);
+                    if (intersect
+                        && std::max(box0.cellMin[0], box1.cellMin[0]) == c0
+                        && std::max(box0.cellMin[1], box1.cellMin[1]) == c1)
                     {
-                        mOverlap.insert(EdgeKey<false>(e0.index, e1.index));
+                        overlap.push_back(EdgeKey<false>(box0.index,
+                            box1.index));
                     }
                 }
             }
+        }
+    });
 
-            // Reorder the items to maintain the sorted list.
-            endpoint[i] = e1;
-            endpoint[i + 1] = e0;
-            lookup[2 * e1.index + e1.type] = i;
-            lookup[2 * e0.index + e0.type] = i + 1;
-            --i;
+    // Sort the pairs by a counting sort on V[1], which is the first index
+    // compared by EdgeKey<false>::operator<, followed by sorts of the short
+    // runs of pairs with equal V[1].  For a dense scene, this is much faster
+    // than a comparison sort of all the pairs.
+    mOverlapStart.assign(static_cast<size_t>(numBoxes) + 1, 0);
+    for (auto const& overlap : mThreadOverlap)
+    {
+        for (auto const& key : overlap)
+        {
+            ++mOverlapStart[key.V[1] + 1];
         }
-        endpoint[i + 1] = key;
-        lookup[2 * key.index + key.type] = i + 1;
+    }
+    for (int i = 0; i < numBoxes; ++i)
+    {
+        mOverlapStart[i + 1] += mOverlapStart[i];
+    }
+    mOverlap.resize(mOverlapStart[numBoxes]);
+    for (auto const& overlap : mThreadOverlap)
+    {
+        for (auto const& key : overlap)
+        {
+            mOverlap[mOverlapStart[key.V[1]]++] = key;
+        }
+    }
+    for (int i = numBoxes - 1; i > 0; --i)
+    {
+        mOverlapStart[i] = mOverlapStart[i - 1];
+    }
+    mOverlapStart[0] = 0;
+    for (int i = 0; i < numBoxes; ++i)
+    {
+        std::sort(mOverlap.begin() + mOverlapStart[i],
+            mOverlap.begin() + mOverlapStart[i + 1]);
     }
 }
 
 template <typename Real>
-void BoxManager<Real>::Update()
-{
-    InsertionSort(mXEndpoints, mXLookup);
-    InsertionSort(mYEndpoints, mYLookup);
-    InsertionSort(mZEndpoints, mZLookup);
-}
-
-template <typename Real>
-const std::set<EdgeKey<false>>& BoxManager<Real>::GetOverlap() const
-{
-    return mOverlap;
-}
-
-template <typename Real>
-bool BoxManager<Real>::Endpoint::operator<(const Endpoint& endpoint) const
+void BoxManager<Real>::UpdateOverlapSet()
 {
-    if (value < endpoint.value)
-    {
-        return true;
-    }
-    if (value > endpoint.value)
+    // Merge the sorted array into the set of the previous update.  Only the
+    // pairs that were added or removed since then cause allocations or
+    // deallocations, which is fast for coherent motion.
+    auto element = mOverlapSet.begin();
+    for (auto const& key : mOverlap)
     {
-        return false;
+        while (element != mOverlapSet.end() && *element < key)
+        {
+            element = mOverlapSet.erase(element);
+        }
+        if (element != mOverlapSet.end() && *element == key)
+        {
+            ++element;
+        }
+        else
+        {
+            mOverlapSet.insert(element, key);
+        }
     }
-    return type < endpoint.type;
+    mOverlapSet.erase(element, mOverlapSet.end());
 }
 
 }
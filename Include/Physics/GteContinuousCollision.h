@@ -0,0 +1,561 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteAlignedBox.h>
+#include <Mathematics/GteEdgeKey.h>
+#include <Mathematics/GteIntrOrientedBox3Sphere3.h>
+#include <Mathematics/GteIntrSphere3Triangle3.h>
+#include <algorithm>
+#include <vector>
+
+// Continuous collision detection for a set of objects that move with
+// constant linear velocities during a time step [0,tMax].  The objects are
+// spheres, oriented boxes and triangles.  The candidate pairs are supplied
+// by a broad phase, for example BoxManager applied to the boxes returned by
+// GetSweptBox, and the first contact of each pair is computed by the
+// dynamic find-intersection queries FIQuery for box-sphere and
+// sphere-triangle.  Two spheres are handled here by solving the quadratic
+// for the time at which the distance between their centers is the sum of
+// the radii.  There are no dynamic queries for box-box, box-triangle or
+// triangle-triangle, so those pairs are not tested; their number is
+// reported by GetNumUnsupported.
+//
+// The bounding sphere and velocity of each object are stored as a structure
+// of arrays.  The pairs are processed in blocks of BLOCK_SIZE.  For a block,
+// a branch-free loop rejects the pairs whose bounding spheres do not come
+// into contact during [0,tMax]; the remaining pairs are passed to the exact
+// queries.  The blocks are partitioned among the threads, each thread
+// generating contacts into its own array, and the results are merged into
+// an array of contacts sorted by time.  Ties are broken by the object
+// indices, so the result does not depend on the number of threads.
+
+namespace gte
+{
+
+template <typename Real>
+class ContinuousCollision
+{
+public:
+    enum ObjectType
+    {
+        SPHERE,
+        BOX,
+        TRIANGLE
+    };
+
+    // The first contact of a pair of objects with object0 < object1.  The
+    // intersectionType is -1 when the objects are overlapping at time 0, in
+    // which case the time is 0 and the point is only one of the points of
+    // the overlap, and +1 when the objects are separated at time 0 and come
+    // into contact at 'time', 0 < time <= tMax.
+    struct Contact
+    {
+        Real time;
+        int object0, object1;
+        int intersectionType;
+        Vector3<Real> point;
+    };
+
+    // Construction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    ContinuousCollision(unsigned int numThreads = 1);
+
+    // Disallow copying and assignment.
+    ContinuousCollision(ContinuousCollision const&) = delete;
+    ContinuousCollision& operator=(ContinuousCollision const&) = delete;
+
+    // Add an object with the specified velocity.  The return value is the
+    // index of the object, which is the number of objects before the call.
+    // The indices of the broad-phase pairs must be these indices.
+    int AddSphere(Sphere3<Real> const& sphere, Vector3<Real> const& velocity);
+    int AddBox(OrientedBox3<Real> const& box, Vector3<Real> const& velocity);
+    int AddTriangle(Triangle3<Real> const& triangle,
+        Vector3<Real> const& velocity);
+
+    // Remove all objects.
+    void Clear();
+
+    // Move the objects between updates.  The type of object i must be the
+    // type of the function.
+    void SetSphere(int i, Sphere3<Real> const& sphere,
+        Vector3<Real> const& velocity);
+    void SetBox(int i, OrientedBox3<Real> const& box,
+        Vector3<Real> const& velocity);
+    void SetTriangle(int i, Triangle3<Real> const& triangle,
+        Vector3<Real> const& velocity);
+
+    // Member access.
+    inline int GetNumObjects() const;
+    inline ObjectType GetType(int i) const;
+    inline Vector3<Real> GetVelocity(int i) const;
+
+    // The axis-aligned box that contains the bounding sphere of object i
+    // during [0,tMax], for use by a broad phase.
+    AlignedBox3<Real> GetSweptBox(int i, Real tMax) const;
+
+    // Compute the first contacts during [0,tMax] of the pairs.  The pairs
+    // must have V[0] != V[1]; the pairs of BoxManager::GetOverlapArray()
+    // have V[0] < V[1].
+    void Update(std::vector<EdgeKey<false>> const& pairs, Real tMax);
+
+    // The contacts of the last update, sorted by time, and the number of
+    // pairs of the last update that were not tested because there is no
+    // dynamic query for their object types.
+    inline std::vector<Contact> const& GetContacts() const;
+    inline size_t GetNumUnsupported() const;
+
+private:
+    enum { BLOCK_SIZE = 64 };
+
+    struct Workspace
+    {
+        std::vector<int> object0, object1;
+        std::vector<Real> center[3], velocity[3], radius;
+        std::vector<char> candidate;
+        std::vector<Contact> contacts;
+        size_t numUnsupported;
+    };
+
+    int AddObject(ObjectType type, int index, Vector3<Real> const& center,
+        Real radius, Vector3<Real> const& velocity);
+    void SetObject(int i, Vector3<Real> const& center, Real radius,
+        Vector3<Real> const& velocity);
+
+    // Reject the pairs of a block whose bounding spheres are not in contact
+    // during [0,tMax] and run the exact queries for the others.
+    void UpdateBlock(EdgeKey<false> const* pairs, int numLanes, Real tMax,
+        Workspace& ws) const;
+
+    // The exact query for a pair of objects.  The return value is 'true'
+    // when the objects are in contact during [0,tMax].
+    bool Find(int i0, int i1, Real tMax, Contact& contact) const;
+    bool FindSphereSphere(int i0, int i1, Real tMax, Contact& contact) const;
+
+    // The type of object i and its index in the array for that type.
+    std::vector<ObjectType> mType;
+    std::vector<int> mIndex;
+    std::vector<Sphere3<Real>> mSpheres;
+    std::vector<OrientedBox3<Real>> mBoxes;
+    std::vector<Triangle3<Real>> mTriangles;
+
+    // The bounding spheres and velocities of the objects.
+    std::vector<Real> mCenter[3], mRadius, mVelocity[3];
+
+    unsigned int mNumThreads;
+    std::vector<Workspace> mWorkspace;
+    std::vector<Contact> mContacts;
+    size_t mNumUnsupported;
+};
+
+
+template <typename Real>
+ContinuousCollision<Real>::ContinuousCollision(unsigned int numThreads)
+    :
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mWorkspace(numThreads > 0 ? numThreads : 1),
+    mNumUnsupported(0)
+{
+    for (auto& ws : mWorkspace)
+    {
+        ws.object0.resize(BLOCK_SIZE);
+        ws.object1.resize(BLOCK_SIZE);
+        for (int d = 0; d < 3; ++d)
+        {
+            ws.center[d].resize(BLOCK_SIZE);
+            ws.velocity[d].resize(BLOCK_SIZE);
+        }
+        ws.radius.resize(BLOCK_SIZE);
+        ws.candidate.resize(BLOCK_SIZE);
+        ws.numUnsupported = 0;
+    }
+}
+
+template <typename Real>
+int ContinuousCollision<Real>::AddSphere(Sphere3<Real> const& sphere,
+    Vector3<Real> const& velocity)
+{
+    mSpheres.push_back(sphere);
+    return AddObject(SPHERE, static_cast<int>(mSpheres.size()) - 1,
+        sphere.center, sphere.radius, velocity);
+}
+
+template <typename Real>
+int ContinuousCollision<Real>::AddBox(OrientedBox3<Real> const& box,
+    Vector3<Real> const& velocity)
+{
+    mBoxes.push_back(box);
+    return AddObject(BOX, static_cast<int>(mBoxes.size()) - 1, box.center,
+        Length(box.extent), velocity);
+}
+
+template <typename Real>
+int ContinuousCollision<Real>::AddTriangle(Triangle3<Real> const& triangle,
+    Vector3<Real> const& velocity)
+{
+    mTriangles.push_back(triangle);
+    Vector3<Real> center = (triangle.v[0] + triangle.v[1] + triangle.v[2])
+        / (Real)3;
+    Real radius = std::max(std::max(Length(triangle.v[0] - center),
+        Length(triangle.v[1] - center)), Length(triangle.v[2] - center));
+    return AddObject(TRIANGLE, static_cast<int>(mTriangles.size()) - 1,
+        center, radius, velocity);
+}
+
+template <typename Real>
+void ContinuousCollision<Real>::Clear()
+{
+    mType.clear();
+    mIndex.clear();
+    mSpheres.clear();
+    mBoxes.clear();
+    mTriangles.clear();
+    for (int d = 0; d < 3; ++d)
+    {
+        mCenter[d].clear();
+        mVelocity[d].clear();
+    }
+    mRadius.clear();
+    mContacts.clear();
+    mNumUnsupported = 0;
+}
+
+template <typename Real>
+void ContinuousCollision<Real>::SetSphere(int i, Sphere3<Real> const& sphere,
+    Vector3<Real> const& velocity)
+{
+    mSpheres[mIndex[i]] = sphere;
+    SetObject(i, sphere.center, sphere.radius, velocity);
+}
+
+template <typename Real>
+void ContinuousCollision<Real>::SetBox(int i, OrientedBox3<Real> const& box,
+    Vector3<Real> const& velocity)
+{
+    mBoxes[mIndex[i]] = box;
+    SetObject(i, box.center, Length(box.extent), velocity);
+}
+
+template <typename Real>
+void ContinuousCollision<Real>::SetTriangle(int i,
+    Triangle3<Real> const& triangle, Vector3<Real> const& velocity)
+{
+    mTriangles[mIndex[i]] = triangle;
+    Vector3<Real> center = (triangle.v[0] + triangle.v[1] + triangle.v[2])
+        / (Real)3;
+    Real radius = std::max(std::max(Length(triangle.v[0] - center),
+        Length(triangle.v[1] - center)), Length(triangle.v[2] - center));
+    SetObject(i, center, radius, velocity);
+}
+
+template <typename Real> inline
+int ContinuousCollision<Real>::GetNumObjects() const
+{
+    return static_cast<int>(mType.size());
+}
+
+template <typename Real> inline
+typename ContinuousCollision<Real>::ObjectType
+ContinuousCollision<Real>::GetType(int i) const
+{
+    return mType[i];
+}
+
+template <typename Real> inline
+Vector3<Real> ContinuousCollision<Real>::GetVelocity(int i) const
+{
+    return Vector3<Real>{ mVelocity[0][i], mVelocity[1][i],
+        mVelocity[2][i] };
+}
+
+template <typename Real>
+AlignedBox3<Real> ContinuousCollision<Real>::GetSweptBox(int i,
+    Real tMax) const
+{
+    AlignedBox3<Real> box;
+    for (int d = 0; d < 3; ++d)
+    {
+        Real c0 = mCenter[d][i];
+        Real c1 = c0 + tMax * mVelocity[d][i];
+        box.min[d] = std::min(c0, c1) - mRadius[i];
+        box.max[d] = std::max(c0, c1) + mRadius[i];
+    }
+    return box;
+}
+
+template <typename Real>
+void ContinuousCollision<Real>::Update(
+    std::vector<EdgeKey<false>> const& pairs, Real tMax)
+{
+    for (auto& ws : mWorkspace)
+    {
+        ws.contacts.clear();
+        ws.numUnsupported = 0;
+    }
+
+    int const numPairs = static_cast<int>(pairs.size());
+    EdgeKey<false> const* pairData = pairs.data();
+    ParallelFor(mNumThreads, numPairs,
+        [this, pairData, tMax](unsigned int t, int imin, int imax)
+    {
+        for (int bmin = imin; bmin < imax; bmin += BLOCK_SIZE)
+        {
+            int numLanes = std::min(static_cast<int>(BLOCK_SIZE),
+                imax - bmin);
+            UpdateBlock(pairData + bmin, numLanes, tMax, mWorkspace[t]);
+        }
+    });
+
+    size_t numContacts = 0;
+    mNumUnsupported = 0;
+    for (auto const& ws : mWorkspace)
+    {
+        numContacts += ws.contacts.size();
+        mNumUnsupported += ws.numUnsupported;
+    }
+    mContacts.resize(numContacts);
+    auto current = mContacts.begin();
+    for (auto const& ws : mWorkspace)
+    {
+        current = std::copy(ws.contacts.begin(), ws.contacts.end(), current);
+    }
+    std::sort(mContacts.begin(), mContacts.end(),
+        [](Contact const& contact0, Contact const& contact1)
+        {
+            if (contact0.time != contact1.time)
+            {
+                return contact0.time < contact1.time;
+            }
+            if (contact0.object0 != contact1.object0)
+            {
+                return contact0.object0 < contact1.object0;
+            }
+            return contact0.object1 < contact1.object1;
+        });
+}
+
+template <typename Real> inline
+std::vector<typename ContinuousCollision<Real>::Contact> const&
+ContinuousCollision<Real>::GetContacts() const
+{
+    return mContacts;
+}
+
+template <typename Real> inline
+size_t ContinuousCollision<Real>::GetNumUnsupported() const
+{
+    return mNumUnsupported;
+}
+
+template <typename Real>
+int ContinuousCollision<Real>::AddObject(ObjectType type, int index,
+    Vector3<Real> const& center, Real radius, Vector3<Real> const& velocity)
+{
+    mType.push_back(type);
+    mIndex.push_back(index);
+    for (int d = 0; d < 3; ++d)
+    {
+        mCenter[d].push_back(center[d]);
+        mVelocity[d].push_back(velocity[d]);
+    }
+    mRadius.push_back(radius);
+    return static_cast<int>(mType.size()) - 1;
+}
+
+template <typename Real>
+void ContinuousCollision<Real>::SetObject(int i, Vector3<Real> const& center,
+    Real radius, Vector3<Real> const& velocity)
+{
+    for (int d = 0; d < 3; ++d)
+    {
+        mCenter[d][i] = center[d];
+        mVelocity[d][i] = velocity[d];
+    }
+    mRadius[i] = radius;
+}
+
+template <typename Real>
+void ContinuousCollision<Real>::UpdateBlock(EdgeKey<false> const* pairs,
+    int numLanes, Real tMax, Workspace& ws) const
+{
+    // Gather the relative positions and velocities of the bounding spheres.
+    int* object0 = ws.object0.data();
+    int* object1 = ws.object1.data();
+    for (int j = 0; j < numLanes; ++j)
+    {
+        object0[j] = pairs[j].V[0];
+        object1[j] = pairs[j].V[1];
+    }
+    for (int d = 0; d < 3; ++d)
+    {
+        Real const* center = mCenter[d].data();
+        Real const* velocity = mVelocity[d].data();
+        Real* blockCenter = ws.center[d].data();
+        Real* blockVelocity = ws.velocity[d].data();
+        for (int j = 0; j < numLanes; ++j)
+        {
+            blockCenter[j] = center[object1[j]] - center[object0[j]];
+            blockVelocity[j] = velocity[object1[j]] - velocity[object0[j]];
+        }
+    }
+    Real* radius = ws.radius.data();
+    for (int j = 0; j < numLanes; ++j)
+    {
+        radius[j] = mRadius[object0[j]] + mRadius[object1[j]];
+    }
+
+    // The squared distance between the centers at time t is the quadratic
+    // |D + t*V|^2 = Dot(D,D) + 2*t*Dot(D,V) + t^2*Dot(V,V), whose minimum on
+    // [0,tMax] is at t = -Dot(D,V)/Dot(V,V) clamped to [0,tMax].  To avoid
+    // the division, the test is multiplied by Dot(V,V) and is in terms of
+    // s = t*Dot(V,V).  The pairs with Dot(V,V) = 0 are candidates when their
+    // bounding spheres overlap at time 0.
+    Real const* Dx = ws.center[0].data();
+    Real const* Dy = ws.center[1].data();
+    Real const* Dz = ws.center[2].data();
+    Real const* Vx = ws.velocity[0].data();
+    Real const* Vy = ws.velocity[1].data();
+    Real const* Vz = ws.velocity[2].data();
+    char* candidate = ws.candidate.data();
+    for (int j = 0; j < numLanes; ++j)
+    {
+        Real dotVV = Vx[j] * Vx[j] + Vy[j] * Vy[j] + Vz[j] * Vz[j];
+        Real dotDV = Dx[j] * Vx[j] + Dy[j] * Vy[j] + Dz[j] * Vz[j];
+        Real dotDD = Dx[j] * Dx[j] + Dy[j] * Dy[j] + Dz[j] * Dz[j];
+        Real sqrRadius = radius[j] * radius[j];
+        Real s = std::min(std::max(-dotDV, (Real)0), tMax * dotVV);
+        Real sqrDistanceTimesVV = dotVV * dotDD + s * ((Real)2 * dotDV + s);
+        candidate[j] = static_cast<char>(
+            ((dotVV > (Real)0) & (sqrDistanceTimesVV <= sqrRadius * dotVV)) |
+            (dotDD <= sqrRadius));
+    }
+
+    // Run the exact queries for the candidates.
+    Contact contact;
+    for (int j = 0; j < numLanes; ++j)
+    {
+        if (candidate[j])
+        {
+            int i0 = object0[j], i1 = object1[j];
+            if (mType[i0] != SPHERE && mType[i1] != SPHERE)
+            {
+                ++ws.numUnsupported;
+            }
+            else if (Find(i0, i1, tMax, contact))
+            {
+                ws.contacts.push_back(contact);
+            }
+        }
+    }
+}
+
+template <typename Real>
+bool ContinuousCollision<Real>::Find(int i0, int i1, Real tMax,
+    Contact& contact) const
+{
+    // The queries are ordered by object type, so swap the objects if
+    // necessary.  The contact is reported for the pair as given.
+    int j0 = i0, j1 = i1;
+    if (mType[j0] > mType[j1])
+    {
+        std::swap(j0, j1);
+    }
+    contact.object0 = i0;
+    contact.object1 = i1;
+
+    ObjectType type0 = mType[j0], type1 = mType[j1];
+    Vector3<Real> velocity0 = GetVelocity(j0), velocity1 = GetVelocity(j1);
+    if (type0 == SPHERE && type1 == SPHERE)
+    {
+        return FindSphereSphere(j0, j1, tMax, contact);
+    }
+    else if (type0 == SPHERE && type1 == BOX)
+    {
+        FIQuery<Real, OrientedBox3<Real>, Sphere3<Real>> query;
+        auto result = query(mBoxes[mIndex[j1]], velocity1,
+            mSpheres[mIndex[j0]], velocity0);
+        contact.time = result.contactTime;
+        contact.intersectionType = result.intersectionType;
+        contact.point = result.contactPoint;
+    }
+    else if (type0 == SPHERE && type1 == TRIANGLE)
+    {
+        FIQuery<Real, Sphere3<Real>, Triangle3<Real>> query;
+        auto result = query(mSpheres[mIndex[j0]], velocity0,
+            mTriangles[mIndex[j1]], velocity1);
+        contact.time = result.contactTime;
+        contact.intersectionType = result.intersectionType;
+        contact.point = result.contactPoint;
+    }
+    else
+    {
+        return false;
+    }
+
+    // The sphere-triangle query can report intersectionType +1 with a
+    // negative time for objects that are moving apart, so the time is
+    // tested against both ends of the interval.
+    return contact.intersectionType != 0
+        && contact.time >= (Real)0 && contact.time <= tMax;
+}
+
+template <typename Real>
+bool ContinuousCollision<Real>::FindSphereSphere(int i0, int i1, Real tMax,
+    Contact& contact) const
+{
+    Sphere3<Real> const& sphere0 = mSpheres[mIndex[i0]];
+    Sphere3<Real> const& sphere1 = mSpheres[mIndex[i1]];
+    Vector3<Real> D = sphere1.center - sphere0.center;
+    Vector3<Real> V = GetVelocity(i1) - GetVelocity(i0);
+    Real radiusSum = sphere0.radius + sphere1.radius;
+    Real dotDD = Dot(D, D), sqrRadiusSum = radiusSum * radiusSum;
+    Real t;
+    if (dotDD <= sqrRadiusSum)
+    {
+        // The spheres are overlapping or touching at time 0.
+        contact.intersectionType = -1;
+        t = (Real)0;
+    }
+    else
+    {
+        // Solve |D + t*V|^2 = r^2 for the smallest root, which exists when
+        // the spheres approach each other and the discriminant is
+        // nonnegative.
+        Real dotDV = Dot(D, V);
+        if (dotDV >= (Real)0)
+        {
+            return false;
+        }
+        Real dotVV = Dot(V, V);
+        Real discr = dotDV * dotDV - dotVV * (dotDD - sqrRadiusSum);
+        if (discr < (Real)0)
+        {
+            return false;
+        }
+
+        // The root -(dotDV + sqrt(discr))/dotVV, rewritten to avoid the
+        // cancellation when dotDV*dotDV is much larger than discr.
+        t = (dotDD - sqrRadiusSum) / (std::sqrt(discr) - dotDV);
+        if (t > tMax)
+        {
+            return false;
+        }
+        contact.intersectionType = +1;
+    }
+
+    // The point on the segment of centers at the time of contact that
+    // divides it in the ratio of the radii.
+    Vector3<Real> center0 = sphere0.center + t * GetVelocity(i0);
+    contact.time = t;
+    contact.point = center0 + (sphere0.radius / radiusSum) * (D + t * V);
+    return true;
+}
+
+
+}
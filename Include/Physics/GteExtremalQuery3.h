@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/16)
 
 #pragma once
 
@@ -32,6 +32,14 @@ public:
     virtual void GetExtremeVertices(Vector3<Real> const& direction,
         int& positiveDirection, int& negativeDirection) = 0;
 
+    // Compute the extreme vertices for each of the numDirections directions,
+    // storing them in positiveDirection[i] and negativeDirection[i].  The
+    // default calls the single-direction query for each direction; derived
+    // classes override this to avoid the virtual call per direction.
+    virtual void GetExtremeVertices(int numDirections,
+        Vector3<Real> const* directions, int* positiveDirection,
+        int* negativeDirection);
+
 protected:
     // The caller must ensure that the input polyhedron is convex.
     ExtremalQuery3(Polyhedron3<Real> const& polytope);
@@ -58,13 +66,25 @@ std::vector<Vector3<Real>> const& ExtremalQuery3<Real>::GetFaceNormals() const
     return mFaceNormals;
 }
 
+template <typename Real>
+void ExtremalQuery3<Real>::GetExtremeVertices(int numDirections,
+    Vector3<Real> const* directions, int* positiveDirection,
+    int* negativeDirection)
+{
+    for (int i = 0; i < numDirections; ++i)
+    {
+        GetExtremeVertices(directions[i], positiveDirection[i],
+            negativeDirection[i]);
+    }
+}
+
 template <typename Real>
 ExtremalQuery3<Real>::ExtremalQuery3(Polyhedron3<Real> const& polytope)
     :
     mPolytope(polytope)
 {
     // Create the face normals.
-    auto vertexPool = mPolytope.GetVertices();
+    auto const& vertexPool = mPolytope.GetVertices();
     auto const& indices = mPolytope.GetIndices();
     int const numTriangles = static_cast<int>(indices.size()) / 3;
     mFaceNormals.resize(numTriangles);
@@ -0,0 +1,216 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Physics/GteExtremalQuery3.h>
+#include <algorithm>
+#include <atomic>
+
+// Extremal queries by hill climbing on the vertex adjacency graph of the
+// convex polyhedron.  Starting at a vertex, the search moves to the
+// adjacent vertex with the largest projection onto the direction until no
+// adjacent vertex has a larger projection; on a convex polyhedron that
+// vertex is extreme.  The cost of a query is the number of vertices visited
+// times their degree, so a query is fast when it starts near the answer.
+// The queries without start vertices are warm started at the extreme
+// vertices of the previous query, which is effective when the directions
+// change little from one query to the next, as in the iterations of GJK or
+// from one frame to the next.  Because of the warm start, a query object
+// must not be shared by threads; the queries with explicit start vertices
+// modify only the atomic visit counter, so they may be called concurrently.
+
+namespace gte
+{
+
+template <typename Real>
+class ExtremalQuery3ADJ : public ExtremalQuery3<Real>
+{
+public:
+    // Construction.
+    ExtremalQuery3ADJ(Polyhedron3<Real> const& polytope);
+
+    // Disallow copying and assignment.
+    ExtremalQuery3ADJ(ExtremalQuery3ADJ const&) = delete;
+    ExtremalQuery3ADJ& operator=(ExtremalQuery3ADJ const&) = delete;
+
+    // Compute the extreme vertices in the specified direction and return the
+    // indices of the vertices in the polyhedron vertex array.  The searches
+    // start at the extreme vertices of the previous query.
+    virtual void GetExtremeVertices(Vector3<Real> const& direction,
+        int& positiveDirection, int& negativeDirection) override;
+
+    // Compute the extreme vertices for each of the numDirections directions.
+    // The search for a direction starts at the extreme vertices of the
+    // previous direction, so consecutive directions should be close.
+    virtual void GetExtremeVertices(int numDirections,
+        Vector3<Real> const* directions, int* positiveDirection,
+        int* negativeDirection) override;
+
+    // Compute the extreme vertices with searches that start at the specified
+    // vertices, for callers that keep a warm start per query, for example
+    // per pair of objects.
+    void GetExtremeVertices(Vector3<Real> const& direction,
+        int positiveStart, int negativeStart, int& positiveDirection,
+        int& negativeDirection) const;
+
+    // The number of vertices visited by all the searches since
+    // construction, including the start vertices and the searches with
+    // explicit start vertices.
+    inline size_t GetNumVisited() const;
+
+private:
+    // Hill climbing from vertex 'start' to the vertex with the largest
+    // projection sign*Dot(direction,vertex).
+    int Climb(Vector3<Real> const& direction, Real sign, int start,
+        size_t& numVisited) const;
+
+    // The vertices of the polyhedron and the compact vertex adjacency:  the
+    // vertices adjacent to vertex v are mAdjacent[mAdjacentOffset[v]]
+    // through mAdjacent[mAdjacentOffset[v+1] - 1].
+    std::vector<Vector3<Real>> mVertices;
+    std::vector<int> mAdjacentOffset, mAdjacent;
+
+    int mPositiveStart, mNegativeStart;
+    mutable std::atomic<size_t> mNumVisited;
+};
+
+
+template <typename Real>
+ExtremalQuery3ADJ<Real>::ExtremalQuery3ADJ(Polyhedron3<Real> const& polytope)
+    :
+    ExtremalQuery3<Real>(polytope),
+    mVertices(polytope.GetVertices()),
+    mNumVisited(0)
+{
+    // Each edge of a triangle is stored in both directions; the edges
+    // shared by two triangles are stored twice and are made unique below.
+    auto const& indices = this->mPolytope.GetIndices();
+    int const numVertices = static_cast<int>(mVertices.size());
+    int const numTriangles = static_cast<int>(indices.size()) / 3;
+    std::vector<std::pair<int, int>> edges;
+    edges.reserve(6 * numTriangles);
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        for (int i0 = 2, i1 = 0; i1 < 3; i0 = i1++)
+        {
+            int v0 = indices[3 * t + i0], v1 = indices[3 * t + i1];
+            edges.push_back(std::make_pair(v0, v1));
+            edges.push_back(std::make_pair(v1, v0));
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    mAdjacentOffset.resize(numVertices + 1);
+    std::fill(mAdjacentOffset.begin(), mAdjacentOffset.end(), 0);
+    mAdjacent.resize(edges.size());
+    for (size_t e = 0; e < edges.size(); ++e)
+    {
+        ++mAdjacentOffset[edges[e].first + 1];
+        mAdjacent[e] = edges[e].second;
+    }
+    for (int v = 0; v < numVertices; ++v)
+    {
+        mAdjacentOffset[v + 1] += mAdjacentOffset[v];
+    }
+
+    // Start the first query at a vertex of the polyhedron.
+    mPositiveStart = (numTriangles > 0 ? indices[0] : 0);
+    mNegativeStart = mPositiveStart;
+}
+
+template <typename Real>
+void ExtremalQuery3ADJ<Real>::GetExtremeVertices(
+    Vector3<Real> const& direction, int& positiveDirection,
+    int& negativeDirection)
+{
+    size_t numVisited = 0;
+    positiveDirection = Climb(direction, (Real)1, mPositiveStart,
+        numVisited);
+    negativeDirection = Climb(direction, (Real)-1, mNegativeStart,
+        numVisited);
+    mPositiveStart = positiveDirection;
+    mNegativeStart = negativeDirection;
+    mNumVisited.fetch_add(numVisited, std::memory_order_relaxed);
+}
+
+template <typename Real>
+void ExtremalQuery3ADJ<Real>::GetExtremeVertices(int numDirections,
+    Vector3<Real> const* directions, int* positiveDirection,
+    int* negativeDirection)
+{
+    int positiveStart = mPositiveStart, negativeStart = mNegativeStart;
+    size_t numVisited = 0;
+    for (int i = 0; i < numDirections; ++i)
+    {
+        positiveStart = Climb(directions[i], (Real)1, positiveStart,
+            numVisited);
+        negativeStart = Climb(directions[i], (Real)-1, negativeStart,
+            numVisited);
+        positiveDirection[i] = positiveStart;
+        negativeDirection[i] = negativeStart;
+    }
+    mPositiveStart = positiveStart;
+    mNegativeStart = negativeStart;
+    mNumVisited.fetch_add(numVisited, std::memory_order_relaxed);
+}
+
+template <typename Real>
+void ExtremalQuery3ADJ<Real>::GetExtremeVertices(
+    Vector3<Real> const& direction, int positiveStart, int negativeStart,
+    int& positiveDirection, int& negativeDirection) const
+{
+    size_t numVisited = 0;
+    positiveDirection = Climb(direction, (Real)1, positiveStart, numVisited);
+    negativeDirection = Climb(direction, (Real)-1, negativeStart,
+        numVisited);
+    mNumVisited.fetch_add(numVisited, std::memory_order_relaxed);
+}
+
+template <typename Real> inline
+size_t ExtremalQuery3ADJ<Real>::GetNumVisited() const
+{
+    return mNumVisited.load(std::memory_order_relaxed);
+}
+
+template <typename Real>
+int ExtremalQuery3ADJ<Real>::Climb(Vector3<Real> const& direction,
+    Real sign, int start, size_t& numVisited) const
+{
+    Vector3<Real> D = sign * direction;
+    int current = start;
+    Real currentDot = Dot(D, mVertices[current]);
+    ++numVisited;
+    for (;;)
+    {
+        // Move to the adjacent vertex with the largest projection.  The
+        // projections increase strictly, so the search terminates.
+        int next = current;
+        Real nextDot = currentDot;
+        int const jmax = mAdjacentOffset[current + 1];
+        for (int j = mAdjacentOffset[current]; j < jmax; ++j)
+        {
+            int adjacent = mAdjacent[j];
+            Real dot = Dot(D, mVertices[adjacent]);
+            if (dot > nextDot)
+            {
+                next = adjacent;
+                nextDot = dot;
+            }
+        }
+        if (next == current)
+        {
+            return current;
+        }
+        current = next;
+        currentDot = nextDot;
+        ++numVisited;
+    }
+}
+
+}
@@ -3,18 +3,40 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.1 (2018/10/05)
+// File Version: 3.0.2 (2019/09/16)
 
 #pragma once
 
 #include <Physics/GteExtremalQuery3.h>
 #include <Mathematics/GteMath.h>
 #include <Mathematics/GteVETManifoldMesh.h>
-#include <LowLevel/GteLogger.h>
-#include <LowLevel/GteRangeIteration.h>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include <stack>
-#include <queue>
+
+// Extremal queries by a BSP tree of the Gauss map of the convex polyhedron.
+// The Gauss map partitions the unit sphere into convex spherical polygons,
+// one per vertex: the polygon of vertex V is the set of directions for which
+// V is extreme, and its corners are the normals of the triangles sharing V.
+// The tree is built by splitting the polygons recursively by great circles
+// that contain polygon edges.  A node stores the normal N of its circle; the
+// directions D with Dot(N,D) >= 0 are on its positive side.  The recursion
+// stops when the pieces of polygons in a cell all belong to one vertex, so
+// each leaf is labeled by the vertex that is extreme for the directions in
+// its cell.  A query walks from the root to a leaf with one dot product per
+// level.
+//
+// The circle of a node is chosen from the edges of a sample of the pieces
+// in its cell, preferring circles that split few pieces and balance the two
+// sides.  A piece corner within a small tolerance of the circle is treated
+// as on the circle, which avoids most of the sliver pieces that rounding
+// errors would otherwise create.  A cell whose pieces cannot be separated,
+// because a remaining sliver overlaps its neighbor, is a leaf for its piece
+// of largest area.  The vertex returned for a direction within a few
+// tolerances of the boundary of its polygon can therefore have a projection
+// that is smaller than the maximum by a correspondingly small amount.  The
+// tolerance is an angle of 100 ulps of Real.
 
 namespace gte
 {
@@ -35,43 +57,29 @@ public:
     virtual void GetExtremeVertices(Vector3<Real> const& direction,
         int& positiveDirection, int& negativeDirection) override;
 
+    // Compute the extreme vertices for each of the numDirections directions.
+    virtual void GetExtremeVertices(int numDirections,
+        Vector3<Real> const* directions, int* positiveDirection,
+        int* negativeDirection) override;
+
     // Tree statistics.
     inline int GetNumNodes() const;
     inline int GetTreeDepth() const;
 
 private:
-    class SphericalArc
+    // A piece of the Gauss-map polygon of a vertex.  The corners are unit
+    // vectors ordered around the boundary.
+    struct Piece
     {
-    public:
-        // Construction.
-        SphericalArc();
-
-        // The arcs are stored in a multiset ordered by increasing separation.
-        // The multiset will be traversed in reverse order.  This heuristic is
-        // designed to create BSP trees whose top-most nodes can eliminate as
-        // many arcs as possible during an extremal query.
-        bool operator<(SphericalArc const& arc) const;
-
-        // Indices N[] into the face normal array for the endpoints of the arc.
-        int nIndex[2];
-
-        // The number of arcs in the path from normal N[0] to normal N[1].
-        // For spherical polygon edges, the number is 1.  The number is 2 or
-        // larger for bisector arcs of the spherical polygon.
-        int separation;
-
-        // The normal is Cross(FaceNormal[N[0]],FaceNormal[N[1]]).
-        Vector3<Real> normal;
-
-        // Indices into the vertex array for the extremal points for the
-        // two regions sharing the arc.  As the arc is traversed from normal
-        // N[0] to normal N[1], PosVertex is the index for the extreme vertex
-        // to the left of the arc and NegVertex is the index for the extreme
-        // vertex to the right of the arc.
-        int posVertex, negVertex;
+        int vertex;
+        std::vector<Vector3<Real>> corners;
+    };
 
-        // Support for BSP trees stored as contiguous nodes in an array.
-        int posChild, negChild;
+    // The pieces of a cell and the index of the node that splits it.
+    struct Cell
+    {
+        int node, depth;
+        std::vector<Piece> pieces;
     };
 
     typedef VETManifoldMesh::Triangle Triangle;
@@ -80,23 +88,61 @@ private:
         std::set<std::shared_ptr<Triangle>> const& tAdj,
         std::vector<std::shared_ptr<Triangle>>& tAdjSorted);
 
-    void CreateSphericalArcs(VETManifoldMesh& mesh, std::multiset<SphericalArc>& arcs);
-    void CreateSphericalBisectors(VETManifoldMesh& mesh, std::multiset<SphericalArc>& arcs);
-    void CreateBSPTree(std::multiset<SphericalArc>& arcs);
-    void InsertArc(SphericalArc const& arcs);
+    void CreatePolygons(VETManifoldMesh& mesh, std::vector<Piece>& pieces);
+    void CreateBSPTree(std::vector<Piece>& pieces);
+
+    // The pieces all belong to the same vertex.
+    static bool IsLeaf(std::vector<Piece> const& pieces);
+
+    // The area of the planar polygon with the corners of the piece, which
+    // is used only to compare pieces.
+    static Real GetArea(Piece const& piece);
+
+    // Select the great circle that splits the pieces of a cell.  The return
+    // value is 'false' when no edge of a piece separates the pieces.
+    bool SelectSplitter(std::vector<Piece> const& pieces,
+        Vector3<Real>& normal) const;
 
-    // Lookup table for indexing into mFaceNormals.
+    // Classify the corners of the piece: -1 when the piece is on the
+    // negative side of the circle, +1 when it is on the positive side and
+    // 0 when the circle splits the piece.
+    int Classify(Piece const& piece, Vector3<Real> const& normal) const;
+
+    // Split the pieces by the circle, appending the results to 'positive'
+    // and 'negative'.
+    void Split(std::vector<Piece> const& pieces, Vector3<Real> const& normal,
+        std::vector<Piece>& positive, std::vector<Piece>& negative) const;
+
+    // The search of the BSP tree for the extreme vertices of a direction.
+    inline void Search(Vector3<Real> const& direction,
+        int& positiveDirection, int& negativeDirection) const;
+
+    // Lookup table for indexing into mFaceNormals, used only during
+    // construction.
     std::map<std::shared_ptr<Triangle>, int> mTriToNormal;
 
-    // Fixed-size storage for the BSP nodes.
-    std::vector<SphericalArc> mNodes;
+    // The BSP tree nodes stored contiguously, with only the members needed
+    // by the queries, so the nodes visited by a query share fewer cache
+    // lines.  Index 0 is the root.  A child index of -1 denotes a leaf,
+    // in which case the vertex for that side is the extreme vertex.
+    struct Node
+    {
+        Vector3<Real> normal;
+        int posChild, negChild;
+        int posVertex, negVertex;
+    };
+
+    Real mTolerance;
+    std::vector<Node> mNodes;
     int mTreeDepth;
 };
 
 template <typename Real>
 ExtremalQuery3BSP<Real>::ExtremalQuery3BSP(Polyhedron3<Real> const& polytope)
     :
-    ExtremalQuery3<Real>(polytope)
+    ExtremalQuery3<Real>(polytope),
+    mTolerance(static_cast<Real>(100) * std::numeric_limits<Real>::epsilon()),
+    mTreeDepth(0)
 {
     // Create the adjacency information for the polytope.
     VETManifoldMesh mesh;
@@ -113,71 +159,28 @@ ExtremalQuery3BSP<Real>::ExtremalQuery3BSP(Polyhedron3<Real> const& polytope)
         mTriToNormal.insert(std::make_pair(triangle, t));
     }
 
-    // Create the set of unique arcs which are used to create the BSP tree.
-    std::multiset<SphericalArc> arcs;
-    CreateSphericalArcs(mesh, arcs);
-
-    // Create the BSP tree to be used in the extremal query.
-    CreateBSPTree(arcs);
+    // Create the Gauss-map polygons, which are used to create the BSP tree.
+    std::vector<Piece> pieces;
+    CreatePolygons(mesh, pieces);
+    mTriToNormal.clear();
+    CreateBSPTree(pieces);
 }
 
 template <typename Real>
 void ExtremalQuery3BSP<Real>::GetExtremeVertices(Vector3<Real> const& direction,
     int& positiveDirection, int& negativeDirection)
 {
-    // Do a nonrecursive depth-first search of the BSP tree to determine
-    // spherical polygon contains the incoming direction D.  Index 0 is the
-    // root of the BSP tree.
-    int current = 0;
-    while (current >= 0)
-    {
-        SphericalArc& node = mNodes[current];
-        int sign = gte::isign(Dot(direction, node.normal));
-        if (sign >= 0)
-        {
-            current = node.posChild;
-            if (current == -1)
-            {
-                // At a leaf node.
-                positiveDirection = node.posVertex;
-            }
-        }
-        else
-        {
-            current = node.negChild;
-            if (current == -1)
-            {
-                // At a leaf node.
-                positiveDirection = node.negVertex;
-            }
-        }
-    }
+    Search(direction, positiveDirection, negativeDirection);
+}
 
-    // Do a nonrecursive depth-first search of the BSP tree to determine
-    // spherical polygon contains the reverse incoming direction -D.
-    current = 0;  // the root of the BSP tree
-    while (current >= 0)
+template <typename Real>
+void ExtremalQuery3BSP<Real>::GetExtremeVertices(int numDirections,
+    Vector3<Real> const* directions, int* positiveDirection,
+    int* negativeDirection)
+{
+    for (int i = 0; i < numDirections; ++i)
     {
-        SphericalArc& node = mNodes[current];
-        int sign = gte::isign(Dot(direction, node.normal));
-        if (sign <= 0)
-        {
-            current = node.posChild;
-            if (current == -1)
-            {
-                // At a leaf node.
-                negativeDirection = node.posVertex;
-            }
-        }
-        else
-        {
-            current = node.negChild;
-            if (current == -1)
-            {
-                // At a leaf node.
-                negativeDirection = node.negVertex;
-            }
-        }
+        Search(directions[i], positiveDirection[i], negativeDirection[i]);
     }
 }
 
@@ -203,8 +206,18 @@ void ExtremalQuery3BSP<Real>::SortAdjacentTriangles(int vIndex,
     tAdjSorted.resize(tAdj.size());
 
     // Traverse the triangles adjacent to vertex V using edge-triangle adjacency
-    // information to produce a sorted array of adjacent triangles.
+    // information to produce a sorted array of adjacent triangles.  The
+    // traversal starts at the triangle of smallest index rather than at the
+    // first element of the set, which is ordered by pointer value, so that
+    // the tree does not depend on the memory addresses of the triangles.
     auto tri = *tAdj.begin();
+    for (auto const& candidate : tAdj)
+    {
+        if (mTriToNormal[candidate] < mTriToNormal[tri])
+        {
+            tri = candidate;
+        }
+    }
     for (int i = 0; i < numTriangles; ++i)
     {
         for (int prev = 2, curr = 0; curr < 3; prev = curr++)
@@ -220,226 +233,368 @@ void ExtremalQuery3BSP<Real>::SortAdjacentTriangles(int vIndex,
 }
 
 template <typename Real>
-void ExtremalQuery3BSP<Real>::CreateSphericalArcs(VETManifoldMesh& mesh,
-    std::multiset<SphericalArc>& arcs)
+void ExtremalQuery3BSP<Real>::CreatePolygons(VETManifoldMesh& mesh,
+    std::vector<Piece>& pieces)
 {
-    int const prev[3] = { 2, 0, 1 };
-    int const next[3] = { 1, 2, 0 };
+    pieces.reserve(mesh.GetVertices().size());
+    std::vector<std::shared_ptr<Triangle>> tAdjSorted;
+    for (auto const& element : mesh.GetVertices())
+    {
+        // The normals of the adjacent triangles, sorted around the vertex,
+        // are the corners of its spherical polygon.
+        auto vertex = element.second;
+        SortAdjacentTriangles(vertex->V, vertex->TAdjacent, tAdjSorted);
+        Piece piece;
+        piece.vertex = vertex->V;
+        piece.corners.reserve(tAdjSorted.size());
+        for (auto const& tri : tAdjSorted)
+        {
+            piece.corners.push_back(this->mFaceNormals[mTriToNormal[tri]]);
+        }
+        pieces.push_back(std::move(piece));
+    }
+}
+
+template <typename Real>
+void ExtremalQuery3BSP<Real>::CreateBSPTree(std::vector<Piece>& pieces)
+{
+    mNodes.clear();
+    mTreeDepth = 1;
+    if (pieces.size() == 0)
+    {
+        return;
+    }
 
-    for (auto const& element : mesh.GetEdges())
+    if (IsLeaf(pieces))
     {
-        auto edge = element.second;
+        // This happens only for a degenerate polyhedron.  Any plane through
+        // the origin works.
+        Node node;
+        node.normal = { (Real)0, (Real)0, (Real)1 };
+        node.posChild = -1;
+        node.negChild = -1;
+        node.posVertex = pieces[0].vertex;
+        node.negVertex = pieces[0].vertex;
+        mNodes.push_back(node);
+        return;
+    }
 
-        SphericalArc arc;
-        arc.nIndex[0] = mTriToNormal[edge->T[0].lock()];
-        arc.nIndex[1] = mTriToNormal[edge->T[1].lock()];
-        arc.separation = 1;
-        arc.normal = Cross(this->mFaceNormals[arc.nIndex[0]], this->mFaceNormals[arc.nIndex[1]]);
+    // Split the cells in depth-first order.
+    std::stack<Cell> cells;
+    Cell root;
+    root.node = 0;
+    root.depth = 1;
+    root.pieces = std::move(pieces);
+    mNodes.resize(1);
+    cells.push(std::move(root));
+    std::vector<Piece> positive, negative;
+    while (!cells.empty())
+    {
+        Cell cell = std::move(cells.top());
+        cells.pop();
 
-        auto adj = edge->T[0].lock();
-        int j;
-        for (j = 0; j < 3; ++j)
+        Vector3<Real> normal;
+        if (!SelectSplitter(cell.pieces, normal))
         {
-            if (adj->V[j] != edge->V[0] && adj->V[j] != edge->V[1])
+            // The pieces cannot be separated, which happens when slivers
+            // created by rounding errors overlap a neighboring piece.  The
+            // cell is a leaf for the piece of largest area.
+            normal = { (Real)0, (Real)0, (Real)1 };
+            size_t largest = 0;
+            Real maxArea = (Real)-1;
+            for (size_t i = 0; i < cell.pieces.size(); ++i)
             {
-                arc.posVertex = adj->V[prev[j]];
-                arc.negVertex = adj->V[next[j]];
-                break;
+                Real area = GetArea(cell.pieces[i]);
+                if (area > maxArea)
+                {
+                    maxArea = area;
+                    largest = i;
+                }
             }
+            positive.assign(1, cell.pieces[largest]);
+            negative.assign(1, cell.pieces[largest]);
+        }
+        else
+        {
+            positive.clear();
+            negative.clear();
+            Split(cell.pieces, normal, positive, negative);
+        }
+        cell.pieces.clear();
+
+        // The two children are leaves or cells that are split later.
+        Node& node = mNodes[cell.node];
+        node.normal = normal;
+        node.posChild = -1;
+        node.negChild = -1;
+        node.posVertex = positive[0].vertex;
+        node.negVertex = negative[0].vertex;
+        mTreeDepth = std::max(mTreeDepth, cell.depth + 1);
+
+        if (!IsLeaf(negative))
+        {
+            Cell child;
+            child.node = static_cast<int>(mNodes.size());
+            child.depth = cell.depth + 1;
+            child.pieces = std::move(negative);
+            mNodes[cell.node].negChild = child.node;
+            mNodes.push_back(Node());
+            cells.push(std::move(child));
+        }
+
+        if (!IsLeaf(positive))
+        {
+            Cell child;
+            child.node = static_cast<int>(mNodes.size());
+            child.depth = cell.depth + 1;
+            child.pieces = std::move(positive);
+            mNodes[cell.node].posChild = child.node;
+            mNodes.push_back(Node());
+            cells.push(std::move(child));
         }
-        LogAssert(j < 3, "Unexpected condition.");
 
-        arcs.insert(arc);
+        positive.clear();
+        negative.clear();
     }
+}
 
-    CreateSphericalBisectors(mesh, arcs);
+template <typename Real>
+bool ExtremalQuery3BSP<Real>::IsLeaf(std::vector<Piece> const& pieces)
+{
+    for (auto const& piece : pieces)
+    {
+        if (piece.vertex != pieces[0].vertex)
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
 template <typename Real>
-void ExtremalQuery3BSP<Real>::CreateSphericalBisectors(VETManifoldMesh& mesh,
-    std::multiset<SphericalArc>& arcs)
+Real ExtremalQuery3BSP<Real>::GetArea(Piece const& piece)
 {
-    std::queue<std::pair<int,int>> queue;
-    for (auto const& element : mesh.GetVertices())
+    Vector3<Real> sum{ (Real)0, (Real)0, (Real)0 };
+    int const numCorners = static_cast<int>(piece.corners.size());
+    for (int j0 = numCorners - 1, j1 = 0; j1 < numCorners; j0 = j1++)
     {
-        // Sort the normals into a counterclockwise spherical polygon when
-        // viewed from outside the sphere.
-        auto vertex = element.second;
-        int const vIndex = vertex->V;
-        std::vector<std::shared_ptr<Triangle>> tAdjSorted;
-        SortAdjacentTriangles(vIndex, vertex->TAdjacent, tAdjSorted);
-        int const numTriangles = static_cast<int>(vertex->TAdjacent.size());
-        queue.push(std::make_pair(0, numTriangles));
-        while (!queue.empty())
+        sum += Cross(piece.corners[j0], piece.corners[j1]);
+    }
+    return Length(sum) * (Real)0.5;
+}
+
+template <typename Real>
+bool ExtremalQuery3BSP<Real>::SelectSplitter(std::vector<Piece> const& pieces,
+    Vector3<Real>& normal) const
+{
+    // The candidates are edges of a sample of the pieces.  The cost of a
+    // candidate penalizes the pieces that are split, which are stored on
+    // both sides, and the imbalance of the two sides.
+    int const numPieces = static_cast<int>(pieces.size());
+    int const numSamples = std::min(numPieces, 8);
+    bool found = false;
+    int minCost = 0;
+    for (int pass = 0; pass < 2 && !found; ++pass)
+    {
+        // The first pass tries one edge of each sampled piece.  When no
+        // sampled edge separates the pieces, the second pass tries all the
+        // edges of all the pieces.
+        int const imax = (pass == 0 ? numSamples : numPieces);
+        for (int i = 0; i < imax; ++i)
         {
-            std::pair<int, int> item = queue.front();
-            queue.pop();
-            int i0 = item.first, i1 = item.second;
-            int separation = i1 - i0;
-            if (separation > 1 && separation != numTriangles - 1)
+            Piece const& piece = pieces[pass == 0 ?
+                (i * numPieces) / numSamples : i];
+            int const numCorners = static_cast<int>(piece.corners.size());
+            int const jmin = (pass == 0 ? i % numCorners : 0);
+            int const jmax = (pass == 0 ? jmin + 1 : numCorners);
+            for (int j = jmin; j < jmax; ++j)
             {
-                if (i1 < numTriangles)
+                Vector3<Real> candidate = UnitCross(piece.corners[j],
+                    piece.corners[(j + 1) % numCorners]);
+                int numPositive = 0, numNegative = 0, numSplit = 0;
+                for (auto const& other : pieces)
                 {
-                    SphericalArc arc;
-                    arc.nIndex[0] = mTriToNormal[tAdjSorted[i0]];
-                    arc.nIndex[1] = mTriToNormal[tAdjSorted[i1]];
-                    arc.separation = separation;
-
-                    arc.normal = Cross(this->mFaceNormals[arc.nIndex[0]],
-                        this->mFaceNormals[arc.nIndex[1]]);
-
-                    arc.posVertex = vIndex;
-                    arc.negVertex = vIndex;
-                    arcs.insert(arc);
+                    int side = Classify(other, candidate);
+                    if (side > 0)
+                    {
+                        ++numPositive;
+                    }
+                    else if (side < 0)
+                    {
+                        ++numNegative;
+                    }
+                    else
+                    {
+                        ++numSplit;
+                    }
                 }
-                int imid = (i0 + i1 + 1) / 2;
-                if (imid != i1)
+                if (numPositive + numSplit == numPieces
+                    || numNegative + numSplit == numPieces)
                 {
-                    queue.push(std::make_pair(i0, imid));
-                    queue.push(std::make_pair(imid, i1));
+                    // The circle does not separate the pieces, which is the
+                    // case for an edge on a circle of an ancestor node.
+                    if (numSplit == 0)
+                    {
+                        continue;
+                    }
+                }
+
+                int cost = 4 * numSplit + std::abs(numPositive - numNegative);
+                if (!found || cost < minCost)
+                {
+                    found = true;
+                    minCost = cost;
+                    normal = candidate;
                 }
             }
         }
     }
+    return found;
 }
 
 template <typename Real>
-void ExtremalQuery3BSP<Real>::CreateBSPTree(std::multiset<SphericalArc>& arcs)
+int ExtremalQuery3BSP<Real>::Classify(Piece const& piece,
+    Vector3<Real> const& normal) const
 {
-    // The tree has at least a root.
-    mTreeDepth = 1;
-
-    for (auto const& arc : gte::reverse(arcs))
+    bool hasPositive = false, hasNegative = false;
+    for (auto const& corner : piece.corners)
     {
-        InsertArc(arc);
+        Real dot = Dot(normal, corner);
+        if (dot > mTolerance)
+        {
+            hasPositive = true;
+        }
+        else if (dot < -mTolerance)
+        {
+            hasNegative = true;
+        }
     }
-
-    // The leaf nodes are not counted in the traversal of InsertArc.  The
-    // depth must be incremented to account for leaves.
-    ++mTreeDepth;
+    if (hasPositive && hasNegative)
+    {
+        return 0;
+    }
+    return (hasNegative ? -1 : +1);
 }
 
 template <typename Real>
-void ExtremalQuery3BSP<Real>::InsertArc(SphericalArc const& arc)
+void ExtremalQuery3BSP<Real>::Split(std::vector<Piece> const& pieces,
+    Vector3<Real> const& normal, std::vector<Piece>& positive,
+    std::vector<Piece>& negative) const
 {
-    // The incoming arc is stored at the end of the nodes array.
-    if (mNodes.size() > 0)
+    std::vector<Real> dots;
+    for (auto const& piece : pieces)
     {
-        // Do a nonrecursive depth-first search of the current BSP tree to
-        // place the incoming arc.  Index 0 is the root of the BSP tree.
-        std::stack<int> candidates;
-        candidates.push(0);
-        while (!candidates.empty())
+        int side = Classify(piece, normal);
+        if (side > 0)
+        {
+            positive.push_back(piece);
+            continue;
+        }
+        if (side < 0)
         {
-            int current = candidates.top();
-            candidates.pop();
-            SphericalArc* node = &mNodes[current];
+            negative.push_back(piece);
+            continue;
+        }
 
-            int sign0;
-            if (arc.nIndex[0] == node->nIndex[0] || arc.nIndex[0] == node->nIndex[1])
-            {
-                sign0 = 0;
-            }
-            else
-            {
-                Real dot = Dot(this->mFaceNormals[arc.nIndex[0]], node->normal);
-                sign0 = gte::isign(dot);
-            }
+        // Clip the polygon by the plane of the circle.  The corners within
+        // the tolerance of the circle are shared by both pieces.
+        int const numCorners = static_cast<int>(piece.corners.size());
+        dots.resize(numCorners);
+        for (int j = 0; j < numCorners; ++j)
+        {
+            Real dot = Dot(normal, piece.corners[j]);
+            dots[j] = (std::fabs(dot) > mTolerance ? dot : (Real)0);
+        }
 
-            int sign1;
-            if (arc.nIndex[1] == node->nIndex[0] || arc.nIndex[1] == node->nIndex[1])
+        Piece posPiece, negPiece;
+        posPiece.vertex = piece.vertex;
+        negPiece.vertex = piece.vertex;
+        for (int j0 = numCorners - 1, j1 = 0; j1 < numCorners; j0 = j1++)
+        {
+            Vector3<Real> const& corner0 = piece.corners[j0];
+            Vector3<Real> const& corner1 = piece.corners[j1];
+            Real dot0 = dots[j0], dot1 = dots[j1];
+            if ((dot0 > (Real)0 && dot1 < (Real)0)
+                || (dot0 < (Real)0 && dot1 > (Real)0))
             {
-                sign1 = 0;
+                Vector3<Real> point = corner0 + (dot0 / (dot0 - dot1)) *
+                    (corner1 - corner0);
+                Normalize(point);
+                posPiece.corners.push_back(point);
+                negPiece.corners.push_back(point);
             }
-            else
+            if (dot1 >= (Real)0)
             {
-                Real dot = Dot(this->mFaceNormals[arc.nIndex[1]], node->normal);
-                sign1 = gte::isign(dot);
+                posPiece.corners.push_back(corner1);
             }
-
-            int doTest = 0;
-            if (sign0 * sign1 < 0)
+            if (dot1 <= (Real)0)
             {
-                // The new arc straddles the current arc, so propagate it
-                // to both child nodes.
-                doTest = 3;
+                negPiece.corners.push_back(corner1);
             }
-            else if (sign0 > 0 || sign1 > 0)
+        }
+        positive.push_back(std::move(posPiece));
+        negative.push_back(std::move(negPiece));
+    }
+}
+
+template <typename Real> inline
+void ExtremalQuery3BSP<Real>::Search(Vector3<Real> const& direction,
+    int& positiveDirection, int& negativeDirection) const
+{
+    // Do a nonrecursive depth-first search of the BSP tree to determine
+    // spherical polygon contains the incoming direction D.  Index 0 is the
+    // root of the BSP tree.
+    int current = 0;
+    while (current >= 0)
+    {
+        Node const& node = mNodes[current];
+        int sign = gte::isign(Dot(direction, node.normal));
+        if (sign >= 0)
+        {
+            current = node.posChild;
+            if (current == -1)
             {
-                // The new arc is on the positive side of the current arc.
-                doTest = 1;
+                // At a leaf node.
+                positiveDirection = node.posVertex;
             }
-            else if (sign0 < 0 || sign1 < 0)
+        }
+        else
+        {
+            current = node.negChild;
+            if (current == -1)
             {
-                // The new arc is on the negative side of the current arc.
-                doTest = 2;
+                // At a leaf node.
+                positiveDirection = node.negVertex;
             }
-            // else: sign0 = sign1 = 0, in which case no propagation is
-            // needed because the current BSP node will handle the correct
-            // partitioning of the arcs during extremal queries.
-
-            int depth;
+        }
+    }
 
-            if (doTest & 1)
+    // Do a nonrecursive depth-first search of the BSP tree to determine
+    // spherical polygon contains the reverse incoming direction -D.
+    current = 0;  // the root of the BSP tree
+    while (current >= 0)
+    {
+        Node const& node = mNodes[current];
+        int sign = gte::isign(Dot(direction, node.normal));
+        if (sign <= 0)
+        {
+            current = node.posChild;
+            if (current == -1)
             {
-                if (node->posChild != -1)
-                {
-                    candidates.push(node->posChild);
-                    depth = static_cast<int>(candidates.size());
-                    if (depth > mTreeDepth)
-                    {
-                        mTreeDepth = depth;
-                    }
-                }
-                else
-                {
-                    node->posChild = static_cast<int>(mNodes.size());
-                    mNodes.push_back(arc);
-
-                    // The push_back can cause a reallocation, so the current
-                    // pointer must be refreshed.
-                    node = &mNodes[current];
-                }
+                // At a leaf node.
+                negativeDirection = node.posVertex;
             }
-
-            if (doTest & 2)
+        }
+        else
+        {
+            current = node.negChild;
+            if (current == -1)
             {
-                if (node->negChild != -1)
-                {
-                    candidates.push(node->negChild);
-                    depth = static_cast<int>(candidates.size());
-                    if (depth > mTreeDepth)
-                    {
-                        mTreeDepth = depth;
-                    }
-                }
-                else
-                {
-                    node->negChild = static_cast<int>(mNodes.size());
-                    mNodes.push_back(arc);
-                }
+                // At a leaf node.
+                negativeDirection = node.negVertex;
             }
         }
     }
-    else
-    {
-        // root node
-        mNodes.push_back(arc);
-    }
-}
-
-template <typename Real>
-ExtremalQuery3BSP<Real>::SphericalArc::SphericalArc()
-    :
-    posChild(-1),
-    negChild(-1)
-{
-}
-
-template <typename Real>
-bool ExtremalQuery3BSP<Real>::SphericalArc::operator<(SphericalArc const& arc) const
-{
-    return separation < arc.separation;
 }
 
 }
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/16)
 
 #pragma once
 
@@ -29,8 +29,21 @@ public:
     virtual void GetExtremeVertices(Vector3<Real> const& direction,
         int& positiveDirection, int& negativeDirection) override;
 
+    // Compute the extreme vertices for each of the numDirections directions.
+    virtual void GetExtremeVertices(int numDirections,
+        Vector3<Real> const* directions, int* positiveDirection,
+        int* negativeDirection) override;
+
 private:
+    inline void Project(Vector3<Real> const& direction,
+        int& positiveDirection, int& negativeDirection) const;
+
     Vector3<Real> mCentroid;
+
+    // The vertices of the polyhedron relative to the centroid, stored
+    // contiguously, and their indices in the polyhedron vertex array.
+    std::vector<Vector3<Real>> mDifferences;
+    std::vector<int> mIndices;
 };
 
 
@@ -40,29 +53,56 @@ ExtremalQuery3PRJ<Real>::ExtremalQuery3PRJ(Polyhedron3<Real> const& polytope)
     ExtremalQuery3<Real>(polytope)
 {
     mCentroid = this->mPolytope.ComputeVertexAverage();
+
+    auto const& vertexPool = this->mPolytope.GetVertices();
+    auto const& uniqueIndices = this->mPolytope.GetUniqueIndices();
+    mDifferences.reserve(uniqueIndices.size());
+    mIndices.reserve(uniqueIndices.size());
+    for (auto i : uniqueIndices)
+    {
+        mDifferences.push_back(vertexPool[i] - mCentroid);
+        mIndices.push_back(i);
+    }
 }
 
 template <typename Real>
 void ExtremalQuery3PRJ<Real>::GetExtremeVertices(Vector3<Real> const& direction,
     int& positiveDirection, int& negativeDirection)
+{
+    Project(direction, positiveDirection, negativeDirection);
+}
+
+template <typename Real>
+void ExtremalQuery3PRJ<Real>::GetExtremeVertices(int numDirections,
+    Vector3<Real> const* directions, int* positiveDirection,
+    int* negativeDirection)
+{
+    for (int i = 0; i < numDirections; ++i)
+    {
+        Project(directions[i], positiveDirection[i], negativeDirection[i]);
+    }
+}
+
+template <typename Real> inline
+void ExtremalQuery3PRJ<Real>::Project(Vector3<Real> const& direction,
+    int& positiveDirection, int& negativeDirection) const
 {
     Real minValue = std::numeric_limits<Real>::max(), maxValue = -minValue;
     negativeDirection = -1;
     positiveDirection = -1;
 
-    auto vertexPool = this->mPolytope.GetVertexPool();
-    for (auto i : this->mPolytope.GetUniqueIndices())
+    int const numVertices = static_cast<int>(mIndices.size());
+    for (int j = 0; j < numVertices; ++j)
     {
-        Vector3<Real> diff = vertexPool.get()->at(i) - mCentroid;
-        Real dot = Dot(direction, diff);
+        Real dot = Dot(direction, mDifferences[j]);
         if (dot < minValue)
         {
-            negativeDirection = i;
+            negativeDirection = mIndices[j];
             minValue = dot;
         }
         if (dot > maxValue)
         {
-            positiveDirection = i;
+            positiveDirection = mIndices[j];
             maxValue = dot;
         }
     }
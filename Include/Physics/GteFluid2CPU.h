@@ -0,0 +1,167 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.1 (2019/09/16)
+
+#pragma once
+
+#include <Physics/GteFluid2Parameters.h>
+#include <Physics/GtePoissonMultigrid.h>
+#include <memory>
+#include <vector>
+
+// A CPU implementation of the fluid simulation of Fluid2 that does not
+// require a GraphicsEngine.  The stages, parameters, random number
+// sequences and state layout are those of the compute shaders, so the
+// results are comparable.  As in Fluid3CPU, only the interior pixels are
+// computed by the stages; the boundary pixels are set by
+// EnforceStateBoundary and the Poisson boundary is zero.  The rows are
+// partitioned among the threads.  The Poisson solver and the
+// instrumentation are those of Fluid3CPU.
+//
+// Each of xSize and ySize must be at least 3.
+
+namespace gte
+{
+
+class GTE_IMPEXP Fluid2CPU
+{
+public:
+    // Construction.  The (x,y) grid covers [0,1]^2.  The number of threads
+    // should satisfy 1 <= numThreads <= std::thread::hardware_concurrency().
+    Fluid2CPU(int xSize, int ySize, float dt, float densityViscosity,
+        float velocityViscosity, unsigned int numThreads = 1);
+
+    void Initialize();
+    void DoSimulationStep();
+
+    // Select the Poisson solver.  SetJacobiSolver(32) is the default and
+    // matches Fluid2SolvePoisson.  SetMultigridSolver runs V-cycles until the
+    // residual is at most tolerance times the initial residual or until
+    // maxCycles cycles are run.  Both solvers start with a zero pressure.
+    void SetJacobiSolver(int numIterations);
+    void SetMultigridSolver(float tolerance, int maxCycles);
+
+    struct Statistics
+    {
+        // The seconds spent in each stage by the last DoSimulationStep.
+        double updateState;
+        double enforceStateBoundary;
+        double computeDivergence;
+        double solvePoisson;
+        double adjustVelocity;
+
+        // The root-mean-square residuals of the Poisson equation before the
+        // first and after each Jacobi iteration or V-cycle.
+        std::vector<float> residuals;
+    };
+
+    // The statistics are updated only when instrumentation is enabled.  The
+    // default is disabled.
+    void SetInstrumentation(bool enable);
+    inline Statistics const& GetStatistics() const;
+
+    // Member access.  The state and source have 4 floats per pixel,
+    // (velocity.xy, 0, density), with the pixel (x,y) at index x + xSize*y,
+    // which is the layout of a Texture2 with format DF_R32G32B32A32_FLOAT.
+    inline Fluid2Parameters const& GetParameters() const;
+    inline std::vector<float> const& GetSource() const;
+    inline std::vector<float> const& GetState() const;
+
+private:
+    enum { NUM_VORTICES = 1024, NUM_POISSON_ITERATIONS = 32 };
+
+    enum PoissonSolver
+    {
+        POISSON_JACOBI,
+        POISSON_MULTIGRID
+    };
+
+    struct External
+    {
+        Vector4<float> densityProducer;  // (x, y, variance, amplitude)
+        Vector4<float> densityConsumer;  // (x, y, variance, amplitude)
+        Vector4<float> gravity;          // (x, y, *, *)
+        Vector4<float> wind;             // (x, y, variance, amplitude)
+    };
+
+    // The simulation stages.  The inputs and outputs are those of the
+    // compute shaders with the same names.
+    void InitializeSource();
+    void InitializeState();
+    void EnforceStateBoundary(std::vector<float>& state);
+    void UpdateState();
+    void ComputeDivergence();
+    void SolvePoisson();
+    void SolvePoissonJacobi();
+    void AdjustVelocity();
+
+    // Bilinear interpolation of the state with clamping, where (x,y) is in
+    // pixel units.
+    void Sample(std::vector<float> const& state, float x, float y,
+        float* result) const;
+
+    inline int GetIndex(int x, int y) const;
+
+    void CreateMultigrid();
+
+    // Constructor inputs.
+    int mXSize, mYSize;
+    float mDt;
+    unsigned int mNumThreads;
+
+    // Current simulation time.
+    float mTime;
+
+    Fluid2Parameters mParameters;
+    External mExternal;
+
+    std::vector<float> mSource;
+    std::vector<float> mStateTm1;
+    std::vector<float> mStateT;
+    std::vector<float> mStateTp1;
+    std::vector<float> mDivergence;
+    std::vector<float> mPoisson0;
+    std::vector<float> mPoisson1;
+
+    // The Poisson solver.  The multigrid object is created on demand, and
+    // the Jacobi solver uses it to compute residuals for the statistics.
+    PoissonSolver mPoissonSolver;
+    int mNumJacobiIterations;
+    float mMultigridTolerance;
+    int mMultigridMaxCycles;
+    std::unique_ptr<PoissonMultigrid> mMultigrid;
+
+    bool mInstrumentation;
+    Statistics mStatistics;
+};
+
+
+inline Fluid2Parameters const& Fluid2CPU::GetParameters() const
+{
+    return mParameters;
+}
+
+inline std::vector<float> const& Fluid2CPU::GetSource() const
+{
+    return mSource;
+}
+
+inline std::vector<float> const& Fluid2CPU::GetState() const
+{
+    return mStateT;
+}
+
+inline Fluid2CPU::Statistics const& Fluid2CPU::GetStatistics() const
+{
+    return mStatistics;
+}
+
+inline int Fluid2CPU::GetIndex(int x, int y) const
+{
+    return x + mXSize * y;
+}
+
+}
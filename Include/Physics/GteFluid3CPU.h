@@ -0,0 +1,191 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.1 (2019/09/16)
+
+#pragma once
+
+#include <Physics/GteFluid3Parameters.h>
+#include <Physics/GtePoissonMultigrid.h>
+#include <memory>
+#include <vector>
+
+// A CPU implementation of the fluid simulation of Fluid3 that does not
+// require a GraphicsEngine.  The stages are those of the compute shaders
+// (InitializeSource, InitializeState, UpdateState, EnforceStateBoundary,
+// ComputeDivergence, SolvePoisson and AdjustVelocity), they use the same
+// Fluid3Parameters and the same random number sequences, and the state is
+// stored in the layout of the GPU texture, so the results are comparable.
+//
+// The shaders compute all the voxels, but the boundary voxels of each
+// output are overwritten by EnforceStateBoundary or by zeroing the Poisson
+// boundary.  The stages here process only the interior voxels, which
+// produces the same results and avoids clamping the neighbor indices.  The
+// z-slices are partitioned among the threads, and the x-loops are over
+// contiguous float arrays so that the compiler can vectorize them.
+//
+// The Poisson stage is by default the Jacobi iteration of the shader.  It
+// can be replaced by the V-cycles of PoissonMultigrid, which reach a small
+// residual with much less work on large grids.  With instrumentation
+// enabled, DoSimulationStep records the time of each stage and the
+// residuals of the Poisson equation.
+//
+// Each of xSize, ySize and zSize must be at least 3.
+
+namespace gte
+{
+
+class GTE_IMPEXP Fluid3CPU
+{
+public:
+    // Construction.  The (x,y,z) grid covers [0,1]^3.  The number of threads
+    // should satisfy 1 <= numThreads <= std::thread::hardware_concurrency().
+    Fluid3CPU(int xSize, int ySize, int zSize, float dt, unsigned int numThreads = 1);
+
+    void Initialize();
+    void DoSimulationStep();
+
+    // Select the Poisson solver.  SetJacobiSolver(32) is the default and
+    // matches Fluid3SolvePoisson.  SetMultigridSolver runs V-cycles until the
+    // residual is at most tolerance times the initial residual or until
+    // maxCycles cycles are run.  Both solvers start with a zero pressure.
+    void SetJacobiSolver(int numIterations);
+    void SetMultigridSolver(float tolerance, int maxCycles);
+
+    struct Statistics
+    {
+        // The seconds spent in each stage by the last DoSimulationStep.
+        double updateState;
+        double enforceStateBoundary;
+        double computeDivergence;
+        double solvePoisson;
+        double adjustVelocity;
+
+        // The root-mean-square residuals of the Poisson equation before the
+        // first and after each Jacobi iteration or V-cycle.  The residuals
+        // of the Jacobi iterations are computed only for the statistics, so
+        // their cost is included in solvePoisson.
+        std::vector<float> residuals;
+    };
+
+    // The statistics are updated only when instrumentation is enabled.  The
+    // default is disabled.
+    void SetInstrumentation(bool enable);
+    inline Statistics const& GetStatistics() const;
+
+    // Member access.  The state and source have 4 floats per voxel,
+    // (velocity.xyz, density), with the voxel (x,y,z) at index
+    // x + xSize*(y + ySize*z), which is the layout of a Texture3 with
+    // format DF_R32G32B32A32_FLOAT.
+    inline Fluid3Parameters const& GetParameters() const;
+    inline std::vector<float> const& GetSource() const;
+    inline std::vector<float> const& GetState() const;
+
+private:
+    enum { NUM_VORTICES = 1024, NUM_POISSON_ITERATIONS = 32 };
+
+    enum PoissonSolver
+    {
+        POISSON_JACOBI,
+        POISSON_MULTIGRID
+    };
+
+    struct Vortex
+    {
+        Vector4<float> position;
+        Vector4<float> normal;
+        Vector4<float> data;
+    };
+
+    struct External
+    {
+        Vector4<float> densityProducer;  // (x, y, z, *)
+        Vector4<float> densityPData;     // (variance, amplitude, *, *)
+        Vector4<float> densityConsumer;  // (x, y, z, *)
+        Vector4<float> densityCData;     // (variance, amplitude, *, *)
+        Vector4<float> gravity;
+        Vector4<float> windData;
+    };
+
+    // The simulation stages.  The inputs and outputs are those of the
+    // compute shaders with the same names.
+    void InitializeSource();
+    void InitializeState();
+    void EnforceStateBoundary(std::vector<float>& state);
+    void UpdateState();
+    void ComputeDivergence();
+    void SolvePoisson();
+    void SolvePoissonJacobi();
+    void AdjustVelocity();
+
+    // Trilinear interpolation of the state with clamping, where (x,y,z) is
+    // in voxel units.  This is the GPU texture sampling, which has texel
+    // centers at (x+1/2)/xSize, with the texture coordinates converted to
+    // voxel units.
+    void Sample(std::vector<float> const& state, float x, float y, float z,
+        float* result) const;
+
+    inline int GetIndex(int x, int y, int z) const;
+
+    void CreateMultigrid();
+
+    // Constructor inputs.
+    int mXSize, mYSize, mZSize;
+    float mDt;
+    unsigned int mNumThreads;
+
+    // Current simulation time.
+    float mTime;
+
+    Fluid3Parameters mParameters;
+    External mExternal;
+
+    std::vector<float> mSource;
+    std::vector<float> mStateTm1;
+    std::vector<float> mStateT;
+    std::vector<float> mStateTp1;
+    std::vector<float> mDivergence;
+    std::vector<float> mPoisson0;
+    std::vector<float> mPoisson1;
+
+    // The Poisson solver.  The multigrid object is created on demand, and
+    // the Jacobi solver uses it to compute residuals for the statistics.
+    PoissonSolver mPoissonSolver;
+    int mNumJacobiIterations;
+    float mMultigridTolerance;
+    int mMultigridMaxCycles;
+    std::unique_ptr<PoissonMultigrid> mMultigrid;
+
+    bool mInstrumentation;
+    Statistics mStatistics;
+};
+
+
+inline Fluid3Parameters const& Fluid3CPU::GetParameters() const
+{
+    return mParameters;
+}
+
+inline std::vector<float> const& Fluid3CPU::GetSource() const
+{
+    return mSource;
+}
+
+inline std::vector<float> const& Fluid3CPU::GetState() const
+{
+    return mStateT;
+}
+
+inline Fluid3CPU::Statistics const& Fluid3CPU::GetStatistics() const
+{
+    return mStatistics;
+}
+
+inline int Fluid3CPU::GetIndex(int x, int y, int z) const
+{
+    return x + mXSize * (y + mYSize * z);
+}
+
+}
@@ -3,10 +3,11 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.1 (2019/05/03)
+// File Version: 3.0.2 (2019/09/16)
 
 #pragma once
 
+#include <Physics/GteMassSpringImplicitSolver.h>
 #include <Physics/GteParticleSystem.h>
 #include <cstring>
 #include <set>
@@ -21,9 +22,10 @@ public:
     // Construction and destruction.  This class represents a set of M
     // masses that are connected by S springs with arbitrary topology.  The
     // function SetSpring(...) should be called for each spring that you
-    // want in the system.
+    // want in the system.  The number of threads is that of ParticleSystem.
     virtual ~MassSpringArbitrary();
-    MassSpringArbitrary(int numParticles, int numSprings, Real step);
+    MassSpringArbitrary(int numParticles, int numSprings, Real step,
+        unsigned int numThreads = 1);
 
     struct Spring
     {
@@ -44,6 +46,24 @@ public:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity);
 
+    // The batch version of ExternalAcceleration(...); see the comments for
+    // Accelerations(...) in ParticleSystem.
+    virtual void ExternalAccelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration);
+
+    // Implicit integration; see the comments in
+    // GteMassSpringImplicitSolver.h.
+    void SetImplicit(bool implicit);
+    inline bool GetImplicit() const;
+    inline MassSpringImplicitSolver<N, Real>& GetImplicitSolver();
+
+    // Update(...) rebuilds the compact adjacency when springs were set since
+    // the last update.  A derived class that overrides Update(...) must call
+    // this function.
+    virtual void Update(Real time) override;
+
 protected:
     // Callback for acceleration (ODE solver uses x" = F/m) applied to
     // particle i.  The positions and velocities are not necessarily
@@ -53,12 +73,38 @@ protected:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity);
 
+    // The batch callback, which calls ExternalAccelerations(...) once and
+    // then adds the spring impulses without virtual calls.
+    virtual void Accelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration) override;
+
+    // Add the spring impulses on particle i to its acceleration.
+    inline void AddSpringAcceleration(int i,
+        std::vector<Vector<N, Real>> const& position,
+        Vector<N, Real>& acceleration) const;
+
     std::vector<Spring> mSpring;
 
     // Each particle has an associated array of spring indices for those
     // springs adjacent to the particle.  The set elements are spring
     // indices, not indices of adjacent particles.
     std::vector<std::set<int>> mAdjacent;
+
+    // The adjacency in compact form for the batch callback.  The spring
+    // indices of particle i are mAdjacentSpring[j] for
+    // mAdjacentOffset[i] <= j < mAdjacentOffset[i+1].
+    std::vector<int> mAdjacentOffset, mAdjacentSpring;
+    bool mAdjacentModified;
+
+    // Implicit integration.  The springs with nonzero constants are copied
+    // to the solver when they change.
+    void SetImplicitSprings();
+
+    bool mImplicit, mSpringsModified;
+    MassSpringImplicitSolver<N, Real> mImplicitSolver;
+    std::vector<Vector<N, Real>> mExternalAcceleration;
 };
 
 
@@ -69,11 +115,17 @@ MassSpringArbitrary<N, Real>::~MassSpringArbitrary()
 
 template <int N, typename Real>
 MassSpringArbitrary<N, Real>::MassSpringArbitrary(int numParticles,
-    int numSprings, Real step)
+    int numSprings, Real step, unsigned int numThreads)
     :
-    ParticleSystem<N, Real>(numParticles, step),
+    ParticleSystem<N, Real>(numParticles, step, numThreads),
     mSpring(numSprings),
-    mAdjacent(numParticles)
+    mAdjacent(numParticles),
+    mAdjacentOffset(numParticles + 1, 0),
+    mAdjacentModified(false),
+    mImplicit(false),
+    mSpringsModified(true),
+    mImplicitSolver(numThreads),
+    mExternalAcceleration(numParticles)
 {
     std::memset(&mSpring[0], 0, numSprings * sizeof(Spring));
 }
@@ -90,6 +142,8 @@ void MassSpringArbitrary<N, Real>::SetSpring(int index, Spring const& spring)
     mSpring[index] = spring;
     mAdjacent[spring.particle0].insert(index);
     mAdjacent[spring.particle1].insert(index);
+    mAdjacentModified = true;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
@@ -106,6 +160,90 @@ Vector<N, Real> MassSpringArbitrary<N, Real>::ExternalAcceleration(int, Real,
     return Vector<N, Real>::Zero();
 }
 
+template <int N, typename Real>
+void MassSpringArbitrary<N, Real>::ExternalAccelerations(int imin, int imax,
+    Real time, std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    for (int i = imin; i < imax; ++i)
+    {
+        acceleration[i] = ExternalAcceleration(i, time, position, velocity);
+    }
+}
+
+template <int N, typename Real>
+void MassSpringArbitrary<N, Real>::SetImplicit(bool implicit)
+{
+    mImplicit = implicit;
+    mSpringsModified = true;
+}
+
+template <int N, typename Real> inline
+bool MassSpringArbitrary<N, Real>::GetImplicit() const
+{
+    return mImplicit;
+}
+
+template <int N, typename Real> inline
+MassSpringImplicitSolver<N, Real>& MassSpringArbitrary<N, Real>::GetImplicitSolver()
+{
+    return mImplicitSolver;
+}
+
+template <int N, typename Real>
+void MassSpringArbitrary<N, Real>::Update(Real time)
+{
+    if (mAdjacentModified)
+    {
+        int const numParticles = this->mNumParticles;
+        mAdjacentSpring.clear();
+        for (int i = 0; i < numParticles; ++i)
+        {
+            mAdjacentOffset[i] = static_cast<int>(mAdjacentSpring.size());
+            mAdjacentSpring.insert(mAdjacentSpring.end(), mAdjacent[i].begin(),
+                mAdjacent[i].end());
+        }
+        mAdjacentOffset[numParticles] = static_cast<int>(mAdjacentSpring.size());
+        mAdjacentModified = false;
+    }
+
+    if (!mImplicit)
+    {
+        ParticleSystem<N, Real>::Update(time);
+        return;
+    }
+
+    if (mSpringsModified)
+    {
+        SetImplicitSprings();
+        mSpringsModified = false;
+    }
+
+    ParallelFor(this->mNumThreads, this->mNumParticles, [this, time](unsigned int, int imin, int imax)
+    {
+        ExternalAccelerations(imin, imax, time, this->mPosition, this->mVelocity,
+            mExternalAcceleration);
+    });
+    mImplicitSolver.Update(this->mStep, this->mMass, this->mInvMass,
+        mExternalAcceleration, this->mPosition, this->mVelocity);
+}
+
+template <int N, typename Real>
+void MassSpringArbitrary<N, Real>::SetImplicitSprings()
+{
+    std::vector<typename MassSpringImplicitSolver<N, Real>::Spring> springs;
+    for (auto const& spring : mSpring)
+    {
+        if (spring.constant != (Real)0)
+        {
+            springs.push_back({ spring.particle0, spring.particle1,
+                spring.constant, spring.length });
+        }
+    }
+    mImplicitSolver.SetSprings(this->mNumParticles, springs);
+}
+
 template <int N, typename Real>
 Vector<N, Real> MassSpringArbitrary<N, Real>::Acceleration(int i, Real time,
     std::vector<Vector<N, Real>> const& position,
@@ -140,5 +278,36 @@ Vector<N, Real> MassSpringArbitrary<N, Real>::Acceleration(int i, Real time,
     return acceleration;
 }
 
+template <int N, typename Real>
+void MassSpringArbitrary<N, Real>::Accelerations(int imin, int imax,
+    Real time, std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    ExternalAccelerations(imin, imax, time, position, velocity, acceleration);
+    for (int i = imin; i < imax; ++i)
+    {
+        AddSpringAcceleration(i, position, acceleration[i]);
+    }
+}
+
+template <int N, typename Real> inline
+void MassSpringArbitrary<N, Real>::AddSpringAcceleration(int i,
+    std::vector<Vector<N, Real>> const& position,
+    Vector<N, Real>& acceleration) const
+{
+    // The springs are those of mAdjacent[i] in the same order, so the
+    // result is that of Acceleration(...).
+    for (int j = mAdjacentOffset[i]; j < mAdjacentOffset[i + 1]; ++j)
+    {
+        Spring const& spring = mSpring[mAdjacentSpring[j]];
+        int const other = (i != spring.particle0 ? spring.particle0 : spring.particle1);
+        Vector<N, Real> diff = position[other] - position[i];
+        Real ratio = spring.length / Length(diff);
+        Vector<N, Real> force = spring.constant * ((Real)1 - ratio) * diff;
+        acceleration += this->mInvMass[i] * force;
+    }
+}
+
 
 }
@@ -3,7 +3,7 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/16)
 
 #pragma once
 
@@ -17,9 +17,10 @@ class MassSpringCurve : public ParticleSystem<N, Real>
 {
 public:
     // Construction and destruction.  This class represents a set of N-1
-    // springs connecting N masses that lie on a curve.
+    // springs connecting N masses that lie on a curve.  The number of
+    // threads is that of ParticleSystem.
     virtual ~MassSpringCurve();
-    MassSpringCurve(int numParticles, Real step);
+    MassSpringCurve(int numParticles, Real step, unsigned int numThreads = 1);
 
     // Member access.  The parameters are spring constant and spring resting
     // length.
@@ -37,6 +38,13 @@ public:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity);
 
+    // The batch version of ExternalAcceleration(...); see the comments for
+    // Accelerations(...) in ParticleSystem.
+    virtual void ExternalAccelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration);
+
 protected:
     // Callback for acceleration (ODE solver uses x" = F/m) applied to
     // particle i.  The positions and velocities are not necessarily
@@ -46,6 +54,18 @@ protected:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity);
 
+    // The batch callback, which calls ExternalAccelerations(...) once and
+    // then adds the spring impulses without virtual calls.
+    virtual void Accelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration) override;
+
+    // Add the spring impulses on particle i to its acceleration.
+    inline void AddSpringAcceleration(int i,
+        std::vector<Vector<N, Real>> const& position,
+        Vector<N, Real>& acceleration) const;
+
     std::vector<Real> mConstant, mLength;
 };
 
@@ -56,9 +76,10 @@ MassSpringCurve<N, Real>::~MassSpringCurve()
 }
 
 template <int N, typename Real>
-MassSpringCurve<N, Real>::MassSpringCurve(int numParticles, Real step)
+MassSpringCurve<N, Real>::MassSpringCurve(int numParticles, Real step,
+    unsigned int numThreads)
     :
-    ParticleSystem<N, Real>(numParticles, step),
+    ParticleSystem<N, Real>(numParticles, step, numThreads),
     mConstant(numParticles - 1),
     mLength(numParticles - 1)
 {
@@ -103,6 +124,18 @@ Vector<N, Real> MassSpringCurve<N, Real>::ExternalAcceleration(int, Real,
     return Vector<N, Real>::Zero();
 }
 
+template <int N, typename Real>
+void MassSpringCurve<N, Real>::ExternalAccelerations(int imin, int imax,
+    Real time, std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    for (int i = imin; i < imax; ++i)
+    {
+        acceleration[i] = ExternalAcceleration(i, time, position, velocity);
+    }
+}
+
 template <int N, typename Real>
 Vector<N, Real> MassSpringCurve<N, Real>::Acceleration(int i, Real time,
     std::vector<Vector<N, Real>> const& position,
@@ -116,7 +149,28 @@ Vector<N, Real> MassSpringCurve<N, Real>::Acceleration(int i, Real time,
 
     Vector<N, Real> acceleration = ExternalAcceleration(i, time, position,
         velocity);
+    AddSpringAcceleration(i, position, acceleration);
+    return acceleration;
+}
 
+template <int N, typename Real>
+void MassSpringCurve<N, Real>::Accelerations(int imin, int imax, Real time,
+    std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    ExternalAccelerations(imin, imax, time, position, velocity, acceleration);
+    for (int i = imin; i < imax; ++i)
+    {
+        AddSpringAcceleration(i, position, acceleration[i]);
+    }
+}
+
+template <int N, typename Real> inline
+void MassSpringCurve<N, Real>::AddSpringAcceleration(int i,
+    std::vector<Vector<N, Real>> const& position,
+    Vector<N, Real>& acceleration) const
+{
     Vector<N, Real> diff, force;
     Real ratio;
 
@@ -137,8 +191,6 @@ Vector<N, Real> MassSpringCurve<N, Real>::Acceleration(int i, Real time,
         force = mConstant[i] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
-
-    return acceleration;
 }
 
 
@@ -0,0 +1,409 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteMatrix.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Backward Euler integration of a mass-spring system, used by the implicit
+// mode of MassSpringSurface, MassSpringVolume and MassSpringArbitrary.  The
+// spring force on particle i of the spring to particle j is
+//   F = c*(1 - L/|D|)*D, D = X[j] - X[i]
+// for spring constant c and rest length L, the same force as in the
+// Acceleration(...) functions of those classes.  The step of size h solves
+//   (M - h^2*K)*dV = h*(F + M*A + h*K*V)
+// for the velocity change dV, where K is the Jacobian of the spring forces
+// with respect to the positions and A is the external acceleration, which
+// is evaluated at the start of the step.  The new velocity is V + dV and
+// the new position is X + h*(V + dV).  The system is solved by conjugate
+// gradient with a diagonal preconditioner, starting with the dV of the
+// previous step.
+//
+// The Jacobian of a spring is the symmetric block
+//   c*((1 - L/|D|)*(I - U*U^T) + U*U^T), U = D/|D|
+// where the coefficient 1 - L/|D| is clamped to zero for a compressed
+// spring, so M - h^2*K is positive definite.  The equations of immovable
+// particles (inverse mass zero) are removed, so their velocities are not
+// changed.
+//
+// The matrix is not assembled as a general sparse matrix.  Each spring
+// stores its block, and each particle stores its diagonal block and the
+// list of its springs, so the products are gathers over the particles.
+// The springs and the particles are partitioned among the threads.
+//
+// The default integration of MassSpringSurface, MassSpringVolume and
+// MassSpringArbitrary is the RK4 solver of ParticleSystem.  After
+// SetImplicit(true), their Update(...) takes the backward Euler steps of
+// this solver instead, which remain stable for stiff springs at steps
+// where the RK4 solver diverges.  GetImplicitSolver() provides access to
+// SetParameters(...) and to the statistics of the last step.
+
+namespace gte
+{
+
+template <int N, typename Real>
+class MassSpringImplicitSolver
+{
+public:
+    struct Spring
+    {
+        int particle0, particle1;
+        Real constant, length;
+    };
+
+    // Construction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    MassSpringImplicitSolver(unsigned int numThreads = 1);
+
+    // The conjugate gradient iterates until the norm of the residual is at
+    // most tolerance times the norm of the right-hand side or until
+    // maxIterations iterations are run.  The defaults are 1e-4 and 256.
+    void SetParameters(int maxIterations, Real tolerance);
+
+    // Set the springs of a system of numParticles particles.  This must be
+    // called before Update(...) and whenever the springs change.
+    void SetSprings(int numParticles, std::vector<Spring> const& springs);
+
+    // Advance the positions and velocities by one step.
+    void Update(Real step, std::vector<Real> const& mass,
+        std::vector<Real> const& invMass,
+        std::vector<Vector<N, Real>> const& externalAcceleration,
+        std::vector<Vector<N, Real>>& position,
+        std::vector<Vector<N, Real>>& velocity);
+
+    // The number of iterations of the last Update(...) and its relative
+    // residual norm.
+    inline int GetNumIterations() const;
+    inline Real GetResidual() const;
+
+private:
+    // Call function(t, i) for each particle i on thread t and return the
+    // sum of the returned values.  The functions of the conjugate gradient
+    // also accumulate the squared length of the residual in
+    // mRSqrLengths[t], which GetRSqrLength() sums.
+    template <typename Function>
+    double SumOverParticles(Function const& function);
+    double GetRSqrLength() const;
+
+    // Compute y = (M - h^2*K)*x.
+    void Multiply(std::vector<Vector<N, Real>> const& x,
+        std::vector<Vector<N, Real>>& y);
+
+    unsigned int mNumThreads;
+    int mMaxIterations;
+    Real mTolerance;
+    int mNumIterations;
+    Real mResidual;
+    Real mStepSqr;
+
+    std::vector<Spring> mSprings;
+
+    // The springs of particle i are mAdjacentSpring[k] for
+    // mAdjacentOffset[i] <= k < mAdjacentOffset[i+1], where the other
+    // particle of the spring is mAdjacentParticle[k].
+    std::vector<int> mAdjacentOffset, mAdjacentSpring, mAdjacentParticle;
+
+    // The Jacobian block and force on particle0 of each spring, and the
+    // diagonal block of M - h^2*K and the diagonal preconditioner of each
+    // particle.  The particles with inverse mass zero have a zero
+    // preconditioner.
+    std::vector<Matrix<N, N, Real>> mSpringBlock, mDiagonalBlock;
+    std::vector<Vector<N, Real>> mSpringForce, mInvDiagonal;
+
+    // The conjugate gradient vectors.
+    std::vector<Vector<N, Real>> mB, mDeltaV, mR, mZ, mP, mAP;
+    std::vector<double> mThreadSums, mRSqrLengths;
+};
+
+
+template <int N, typename Real>
+MassSpringImplicitSolver<N, Real>::MassSpringImplicitSolver(unsigned int numThreads)
+    :
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mMaxIterations(256),
+    mTolerance((Real)1e-4),
+    mNumIterations(0),
+    mResidual((Real)0),
+    mStepSqr((Real)0),
+    mThreadSums(mNumThreads),
+    mRSqrLengths(mNumThreads)
+{
+}
+
+template <int N, typename Real>
+void MassSpringImplicitSolver<N, Real>::SetParameters(int maxIterations, Real tolerance)
+{
+    mMaxIterations = std::max(maxIterations, 0);
+    mTolerance = tolerance;
+}
+
+template <int N, typename Real>
+void MassSpringImplicitSolver<N, Real>::SetSprings(int numParticles,
+    std::vector<Spring> const& springs)
+{
+    mSprings = springs;
+    int const numSprings = static_cast<int>(mSprings.size());
+
+    // Count the springs of each particle and then fill in the lists.
+    mAdjacentOffset.assign(numParticles + 1, 0);
+    for (auto const& spring : mSprings)
+    {
+        ++mAdjacentOffset[spring.particle0 + 1];
+        ++mAdjacentOffset[spring.particle1 + 1];
+    }
+    for (int i = 0; i < numParticles; ++i)
+    {
+        mAdjacentOffset[i + 1] += mAdjacentOffset[i];
+    }
+
+    std::vector<int> current(mAdjacentOffset.begin(), mAdjacentOffset.end() - 1);
+    mAdjacentSpring.resize(2 * numSprings);
+    mAdjacentParticle.resize(2 * numSprings);
+    for (int s = 0; s < numSprings; ++s)
+    {
+        int const i0 = mSprings[s].particle0, i1 = mSprings[s].particle1;
+        mAdjacentSpring[current[i0]] = s;
+        mAdjacentParticle[current[i0]++] = i1;
+        mAdjacentSpring[current[i1]] = s;
+        mAdjacentParticle[current[i1]++] = i0;
+    }
+
+    mSpringBlock.resize(numSprings);
+    mSpringForce.resize(numSprings);
+    mDiagonalBlock.resize(numParticles);
+    mInvDiagonal.resize(numParticles);
+    mB.resize(numParticles);
+    mDeltaV.assign(numParticles, Vector<N, Real>::Zero());
+    mR.resize(numParticles);
+    mZ.resize(numParticles);
+    mP.resize(numParticles);
+    mAP.resize(numParticles);
+}
+
+template <int N, typename Real>
+void MassSpringImplicitSolver<N, Real>::Update(Real step,
+    std::vector<Real> const& mass, std::vector<Real> const& invMass,
+    std::vector<Vector<N, Real>> const& externalAcceleration,
+    std::vector<Vector<N, Real>>& position,
+    std::vector<Vector<N, Real>>& velocity)
+{
+    int const numParticles = static_cast<int>(mAdjacentOffset.size()) - 1;
+    int const numSprings = static_cast<int>(mSprings.size());
+    mStepSqr = step * step;
+
+    // Compute the force and Jacobian block of each spring.
+    ParallelFor(mNumThreads, numSprings, [this, &position](unsigned int, int smin, int smax)
+    {
+        for (int s = smin; s < smax; ++s)
+        {
+            Spring const& spring = mSprings[s];
+            Vector<N, Real> diff = position[spring.particle1] - position[spring.particle0];
+            Real length = Length(diff);
+            Real ratio = spring.length / length;
+            mSpringForce[s] = spring.constant * ((Real)1 - ratio) * diff;
+
+            Vector<N, Real> unit = diff / length;
+            Matrix<N, N, Real> uut = OuterProduct(unit, unit);
+            Matrix<N, N, Real> block;
+            block.MakeIdentity();
+            block = std::max((Real)1 - ratio, (Real)0) * (block - uut) + uut;
+            mSpringBlock[s] = spring.constant * block;
+        }
+    });
+
+    // Gather the diagonal blocks and the right-hand side
+    // h*(F + M*A + h*K*V).  The initial guess is the previous dV.
+    double bSqrLength = SumOverParticles([this, step, &mass, &invMass,
+        &externalAcceleration, &velocity](unsigned int, int i)
+    {
+        if (invMass[i] == (Real)0)
+        {
+            mB[i].MakeZero();
+            mDeltaV[i].MakeZero();
+            mInvDiagonal[i].MakeZero();
+            return 0.0;
+        }
+
+        Matrix<N, N, Real> sum;
+        Vector<N, Real> force = mass[i] * externalAcceleration[i];
+        Vector<N, Real> kv = Vector<N, Real>::Zero();
+        for (int k = mAdjacentOffset[i]; k < mAdjacentOffset[i + 1]; ++k)
+        {
+            int const s = mAdjacentSpring[k];
+            if (mSprings[s].particle0 == i)
+            {
+                force += mSpringForce[s];
+            }
+            else
+            {
+                force -= mSpringForce[s];
+            }
+            sum += mSpringBlock[s];
+            kv += mSpringBlock[s] * (velocity[mAdjacentParticle[k]] - velocity[i]);
+        }
+
+        Matrix<N, N, Real>& diagonal = mDiagonalBlock[i];
+        diagonal = mStepSqr * sum;
+        for (int d = 0; d < N; ++d)
+        {
+            diagonal(d, d) += mass[i];
+            mInvDiagonal[i][d] = (Real)1 / diagonal(d, d);
+        }
+        mB[i] = step * (force + step * kv);
+        return static_cast<double>(Dot(mB[i], mB[i]));
+    });
+
+    // Preconditioned conjugate gradient.
+    Multiply(mDeltaV, mAP);
+    std::fill(mRSqrLengths.begin(), mRSqrLengths.end(), 0.0);
+    double rz = SumOverParticles([this](unsigned int t, int i)
+    {
+        mR[i] = mB[i] - mAP[i];
+        mZ[i] = mInvDiagonal[i] * mR[i];
+        mP[i] = mZ[i];
+        mRSqrLengths[t] += static_cast<double>(Dot(mR[i], mR[i]));
+        return static_cast<double>(Dot(mR[i], mZ[i]));
+    });
+    double rSqrLength = GetRSqrLength();
+
+    double const bLength = std::sqrt(bSqrLength);
+    double const target = static_cast<double>(mTolerance) * bLength;
+    for (mNumIterations = 0; mNumIterations < mMaxIterations; ++mNumIterations)
+    {
+        if (std::sqrt(rSqrLength) <= target || rz <= 0.0)
+        {
+            break;
+        }
+
+        Multiply(mP, mAP);
+        double pAp = SumOverParticles([this](unsigned int, int i)
+        {
+            return static_cast<double>(Dot(mP[i], mAP[i]));
+        });
+        if (pAp <= 0.0)
+        {
+            break;
+        }
+
+        Real alpha = static_cast<Real>(rz / pAp);
+        std::fill(mRSqrLengths.begin(), mRSqrLengths.end(), 0.0);
+        double rzNext = SumOverParticles([this, alpha](unsigned int t, int i)
+        {
+            mDeltaV[i] += alpha * mP[i];
+            mR[i] -= alpha * mAP[i];
+            mZ[i] = mInvDiagonal[i] * mR[i];
+            mRSqrLengths[t] += static_cast<double>(Dot(mR[i], mR[i]));
+            return static_cast<double>(Dot(mR[i], mZ[i]));
+        });
+        rSqrLength = GetRSqrLength();
+
+        Real beta = static_cast<Real>(rzNext / rz);
+        rz = rzNext;
+        ParallelFor(mNumThreads, numParticles, [this, beta](unsigned int, int imin, int imax)
+        {
+            for (int i = imin; i < imax; ++i)
+            {
+                mP[i] = mZ[i] + beta * mP[i];
+            }
+        });
+    }
+    mResidual = static_cast<Real>(bLength > 0.0 ? std::sqrt(rSqrLength) / bLength : 0.0);
+
+    ParallelFor(mNumThreads, numParticles, [this, step, &invMass, &position, &velocity](
+        unsigned int, int imin, int imax)
+    {
+        for (int i = imin; i < imax; ++i)
+        {
+            if (invMass[i] > (Real)0)
+            {
+                velocity[i] += mDeltaV[i];
+                position[i] += step * velocity[i];
+            }
+        }
+    });
+}
+
+template <int N, typename Real> inline
+int MassSpringImplicitSolver<N, Real>::GetNumIterations() const
+{
+    return mNumIterations;
+}
+
+template <int N, typename Real> inline
+Real MassSpringImplicitSolver<N, Real>::GetResidual() const
+{
+    return mResidual;
+}
+
+template <int N, typename Real>
+template <typename Function>
+double MassSpringImplicitSolver<N, Real>::SumOverParticles(Function const& function)
+{
+    int const numParticles = static_cast<int>(mAdjacentOffset.size()) - 1;
+    std::fill(mThreadSums.begin(), mThreadSums.end(), 0.0);
+    ParallelFor(mNumThreads, numParticles, [this, &function](unsigned int t, int imin, int imax)
+    {
+        double sum = 0.0;
+        for (int i = imin; i < imax; ++i)
+        {
+            sum += function(t, i);
+        }
+        mThreadSums[t] = sum;
+    });
+
+    double sum = 0.0;
+    for (auto const& threadSum : mThreadSums)
+    {
+        sum += threadSum;
+    }
+    return sum;
+}
+
+template <int N, typename Real>
+double MassSpringImplicitSolver<N, Real>::GetRSqrLength() const
+{
+    double sum = 0.0;
+    for (auto const& sqrLength : mRSqrLengths)
+    {
+        sum += sqrLength;
+    }
+    return sum;
+}
+
+template <int N, typename Real>
+void MassSpringImplicitSolver<N, Real>::Multiply(std::vector<Vector<N, Real>> const& x,
+    std::vector<Vector<N, Real>>& y)
+{
+    // The rows of the immovable particles are zero, and x is zero at those
+    // particles, so their columns do not contribute.
+    int const numParticles = static_cast<int>(mAdjacentOffset.size()) - 1;
+    ParallelFor(mNumThreads, numParticles, [this, &x, &y](unsigned int, int imin, int imax)
+    {
+        for (int i = imin; i < imax; ++i)
+        {
+            if (mInvDiagonal[i][0] == (Real)0)
+            {
+                y[i].MakeZero();
+                continue;
+            }
+
+            Vector<N, Real> offDiagonal = Vector<N, Real>::Zero();
+            for (int k = mAdjacentOffset[i]; k < mAdjacentOffset[i + 1]; ++k)
+            {
+                offDiagonal += mSpringBlock[mAdjacentSpring[k]] * x[mAdjacentParticle[k]];
+            }
+            y[i] = mDiagonalBlock[i] * x[i] - mStepSqr * offDiagonal;
+        }
+    });
+}
+
+
+}
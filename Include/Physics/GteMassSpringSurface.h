@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <Physics/GteMassSpringImplicitSolver.h>
 #include <Physics/GteParticleSystem.h>
 
 namespace gte
@@ -26,7 +27,8 @@ public:
     // masses are arranged in row-major order:  position[c+C*r] = X[r][c]
     // for 0 <= r < R and 0 <= c < C.  The other arrays are stored similarly.
     virtual ~MassSpringSurface();
-    MassSpringSurface(int numRows, int numCols, Real step);
+    MassSpringSurface(int numRows, int numCols, Real step,
+        unsigned int numThreads = 1);
 
     // Member access.
     inline int GetNumRows() const;
@@ -61,6 +63,21 @@ public:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity);
 
+    // The batch version of ExternalAcceleration(...); see the comments for
+    // Accelerations(...) in ParticleSystem.
+    virtual void ExternalAccelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration);
+
+    // Implicit integration; see the comments in
+    // GteMassSpringImplicitSolver.h.
+    void SetImplicit(bool implicit);
+    inline bool GetImplicit() const;
+    inline MassSpringImplicitSolver<N, Real>& GetImplicitSolver();
+
+    virtual void Update(Real time) override;
+
 protected:
     // Callback for acceleration (ODE solver uses x" = F/m) applied to
     // particle i.  The positions and velocities are not necessarily
@@ -70,12 +87,32 @@ protected:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity);
 
+    // The batch callback, which calls ExternalAccelerations(...) once and
+    // then adds the spring impulses without virtual calls.
+    virtual void Accelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration) override;
+
+    // Add the spring impulses on particle i at (r, c) to its acceleration.
+    inline void AddSpringAcceleration(int i, int r, int c,
+        std::vector<Vector<N, Real>> const& position,
+        Vector<N, Real>& acceleration) const;
+
     inline int GetIndex(int r, int c) const;
     void GetCoordinates(int i, int& r, int& c) const;
 
     int mNumRows, mNumCols;
     std::vector<Real> mConstantR, mLengthR;
     std::vector<Real> mConstantC, mLengthC;
+
+    // Implicit integration.  The springs with nonzero constants are copied
+    // to the solver when they change.
+    void SetImplicitSprings();
+
+    bool mImplicit, mSpringsModified;
+    MassSpringImplicitSolver<N, Real> mImplicitSolver;
+    std::vector<Vector<N, Real>> mExternalAcceleration;
 };
 
 
@@ -86,15 +123,19 @@ MassSpringSurface<N, Real>::~MassSpringSurface()
 
 template <int N, typename Real>
 MassSpringSurface<N, Real>::MassSpringSurface(int numRows, int numCols,
-    Real step)
+    Real step, unsigned int numThreads)
     :
-    ParticleSystem<N, Real>(numRows * numCols, step),
+    ParticleSystem<N, Real>(numRows * numCols, step, numThreads),
     mNumRows(numRows),
     mNumCols(numCols),
     mConstantR(numRows * numCols),
     mLengthR(numRows * numCols),
     mConstantC(numRows * numCols),
-    mLengthC(numRows * numCols)
+    mLengthC(numRows * numCols),
+    mImplicit(false),
+    mSpringsModified(true),
+    mImplicitSolver(numThreads),
+    mExternalAcceleration(numRows * numCols)
 {
     std::fill(mConstantR.begin(), mConstantR.end(), (Real)0);
     std::fill(mLengthR.begin(), mLengthR.end(), (Real)0);
@@ -158,24 +199,28 @@ template <int N, typename Real> inline
 void MassSpringSurface<N, Real>::SetConstantR(int r, int c, Real constant)
 {
     mConstantR[GetIndex(r, c)] = constant;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
 void MassSpringSurface<N, Real>::SetLengthR(int r, int c, Real length)
 {
     mLengthR[GetIndex(r, c)] = length;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
 void MassSpringSurface<N, Real>::SetConstantC(int r, int c, Real constant)
 {
     mConstantC[GetIndex(r, c)] = constant;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
 void MassSpringSurface<N, Real>::SetLengthC(int r, int c, Real length)
 {
     mLengthC[GetIndex(r, c)] = length;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
@@ -209,6 +254,18 @@ Vector<N, Real> MassSpringSurface<N, Real>::ExternalAcceleration(int, Real,
     return Vector<N, Real>::Zero();
 }
 
+template <int N, typename Real>
+void MassSpringSurface<N, Real>::ExternalAccelerations(int imin, int imax,
+    Real time, std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    for (int i = imin; i < imax; ++i)
+    {
+        acceleration[i] = ExternalAcceleration(i, time, position, velocity);
+    }
+}
+
 template <int N, typename Real>
 Vector<N, Real> MassSpringSurface<N, Real>::Acceleration(int i, Real time,
     std::vector<Vector<N, Real>> const& position,
@@ -223,18 +280,50 @@ Vector<N, Real> MassSpringSurface<N, Real>::Acceleration(int i, Real time,
     Vector<N, Real> acceleration = ExternalAcceleration(i, time, position,
         velocity);
 
+    int r, c;
+    GetCoordinates(i, r, c);
+    AddSpringAcceleration(i, r, c, position, acceleration);
+    return acceleration;
+}
+
+template <int N, typename Real>
+void MassSpringSurface<N, Real>::Accelerations(int imin, int imax, Real time,
+    std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    ExternalAccelerations(imin, imax, time, position, velocity, acceleration);
+
+    // The coordinates of the particles are incremented rather than computed
+    // from the indices.
+    int r, c;
+    GetCoordinates(imin, r, c);
+    for (int i = imin; i < imax; ++i)
+    {
+        AddSpringAcceleration(i, r, c, position, acceleration[i]);
+        if (++c == mNumCols)
+        {
+            c = 0;
+            ++r;
+        }
+    }
+}
+
+template <int N, typename Real> inline
+void MassSpringSurface<N, Real>::AddSpringAcceleration(int i, int r, int c,
+    std::vector<Vector<N, Real>> const& position,
+    Vector<N, Real>& acceleration) const
+{
     Vector<N, Real> diff, force;
     Real ratio;
-
-    int r, c, prev, next;
-    GetCoordinates(i, r, c);
+    int prev, next;
 
     if (r > 0)
     {
         prev = i - mNumCols;  // index to previous row-neighbor
         diff = position[prev] - position[i];
-        ratio = GetLengthR(r - 1, c) / Length(diff);
-        force = GetConstantR(r - 1, c) * ((Real)1 - ratio) * diff;
+        ratio = mLengthR[prev] / Length(diff);
+        force = mConstantR[prev] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
 
@@ -242,8 +331,8 @@ Vector<N, Real> MassSpringSurface<N, Real>::Acceleration(int i, Real time,
     {
         next = i + mNumCols;  // index to next row-neighbor
         diff = position[next] - position[i];
-        ratio = GetLengthR(r, c) / Length(diff);
-        force = GetConstantR(r, c) * ((Real)1 - ratio) * diff;
+        ratio = mLengthR[i] / Length(diff);
+        force = mConstantR[i] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
 
@@ -251,8 +340,8 @@ Vector<N, Real> MassSpringSurface<N, Real>::Acceleration(int i, Real time,
     {
         prev = i - 1;  // index to previous col-neighbor
         diff = position[prev] - position[i];
-        ratio = GetLengthC(r, c - 1) / Length(diff);
-        force = GetConstantC(r, c - 1) * ((Real)1 - ratio) * diff;
+        ratio = mLengthC[prev] / Length(diff);
+        force = mConstantC[prev] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
 
@@ -260,12 +349,74 @@ Vector<N, Real> MassSpringSurface<N, Real>::Acceleration(int i, Real time,
     {
         next = i + 1;  // index to next col-neighbor
         diff = position[next] - position[i];
-        ratio = GetLengthC(r, c) / Length(diff);
-        force = GetConstantC(r, c) * ((Real)1 - ratio) * diff;
+        ratio = mLengthC[i] / Length(diff);
+        force = mConstantC[i] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
+}
 
-    return acceleration;
+template <int N, typename Real>
+void MassSpringSurface<N, Real>::SetImplicit(bool implicit)
+{
+    mImplicit = implicit;
+    mSpringsModified = true;
+}
+
+template <int N, typename Real> inline
+bool MassSpringSurface<N, Real>::GetImplicit() const
+{
+    return mImplicit;
+}
+
+template <int N, typename Real> inline
+MassSpringImplicitSolver<N, Real>& MassSpringSurface<N, Real>::GetImplicitSolver()
+{
+    return mImplicitSolver;
+}
+
+template <int N, typename Real>
+void MassSpringSurface<N, Real>::Update(Real time)
+{
+    if (!mImplicit)
+    {
+        ParticleSystem<N, Real>::Update(time);
+        return;
+    }
+
+    if (mSpringsModified)
+    {
+        SetImplicitSprings();
+        mSpringsModified = false;
+    }
+
+    ParallelFor(this->mNumThreads, this->mNumParticles, [this, time](unsigned int, int imin, int imax)
+    {
+        ExternalAccelerations(imin, imax, time, this->mPosition, this->mVelocity,
+            mExternalAcceleration);
+    });
+    mImplicitSolver.Update(this->mStep, this->mMass, this->mInvMass,
+        mExternalAcceleration, this->mPosition, this->mVelocity);
+}
+
+template <int N, typename Real>
+void MassSpringSurface<N, Real>::SetImplicitSprings()
+{
+    std::vector<typename MassSpringImplicitSolver<N, Real>::Spring> springs;
+    for (int r = 0, i = 0; r < mNumRows; ++r)
+    {
+        for (int c = 0; c < mNumCols; ++c, ++i)
+        {
+            if (r < mNumRows - 1 && mConstantR[i] != (Real)0)
+            {
+                springs.push_back({ i, i + mNumCols, mConstantR[i], mLengthR[i] });
+            }
+            if (c < mNumCols - 1 && mConstantC[i] != (Real)0)
+            {
+                springs.push_back({ i, i + 1, mConstantC[i], mLengthC[i] });
+            }
+        }
+    }
+    mImplicitSolver.SetSprings(this->mNumParticles, springs);
 }
 
 template <int N, typename Real> inline
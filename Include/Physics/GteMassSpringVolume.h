@@ -3,10 +3,11 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/16)
 
 #pragma once
 
+#include <Physics/GteMassSpringImplicitSolver.h>
 #include <Physics/GteParticleSystem.h>
 
 namespace gte
@@ -28,7 +29,8 @@ public:
     // position[c+C*(r+R*s)] = X[s][r][c] for 0 <= s < S, 0 <= r < R, and
     // 0 <= c < C.  The other arrays are stored similarly.
     virtual ~MassSpringVolume();
-    MassSpringVolume(int numSlices, int numRows, int numCols, Real step);
+    MassSpringVolume(int numSlices, int numRows, int numCols, Real step,
+        unsigned int numThreads = 1);
 
     // Member access.
     inline int GetNumSlices() const;
@@ -77,6 +79,21 @@ public:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity);
 
+    // The batch version of ExternalAcceleration(...); see the comments for
+    // Accelerations(...) in ParticleSystem.
+    virtual void ExternalAccelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration);
+
+    // Implicit integration; see the comments in
+    // GteMassSpringImplicitSolver.h.
+    void SetImplicit(bool implicit);
+    inline bool GetImplicit() const;
+    inline MassSpringImplicitSolver<N, Real>& GetImplicitSolver();
+
+    virtual void Update(Real time) override;
+
 protected:
     // Callback for acceleration (ODE solver uses x" = F/m) applied to
     // particle i.  The positions and velocities are not necessarily
@@ -86,6 +103,18 @@ protected:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity);
 
+    // The batch callback, which calls ExternalAccelerations(...) once and
+    // then adds the spring impulses without virtual calls.
+    virtual void Accelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration) override;
+
+    // Add the spring impulses on particle i at (s, r, c) to its acceleration.
+    inline void AddSpringAcceleration(int i, int s, int r, int c,
+        std::vector<Vector<N, Real>> const& position,
+        Vector<N, Real>& acceleration) const;
+
     inline int GetIndex(int s, int r, int c) const;
     void GetCoordinates(int i, int& s, int& r, int& c) const;
 
@@ -93,6 +122,14 @@ protected:
     std::vector<Real> mConstantS, mLengthS;
     std::vector<Real> mConstantR, mLengthR;
     std::vector<Real> mConstantC, mLengthC;
+
+    // Implicit integration.  The springs with nonzero constants are copied
+    // to the solver when they change.
+    void SetImplicitSprings();
+
+    bool mImplicit, mSpringsModified;
+    MassSpringImplicitSolver<N, Real> mImplicitSolver;
+    std::vector<Vector<N, Real>> mExternalAcceleration;
 };
 
 
@@ -103,9 +140,9 @@ MassSpringVolume<N, Real>::~MassSpringVolume()
 
 template <int N, typename Real>
 MassSpringVolume<N, Real>::MassSpringVolume(int numSlices, int numRows,
-    int numCols, Real step)
+    int numCols, Real step, unsigned int numThreads)
     :
-    ParticleSystem<N, Real>(numSlices * numRows * numCols, step),
+    ParticleSystem<N, Real>(numSlices * numRows * numCols, step, numThreads),
     mNumSlices(numSlices),
     mNumRows(numRows),
     mNumCols(numCols),
@@ -114,7 +151,11 @@ MassSpringVolume<N, Real>::MassSpringVolume(int numSlices, int numRows,
     mConstantR(numSlices * numRows * numCols),
     mLengthR(numSlices * numRows * numCols),
     mConstantC(numSlices * numRows * numCols),
-    mLengthC(numSlices * numRows * numCols)
+    mLengthC(numSlices * numRows * numCols),
+    mImplicit(false),
+    mSpringsModified(true),
+    mImplicitSolver(numThreads),
+    mExternalAcceleration(numSlices * numRows * numCols)
 {
     std::fill(mConstantS.begin(), mConstantS.end(), (Real)0);
     std::fill(mLengthS.begin(), mLengthS.end(), (Real)0);
@@ -187,12 +228,14 @@ void MassSpringVolume<N, Real>::SetConstantS(int s, int r, int c,
 Real constant)
 {
     mConstantS[GetIndex(s, r, c)] = constant;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
 void MassSpringVolume<N, Real>::SetLengthS(int s, int r, int c, Real length)
 {
     mLengthS[GetIndex(s, r, c)] = length;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
@@ -200,12 +243,14 @@ void MassSpringVolume<N, Real>::SetConstantR(int s, int r, int c,
 Real constant)
 {
     mConstantR[GetIndex(s, r, c)] = constant;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
 void MassSpringVolume<N, Real>::SetLengthR(int s, int r, int c, Real length)
 {
     mLengthR[GetIndex(s, r, c)] = length;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
@@ -213,12 +258,14 @@ void MassSpringVolume<N, Real>::SetConstantC(int s, int r, int c,
 Real constant)
 {
     mConstantC[GetIndex(s, r, c)] = constant;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
 void MassSpringVolume<N, Real>::SetLengthC(int s, int r, int c, Real length)
 {
     mLengthC[GetIndex(s, r, c)] = length;
+    mSpringsModified = true;
 }
 
 template <int N, typename Real> inline
@@ -264,6 +311,18 @@ Vector<N, Real> MassSpringVolume<N, Real>::ExternalAcceleration(int, Real,
     return Vector<N, Real>::Zero();
 }
 
+template <int N, typename Real>
+void MassSpringVolume<N, Real>::ExternalAccelerations(int imin, int imax,
+    Real time, std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    for (int i = imin; i < imax; ++i)
+    {
+        acceleration[i] = ExternalAcceleration(i, time, position, velocity);
+    }
+}
+
 template <int N, typename Real>
 Vector<N, Real> MassSpringVolume<N, Real>::Acceleration(int i, Real time,
     std::vector<Vector<N, Real>> const& position,
@@ -278,18 +337,54 @@ Vector<N, Real> MassSpringVolume<N, Real>::Acceleration(int i, Real time,
     Vector<N, Real> acceleration = ExternalAcceleration(i, time, position,
         velocity);
 
+    int s, r, c;
+    GetCoordinates(i, s, r, c);
+    AddSpringAcceleration(i, s, r, c, position, acceleration);
+    return acceleration;
+}
+
+template <int N, typename Real>
+void MassSpringVolume<N, Real>::Accelerations(int imin, int imax, Real time,
+    std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    ExternalAccelerations(imin, imax, time, position, velocity, acceleration);
+
+    // The coordinates of the particles are incremented rather than computed
+    // from the indices.
+    int s, r, c;
+    GetCoordinates(imin, s, r, c);
+    for (int i = imin; i < imax; ++i)
+    {
+        AddSpringAcceleration(i, s, r, c, position, acceleration[i]);
+        if (++c == mNumCols)
+        {
+            c = 0;
+            if (++r == mNumRows)
+            {
+                r = 0;
+                ++s;
+            }
+        }
+    }
+}
+
+template <int N, typename Real> inline
+void MassSpringVolume<N, Real>::AddSpringAcceleration(int i, int s, int r, int c,
+    std::vector<Vector<N, Real>> const& position,
+    Vector<N, Real>& acceleration) const
+{
     Vector<N, Real> diff, force;
     Real ratio;
-
-    int s, r, c, prev, next;
-    GetCoordinates(i, s, r, c);
+    int prev, next;
 
     if (s > 0)
     {
         prev = i - mNumRows * mNumCols;  // index to previous s-neighbor
         diff = position[prev] - position[i];
-        ratio = GetLengthS(s - 1, r, c) / Length(diff);
-        force = GetConstantS(s - 1, r, c) * ((Real)1 - ratio) * diff;
+        ratio = mLengthS[prev] / Length(diff);
+        force = mConstantS[prev] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
 
@@ -297,8 +392,8 @@ Vector<N, Real> MassSpringVolume<N, Real>::Acceleration(int i, Real time,
     {
         next = i + mNumRows * mNumCols;  // index to next s-neighbor
         diff = position[next] - position[i];
-        ratio = GetLengthS(s, r, c) / Length(diff);
-        force = GetConstantS(s, r, c) * ((Real)1 - ratio) * diff;
+        ratio = mLengthS[i] / Length(diff);
+        force = mConstantS[i] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
 
@@ -306,8 +401,8 @@ Vector<N, Real> MassSpringVolume<N, Real>::Acceleration(int i, Real time,
     {
         prev = i - mNumCols;  // index to previous r-neighbor
         diff = position[prev] - position[i];
-        ratio = GetLengthR(s, r - 1, c) / Length(diff);
-        force = GetConstantR(s, r - 1, c) * ((Real)1 - ratio) * diff;
+        ratio = mLengthR[prev] / Length(diff);
+        force = mConstantR[prev] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
 
@@ -315,8 +410,8 @@ Vector<N, Real> MassSpringVolume<N, Real>::Acceleration(int i, Real time,
     {
         next = i + mNumCols;  // index to next r-neighbor
         diff = position[next] - position[i];
-        ratio = GetLengthR(s, r, c) / Length(diff);
-        force = GetConstantR(s, r, c) * ((Real)1 - ratio) * diff;
+        ratio = mLengthR[i] / Length(diff);
+        force = mConstantR[i] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
 
@@ -324,8 +419,8 @@ Vector<N, Real> MassSpringVolume<N, Real>::Acceleration(int i, Real time,
     {
         prev = i - 1;  // index to previous c-neighbor
         diff = position[prev] - position[i];
-        ratio = GetLengthC(s, r, c - 1) / Length(diff);
-        force = GetConstantC(s, r, c - 1) * ((Real)1 - ratio) * diff;
+        ratio = mLengthC[prev] / Length(diff);
+        force = mConstantC[prev] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
 
@@ -333,12 +428,82 @@ Vector<N, Real> MassSpringVolume<N, Real>::Acceleration(int i, Real time,
     {
         next = i + 1;  // index to next c-neighbor
         diff = position[next] - position[i];
-        ratio = GetLengthC(s, r, c) / Length(diff);
-        force = GetConstantC(s, r, c) * ((Real)1 - ratio) * diff;
+        ratio = mLengthC[i] / Length(diff);
+        force = mConstantC[i] * ((Real)1 - ratio) * diff;
         acceleration += this->mInvMass[i] * force;
     }
+}
 
-    return acceleration;
+template <int N, typename Real>
+void MassSpringVolume<N, Real>::SetImplicit(bool implicit)
+{
+    mImplicit = implicit;
+    mSpringsModified = true;
+}
+
+template <int N, typename Real> inline
+bool MassSpringVolume<N, Real>::GetImplicit() const
+{
+    return mImplicit;
+}
+
+template <int N, typename Real> inline
+MassSpringImplicitSolver<N, Real>& MassSpringVolume<N, Real>::GetImplicitSolver()
+{
+    return mImplicitSolver;
+}
+
+template <int N, typename Real>
+void MassSpringVolume<N, Real>::Update(Real time)
+{
+    if (!mImplicit)
+    {
+        ParticleSystem<N, Real>::Update(time);
+        return;
+    }
+
+    if (mSpringsModified)
+    {
+        SetImplicitSprings();
+        mSpringsModified = false;
+    }
+
+    ParallelFor(this->mNumThreads, this->mNumParticles, [this, time](unsigned int, int imin, int imax)
+    {
+        ExternalAccelerations(imin, imax, time, this->mPosition, this->mVelocity,
+            mExternalAcceleration);
+    });
+    mImplicitSolver.Update(this->mStep, this->mMass, this->mInvMass,
+        mExternalAcceleration, this->mPosition, this->mVelocity);
+}
+
+template <int N, typename Real>
+void MassSpringVolume<N, Real>::SetImplicitSprings()
+{
+    std::vector<typename MassSpringImplicitSolver<N, Real>::Spring> springs;
+    int const sliceSize = mNumRows * mNumCols;
+    for (int s = 0, i = 0; s < mNumSlices; ++s)
+    {
+        for (int r = 0; r < mNumRows; ++r)
+        {
+            for (int c = 0; c < mNumCols; ++c, ++i)
+            {
+                if (s < mNumSlices - 1 && mConstantS[i] != (Real)0)
+                {
+                    springs.push_back({ i, i + sliceSize, mConstantS[i], mLengthS[i] });
+                }
+                if (r < mNumRows - 1 && mConstantR[i] != (Real)0)
+                {
+                    springs.push_back({ i, i + mNumCols, mConstantR[i], mLengthR[i] });
+                }
+                if (c < mNumCols - 1 && mConstantC[i] != (Real)0)
+                {
+                    springs.push_back({ i, i + 1, mConstantC[i], mLengthC[i] });
+                }
+            }
+        }
+    }
+    mImplicitSolver.SetSprings(this->mNumParticles, springs);
 }
 
 template <int N, typename Real> inline
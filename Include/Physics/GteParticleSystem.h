@@ -3,10 +3,11 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/16)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteVector.h>
 #include <limits>
 #include <vector>
@@ -19,9 +20,12 @@ class ParticleSystem
 {
 public:
     // Construction and destruction.  If a particle is to be immovable, set
-    // its mass to std::numeric_limits<Real>::max().
+    // its mass to std::numeric_limits<Real>::max().  The stages of the
+    // Runge-Kutta solver are partitioned among the threads by particle
+    // ranges.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
     virtual ~ParticleSystem();
-    ParticleSystem(int numParticles, Real step);
+    ParticleSystem(int numParticles, Real step, unsigned int numThreads = 1);
 
     // Member access.
     inline int GetNumParticles() const;
@@ -35,9 +39,9 @@ public:
     inline Real GetStep() const;
 
     // Update the particle positions based on current time and particle state.
-    // The Acceleration(...) function is called in this update for each
-    // particle.  This function is virtual so that derived classes can perform
-    // pre-update and/or post-update semantics.
+    // The Accelerations(...) function is called in this update for each
+    // stage and each thread.  This function is virtual so that derived
+    // classes can perform pre-update and/or post-update semantics.
     virtual void Update(Real time);
 
 protected:
@@ -49,18 +53,42 @@ protected:
         std::vector<Vector<N, Real>> const& position,
         std::vector<Vector<N, Real>> const& velocity) = 0;
 
+    // Batch callback for the accelerations of the particles i with
+    // imin <= i < imax, stored in acceleration[i].  The solver calls this
+    // once per stage for the range of particles of each thread, so the
+    // calls must not modify state shared by the ranges.  The accelerations
+    // of immovable particles are ignored.  The default calls
+    // Acceleration(...) for each particle; derived classes override this to
+    // avoid a virtual call per particle.
+    //
+    // The mass-spring systems override this to call their virtual
+    // ExternalAccelerations(imin, imax, time, position, velocity,
+    // acceleration) once, which stores the impulses F/m of the external
+    // forces F in acceleration[i], and then add the spring impulses.  Their
+    // default ExternalAccelerations(...) calls ExternalAcceleration(i, ...)
+    // for each particle.  A derived class with a nonzero external force can
+    // override ExternalAccelerations(...) to avoid a virtual call per
+    // particle.  Like this function, it is called concurrently for disjoint
+    // ranges when the number of threads is larger than 1.
+    virtual void Accelerations(int imin, int imax, Real time,
+        std::vector<Vector<N, Real>> const& position,
+        std::vector<Vector<N, Real>> const& velocity,
+        std::vector<Vector<N, Real>>& acceleration);
+
     int mNumParticles;
     std::vector<Real> mMass, mInvMass;
     std::vector<Vector<N, Real>> mPosition, mVelocity;
     Real mStep, mHalfStep, mSixthStep;
+    unsigned int mNumThreads;
 
     // Temporary storage for the Runge-Kutta differential equation solver.
-    struct Temporary
-    {
-        Vector<N, Real> d1, d2, d3, d4;
-    };
-    std::vector<Vector<N, Real>> mPTmp, mVTmp;
-    std::vector<Temporary> mPAllTmp, mVAllTmp;
+    // The intermediate states are double buffered, because a stage reads
+    // the state of all particles while the threads write the next state of
+    // their particles.  The stage derivatives are kept in separate arrays:
+    // mVD1 is the first acceleration, mPD23 and mVD23 are the sums of the
+    // second and third derivatives, and mVD4 is the current acceleration.
+    std::vector<Vector<N, Real>> mPTmp[2], mVTmp[2];
+    std::vector<Vector<N, Real>> mVD1, mPD23, mVD23, mVD4;
 };
 
 
@@ -70,7 +98,8 @@ ParticleSystem<N, Real>::~ParticleSystem()
 }
 
 template <int N, typename Real> inline
-ParticleSystem<N, Real>::ParticleSystem(int numParticles, Real step)
+ParticleSystem<N, Real>::ParticleSystem(int numParticles, Real step,
+    unsigned int numThreads)
 :
 mNumParticles(numParticles),
 mMass(numParticles),
@@ -80,11 +109,18 @@ mVelocity(numParticles),
 mStep(step),
 mHalfStep(step / (Real)2),
 mSixthStep(step / (Real)6),
-mPTmp(numParticles),
-mVTmp(numParticles),
-mPAllTmp(numParticles),
-mVAllTmp(numParticles)
+mNumThreads(numThreads > 0 ? numThreads : 1),
+mVD1(numParticles),
+mPD23(numParticles),
+mVD23(numParticles),
+mVD4(numParticles)
 {
+    for (int j = 0; j < 2; ++j)
+    {
+        mPTmp[j].resize(numParticles);
+        mVTmp[j].resize(numParticles);
+    }
+
     std::fill(mMass.begin(), mMass.end(), (Real)0);
     std::fill(mInvMass.begin(), mInvMass.end(), (Real)0);
     std::fill(mPosition.begin(), mPosition.end(), Vector<N, Real>::Zero());
@@ -161,100 +197,101 @@ Real ParticleSystem<N, Real>::GetStep() const
 template <int N, typename Real>
 void ParticleSystem<N, Real>::Update(Real time)
 {
-    // Runge-Kutta fourth-order solver.
+    // Runge-Kutta fourth-order solver.  Each stage is a single pass over
+    // the particles: the accelerations of a range are computed in a batch
+    // and then the next intermediate state of the range is computed.
     Real halfTime = time + mHalfStep;
     Real fullTime = time + mStep;
 
-    // Compute the first step.
-    int i;
-    for (i = 0; i < mNumParticles; ++i)
+    // Compute the first step.  The position derivative is mVelocity.
+    ParallelFor(mNumThreads, mNumParticles, [this, time](unsigned int, int imin, int imax)
     {
-        if (mInvMass[i] >(Real)0)
+        Accelerations(imin, imax, time, mPosition, mVelocity, mVD1);
+        for (int i = imin; i < imax; ++i)
         {
-            mPAllTmp[i].d1 = mVelocity[i];
-            mVAllTmp[i].d1 = Acceleration(i, time, mPosition, mVelocity);
+            if (mInvMass[i] > (Real)0)
+            {
+                mPTmp[0][i] = mPosition[i] + mHalfStep * mVelocity[i];
+                mVTmp[0][i] = mVelocity[i] + mHalfStep * mVD1[i];
+            }
+            else
+            {
+                mPTmp[0][i] = mPosition[i];
+                mVTmp[0][i].MakeZero();
+            }
         }
-    }
-    for (i = 0; i < mNumParticles; ++i)
-    {
-        if (mInvMass[i] >(Real)0)
-        {
-            mPTmp[i] = mPosition[i] + mHalfStep * mPAllTmp[i].d1;
-            mVTmp[i] = mVelocity[i] + mHalfStep * mVAllTmp[i].d1;
-        }
-        else
-        {
-            mPTmp[i] = mPosition[i];
-            mVTmp[i].MakeZero();
-        }
-    }
+    });
 
     // Compute the second step.
-    for (i = 0; i < mNumParticles; ++i)
-    {
-        if (mInvMass[i] >(Real)0)
-        {
-            mPAllTmp[i].d2 = mVTmp[i];
-            mVAllTmp[i].d2 = Acceleration(i, halfTime, mPTmp, mVTmp);
-        }
-    }
-    for (i = 0; i < mNumParticles; ++i)
+    ParallelFor(mNumThreads, mNumParticles, [this, halfTime](unsigned int, int imin, int imax)
     {
-        if (mInvMass[i] >(Real)0)
+        Accelerations(imin, imax, halfTime, mPTmp[0], mVTmp[0], mVD23);
+        for (int i = imin; i < imax; ++i)
         {
-            mPTmp[i] = mPosition[i] + mHalfStep * mPAllTmp[i].d2;
-            mVTmp[i] = mVelocity[i] + mHalfStep * mVAllTmp[i].d2;
+            if (mInvMass[i] > (Real)0)
+            {
+                mPD23[i] = mVTmp[0][i];
+                mPTmp[1][i] = mPosition[i] + mHalfStep * mPD23[i];
+                mVTmp[1][i] = mVelocity[i] + mHalfStep * mVD23[i];
+            }
+            else
+            {
+                mPTmp[1][i] = mPosition[i];
+                mVTmp[1][i].MakeZero();
+            }
         }
-        else
-        {
-            mPTmp[i] = mPosition[i];
-            mVTmp[i].MakeZero();
-        }
-    }
+    });
 
     // Compute the third step.
-    for (i = 0; i < mNumParticles; ++i)
+    ParallelFor(mNumThreads, mNumParticles, [this, halfTime](unsigned int, int imin, int imax)
     {
-        if (mInvMass[i] >(Real)0)
-        {
-            mPAllTmp[i].d3 = mVTmp[i];
-            mVAllTmp[i].d3 = Acceleration(i, halfTime, mPTmp, mVTmp);
-        }
-    }
-    for (i = 0; i < mNumParticles; ++i)
-    {
-        if (mInvMass[i] >(Real)0)
-        {
-            mPTmp[i] = mPosition[i] + mStep * mPAllTmp[i].d3;
-            mVTmp[i] = mVelocity[i] + mStep * mVAllTmp[i].d3;
-        }
-        else
+        Accelerations(imin, imax, halfTime, mPTmp[1], mVTmp[1], mVD4);
+        for (int i = imin; i < imax; ++i)
         {
-            mPTmp[i] = mPosition[i];
-            mVTmp[i].MakeZero();
+            if (mInvMass[i] > (Real)0)
+            {
+                mPD23[i] += mVTmp[1][i];
+                mVD23[i] += mVD4[i];
+                mPTmp[0][i] = mPosition[i] + mStep * mVTmp[1][i];
+                mVTmp[0][i] = mVelocity[i] + mStep * mVD4[i];
+            }
+            else
+            {
+                mPTmp[0][i] = mPosition[i];
+                mVTmp[0][i].MakeZero();
+            }
         }
-    }
+    });
 
     // Compute the fourth step.
-    for (i = 0; i < mNumParticles; ++i)
+    ParallelFor(mNumThreads, mNumParticles, [this, fullTime](unsigned int, int imin, int imax)
     {
-        if (mInvMass[i] >(Real)0)
+        Accelerations(imin, imax, fullTime, mPTmp[0], mVTmp[0], mVD4);
+        for (int i = imin; i < imax; ++i)
         {
-            mPAllTmp[i].d4 = mVTmp[i];
-            mVAllTmp[i].d4 = Acceleration(i, fullTime, mPTmp, mVTmp);
+            if (mInvMass[i] > (Real)0)
+            {
+                mPosition[i] += mSixthStep * (mVelocity[i] +
+                    ((Real)2) * mPD23[i] + mVTmp[0][i]);
+
+                mVelocity[i] += mSixthStep * (mVD1[i] +
+                    ((Real)2) * mVD23[i] + mVD4[i]);
+            }
         }
-    }
-    for (i = 0; i < mNumParticles; ++i)
+    });
+}
+
+template <int N, typename Real>
+void ParticleSystem<N, Real>::Accelerations(int imin, int imax, Real time,
+    std::vector<Vector<N, Real>> const& position,
+    std::vector<Vector<N, Real>> const& velocity,
+    std::vector<Vector<N, Real>>& acceleration)
+{
+    for (int i = imin; i < imax; ++i)
     {
-        if (mInvMass[i] >(Real)0)
+        if (mInvMass[i] > (Real)0)
         {
-            mPosition[i] += mSixthStep * (mPAllTmp[i].d1 +
-                ((Real)2) * (mPAllTmp[i].d2 + mPAllTmp[i].d3) +
-                mPAllTmp[i].d4);
-
-            mVelocity[i] += mSixthStep * (mVAllTmp[i].d1 +
-                ((Real)2) * (mVAllTmp[i].d2 + mVAllTmp[i].d3) +
-                mVAllTmp[i].d4);
+            acceleration[i] = Acceleration(i, time, position, velocity);
         }
     }
 }
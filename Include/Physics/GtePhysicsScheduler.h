@@ -0,0 +1,191 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <GTEngineDEF.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A fixed-step scheduler for a physics pipeline, for example bounding boxes,
+// broad phase (BoxManager), narrow phase (the intersection queries),
+// contact resolution (LCPBatchSolver) and integration.  Each step runs the
+// stages in the order they were added.  A serial stage is a function that
+// is called once per step by the thread that calls Step or Advance.  A
+// parallel stage has numItems items, counted at the start of each step,
+// that are split into tasks of grainSize consecutive items; the last task
+// can have fewer items.  The tasks are executed by a pool of threads that
+// is created once by the constructor; the calling thread is one of them.
+//
+// The results do not depend on the number of threads when each task
+// writes only the data of its items and data owned by the task, which is
+// identified by the task index.  The partition into tasks depends only on
+// numItems and grainSize.  Results of a parallel stage that must be
+// combined, such as the contacts found by the tasks of a narrow phase, are
+// stored per task and combined in task order by a later serial stage.
+//
+// The wall-clock time of each stage is measured for every step.  The
+// timings report the microseconds of the last step, the maximum and the
+// total since the last ResetTimings.
+
+namespace gte
+{
+
+class GTE_IMPEXP PhysicsScheduler
+{
+public:
+    // A serial stage is called as F(time, step), where 'time' is the
+    // simulation time at the beginning of the step.  A parallel stage is
+    // called as F(time, step, task, imin, imax) for the items
+    // imin <= i < imax of the task.
+    typedef std::function<void(double, double)> SerialFunction;
+    typedef std::function<int()> CountFunction;
+    typedef std::function<void(double, double, int, int, int)>
+        ParallelFunction;
+
+    struct Timing
+    {
+        std::string name;
+        int64_t lastMicroseconds;
+        int64_t maxMicroseconds;
+        int64_t totalMicroseconds;
+    };
+
+    // Construction and destruction.  The step must be positive.  The number
+    // of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    ~PhysicsScheduler();
+    PhysicsScheduler(double step, unsigned int numThreads = 1);
+
+    // Disallow copying and assignment.
+    PhysicsScheduler(PhysicsScheduler const&) = delete;
+    PhysicsScheduler& operator=(PhysicsScheduler const&) = delete;
+
+    // Add a stage to the end of the pipeline.  The return value is the index
+    // of the stage, which is the index of its timing.  For a parallel stage,
+    // grainSize must be positive.
+    int AddSerialStage(std::string const& name,
+        SerialFunction const& function);
+    int AddParallelStage(std::string const& name, int grainSize,
+        CountFunction const& numItems, ParallelFunction const& function);
+
+    // The number of tasks of a parallel stage with numItems items and the
+    // specified grain size.  Use this to allocate the per-task data.
+    static int GetNumTasks(int numItems, int grainSize);
+
+    // Run one step of the pipeline.
+    void Step();
+
+    // Add the elapsed wall-clock time to the unsimulated time and run steps
+    // until less than one step of unsimulated time remains.  At most
+    // maxSteps steps are run; when that is not enough, the unsimulated
+    // time that remains is discarded except for its fraction of a step, so
+    // that a slow simulation runs slower than real time instead of falling
+    // farther behind.  The return value is the number of steps.
+    int Advance(double elapsed, int maxSteps = 4);
+
+    // Member access.  The simulation time is the number of steps times the
+    // step.  The interpolation factor is the unsimulated time divided by
+    // the step, which is in [0,1) after Advance; use it to blend the last
+    // two states for drawing.
+    inline double GetStep() const;
+    inline unsigned int GetNumThreads() const;
+    inline uint64_t GetNumSteps() const;
+    inline double GetTime() const;
+    inline double GetInterpolation() const;
+
+    // Timing of the stages, in the order they were added, and of the
+    // entire step, which includes the scheduling overhead.
+    inline std::vector<Timing> const& GetTimings() const;
+    inline Timing const& GetStepTiming() const;
+    void ResetTimings();
+
+private:
+    struct Stage
+    {
+        SerialFunction serial;
+        CountFunction numItems;
+        ParallelFunction parallel;
+        int grainSize;
+    };
+
+    static void UpdateTiming(Timing& timing, int64_t microseconds);
+
+    void RunParallel(Stage const& stage, double time);
+
+    // Execute tasks of the current parallel stage until there are none left.
+    void RunTasks();
+
+    // The main function of the worker threads.
+    void Work();
+
+    double mStep;
+    unsigned int mNumThreads;
+    uint64_t mNumSteps;
+    double mUnsimulated;
+    std::vector<Stage> mStages;
+    std::vector<Timing> mTimings;
+    Timing mStepTiming;
+
+    // The parallel stage that is executing.  A new stage is signaled by
+    // incrementing mGeneration; mNumBusy is the number of worker threads
+    // that have not finished it.
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mStart, mFinish;
+    uint64_t mGeneration;
+    unsigned int mNumBusy;
+    bool mExit;
+    Stage const* mCurrent;
+    double mCurrentTime;
+    int mNumItems, mNumTasks;
+    std::atomic<int> mNextTask;
+};
+
+inline double PhysicsScheduler::GetStep() const
+{
+    return mStep;
+}
+
+inline unsigned int PhysicsScheduler::GetNumThreads() const
+{
+    return mNumThreads;
+}
+
+inline uint64_t PhysicsScheduler::GetNumSteps() const
+{
+    return mNumSteps;
+}
+
+inline double PhysicsScheduler::GetTime() const
+{
+    return static_cast<double>(mNumSteps) * mStep;
+}
+
+inline double PhysicsScheduler::GetInterpolation() const
+{
+    return mUnsimulated / mStep;
+}
+
+inline std::vector<PhysicsScheduler::Timing> const&
+PhysicsScheduler::GetTimings() const
+{
+    return mTimings;
+}
+
+inline PhysicsScheduler::Timing const& PhysicsScheduler::GetStepTiming() const
+{
+    return mStepTiming;
+}
+
+}
@@ -0,0 +1,131 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <GTEngineDEF.h>
+#include <array>
+#include <vector>
+
+// Geometric multigrid solver for the Poisson equation of the pressure
+// projection in Fluid2CPU and Fluid3CPU.  The grid has the layout of the
+// fluid state, xSize*ySize*zSize cells with the cell (x,y,z) at index
+// x + xSize*(y + ySize*z), and zSize = 1 for a 2D grid.  The unknowns are
+// at the interior cells and the boundary cells are zero.  The equation at
+// an interior cell is
+//   (2*p - p[x-1] - p[x+1])/dx^2 + (2*p - p[y-1] - p[y+1])/dy^2
+//     + (2*p - p[z-1] - p[z+1])/dz^2 = f
+// which is the equation whose Jacobi iteration is Fluid3SolvePoisson, where
+// f is the divergence.
+//
+// The solver uses V-cycles.  The cells are treated as the nodes of a grid
+// whose boundary nodes are the boundary cells.  A coarse level consists of
+// every other node of its fine level, so the boundary nodes are shared by
+// all levels.  When a fine dimension has an odd number of intervals, the
+// last node is kept, so the last coarse interval is shorter; the equation
+// uses the nonuniform second difference at such nodes.  The smoother is
+// red-black Gauss-Seidel, the restriction is full weighting and the
+// prolongation is multilinear interpolation.  The coarsening stops when a
+// dimension has fewer than 3 interior nodes, and that level is solved by
+// Gauss-Seidel sweeps.  The rows of a level are partitioned among the
+// threads.
+
+namespace gte
+{
+
+class GTE_IMPEXP PoissonMultigrid
+{
+public:
+    // Construction.  Each of xSize, ySize and zSize (when not 1) must be at
+    // least 3.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    PoissonMultigrid(int xSize, int ySize, int zSize, float dx, float dy,
+        float dz, unsigned int numThreads = 1);
+
+    // Smoothing sweeps before and after the coarse-grid correction.  The
+    // defaults are 2 and 2.
+    void SetNumSmoothingSweeps(int numPreSweeps, int numPostSweeps);
+
+    // Run V-cycles on the initial guess p until the residual is at most
+    // tolerance times the initial residual or until maxCycles cycles are
+    // run.  The boundary cells of p must be zero.  The function returns the
+    // number of cycles.  When 'residuals' is not null, it is set to the
+    // residuals before the first cycle and after each cycle.
+    int Solve(float const* f, float* p, float tolerance, int maxCycles,
+        std::vector<float>* residuals = nullptr);
+
+    // The root-mean-square of the residual over the interior cells.
+    float GetResidual(float const* f, float const* p);
+
+    inline int GetNumLevels() const;
+
+private:
+    struct Axis
+    {
+        // The number of nodes, including the boundary nodes, and the range
+        // [imin,imax) of the interior nodes.  The z-axis of a 2D grid has
+        // the single node 0 and its coefficients are zero.
+        int size, imin, imax;
+
+        // The node positions in units of the spacing of level 0.
+        std::vector<int> position;
+
+        // The coefficients of u[i-1] and u[i+1] in the second difference.
+        std::vector<float> cMinus, cPlus;
+
+        // The transfers between this level and the next coarser level.
+        // Fine node i is interpolated from the coarse nodes pIndex[i] and
+        // coarse node j is the weighted average of the fine nodes
+        // rIndex[j].
+        std::vector<std::array<int, 2>> pIndex;
+        std::vector<std::array<float, 2>> pWeight;
+        std::vector<std::array<int, 3>> rIndex;
+        std::vector<std::array<float, 3>> rWeight;
+    };
+
+    struct Level
+    {
+        Axis axis[3];
+        int yStride, zStride;
+
+        // The unknowns, right-hand side and residual.  The arrays of
+        // level 0 for u and f are those passed to Solve.
+        float* u;
+        float const* f;
+        std::vector<float> uStorage, fStorage, r;
+    };
+
+    static void SetCoefficients(float delta, Axis& axis);
+    static void CreateCoarseAxis(Axis& fine, Axis& coarse);
+
+    // Partition the interior rows of a level among the threads, where
+    // function(t, y, z, i) is called by thread t with i the index of the
+    // cell (0,y,z).
+    template <typename Function>
+    void ForEachRow(Level const& level, Function const& function);
+
+    void Smooth(Level& level, int numSweeps);
+    double ComputeResidual(Level& level);
+    void Restrict(Level const& fine, Level& coarse);
+    void Prolong(Level const& coarse, Level& fine);
+    void VCycle(int l);
+
+    unsigned int mNumThreads;
+    int mNumPreSweeps, mNumPostSweeps;
+    int mNumCoarsestSweeps;
+    int mNumInterior;
+    std::vector<Level> mLevels;
+    std::vector<double> mThreadSums;
+};
+
+
+inline int PoissonMultigrid::GetNumLevels() const
+{
+    return static_cast<int>(mLevels.size());
+}
+
+}
@@ -3,11 +3,14 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/16)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteMatrix3x3.h>
+#include <algorithm>
+#include <vector>
 
 namespace gte
 {
@@ -28,22 +31,89 @@ void ComputeMassProperties(Vector3<Real> const* vertices, int numTriangles,
     int const* indices, bool bodyCoords, Real& mass, Vector3<Real>& center,
     Matrix3x3<Real>& inertia);
 
+// The same mass properties for large meshes.  The triangles are inserted
+// in chunks, so the mass properties can be computed while a mesh file is
+// still being read and without storing the entire mesh.  A chunk is either
+// an indexed triangle mesh whose indices refer to the vertices of that
+// chunk or an array of triangles, each triangle stored as three vertices.
+// The triangles of a chunk are partitioned among the threads.  The sums
+// are compensated (Kahan summation), which keeps the error of the sums
+// from growing with the number of triangles.  The compensation must not be
+// optimized away, so do not compile with -ffast-math or /fp:fast.  For a
+// fixed number of threads and fixed chunks, the results are reproducible.
+
+template <typename Real>
+class PolyhedralMassProperties
+{
+public:
+    // Construction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    PolyhedralMassProperties(unsigned int numThreads = 1);
+
+    // Discard the triangles inserted so far.
+    void Reset();
+
+    // Insert a chunk of triangles.  The first function takes an indexed
+    // chunk with numTriangles triples of indices into 'vertices'.  The
+    // second function takes 3*numTriangles vertices, the vertices of
+    // triangle t being triangles[3*t], triangles[3*t+1] and
+    // triangles[3*t+2].
+    void Insert(Vector3<Real> const* vertices, int numTriangles,
+        int const* indices);
+    void Insert(int numTriangles, Vector3<Real> const* triangles);
+
+    // The number of triangles inserted since construction or Reset.
+    inline size_t GetNumTriangles() const;
+
+    // The mass properties of the triangles inserted so far; the parameters
+    // are those of ComputeMassProperties.
+    void GetMassProperties(bool bodyCoords, Real& mass, Vector3<Real>& center,
+        Matrix3x3<Real>& inertia) const;
+
+private:
+    // A compensated sum of the 10 integrals.  The true sum is
+    // sum[i] - compensation[i].
+    struct Sum
+    {
+        void Reset();
+        inline void Add(int i, Real value);
+
+        Real sum[10], compensation[10];
+    };
+
+    template <typename GetVertices>
+    void InsertChunk(int numTriangles, GetVertices const& getVertices);
+
+    unsigned int mNumThreads;
+    std::vector<Sum> mThreadSum;
+    Sum mSum;
+    size_t mNumTriangles;
+};
+
+// Support for ComputeMassProperties and PolyhedralMassProperties.  Compute
+// the contributions of a triangle to the integrals, in the order 1, x, y,
+// z, x^2, y^2, z^2, xy, yz, zx, before the scaling by 1/6, 1/24, 1/60 or
+// 1/120.  Compute the mass properties from the sums of the contributions.
+template <typename Real>
+void ComputeMassTerms(Vector3<Real> const& v0, Vector3<Real> const& v1,
+    Vector3<Real> const& v2, Real term[10]);
+
+template <typename Real>
+void ComputeMassProperties(Real const sums[10], bool bodyCoords,
+    Real& mass, Vector3<Real>& center, Matrix3x3<Real>& inertia);
+
 
 template <typename Real>
 void ComputeMassProperties(Vector3<Real> const* vertices, int numTriangles,
     int const* indices, bool bodyCoords, Real& mass, Vector3<Real>& center,
     Matrix3x3<Real>& inertia)
 {
-    Real const oneDiv6 = (Real)(1.0 / 6.0);
-    Real const oneDiv24 = (Real)(1.0 / 24.0);
-    Real const oneDiv60 = (Real)(1.0 / 60.0);
-    Real const oneDiv120 = (Real)(1.0 / 120.0);
-
     // order:  1, x, y, z, x^2, y^2, z^2, xy, yz, zx
     Real integral[10] = { (Real)0.0, (Real)0.0, (Real)0.0, (Real)0.0,
         (Real)0.0, (Real)0.0, (Real)0.0, (Real)0.0, (Real)0.0, (Real)0.0 };
 
     int const* index = indices;
+    Real term[10];
     for (int i = 0; i < numTriangles; ++i)
     {
         // Get vertices of triangle i.
@@ -51,69 +121,223 @@ void ComputeMassProperties(Vector3<Real> const* vertices, int numTriangles,
         Vector3<Real> v1 = vertices[*index++];
         Vector3<Real> v2 = vertices[*index++];
 
-        // Get cross product of edges and normal vector.
-        Vector3<Real> V1mV0 = v1 - v0;
-        Vector3<Real> V2mV0 = v2 - v0;
-        Vector3<Real> N = Cross(V1mV0, V2mV0);
-
-        // Compute integral terms.
-        Real tmp0, tmp1, tmp2;
-        Real f1x, f2x, f3x, g0x, g1x, g2x;
-        tmp0 = v0[0] + v1[0];
-        f1x = tmp0 + v2[0];
-        tmp1 = v0[0] * v0[0];
-        tmp2 = tmp1 + v1[0] * tmp0;
-        f2x = tmp2 + v2[0] * f1x;
-        f3x = v0[0] * tmp1 + v1[0] * tmp2 + v2[0] * f2x;
-        g0x = f2x + v0[0] * (f1x + v0[0]);
-        g1x = f2x + v1[0] * (f1x + v1[0]);
-        g2x = f2x + v2[0] * (f1x + v2[0]);
-
-        Real f1y, f2y, f3y, g0y, g1y, g2y;
-        tmp0 = v0[1] + v1[1];
-        f1y = tmp0 + v2[1];
-        tmp1 = v0[1] * v0[1];
-        tmp2 = tmp1 + v1[1] * tmp0;
-        f2y = tmp2 + v2[1] * f1y;
-        f3y = v0[1] * tmp1 + v1[1] * tmp2 + v2[1] * f2y;
-        g0y = f2y + v0[1] * (f1y + v0[1]);
-        g1y = f2y + v1[1] * (f1y + v1[1]);
-        g2y = f2y + v2[1] * (f1y + v2[1]);
-
-        Real f1z, f2z, f3z, g0z, g1z, g2z;
-        tmp0 = v0[2] + v1[2];
-        f1z = tmp0 + v2[2];
-        tmp1 = v0[2] * v0[2];
-        tmp2 = tmp1 + v1[2] * tmp0;
-        f2z = tmp2 + v2[2] * f1z;
-        f3z = v0[2] * tmp1 + v1[2] * tmp2 + v2[2] * f2z;
-        g0z = f2z + v0[2] * (f1z + v0[2]);
-        g1z = f2z + v1[2] * (f1z + v1[2]);
-        g2z = f2z + v2[2] * (f1z + v2[2]);
-
         // Update integrals.
-        integral[0] += N[0] * f1x;
-        integral[1] += N[0] * f2x;
-        integral[2] += N[1] * f2y;
-        integral[3] += N[2] * f2z;
-        integral[4] += N[0] * f3x;
-        integral[5] += N[1] * f3y;
-        integral[6] += N[2] * f3z;
-        integral[7] += N[0] * (v0[1] * g0x + v1[1] * g1x + v2[1] * g2x);
-        integral[8] += N[1] * (v0[2] * g0y + v1[2] * g1y + v2[2] * g2y);
-        integral[9] += N[2] * (v0[0] * g0z + v1[0] * g1z + v2[0] * g2z);
+        ComputeMassTerms(v0, v1, v2, term);
+        for (int j = 0; j < 10; ++j)
+        {
+            integral[j] += term[j];
+        }
+    }
+
+    ComputeMassProperties(integral, bodyCoords, mass, center, inertia);
+}
+
+template <typename Real>
+PolyhedralMassProperties<Real>::PolyhedralMassProperties(
+    unsigned int numThreads)
+    :
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mThreadSum(numThreads > 0 ? numThreads : 1)
+{
+    Reset();
+}
+
+template <typename Real>
+void PolyhedralMassProperties<Real>::Reset()
+{
+    mSum.Reset();
+    mNumTriangles = 0;
+}
+
+template <typename Real>
+void PolyhedralMassProperties<Real>::Insert(Vector3<Real> const* vertices,
+    int numTriangles, int const* indices)
+{
+    InsertChunk(numTriangles, [vertices, indices](int i, Vector3<Real>& v0,
+        Vector3<Real>& v1, Vector3<Real>& v2)
+    {
+        int const* index = &indices[3 * static_cast<size_t>(i)];
+        v0 = vertices[index[0]];
+        v1 = vertices[index[1]];
+        v2 = vertices[index[2]];
+    });
+}
+
+template <typename Real>
+void PolyhedralMassProperties<Real>::Insert(int numTriangles,
+    Vector3<Real> const* triangles)
+{
+    InsertChunk(numTriangles, [triangles](int i, Vector3<Real>& v0,
+        Vector3<Real>& v1, Vector3<Real>& v2)
+    {
+        Vector3<Real> const* vertex = &triangles[3 * static_cast<size_t>(i)];
+        v0 = vertex[0];
+        v1 = vertex[1];
+        v2 = vertex[2];
+    });
+}
+
+template <typename Real> inline
+size_t PolyhedralMassProperties<Real>::GetNumTriangles() const
+{
+    return mNumTriangles;
+}
+
+template <typename Real>
+void PolyhedralMassProperties<Real>::GetMassProperties(bool bodyCoords,
+    Real& mass, Vector3<Real>& center, Matrix3x3<Real>& inertia) const
+{
+    Real integral[10];
+    for (int j = 0; j < 10; ++j)
+    {
+        integral[j] = mSum.sum[j] - mSum.compensation[j];
+    }
+    ComputeMassProperties(integral, bodyCoords, mass, center, inertia);
+}
+
+template <typename Real>
+void PolyhedralMassProperties<Real>::Sum::Reset()
+{
+    for (int j = 0; j < 10; ++j)
+    {
+        sum[j] = (Real)0;
+        compensation[j] = (Real)0;
+    }
+}
+
+template <typename Real> inline
+void PolyhedralMassProperties<Real>::Sum::Add(int i, Real value)
+{
+    Real y = value - compensation[i];
+    Real t = sum[i] + y;
+    compensation[i] = (t - sum[i]) - y;
+    sum[i] = t;
+}
+
+template <typename Real>
+template <typename GetVertices>
+void PolyhedralMassProperties<Real>::InsertChunk(int numTriangles,
+    GetVertices const& getVertices)
+{
+    // ParallelFor uses fewer threads for small chunks, so all thread sums
+    // are reset.  The sums are accumulated in a local object that the
+    // compiler can keep in registers.
+    for (auto& threadSum : mThreadSum)
+    {
+        threadSum.Reset();
     }
 
-    integral[0] *= oneDiv6;
-    integral[1] *= oneDiv24;
-    integral[2] *= oneDiv24;
-    integral[3] *= oneDiv24;
-    integral[4] *= oneDiv60;
-    integral[5] *= oneDiv60;
-    integral[6] *= oneDiv60;
-    integral[7] *= oneDiv120;
-    integral[8] *= oneDiv120;
-    integral[9] *= oneDiv120;
+    ParallelFor(mNumThreads, numTriangles,
+        [this, &getVertices](unsigned int t, int imin, int imax)
+    {
+        Sum threadSum;
+        threadSum.Reset();
+        Vector3<Real> v0, v1, v2;
+        Real term[10];
+        for (int i = imin; i < imax; ++i)
+        {
+            getVertices(i, v0, v1, v2);
+            ComputeMassTerms(v0, v1, v2, term);
+            for (int j = 0; j < 10; ++j)
+            {
+                threadSum.Add(j, term[j]);
+            }
+        }
+        mThreadSum[t] = threadSum;
+    });
+
+    // Merge the thread sums in a fixed order, including their
+    // compensations, so that the result does not depend on the timing of
+    // the threads.
+    for (auto const& threadSum : mThreadSum)
+    {
+        for (int j = 0; j < 10; ++j)
+        {
+            mSum.Add(j, threadSum.sum[j]);
+            mSum.Add(j, -threadSum.compensation[j]);
+        }
+    }
+    mNumTriangles += static_cast<size_t>(std::max(numTriangles, 0));
+}
+
+template <typename Real>
+void ComputeMassTerms(Vector3<Real> const& v0, Vector3<Real> const& v1,
+    Vector3<Real> const& v2, Real term[10])
+{
+    // Get cross product of edges and normal vector.
+    Vector3<Real> V1mV0 = v1 - v0;
+    Vector3<Real> V2mV0 = v2 - v0;
+    Vector3<Real> N = Cross(V1mV0, V2mV0);
+
+    // Compute integral terms.
+    Real tmp0, tmp1, tmp2;
+    Real f1x, f2x, f3x, g0x, g1x, g2x;
+    tmp0 = v0[0] + v1[0];
+    f1x = tmp0 + v2[0];
+    tmp1 = v0[0] * v0[0];
+    tmp2 = tmp1 + v1[0] * tmp0;
+    f2x = tmp2 + v2[0] * f1x;
+    f3x = v0[0] * tmp1 + v1[0] * tmp2 + v2[0] * f2x;
+    g0x = f2x + v0[0] * (f1x + v0[0]);
+    g1x = f2x + v1[0] * (f1x + v1[0]);
+    g2x = f2x + v2[0] * (f1x + v2[0]);
+
+    Real f1y, f2y, f3y, g0y, g1y, g2y;
+    tmp0 = v0[1] + v1[1];
+    f1y = tmp0 + v2[1];
+    tmp1 = v0[1] * v0[1];
+    tmp2 = tmp1 + v1[1] * tmp0;
+    f2y = tmp2 + v2[1] * f1y;
+    f3y = v0[1] * tmp1 + v1[1] * tmp2 + v2[1] * f2y;
+    g0y = f2y + v0[1] * (f1y + v0[1]);
+    g1y = f2y + v1[1] * (f1y + v1[1]);
+    g2y = f2y + v2[1] * (f1y + v2[1]);
+
+    Real f1z, f2z, f3z, g0z, g1z, g2z;
+    tmp0 = v0[2] + v1[2];
+    f1z = tmp0 + v2[2];
+    tmp1 = v0[2] * v0[2];
+    tmp2 = tmp1 + v1[2] * tmp0;
+    f2z = tmp2 + v2[2] * f1z;
+    f3z = v0[2] * tmp1 + v1[2] * tmp2 + v2[2] * f2z;
+    g0z = f2z + v0[2] * (f1z + v0[2]);
+    g1z = f2z + v1[2] * (f1z + v1[2]);
+    g2z = f2z + v2[2] * (f1z + v2[2]);
+
+    // Compute the contributions to the integrals.
+    term[0] = N[0] * f1x;
+    term[1] = N[0] * f2x;
+    term[2] = N[1] * f2y;
+    term[3] = N[2] * f2z;
+    term[4] = N[0] * f3x;
+    term[5] = N[1] * f3y;
+    term[6] = N[2] * f3z;
+    term[7] = N[0] * (v0[1] * g0x + v1[1] * g1x + v2[1] * g2x);
+    term[8] = N[1] * (v0[2] * g0y + v1[2] * g1y + v2[2] * g2y);
+    term[9] = N[2] * (v0[0] * g0z + v1[0] * g1z + v2[0] * g2z);
+}
+
+template <typename Real>
+void ComputeMassProperties(Real const sums[10], bool bodyCoords,
+    Real& mass, Vector3<Real>& center, Matrix3x3<Real>& inertia)
+{
+    Real const oneDiv6 = (Real)(1.0 / 6.0);
+    Real const oneDiv24 = (Real)(1.0 / 24.0);
+    Real const oneDiv60 = (Real)(1.0 / 60.0);
+    Real const oneDiv120 = (Real)(1.0 / 120.0);
+
+    // order:  1, x, y, z, x^2, y^2, z^2, xy, yz, zx
+    Real integral[10];
+    integral[0] = sums[0] * oneDiv6;
+    integral[1] = sums[1] * oneDiv24;
+    integral[2] = sums[2] * oneDiv24;
+    integral[3] = sums[3] * oneDiv24;
+    integral[4] = sums[4] * oneDiv60;
+    integral[5] = sums[5] * oneDiv60;
+    integral[6] = sums[6] * oneDiv60;
+    integral[7] = sums[7] * oneDiv120;
+    integral[8] = sums[8] * oneDiv120;
+    integral[9] = sums[9] * oneDiv120;
 
     // mass
     mass = integral[0];
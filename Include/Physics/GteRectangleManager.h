@@ -3,16 +3,37 @@
 // Distributed under the Boost Software License, Version 1.0.
 // http://www.boost.org/LICENSE_1_0.txt
 // http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
-// File Version: 3.0.0 (2016/06/19)
+// File Version: 3.0.1 (2019/09/12)
 
 #pragma once
 
+#include <LowLevel/GteParallelFor.h>
 #include <Mathematics/GteIntrAlignedBox2AlignedBox2.h>
 #include <Mathematics/GteEdgeKey.h>
 #include <algorithm>
+#include <array>
 #include <set>
 #include <vector>
 
+// The overlapping pairs of a set of axis-aligned rectangles are computed by
+// a sort-and-sweep.  The sweep axis is the one for which the rectangle
+// centers have the largest variance.  The rectangles are stored in a
+// contiguous array sorted by their minimum on the sweep axis.  For coherent
+// motion, the array is nearly sorted from the previous update and an
+// insertion sort is fast.  For incoherent motion, the insertion sort is
+// abandoned in favor of std::sort when the number of element moves becomes
+// large.
+//
+// The sweep is done per band of a uniform partition of the other axis, with
+// bands about twice the mean rectangle size, so the number of pairs tested
+// is proportional to the number of rectangles times their density rather
+// than O(N^{3/2}) for N rectangles spread over an area.  This is the 2D
+// counterpart of the grid of BoxManager.  A pair of rectangles that share
+// several bands is reported only by the band that contains the minimum of
+// their intersection.  The bands are partitioned among the threads, each
+// thread generating pairs into its own array, and the results are merged
+// into a sorted array of pairs.
+
 namespace gte
 {
 
@@ -20,8 +41,10 @@ template <typename Real>
 class RectangleManager
 {
 public:
-    // Construction.
-    RectangleManager(std::vector<AlignedBox2<Real>>& rectangles);
+    // Construction.  The number of threads should satisfy
+    // 1 <= numThreads <= std::thread::hardware_concurrency().
+    RectangleManager(std::vector<AlignedBox2<Real>>& rectangles,
+        unsigned int numThreads = 1);
 
     // No default construction, copy construction, or assignment are allowed.
     RectangleManager() = delete;
@@ -36,56 +59,89 @@ public:
     void Initialize();
 
     // After the system is initialized, you can move the rectangles using this
-    // function.  It is not enough to modify the input array of rectangles
-    // since the endpoint values stored internally by this class must also
-    // change.  You can also retrieve the current rectangles information.
+    // function.  You can also retrieve the current rectangle information.
     void SetRectangle(int i, AlignedBox2<Real> const& rectangle);
     void GetRectangle(int i, AlignedBox2<Real>& rectangle) const;
-    
+
     // When you are finished moving rectangles, call this function to
-    // determine the overlapping rectangles.  An incremental update is applied
-    // to determine the new set of overlapping rectangles.
+    // determine the overlapping rectangles.  The sorted order of the
+    // previous call is used as the starting point for the sort of the
+    // current call.
     void Update();
 
     // If (i,j) is in the overlap set, then rectangle i and rectangle j are
     // overlapping.  The indices are those for the the input array.  The
     // set elements (i,j) are stored so that i < j.
-    std::set<EdgeKey<false>> const& GetOverlap() const;
+    inline std::set<EdgeKey<false>> const& GetOverlap() const;
+
+    // The overlapping pairs of GetOverlap() stored in an array in the order
+    // of EdgeKey<false>::operator<, which is the iteration order of the
+    // set.  Use it when the pairs are only iterated or are partitioned
+    // among threads by index.
+    inline std::vector<EdgeKey<false>> const& GetOverlapArray() const;
+
+    // The axis used by the sweep of the last update.
+    inline int GetSweepAxis() const;
 
 private:
-    class Endpoint
+    // The rectangles sorted by min[mAxis].  The rectangle bounds are copied
+    // so that the sweep accesses contiguous memory.
+    class SortedRectangle
     {
     public:
-        Real value; // endpoint value
-        int type;   // '0' if interval min, '1' if interval max.
-        int index;  // index of interval containing this endpoint
+        Real min[2], max[2];
+        int index;
+    };
 
-        // Support for sorting of endpoints.
-        bool operator<(Endpoint const& endpoint) const;
+    // A rectangle in the list of a band.  The bounds on the other axis and
+    // the band of the rectangle minimum are copied so that the sweep of a
+    // band accesses contiguous memory.
+    class BandRectangle
+    {
+    public:
+        Real min0, max0;
+        std::array<Real, 2> bounds;
+        int bandMin;
+        int index;
     };
 
-    void InsertionSort (std::vector<Endpoint>& endpoint, std::vector<int>& lookup);
+    void SelectAxis();
+    void InsertionSort();
+    void SelectBands();
+    void Sweep();
+    void UpdateOverlapSet();
+
+    inline int GetBand(Real value) const;
 
     std::vector<AlignedBox2<Real>>& mRectangles;
-    std::vector<Endpoint> mXEndpoints, mYEndpoints;
-    std::set<EdgeKey<false>> mOverlap;
-
-    // The intervals are indexed 0 <= i < n.  The endpoint array has 2*n
-    // entries.  The original 2*n interval values are ordered as b[0], e[0],
-    // b[1], e[1], ..., b[n-1], e[n-1].  When the endpoint array is sorted,
-    // the mapping between interval values and endpoints is lost.  In order
-    // to modify interval values that are stored in the endpoint array, we
-    // need to maintain the mapping.  This is done by the following lookup
-    // table of 2*n entries.  The value mLookup[2*i] is the index of b[i]
-    // in the endpoint array.  The value mLookup[2*i+1] is the index of
-    // e[i] in the endpoint array.
-    std::vector<int> mXLookup, mYLookup;
+    unsigned int mNumThreads;
+    int mAxis;
+    std::vector<SortedRectangle> mSorted;
+
+    // The bands on the axis 1-mAxis.
+    int mNumBands;
+    Real mBandOrigin, mBandScale;
+    std::vector<std::array<int, 2>> mRectangleBands;
+    std::vector<int> mBandStart;
+    std::vector<BandRectangle> mBandRectangles;
+
+    std::vector<std::vector<EdgeKey<false>>> mThreadOverlap;
+    std::vector<int> mOverlapStart;
+    std::vector<EdgeKey<false>> mOverlap;
+    std::set<EdgeKey<false>> mOverlapSet;
 };
 
 template <typename Real>
-RectangleManager<Real>::RectangleManager(std::vector<AlignedBox2<Real>>& rectangles)
+RectangleManager<Real>::RectangleManager(
+    std::vector<AlignedBox2<Real>>& rectangles, unsigned int numThreads)
     :
-    mRectangles(rectangles)
+    mRectangles(rectangles),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mAxis(-1),
+    mNumBands(1),
+    mBandOrigin((Real)0),
+    mBandScale((Real)0),
+    mThreadOverlap(mNumThreads)
 {
     Initialize();
 }
@@ -93,188 +149,350 @@ RectangleManager<Real>::RectangleManager(std::vector<AlignedBox2<Real>>& rectang
 template <typename Real>
 void RectangleManager<Real>::Initialize()
 {
-    // Get the rectangle endpoints.
-    int intrSize = static_cast<int>(mRectangles.size()), endpSize = 2 * intrSize;
-    mXEndpoints.resize(endpSize);
-    mYEndpoints.resize(endpSize);
-    for (int i = 0, j = 0; i < intrSize; ++i)
+    int const numRectangles = static_cast<int>(mRectangles.size());
+    mSorted.resize(numRectangles);
+    for (int i = 0; i < numRectangles; ++i)
     {
-        mXEndpoints[j].type = 0;
-        mXEndpoints[j].value = mRectangles[i].min[0];
-        mXEndpoints[j].index = i;
-        mYEndpoints[j].type = 0;
-        mYEndpoints[j].value = mRectangles[i].min[1];
-        mYEndpoints[j].index = i;
-        ++j;
-
-        mXEndpoints[j].type = 1;
-        mXEndpoints[j].value = mRectangles[i].max[0];
-        mXEndpoints[j].index = i;
-        mYEndpoints[j].type = 1;
-        mYEndpoints[j].value = mRectangles[i].max[1];
-        mYEndpoints[j].index = i;
-        ++j;
+        mSorted[i].index = i;
     }
 
-    // Sort the rectangle endpoints.
-    std::sort(mXEndpoints.begin(), mXEndpoints.end());
-    std::sort(mYEndpoints.begin(), mYEndpoints.end());
-
-    // Create the interval-to-endpoint lookup tables.
-    mXLookup.resize(endpSize);
-    mYLookup.resize(endpSize);
-    for (int j = 0; j < endpSize; ++j)
-    {
-        mXLookup[2 * mXEndpoints[j].index + mXEndpoints[j].type] = j;
-        mYLookup[2 * mYEndpoints[j].index + mYEndpoints[j].type] = j;
-    }
+    // Force a full sort in Update().
+    mAxis = -1;
+    Update();
+}
 
-    // Active set of rectangles (stored by index in array).
-    std::set<int> active;
+template <typename Real>
+void RectangleManager<Real>::SetRectangle(int i, AlignedBox2<Real> const& rectangle)
+{
+    mRectangles[i] = rectangle;
+}
 
-    // Set of overlapping rectangles (stored by pairs of indices in array).
-    mOverlap.clear();
+template <typename Real>
+void RectangleManager<Real>::GetRectangle(int i, AlignedBox2<Real>& rectangle) const
+{
+    rectangle = mRectangles[i];
+}
 
-    // Sweep through the endpoints to determine overlapping x-intervals.
-    for (int i = 0; i < endpSize; ++i)
+template <typename Real>
+void RectangleManager<Real>::Update()
+{
+    // Copy the current bounds to the sorted array, which is in the order of
+    // the previous update.
+    for (auto& sorted : mSorted)
     {
-        Endpoint& endpoint = mXEndpoints[i];
-        int index = endpoint.index;
-        if (endpoint.type == 0)  // an interval 'begin' value
-        {
-            // In the 1D problem, the current interval overlaps with all the
-            // active intervals.  In 2D we also need to check for y-overlap.
-            for (auto activeIndex : active)
-            {
-                // Rectangles activeIndex and index overlap in the
-                // x-dimension.  Test for overlap in the y-dimension.
-                AlignedBox2<Real> const& r0 = mRectangles[activeIndex];
-                AlignedBox2<Real> const& r1 = mRectangles[index];
-                if (r0.max[1] >= r1.min[1] && r0.min[1] <= r1.max[1])
-                {
-                    if (activeIndex < index)
-                    {
-                        mOverlap.insert(EdgeKey<false>(activeIndex, index));
-                    }
-                    else
-                    {
-                        mOverlap.insert(EdgeKey<false>(index, activeIndex));
-                    }
-                }
-            }
-            active.insert(index);
-        }
-        else  // an interval 'end' value
+        AlignedBox2<Real> const& rectangle = mRectangles[sorted.index];
+        for (int d = 0; d < 2; ++d)
         {
-            active.erase(index);
+            sorted.min[d] = rectangle.min[d];
+            sorted.max[d] = rectangle.max[d];
         }
     }
+
+    int const previousAxis = mAxis;
+    SelectAxis();
+    if (mAxis == previousAxis)
+    {
+        InsertionSort();
+    }
+    else
+    {
+        int const axis = mAxis;
+        std::sort(mSorted.begin(), mSorted.end(),
+            [axis](SortedRectangle const& r0, SortedRectangle const& r1)
+            {
+                return r0.min[axis] < r1.min[axis];
+            });
+    }
+
+    SelectBands();
+    Sweep();
+
+    UpdateOverlapSet();
 }
 
 template <typename Real>
-void RectangleManager<Real>::SetRectangle(int i, AlignedBox2<Real> const& rectangle)
+inline std::set<EdgeKey<false>> const& RectangleManager<Real>::GetOverlap() const
 {
-    mRectangles[i] = rectangle;
-    mXEndpoints[mXLookup[2 * i]].value = rectangle.min[0];
-    mXEndpoints[mXLookup[2 * i + 1]].value = rectangle.max[0];
-    mYEndpoints[mYLookup[2 * i]].value = rectangle.min[1];
-    mYEndpoints[mYLookup[2 * i + 1]].value = rectangle.max[1];
+    return mOverlapSet;
 }
 
 template <typename Real>
-void RectangleManager<Real>::GetRectangle(int i, AlignedBox2<Real>& rectangle) const
+inline std::vector<EdgeKey<false>> const& RectangleManager<Real>::GetOverlapArray() const
 {
-    rectangle = mRectangles[i];
+    return mOverlap;
 }
 
 template <typename Real>
-void RectangleManager<Real>::InsertionSort(std::vector<Endpoint>& endpoint, std::vector<int>& lookup)
+inline int RectangleManager<Real>::GetSweepAxis() const
 {
-    // Apply an insertion sort.  Under the assumption that the rectangles
-    // have not changed much since the last call, the endpoints are nearly
-    // sorted.  The insertion sort should be very fast in this case.
+    return mAxis;
+}
 
-    TIQuery<Real, AlignedBox2<Real>, AlignedBox2<Real>> query;
-    int endpSize = static_cast<int>(endpoint.size());
-    for (int j = 1; j < endpSize; ++j)
+template <typename Real>
+void RectangleManager<Real>::SelectAxis()
+{
+    int const numRectangles = static_cast<int>(mSorted.size());
+    if (numRectangles == 0)
     {
-        Endpoint key = endpoint[j];
-        int i = j - 1;
-        while (i >= 0 && key < endpoint[i])
+        mAxis = 0;
+        return;
+    }
+
+    // The centers are scaled by 2 to avoid the division; this does not
+    // change which variance is the largest.
+    Real mean[2] = { (Real)0, (Real)0 };
+    for (auto const& sorted : mSorted)
+    {
+        for (int d = 0; d < 2; ++d)
         {
-            Endpoint e0 = endpoint[i];
-            Endpoint e1 = endpoint[i + 1];
+            mean[d] += sorted.min[d] + sorted.max[d];
+        }
+    }
+    for (int d = 0; d < 2; ++d)
+    {
+        mean[d] /= static_cast<Real>(numRectangles);
+    }
 
-            // Update the overlap status.
-            if (e0.type == 0)
-            {
-                if (e1.type == 1)
-                {
-                    // The 'b' of interval E0.index was smaller than the 'e'
-                    // of interval E1.index, and the intervals *might have
-                    // been* overlapping.  Now 'b' and 'e' are swapped, and
-                    // the intervals cannot overlap.  Remove the pair from
-                    // the overlap set.  The removal operation needs to find
-                    // the pair and erase it if it exists.  Finding the pair
-                    // is the expensive part of the operation, so there is no
-                    // real time savings in testing for existence first, then
-                    // deleting if it does.
-                    mOverlap.erase(EdgeKey<false>(e0.index, e1.index));
-                }
-            }
-            else
-            {
-                if (e1.type == 0)
-                {
-                    // The 'b' of interval E1.index was larger than the 'e'
-                    // of interval E0.index, and the intervals were not
-                    // overlapping.  Now 'b' and 'e' are swapped, and the
-                    // intervals *might be* overlapping.  Determine if they
-                    // are overlapping and then insert.
-                    if (query(mRectangles[e0.index], mRectangles[e1.index]).intersect)
-                    {
-                        mOverlap.insert(EdgeKey<false>(e0.index, e1.index));
-                    }
-                }
-            }
+    Real variance[2] = { (Real)0, (Real)0 };
+    for (auto const& sorted : mSorted)
+    {
+        for (int d = 0; d < 2; ++d)
+        {
+            Real diff = sorted.min[d] + sorted.max[d] - mean[d];
+            variance[d] += diff * diff;
+        }
+    }
 
-            // Reorder the items to maintain the sorted list.
-            endpoint[i] = e1;
-            endpoint[i + 1] = e0;
-            lookup[2 * e1.index + e1.type] = i;
-            lookup[2 * e0.index + e0.type] = i + 1;
+    // Switching axes requires a full sort, so the current axis is kept
+    // unless another axis has a substantially larger variance.  This avoids
+    // alternating between axes with nearly equal variances.
+    int axis = (mAxis >= 0 ? mAxis : 0);
+    for (int d = 0; d < 2; ++d)
+    {
+        if (variance[d] > (Real)2 * variance[axis]
+            || (mAxis < 0 && variance[d] > variance[axis]))
+        {
+            axis = d;
+        }
+    }
+    mAxis = axis;
+}
+
+template <typename Real>
+void RectangleManager<Real>::InsertionSort()
+{
+    // Under the assumption that the rectangles have not moved much since the
+    // last call, the array is nearly sorted and the insertion sort is very
+    // fast.  If the number of moves exceeds a small multiple of the number
+    // of rectangles, the motion is incoherent and std::sort is used instead.
+    int const axis = mAxis;
+    int const numRectangles = static_cast<int>(mSorted.size());
+    long long const maxMoves = 4 * static_cast<long long>(numRectangles);
+    long long numMoves = 0;
+    for (int j = 1; j < numRectangles; ++j)
+    {
+        SortedRectangle key = mSorted[j];
+        int i = j - 1;
+        while (i >= 0 && key.min[axis] < mSorted[i].min[axis])
+        {
+            mSorted[i + 1] = mSorted[i];
             --i;
         }
-        endpoint[i + 1] = key;
-        lookup[2 * key.index + key.type] = i + 1;
+        mSorted[i + 1] = key;
+
+        numMoves += j - 1 - i;
+        if (numMoves > maxMoves)
+        {
+            std::sort(mSorted.begin(), mSorted.end(),
+                [axis](SortedRectangle const& r0, SortedRectangle const& r1)
+                {
+                    return r0.min[axis] < r1.min[axis];
+                });
+            return;
+        }
     }
 }
 
 template <typename Real>
-void RectangleManager<Real>::Update()
+void RectangleManager<Real>::SelectBands()
 {
-    InsertionSort(mXEndpoints, mXLookup);
-    InsertionSort(mYEndpoints, mYLookup);
+    int const numRectangles = static_cast<int>(mSorted.size());
+    int const a1 = 1 - mAxis;
+    mNumBands = 1;
+    mBandOrigin = (Real)0;
+    mBandScale = (Real)0;
+    if (numRectangles == 0)
+    {
+        return;
+    }
+
+    // The band width is twice the mean rectangle size, so a rectangle of
+    // average size overlaps at most 2 bands.  The number of bands is at
+    // most the number of rectangles.
+    Real minValue = mSorted[0].min[a1], maxValue = mSorted[0].max[a1];
+    Real sumSizes = (Real)0;
+    for (auto const& sorted : mSorted)
+    {
+        minValue = std::min(minValue, sorted.min[a1]);
+        maxValue = std::max(maxValue, sorted.max[a1]);
+        sumSizes += sorted.max[a1] - sorted.min[a1];
+    }
+    Real const range = maxValue - minValue;
+    Real const bandWidth = (Real)2 * sumSizes / static_cast<Real>(numRectangles);
+    Real size = (bandWidth > (Real)0 ? range / bandWidth : (Real)0);
+    size = std::min(size, static_cast<Real>(numRectangles));
+    if (size >= (Real)2)
+    {
+        mNumBands = static_cast<int>(size);
+        mBandOrigin = minValue;
+        mBandScale = static_cast<Real>(mNumBands) / range;
+    }
 }
 
 template <typename Real>
-std::set<EdgeKey<false>> const& RectangleManager<Real>::GetOverlap() const
+inline int RectangleManager<Real>::GetBand(Real value) const
 {
-    return mOverlap;
+    // The band index is a nondecreasing function of the value, so two
+    // overlapping intervals have overlapping ranges of bands.
+    int band = static_cast<int>((value - mBandOrigin) * mBandScale);
+    return std::min(std::max(band, 0), mNumBands - 1);
 }
 
 template <typename Real>
-bool RectangleManager<Real>::Endpoint::operator<(Endpoint const& endpoint) const
+void RectangleManager<Real>::Sweep()
 {
-    if (value < endpoint.value)
+    int const a0 = mAxis, a1 = 1 - a0;
+    int const numRectangles = static_cast<int>(mSorted.size());
+    for (auto& overlap : mThreadOverlap)
+    {
+        overlap.clear();
+    }
+
+    // Count the rectangles in each band and distribute them in sorted
+    // order, so that the list of each band is sorted by min[a0].
+    mRectangleBands.resize(numRectangles);
+    mBandStart.assign(static_cast<size_t>(mNumBands) + 1, 0);
+    for (int i = 0; i < numRectangles; ++i)
+    {
+        SortedRectangle const& sorted = mSorted[i];
+        std::array<int, 2>& bands = mRectangleBands[i];
+        bands = { GetBand(sorted.min[a1]), GetBand(sorted.max[a1]) };
+        for (int b = bands[0]; b <= bands[1]; ++b)
+        {
+            ++mBandStart[b + 1];
+        }
+    }
+    for (int b = 0; b < mNumBands; ++b)
+    {
+        mBandStart[b + 1] += mBandStart[b];
+    }
+    mBandRectangles.resize(mBandStart[mNumBands]);
+    std::vector<int> next(mBandStart.begin(), mBandStart.end() - 1);
+    for (int i = 0; i < numRectangles; ++i)
+    {
+        SortedRectangle const& sorted = mSorted[i];
+        std::array<int, 2> const& bands = mRectangleBands[i];
+        BandRectangle bandRectangle;
+        bandRectangle.min0 = sorted.min[a0];
+        bandRectangle.max0 = sorted.max[a0];
+        bandRectangle.bounds = { sorted.min[a1], sorted.max[a1] };
+        bandRectangle.bandMin = bands[0];
+        bandRectangle.index = sorted.index;
+        for (int b = bands[0]; b <= bands[1]; ++b)
+        {
+            mBandRectangles[next[b]++] = bandRectangle;
+        }
+    }
+
+    ParallelFor(mNumThreads, mNumBands, [this](unsigned int t, int bmin,
+        int bmax)
+    {
+        std::vector<EdgeKey<false>>& overlap = mThreadOverlap[t];
+        for (int b = bmin; b < bmax; ++b)
+        {
+            int const jmax = mBandStart[b + 1];
+            for (int i = mBandStart[b]; i < jmax; ++i)
+            {
+                // The rectangles j > i of the band with min0 <= max0 of
+                // rectangle i are exactly those whose a0-intervals overlap
+                // that of rectangle i and that follow it in the sorted
+                // order.  Test them for overlap in the other dimension.
+                BandRectangle const& r0 = mBandRectangles[i];
+                std::array<Real, 2> const& b0 = r0.bounds;
+                for (int j = i + 1; j < jmax && mBandRectangles[j].min0 <= r0.max0; ++j)
+                {
+                    BandRectangle const& r1 = mBandRectangles[j];
+                    std::array<Real, 2> const& b1 = r1.bounds;
+                    bool intersect = (b0[1] >= b1[0]) & (b0[0] <= b1[1]);
+                    if (intersect && std::max(r0.bandMin, r1.bandMin) == b)
+                    {
+                        overlap.push_back(EdgeKey<false>(r0.index,
+                            r1.index));
+                    }
+                }
+            }
+        }
+    });
+
+    // Sort the pairs by a counting sort on V[1], which is the first index
+    // compared by EdgeKey<false>::operator<, followed by sorts of the short
+    // runs of pairs with equal V[1].  For a dense scene, this is much faster
+    // than a comparison sort of all the pairs.
+    mOverlapStart.assign(static_cast<size_t>(numRectangles) + 1, 0);
+    for (auto const& overlap : mThreadOverlap)
+    {
+        for (auto const& key : overlap)
+        {
+            ++mOverlapStart[key.V[1] + 1];
+        }
+    }
+    for (int i = 0; i < numRectangles; ++i)
     {
-        return true;
+        mOverlapStart[i + 1] += mOverlapStart[i];
     }
-    if (value > endpoint.value)
+    mOverlap.resize(mOverlapStart[numRectangles]);
+    for (auto const& overlap : mThreadOverlap)
     {
-        return false;
+        for (auto const& key : overlap)
+        {
+            mOverlap[mOverlapStart[key.V[1]]++] = key;
+        }
+    }
+    for (int i = numRectangles - 1; i > 0; --i)
+    {
+        mOverlapStart[i] = mOverlapStart[i - 1];
+    }
+    mOverlapStart[0] = 0;
+    for (int i = 0; i < numRectangles; ++i)
+    {
+        std::sort(mOverlap.begin() + mOverlapStart[i],
+            mOverlap.begin() + mOverlapStart[i + 1]);
+    }
+}
+
+template <typename Real>
+void RectangleManager<Real>::UpdateOverlapSet()
+{
+    // Merge the sorted array into the set of the previous update.  Only the
+    // pairs that were added or removed since then cause allocations or
+    // deallocations, which is fast for coherent motion.
+    auto element = mOverlapSet.begin();
+    for (auto const& key : mOverlap)
+    {
+        while (element != mOverlapSet.end() && *element < key)
+        {
+            element = mOverlapSet.erase(element);
+        }
+        if (element != mOverlapSet.end() && *element == key)
+        {
+            ++element;
+        }
+        else
+        {
+            mOverlapSet.insert(element, key);
+        }
     }
-    return type < endpoint.type;
+    mOverlapSet.erase(element, mOverlapSet.end());
 }
 
 }
@@ -0,0 +1,945 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <LowLevel/GteParallelFor.h>
+#include <Physics/GteRigidBody.h>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// A collection of rigid bodies with the state and the Runge-Kutta solver of
+// RigidBody<Real>, for scenes with many bodies.  The state is stored as a
+// structure of arrays, one array per component of each quantity, and the
+// bodies are integrated in blocks of BLOCK_SIZE consecutive bodies.  All
+// four stages of a block are computed before the next block, so the stage
+// states stay in per-thread workspace, and the loops over the bodies of a
+// block have no branches and no calls so that the compiler can vectorize
+// them.  The forces and torques are computed by one call per block and
+// stage.  The blocks are partitioned among the threads.  The force and
+// torque on a body must depend only on the time and the state of that body,
+// which is the model of RigidBody<Real>; the bodies do not interact during
+// Update.
+
+namespace gte
+{
+
+template <typename Real>
+class RigidBodyWorld
+{
+public:
+    // Construction and destruction.  The bodies are immovable, with the
+    // default state of RigidBody<Real>.  Use the set functions to initialize
+    // the state before starting the simulation.  The number of threads
+    // should satisfy 1 <= numThreads <= std::thread::hardware_concurrency().
+    virtual ~RigidBodyWorld();
+    RigidBodyWorld(int numBodies, unsigned int numThreads = 1);
+
+    inline int GetNumBodies() const;
+
+    // Set the state of body i.  The semantics are those of the functions of
+    // RigidBody<Real> with the same names.
+    void SetMass(int i, Real mass);
+    void SetBodyInertia(int i, Matrix3x3<Real> const& inertia);
+    void SetPosition(int i, Vector3<Real> const& position);
+    void SetQOrientation(int i, Quaternion<Real> const& quatOrient);
+    void SetLinearMomentum(int i, Vector3<Real> const& linearMomentum);
+    void SetAngularMomentum(int i, Vector3<Real> const& angularMomentum);
+    void SetROrientation(int i, Matrix3x3<Real> const& rotOrient);
+    void SetLinearVelocity(int i, Vector3<Real> const& linearVelocity);
+    void SetAngularVelocity(int i, Vector3<Real> const& angularVelocity);
+
+    // Copy the state of a RigidBody<Real> to body i.
+    void SetBody(int i, RigidBody<Real> const& body);
+
+    // Get the state of body i.
+    inline Real GetMass(int i) const;
+    inline Real GetInverseMass(int i) const;
+    inline Matrix3x3<Real> const& GetBodyInertia(int i) const;
+    Matrix3x3<Real> GetBodyInverseInertia(int i) const;
+    Matrix3x3<Real> GetWorldInertia(int i) const;
+    Matrix3x3<Real> GetWorldInverseInertia(int i) const;
+    Vector3<Real> GetPosition(int i) const;
+    Quaternion<Real> GetQOrientation(int i) const;
+    Vector3<Real> GetLinearMomentum(int i) const;
+    Vector3<Real> GetAngularMomentum(int i) const;
+    Matrix3x3<Real> GetROrientation(int i) const;
+    Vector3<Real> GetLinearVelocity(int i) const;
+    Vector3<Real> GetAngularVelocity(int i) const;
+
+    // A view of one body with the get functions of RigidBody<Real>.  The
+    // quantities are returned by value, because they are assembled from the
+    // arrays.  A view remains valid as long as the world exists.
+    class Body
+    {
+    public:
+        inline Body(RigidBodyWorld const& world, int i);
+
+        inline int GetIndex() const;
+        inline Real GetMass() const;
+        inline Real GetInverseMass() const;
+        inline Matrix3x3<Real> const& GetBodyInertia() const;
+        inline Matrix3x3<Real> GetBodyInverseInertia() const;
+        inline Matrix3x3<Real> GetWorldInertia() const;
+        inline Matrix3x3<Real> GetWorldInverseInertia() const;
+        inline Vector3<Real> GetPosition() const;
+        inline Quaternion<Real> GetQOrientation() const;
+        inline Vector3<Real> GetLinearMomentum() const;
+        inline Vector3<Real> GetAngularMomentum() const;
+        inline Matrix3x3<Real> GetROrientation() const;
+        inline Vector3<Real> GetLinearVelocity() const;
+        inline Vector3<Real> GetAngularVelocity() const;
+
+    private:
+        RigidBodyWorld const* mWorld;
+        int mIndex;
+    };
+
+    inline Body GetBody(int i) const;
+
+    // The state of the bodies i with imin <= i < imax passed to the force
+    // and torque function, where component k of a quantity of body i is
+    // quantity[k][i - imin].  The component (r,c) of the rotation matrix is
+    // rotOrient[3*r + c].
+    struct State
+    {
+        Real const* mass;
+        Real const* position[3];
+        Real const* quatOrient[4];
+        Real const* linearMomentum[3];
+        Real const* angularMomentum[3];
+        Real const* rotOrient[9];
+        Real const* linearVelocity[3];
+        Real const* angularVelocity[3];
+    };
+
+    // Force/torque function format.  The function stores the force and the
+    // torque on body i in force[k][i - imin] and torque[k][i - imin] for
+    // 0 <= k < 3.  The function is called by each thread for its blocks, so
+    // it must not modify data shared by the blocks.
+    typedef std::function
+    <
+        void
+        (
+            Real,                       // time of application
+            int,                        // imin
+            int,                        // imax
+            State const&,               // state of bodies imin through imax-1
+            Real* const*,               // force[3]
+            Real* const*                // torque[3]
+        )
+    >
+    Function;
+
+    // The force and torque function.  When it is not set, the forces and
+    // torques are zero.
+    Function mForceTorque;
+
+    // Runge-Kutta fourth-order differential equation solver applied to all
+    // bodies.
+    void Update(Real t, Real dt);
+
+private:
+    enum { BLOCK_SIZE = 64 };
+
+    // Pointers to the state arrays of a block.
+    struct Arrays
+    {
+        Real* position[3];
+        Real* quatOrient[4];
+        Real* linearMomentum[3];
+        Real* angularMomentum[3];
+        Real* rotOrient[9];
+        Real* linearVelocity[3];
+        Real* angularVelocity[3];
+    };
+
+    // The derivatives of the state of a block.
+    struct Derivative
+    {
+        Real dxdt[3][BLOCK_SIZE];
+        Real dqdt[4][BLOCK_SIZE];
+        Real dpdt[3][BLOCK_SIZE];
+        Real dldt[3][BLOCK_SIZE];
+    };
+
+    // The per-thread workspace.  The stage state is that of the second,
+    // third and fourth stages.  The derivatives are those of RigidBody's
+    // Update:  d1 is A1, d23 is the sum A2+A3 and d is A3 or A4.
+    struct Workspace
+    {
+        Real position[3][BLOCK_SIZE];
+        Real quatOrient[4][BLOCK_SIZE];
+        Real linearMomentum[3][BLOCK_SIZE];
+        Real angularMomentum[3][BLOCK_SIZE];
+        Real rotOrient[9][BLOCK_SIZE];
+        Real linearVelocity[3][BLOCK_SIZE];
+        Real angularVelocity[3][BLOCK_SIZE];
+        Derivative d1, d23, d;
+    };
+
+    // Set the rotation, linear velocity and angular velocity of body i from
+    // its quaternion and momenta.
+    void UpdateDerived(int i);
+
+    // Integrate the bodies imin <= i < imax, at most BLOCK_SIZE of them.
+    void UpdateBlock(Real t, Real dt, int imin, int imax, Workspace& ws);
+
+    // The derived quantities and the derivatives of the state s of the
+    // bodies imin <= i < imin + numBodies.
+    void ComputeDerived(int imin, int numBodies, Arrays const& s);
+    void ComputeDerivative(Real t, int imin, int numBodies,
+        Arrays const& s, Derivative& d);
+
+    // The arrays of the state starting at body imin.
+    Arrays GetArrays(int imin);
+
+    int mNumBodies;
+    unsigned int mNumThreads;
+
+    // Constant quantities.
+    std::vector<Real> mMass, mInvMass;
+    std::vector<Matrix3x3<Real>> mInertia;
+    std::vector<Real> mInvInertia[9];
+
+    // State variables.
+    std::vector<Real> mPosition[3];
+    std::vector<Real> mQuatOrient[4];
+    std::vector<Real> mLinearMomentum[3];
+    std::vector<Real> mAngularMomentum[3];
+
+    // Derived state variables.
+    std::vector<Real> mRotOrient[9];
+    std::vector<Real> mLinearVelocity[3];
+    std::vector<Real> mAngularVelocity[3];
+
+    std::vector<Workspace> mWorkspace;
+};
+
+
+template <typename Real>
+RigidBodyWorld<Real>::~RigidBodyWorld()
+{
+}
+
+template <typename Real>
+RigidBodyWorld<Real>::RigidBodyWorld(int numBodies, unsigned int numThreads)
+    :
+    mNumBodies(numBodies),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mMass(numBodies),
+    mInvMass(numBodies),
+    mInertia(numBodies),
+    mWorkspace(numThreads > 0 ? numThreads : 1)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        mPosition[k].resize(numBodies);
+        mLinearMomentum[k].resize(numBodies);
+        mAngularMomentum[k].resize(numBodies);
+        mLinearVelocity[k].resize(numBodies);
+        mAngularVelocity[k].resize(numBodies);
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+        mQuatOrient[k].resize(numBodies);
+    }
+    for (int k = 0; k < 9; ++k)
+    {
+        mInvInertia[k].resize(numBodies);
+        mRotOrient[k].resize(numBodies);
+    }
+
+    // The default bodies are immovable.
+    for (int i = 0; i < numBodies; ++i)
+    {
+        SetMass(i, std::numeric_limits<Real>::max());
+        SetPosition(i, Vector3<Real>::Zero());
+    }
+}
+
+template <typename Real> inline
+int RigidBodyWorld<Real>::GetNumBodies() const
+{
+    return mNumBodies;
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetMass(int i, Real mass)
+{
+    if ((Real)0 < mass && mass < std::numeric_limits<Real>::max())
+    {
+        mMass[i] = mass;
+        mInvMass[i] = ((Real)1) / mass;
+    }
+    else
+    {
+        // Assume the body as immovable.
+        mMass[i] = std::numeric_limits<Real>::max();
+        mInvMass[i] = (Real)0;
+        mInertia[i] = Matrix3x3<Real>::Identity();
+        for (int k = 0; k < 9; ++k)
+        {
+            mInvInertia[k][i] = (Real)0;
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            mLinearMomentum[k][i] = (Real)0;
+            mAngularMomentum[k][i] = (Real)0;
+        }
+        mQuatOrient[0][i] = (Real)0;
+        mQuatOrient[1][i] = (Real)0;
+        mQuatOrient[2][i] = (Real)0;
+        mQuatOrient[3][i] = (Real)1;
+        UpdateDerived(i);
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetBodyInertia(int i,
+    Matrix3x3<Real> const& inertia)
+{
+    mInertia[i] = inertia;
+    Matrix3x3<Real> invInertia = Inverse(inertia);
+    for (int r = 0, k = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c, ++k)
+        {
+            mInvInertia[k][i] = invInertia(r, c);
+        }
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetPosition(int i, Vector3<Real> const& position)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        mPosition[k][i] = position[k];
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetQOrientation(int i,
+    Quaternion<Real> const& quatOrient)
+{
+    Matrix3x3<Real> rotOrient = Rotation<3, Real>(quatOrient);
+    for (int k = 0; k < 4; ++k)
+    {
+        mQuatOrient[k][i] = quatOrient[k];
+    }
+    for (int r = 0, k = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c, ++k)
+        {
+            mRotOrient[k][i] = rotOrient(r, c);
+        }
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetLinearMomentum(int i,
+    Vector3<Real> const& linearMomentum)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        mLinearMomentum[k][i] = linearMomentum[k];
+        mLinearVelocity[k][i] = mInvMass[i] * linearMomentum[k];
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetAngularMomentum(int i,
+    Vector3<Real> const& angularMomentum)
+{
+    Matrix3x3<Real> rotOrient = GetROrientation(i);
+    Vector3<Real> angularVelocity = angularMomentum * rotOrient;
+    angularVelocity = GetBodyInverseInertia(i) * angularVelocity;
+    angularVelocity = rotOrient * angularVelocity;
+    for (int k = 0; k < 3; ++k)
+    {
+        mAngularMomentum[k][i] = angularMomentum[k];
+        mAngularVelocity[k][i] = angularVelocity[k];
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetROrientation(int i,
+    Matrix3x3<Real> const& rotOrient)
+{
+    Quaternion<Real> quatOrient = Rotation<3, Real>(rotOrient);
+    for (int r = 0, k = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c, ++k)
+        {
+            mRotOrient[k][i] = rotOrient(r, c);
+        }
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+        mQuatOrient[k][i] = quatOrient[k];
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetLinearVelocity(int i,
+    Vector3<Real> const& linearVelocity)
+{
+    for (int k = 0; k < 3; ++k)
+    {
+        mLinearVelocity[k][i] = linearVelocity[k];
+        mLinearMomentum[k][i] = mMass[i] * linearVelocity[k];
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetAngularVelocity(int i,
+    Vector3<Real> const& angularVelocity)
+{
+    Matrix3x3<Real> rotOrient = GetROrientation(i);
+    Vector3<Real> angularMomentum = angularVelocity * rotOrient;
+    angularMomentum = mInertia[i] * angularMomentum;
+    angularMomentum = rotOrient * angularMomentum;
+    for (int k = 0; k < 3; ++k)
+    {
+        mAngularVelocity[k][i] = angularVelocity[k];
+        mAngularMomentum[k][i] = angularMomentum[k];
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::SetBody(int i, RigidBody<Real> const& body)
+{
+    mMass[i] = body.GetMass();
+    mInvMass[i] = body.GetInverseMass();
+    mInertia[i] = body.GetBodyInertia();
+    Matrix3x3<Real> const& invInertia = body.GetBodyInverseInertia();
+    Matrix3x3<Real> const& rotOrient = body.GetROrientation();
+    for (int r = 0, k = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c, ++k)
+        {
+            mInvInertia[k][i] = invInertia(r, c);
+            mRotOrient[k][i] = rotOrient(r, c);
+        }
+    }
+
+    Vector3<Real> const& position = body.GetPosition();
+    Quaternion<Real> const& quatOrient = body.GetQOrientation();
+    Vector3<Real> const& linearMomentum = body.GetLinearMomentum();
+    Vector3<Real> const& angularMomentum = body.GetAngularMomentum();
+    Vector3<Real> const& linearVelocity = body.GetLinearVelocity();
+    Vector3<Real> const& angularVelocity = body.GetAngularVelocity();
+    for (int k = 0; k < 3; ++k)
+    {
+        mPosition[k][i] = position[k];
+        mLinearMomentum[k][i] = linearMomentum[k];
+        mAngularMomentum[k][i] = angularMomentum[k];
+        mLinearVelocity[k][i] = linearVelocity[k];
+        mAngularVelocity[k][i] = angularVelocity[k];
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+        mQuatOrient[k][i] = quatOrient[k];
+    }
+}
+
+template <typename Real> inline
+Real RigidBodyWorld<Real>::GetMass(int i) const
+{
+    return mMass[i];
+}
+
+template <typename Real> inline
+Real RigidBodyWorld<Real>::GetInverseMass(int i) const
+{
+    return mInvMass[i];
+}
+
+template <typename Real> inline
+Matrix3x3<Real> const& RigidBodyWorld<Real>::GetBodyInertia(int i) const
+{
+    return mInertia[i];
+}
+
+template <typename Real>
+Matrix3x3<Real> RigidBodyWorld<Real>::GetBodyInverseInertia(int i) const
+{
+    Matrix3x3<Real> invInertia;
+    for (int r = 0, k = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c, ++k)
+        {
+            invInertia(r, c) = mInvInertia[k][i];
+        }
+    }
+    return invInertia;
+}
+
+template <typename Real>
+Matrix3x3<Real> RigidBodyWorld<Real>::GetWorldInertia(int i) const
+{
+    Matrix3x3<Real> rotOrient = GetROrientation(i);
+    return MultiplyABT(rotOrient * mInertia[i], rotOrient);  // R*J*R^T
+}
+
+template <typename Real>
+Matrix3x3<Real> RigidBodyWorld<Real>::GetWorldInverseInertia(int i) const
+{
+    Matrix3x3<Real> rotOrient = GetROrientation(i);
+    return MultiplyABT(rotOrient * GetBodyInverseInertia(i), rotOrient);
+}
+
+template <typename Real>
+Vector3<Real> RigidBodyWorld<Real>::GetPosition(int i) const
+{
+    return Vector3<Real>{ mPosition[0][i], mPosition[1][i], mPosition[2][i] };
+}
+
+template <typename Real>
+Quaternion<Real> RigidBodyWorld<Real>::GetQOrientation(int i) const
+{
+    return Quaternion<Real>(mQuatOrient[0][i], mQuatOrient[1][i],
+        mQuatOrient[2][i], mQuatOrient[3][i]);
+}
+
+template <typename Real>
+Vector3<Real> RigidBodyWorld<Real>::GetLinearMomentum(int i) const
+{
+    return Vector3<Real>{ mLinearMomentum[0][i], mLinearMomentum[1][i],
+        mLinearMomentum[2][i] };
+}
+
+template <typename Real>
+Vector3<Real> RigidBodyWorld<Real>::GetAngularMomentum(int i) const
+{
+    return Vector3<Real>{ mAngularMomentum[0][i], mAngularMomentum[1][i],
+        mAngularMomentum[2][i] };
+}
+
+template <typename Real>
+Matrix3x3<Real> RigidBodyWorld<Real>::GetROrientation(int i) const
+{
+    Matrix3x3<Real> rotOrient;
+    for (int r = 0, k = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 3; ++c, ++k)
+        {
+            rotOrient(r, c) = mRotOrient[k][i];
+        }
+    }
+    return rotOrient;
+}
+
+template <typename Real>
+Vector3<Real> RigidBodyWorld<Real>::GetLinearVelocity(int i) const
+{
+    return Vector3<Real>{ mLinearVelocity[0][i], mLinearVelocity[1][i],
+        mLinearVelocity[2][i] };
+}
+
+template <typename Real>
+Vector3<Real> RigidBodyWorld<Real>::GetAngularVelocity(int i) const
+{
+    return Vector3<Real>{ mAngularVelocity[0][i], mAngularVelocity[1][i],
+        mAngularVelocity[2][i] };
+}
+
+template <typename Real> inline
+RigidBodyWorld<Real>::Body::Body(RigidBodyWorld const& world, int i)
+    :
+    mWorld(&world),
+    mIndex(i)
+{
+}
+
+template <typename Real> inline
+int RigidBodyWorld<Real>::Body::GetIndex() const
+{
+    return mIndex;
+}
+
+template <typename Real> inline
+Real RigidBodyWorld<Real>::Body::GetMass() const
+{
+    return mWorld->GetMass(mIndex);
+}
+
+template <typename Real> inline
+Real RigidBodyWorld<Real>::Body::GetInverseMass() const
+{
+    return mWorld->GetInverseMass(mIndex);
+}
+
+template <typename Real> inline
+Matrix3x3<Real> const& RigidBodyWorld<Real>::Body::GetBodyInertia() const
+{
+    return mWorld->GetBodyInertia(mIndex);
+}
+
+template <typename Real> inline
+Matrix3x3<Real> RigidBodyWorld<Real>::Body::GetBodyInverseInertia() const
+{
+    return mWorld->GetBodyInverseInertia(mIndex);
+}
+
+template <typename Real> inline
+Matrix3x3<Real> RigidBodyWorld<Real>::Body::GetWorldInertia() const
+{
+    return mWorld->GetWorldInertia(mIndex);
+}
+
+template <typename Real> inline
+Matrix3x3<Real> RigidBodyWorld<Real>::Body::GetWorldInverseInertia() const
+{
+    return mWorld->GetWorldInverseInertia(mIndex);
+}
+
+template <typename Real> inline
+Vector3<Real> RigidBodyWorld<Real>::Body::GetPosition() const
+{
+    return mWorld->GetPosition(mIndex);
+}
+
+template <typename Real> inline
+Quaternion<Real> RigidBodyWorld<Real>::Body::GetQOrientation() const
+{
+    return mWorld->GetQOrientation(mIndex);
+}
+
+template <typename Real> inline
+Vector3<Real> RigidBodyWorld<Real>::Body::GetLinearMomentum() const
+{
+    return mWorld->GetLinearMomentum(mIndex);
+}
+
+template <typename Real> inline
+Vector3<Real> RigidBodyWorld<Real>::Body::GetAngularMomentum() const
+{
+    return mWorld->GetAngularMomentum(mIndex);
+}
+
+template <typename Real> inline
+Matrix3x3<Real> RigidBodyWorld<Real>::Body::GetROrientation() const
+{
+    return mWorld->GetROrientation(mIndex);
+}
+
+template <typename Real> inline
+Vector3<Real> RigidBodyWorld<Real>::Body::GetLinearVelocity() const
+{
+    return mWorld->GetLinearVelocity(mIndex);
+}
+
+template <typename Real> inline
+Vector3<Real> RigidBodyWorld<Real>::Body::GetAngularVelocity() const
+{
+    return mWorld->GetAngularVelocity(mIndex);
+}
+
+template <typename Real> inline
+typename RigidBodyWorld<Real>::Body RigidBodyWorld<Real>::GetBody(int i) const
+{
+    return Body(*this, i);
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::Update(Real t, Real dt)
+{
+    // Each thread processes the blocks of its range of bodies.
+    ParallelFor(mNumThreads, mNumBodies,
+        [this, t, dt](unsigned int thread, int imin, int imax)
+    {
+        Workspace& ws = mWorkspace[thread];
+        for (int bmin = imin; bmin < imax; bmin += BLOCK_SIZE)
+        {
+            UpdateBlock(t, dt, bmin, std::min(bmin + BLOCK_SIZE, imax), ws);
+        }
+    });
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::UpdateDerived(int i)
+{
+    ComputeDerived(i, 1, GetArrays(i));
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::UpdateBlock(Real t, Real dt, int imin, int imax,
+    Workspace& ws)
+{
+    // The stages are those of RigidBody<Real>::Update.
+    Real halfDT = ((Real)0.5)*dt;
+    Real sixthDT = dt / ((Real)6);
+    Real TpHalfDT = t + halfDT;
+    Real TpDT = t + dt;
+    int const numBodies = imax - imin;
+
+    Arrays s0 = GetArrays(imin), s;
+    for (int k = 0; k < 3; ++k)
+    {
+        s.position[k] = ws.position[k];
+        s.linearMomentum[k] = ws.linearMomentum[k];
+        s.angularMomentum[k] = ws.angularMomentum[k];
+        s.linearVelocity[k] = ws.linearVelocity[k];
+        s.angularVelocity[k] = ws.angularVelocity[k];
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+        s.quatOrient[k] = ws.quatOrient[k];
+    }
+    for (int k = 0; k < 9; ++k)
+    {
+        s.rotOrient[k] = ws.rotOrient[k];
+    }
+
+    // Set the stage state s = s0 + scale*d.
+    auto setStage = [numBodies, &s0, &s](Real scale, Derivative const& d)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            for (int j = 0; j < numBodies; ++j)
+            {
+                s.position[k][j] = s0.position[k][j] + scale * d.dxdt[k][j];
+                s.linearMomentum[k][j] =
+                    s0.linearMomentum[k][j] + scale * d.dpdt[k][j];
+                s.angularMomentum[k][j] =
+                    s0.angularMomentum[k][j] + scale * d.dldt[k][j];
+            }
+        }
+        for (int k = 0; k < 4; ++k)
+        {
+            for (int j = 0; j < numBodies; ++j)
+            {
+                s.quatOrient[k][j] =
+                    s0.quatOrient[k][j] + scale * d.dqdt[k][j];
+            }
+        }
+    };
+
+    // A1 = G(T,S0), B1 = S0 + (DT/2)*A1
+    ComputeDerivative(t, imin, numBodies, s0, ws.d1);
+    setStage(halfDT, ws.d1);
+    ComputeDerived(imin, numBodies, s);
+
+    // A2 = G(T+DT/2,B1), B2 = S0 + (DT/2)*A2
+    ComputeDerivative(TpHalfDT, imin, numBodies, s, ws.d23);
+    setStage(halfDT, ws.d23);
+    ComputeDerived(imin, numBodies, s);
+
+    // A3 = G(T+DT/2,B2), B3 = S0 + DT*A3
+    ComputeDerivative(TpHalfDT, imin, numBodies, s, ws.d);
+    setStage(dt, ws.d);
+    ComputeDerived(imin, numBodies, s);
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int j = 0; j < numBodies; ++j)
+        {
+            ws.d23.dxdt[k][j] += ws.d.dxdt[k][j];
+            ws.d23.dpdt[k][j] += ws.d.dpdt[k][j];
+            ws.d23.dldt[k][j] += ws.d.dldt[k][j];
+        }
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+        for (int j = 0; j < numBodies; ++j)
+        {
+            ws.d23.dqdt[k][j] += ws.d.dqdt[k][j];
+        }
+    }
+
+    // A4 = G(T+DT,B3), S1 = S0 + (DT/6)*(A1+2*(A2+A3)+A4)
+    ComputeDerivative(TpDT, imin, numBodies, s, ws.d);
+    Derivative const& d1 = ws.d1;
+    Derivative const& d4 = ws.d;
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int j = 0; j < numBodies; ++j)
+        {
+            s0.position[k][j] += sixthDT * (d1.dxdt[k][j] +
+                ((Real)2) * ws.d23.dxdt[k][j] + d4.dxdt[k][j]);
+            s0.linearMomentum[k][j] += sixthDT * (d1.dpdt[k][j] +
+                ((Real)2) * ws.d23.dpdt[k][j] + d4.dpdt[k][j]);
+            s0.angularMomentum[k][j] += sixthDT * (d1.dldt[k][j] +
+                ((Real)2) * ws.d23.dldt[k][j] + d4.dldt[k][j]);
+        }
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+        for (int j = 0; j < numBodies; ++j)
+        {
+            s0.quatOrient[k][j] += sixthDT * (d1.dqdt[k][j] +
+                ((Real)2) * ws.d23.dqdt[k][j] + d4.dqdt[k][j]);
+        }
+    }
+    ComputeDerived(imin, numBodies, s0);
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::ComputeDerived(int imin, int numBodies,
+    Arrays const& s)
+{
+    Real const* invMass = &mInvMass[imin];
+    Real const* J[9];
+    for (int k = 0; k < 9; ++k)
+    {
+        J[k] = &mInvInertia[k][imin];
+    }
+
+    for (int j = 0; j < numBodies; ++j)
+    {
+        // The rotation matrix of Rotation<3,Real>(q).
+        Real twoX = ((Real)2)*s.quatOrient[0][j];
+        Real twoY = ((Real)2)*s.quatOrient[1][j];
+        Real twoZ = ((Real)2)*s.quatOrient[2][j];
+        Real twoXX = twoX*s.quatOrient[0][j];
+        Real twoXY = twoX*s.quatOrient[1][j];
+        Real twoXZ = twoX*s.quatOrient[2][j];
+        Real twoXW = twoX*s.quatOrient[3][j];
+        Real twoYY = twoY*s.quatOrient[1][j];
+        Real twoYZ = twoY*s.quatOrient[2][j];
+        Real twoYW = twoY*s.quatOrient[3][j];
+        Real twoZZ = twoZ*s.quatOrient[2][j];
+        Real twoZW = twoZ*s.quatOrient[3][j];
+
+        Real R[9];
+#if defined(GTE_USE_MAT_VEC)
+        R[0] = (Real)1 - twoYY - twoZZ;
+        R[1] = twoXY - twoZW;
+        R[2] = twoXZ + twoYW;
+        R[3] = twoXY + twoZW;
+        R[4] = (Real)1 - twoXX - twoZZ;
+        R[5] = twoYZ - twoXW;
+        R[6] = twoXZ - twoYW;
+        R[7] = twoYZ + twoXW;
+        R[8] = (Real)1 - twoXX - twoYY;
+#else
+        R[0] = (Real)1 - twoYY - twoZZ;
+        R[3] = twoXY - twoZW;
+        R[6] = twoXZ + twoYW;
+        R[1] = twoXY + twoZW;
+        R[4] = (Real)1 - twoXX - twoZZ;
+        R[7] = twoYZ - twoXW;
+        R[2] = twoXZ - twoYW;
+        R[5] = twoYZ + twoXW;
+        R[8] = (Real)1 - twoXX - twoYY;
+#endif
+        for (int k = 0; k < 9; ++k)
+        {
+            s.rotOrient[k][j] = R[k];
+        }
+
+        // V = P/m
+        for (int k = 0; k < 3; ++k)
+        {
+            s.linearVelocity[k][j] = invMass[j] * s.linearMomentum[k][j];
+        }
+
+        // W = R*J^{-1}*R^T*L
+        Real L0 = s.angularMomentum[0][j];
+        Real L1 = s.angularMomentum[1][j];
+        Real L2 = s.angularMomentum[2][j];
+        Real u0 = L0 * R[0] + L1 * R[3] + L2 * R[6];
+        Real u1 = L0 * R[1] + L1 * R[4] + L2 * R[7];
+        Real u2 = L0 * R[2] + L1 * R[5] + L2 * R[8];
+        Real v0 = J[0][j] * u0 + J[1][j] * u1 + J[2][j] * u2;
+        Real v1 = J[3][j] * u0 + J[4][j] * u1 + J[5][j] * u2;
+        Real v2 = J[6][j] * u0 + J[7][j] * u1 + J[8][j] * u2;
+        s.angularVelocity[0][j] = R[0] * v0 + R[1] * v1 + R[2] * v2;
+        s.angularVelocity[1][j] = R[3] * v0 + R[4] * v1 + R[5] * v2;
+        s.angularVelocity[2][j] = R[6] * v0 + R[7] * v1 + R[8] * v2;
+    }
+}
+
+template <typename Real>
+void RigidBodyWorld<Real>::ComputeDerivative(Real t, int imin,
+    int numBodies, Arrays const& s, Derivative& d)
+{
+    // dX/dt = V
+    for (int k = 0; k < 3; ++k)
+    {
+        std::copy(s.linearVelocity[k], s.linearVelocity[k] + numBodies,
+            d.dxdt[k]);
+    }
+
+    // dQ/dt = W*Q/2, where W = (w0,w1,w2,0) is a quaternion
+    for (int j = 0; j < numBodies; ++j)
+    {
+        Real w0 = ((Real)0.5) * s.angularVelocity[0][j];
+        Real w1 = ((Real)0.5) * s.angularVelocity[1][j];
+        Real w2 = ((Real)0.5) * s.angularVelocity[2][j];
+        Real x = s.quatOrient[0][j];
+        Real y = s.quatOrient[1][j];
+        Real z = s.quatOrient[2][j];
+        Real w = s.quatOrient[3][j];
+        d.dqdt[0][j] = +w0 * w + w1 * z - w2 * y;
+        d.dqdt[1][j] = -w0 * z + w1 * w + w2 * x;
+        d.dqdt[2][j] = +w0 * y - w1 * x + w2 * w;
+        d.dqdt[3][j] = -w0 * x - w1 * y - w2 * z;
+    }
+
+    // dP/dt = F, dL/dt = T
+    Real* force[3] = { d.dpdt[0], d.dpdt[1], d.dpdt[2] };
+    Real* torque[3] = { d.dldt[0], d.dldt[1], d.dldt[2] };
+    if (mForceTorque)
+    {
+        State state;
+        state.mass = &mMass[imin];
+        for (int k = 0; k < 3; ++k)
+        {
+            state.position[k] = s.position[k];
+            state.linearMomentum[k] = s.linearMomentum[k];
+            state.angularMomentum[k] = s.angularMomentum[k];
+            state.linearVelocity[k] = s.linearVelocity[k];
+            state.angularVelocity[k] = s.angularVelocity[k];
+        }
+        for (int k = 0; k < 4; ++k)
+        {
+            state.quatOrient[k] = s.quatOrient[k];
+        }
+        for (int k = 0; k < 9; ++k)
+        {
+            state.rotOrient[k] = s.rotOrient[k];
+        }
+        mForceTorque(t, imin, imin + numBodies, state, force, torque);
+    }
+    else
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            std::fill(force[k], force[k] + numBodies, (Real)0);
+            std::fill(torque[k], torque[k] + numBodies, (Real)0);
+        }
+    }
+}
+
+template <typename Real>
+typename RigidBodyWorld<Real>::Arrays RigidBodyWorld<Real>::GetArrays(int imin)
+{
+    Arrays s;
+    for (int k = 0; k < 3; ++k)
+    {
+        s.position[k] = &mPosition[k][imin];
+        s.linearMomentum[k] = &mLinearMomentum[k][imin];
+        s.angularMomentum[k] = &mAngularMomentum[k][imin];
+        s.linearVelocity[k] = &mLinearVelocity[k][imin];
+        s.angularVelocity[k] = &mAngularVelocity[k][imin];
+    }
+    for (int k = 0; k < 4; ++k)
+    {
+        s.quatOrient[k] = &mQuatOrient[k][imin];
+    }
+    for (int k = 0; k < 9; ++k)
+    {
+        s.rotOrient[k] = &mRotOrient[k][imin];
+    }
+    return s;
+}
+
+}
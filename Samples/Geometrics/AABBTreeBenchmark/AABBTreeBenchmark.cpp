@@ -0,0 +1,301 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "AABBTreeBenchmark.h"
+#include <Applications/GteEnvironment.h>
+#include <LowLevel/GteTimer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+int main(int argc, char const* argv[])
+{
+    // AABBTreeBenchmark [numQueries]
+    int numQueries = (argc > 1 ? std::atoi(argv[1]) : 20000);
+
+    AABBTreeBenchmark benchmark(numQueries);
+    std::printf("%d queries per mesh, 1 thread, queries per second\n",
+        numQueries);
+    std::printf("%-12s %8s %9s %9s %10s %9s %9s %9s %9s\n", "mesh", "tris",
+        "build ms", "closest", "first-hit", "any-hit", "brute cp",
+        "brute ray", "mismatch");
+
+    int numMismatches = 0;
+    std::vector<Vector3<double>> vertices;
+    std::vector<int> indices;
+
+    Environment environment;
+    std::string path = environment.GetVariable("GTE_PATH");
+    if (path != "")
+    {
+        environment.Insert(path + "/Samples/Data/");
+        path = environment.GetPath("Brain_V4098_T8192.binary");
+    }
+    if (path != "")
+    {
+        int const numVertices = 4098, numTriangles = 8192;
+        std::vector<Vector3<float>> positions(numVertices);
+        indices.resize(3 * numTriangles);
+        std::ifstream input(path, std::ios::binary);
+        input.read((char*)positions.data(), positions.size() * sizeof(positions[0]));
+        input.read((char*)indices.data(), indices.size() * sizeof(indices[0]));
+        input.close();
+        vertices.resize(numVertices);
+        for (int i = 0; i < numVertices; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                vertices[i][j] = positions[i][j];
+            }
+        }
+        numMismatches += benchmark.Run("brain", vertices, indices, 500);
+    }
+    else
+    {
+        std::printf("brain        skipped, set GTE_PATH to the GTEngine folder\n");
+    }
+
+    for (int n : { 100, 300, 700 })
+    {
+        AABBTreeBenchmark::CreateHeightField(n, vertices, indices);
+        numMismatches += benchmark.Run("height" + std::to_string(n),
+            vertices, indices, (n <= 300 ? 100 : 20));
+    }
+
+    for (int n : { 200, 500 })
+    {
+        AABBTreeBenchmark::CreateSphere(n, vertices, indices);
+        numMismatches += benchmark.Run("sphere" + std::to_string(n),
+            vertices, indices, 20);
+    }
+
+    for (int n : { 100000, 1000000 })
+    {
+        benchmark.CreateSoup(n, vertices, indices);
+        numMismatches += benchmark.Run("soup" + std::to_string(n),
+            vertices, indices, 20);
+    }
+
+    return (numMismatches == 0 ? 0 : 1);
+}
+
+AABBTreeBenchmark::AABBTreeBenchmark(int numQueries)
+    :
+    mNumQueries(numQueries),
+    mGenerator(5)
+{
+}
+
+int AABBTreeBenchmark::Run(std::string const& name,
+    std::vector<Vector3<double>> const& vertices,
+    std::vector<int> const& indices, int numBruteQueries)
+{
+    int const numTriangles = static_cast<int>(indices.size() / 3);
+    numBruteQueries = std::min(numBruteQueries, mNumQueries);
+    CreateQueries(vertices);
+    Timer timer;
+
+    Tree tree(static_cast<int>(vertices.size()), vertices.data(),
+        numTriangles, indices.data(), 4, 1);
+    double buildTime = 1e-9 * timer.GetNanoseconds();
+
+    std::vector<int> closest(mNumQueries), firstHit(mNumQueries);
+    std::vector<int> anyHit(mNumQueries);
+    std::vector<double> sqrDistance(mNumQueries), parameter(mNumQueries);
+    Tree::PTQuery::Result ptResult;
+    Tree::RTQuery::Result rtResult;
+
+    timer.Reset();
+    for (int q = 0; q < mNumQueries; ++q)
+    {
+        closest[q] = tree.GetClosest(mPoints[q], ptResult);
+        sqrDistance[q] = ptResult.sqrDistance;
+    }
+    double closestTime = 1e-9 * timer.GetNanoseconds();
+
+    timer.Reset();
+    for (int q = 0; q < mNumQueries; ++q)
+    {
+        firstHit[q] = tree.GetFirstHit(mRays[q], rtResult);
+        parameter[q] = (firstHit[q] >= 0 ? rtResult.parameter : -1.0);
+    }
+    double firstHitTime = 1e-9 * timer.GetNanoseconds();
+
+    timer.Reset();
+    for (int q = 0; q < mNumQueries; ++q)
+    {
+        anyHit[q] = tree.GetAnyHit(mRays[q], rtResult);
+    }
+    double anyHitTime = 1e-9 * timer.GetNanoseconds();
+
+    // Brute force on the first queries.
+    std::vector<Triangle3<double>> triangles(numTriangles);
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        triangles[t] = Triangle3<double>(vertices[indices[3 * t]],
+            vertices[indices[3 * t + 1]], vertices[indices[3 * t + 2]]);
+    }
+
+    Tree::PTQuery ptQuery;
+    Tree::RTQuery rtQuery;
+    double bruteClosestTime = 0.0, bruteRayTime = 0.0;
+    int numMismatches = 0;
+    for (int q = 0; q < numBruteQueries; ++q)
+    {
+        timer.Reset();
+        double minSqrDistance = std::numeric_limits<double>::max();
+        for (auto const& triangle : triangles)
+        {
+            minSqrDistance = std::min(minSqrDistance,
+                ptQuery(mPoints[q], triangle).sqrDistance);
+        }
+        bruteClosestTime += 1e-9 * timer.GetNanoseconds();
+
+        timer.Reset();
+        double minParameter = std::numeric_limits<double>::max();
+        int hit = -1;
+        for (int t = 0; t < numTriangles; ++t)
+        {
+            auto result = rtQuery(mRays[q], triangles[t]);
+            if (result.intersect && result.parameter < minParameter)
+            {
+                minParameter = result.parameter;
+                hit = t;
+            }
+        }
+        bruteRayTime += 1e-9 * timer.GetNanoseconds();
+
+        if (std::fabs(minSqrDistance - sqrDistance[q]) >
+            1e-12 * (1.0 + minSqrDistance))
+        {
+            ++numMismatches;
+        }
+        if ((hit < 0) != (firstHit[q] < 0) || (hit >= 0 &&
+            std::fabs(minParameter - parameter[q]) > 1e-12 * (1.0 + minParameter)))
+        {
+            ++numMismatches;
+        }
+        if ((hit < 0) != (anyHit[q] < 0))
+        {
+            ++numMismatches;
+        }
+    }
+
+    double const numQueries = static_cast<double>(mNumQueries);
+    double const numBrute = static_cast<double>(numBruteQueries);
+    std::printf("%-12s %8d %9.1f %9.0f %10.0f %9.0f %9.1f %9.1f %6d/%d\n",
+        name.c_str(), numTriangles, 1000.0 * buildTime,
+        numQueries / closestTime, numQueries / firstHitTime,
+        numQueries / anyHitTime, numBrute / bruteClosestTime,
+        numBrute / bruteRayTime, numMismatches, numBruteQueries);
+    std::fflush(stdout);
+    return numMismatches;
+}
+
+void AABBTreeBenchmark::CreateHeightField(int n,
+    std::vector<Vector3<double>>& vertices, std::vector<int>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    double const invN = 1.0 / static_cast<double>(n);
+    for (int y = 0; y <= n; ++y)
+    {
+        for (int x = 0; x <= n; ++x)
+        {
+            double u = x * invN, v = y * invN;
+            vertices.push_back({ u, v, 0.1 * std::sin(10.0 * u) * std::cos(7.0 * v) });
+        }
+    }
+    for (int y = 0; y < n; ++y)
+    {
+        for (int x = 0; x < n; ++x)
+        {
+            int i = x + (n + 1) * y;
+            indices.insert(indices.end(),
+                { i, i + 1, i + n + 2, i, i + n + 2, i + n + 1 });
+        }
+    }
+}
+
+void AABBTreeBenchmark::CreateSphere(int n,
+    std::vector<Vector3<double>>& vertices, std::vector<int>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    for (int i = 0; i <= n; ++i)
+    {
+        double theta = GTE_C_PI * i / n;
+        for (int j = 0; j <= 2 * n; ++j)
+        {
+            double phi = GTE_C_PI * j / n;
+            vertices.push_back({ std::sin(theta) * std::cos(phi),
+                std::sin(theta) * std::sin(phi), std::cos(theta) });
+        }
+    }
+    int const w = 2 * n + 1;
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < 2 * n; ++j)
+        {
+            int k = j + w * i;
+            indices.insert(indices.end(),
+                { k, k + w, k + w + 1, k, k + w + 1, k + 1 });
+        }
+    }
+}
+
+void AABBTreeBenchmark::CreateSoup(int n,
+    std::vector<Vector3<double>>& vertices, std::vector<int>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    std::uniform_real_distribution<double> center(0.0, 1.0), offset(-0.01, 0.01);
+    for (int t = 0; t < n; ++t)
+    {
+        Vector3<double> c{ center(mGenerator), center(mGenerator), center(mGenerator) };
+        for (int k = 0; k < 3; ++k)
+        {
+            indices.push_back(static_cast<int>(vertices.size()));
+            vertices.push_back(c + Vector3<double>{ offset(mGenerator),
+                offset(mGenerator), offset(mGenerator) });
+        }
+    }
+}
+
+void AABBTreeBenchmark::CreateQueries(std::vector<Vector3<double>> const& vertices)
+{
+    Vector3<double> vmin = vertices[0], vmax = vertices[0];
+    for (auto const& v : vertices)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            vmin[j] = std::min(vmin[j], v[j]);
+            vmax[j] = std::max(vmax[j], v[j]);
+        }
+    }
+    Vector3<double> center = 0.5 * (vmin + vmax);
+    Vector3<double> extent = 0.5 * (vmax - vmin);
+    double maxExtent = std::max(extent[0], std::max(extent[1], extent[2]));
+    for (int j = 0; j < 3; ++j)
+    {
+        extent[j] = std::max(extent[j], 0.1 * maxExtent);
+    }
+
+    std::uniform_real_distribution<double> uniform(-1.2, 1.2);
+    mPoints.resize(mNumQueries);
+    mRays.resize(mNumQueries);
+    for (int q = 0; q < mNumQueries; ++q)
+    {
+        mPoints[q] = center + Vector3<double>{ uniform(mGenerator) * extent[0],
+            uniform(mGenerator) * extent[1], uniform(mGenerator) * extent[2] };
+        Vector3<double> direction{ uniform(mGenerator), uniform(mGenerator),
+            uniform(mGenerator) };
+        mRays[q] = Ray3<double>(mPoints[q], direction);
+    }
+}
@@ -0,0 +1,54 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteAABBTreeOfTriangles.h>
+#include <random>
+#include <string>
+using namespace gte;
+
+// A headless comparison of AABBTreeOfTriangles and brute-force queries.
+// The meshes are
+//   brain      Samples/Data/Brain_V4098_T8192.binary (requires GTE_PATH)
+//   height<n>  z = 0.1*sin(10x)*cos(7y) on an n-by-n grid in [0,1]^2
+//   sphere<n>  a UV sphere with n rings and 2n segments
+//   soup<n>    n random triangles of size about 0.02 in the unit cube
+// The query points are uniform in the mesh bounding box grown by 20%, and
+// the ray directions are uniform in a cube.  Brute force tests every
+// triangle with the same DCPQuery and FIQuery on the first queries, and
+// the results are compared to those of the tree.
+
+class AABBTreeBenchmark
+{
+public:
+    AABBTreeBenchmark(int numQueries);
+
+    // The return value is the number of queries for which the tree and
+    // brute force disagree.
+    int Run(std::string const& name, std::vector<Vector3<double>> const& vertices,
+        std::vector<int> const& indices, int numBruteQueries);
+
+    static void CreateHeightField(int n, std::vector<Vector3<double>>& vertices,
+        std::vector<int>& indices);
+
+    static void CreateSphere(int n, std::vector<Vector3<double>>& vertices,
+        std::vector<int>& indices);
+
+    void CreateSoup(int n, std::vector<Vector3<double>>& vertices,
+        std::vector<int>& indices);
+
+private:
+    typedef AABBTreeOfTriangles<double> Tree;
+
+    void CreateQueries(std::vector<Vector3<double>> const& vertices);
+
+    int mNumQueries;
+    std::mt19937 mGenerator;
+    std::vector<Vector3<double>> mPoints;
+    std::vector<Ray3<double>> mRays;
+};
@@ -0,0 +1,117 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "ConvexHull2Benchmark.h"
+#include <LowLevel/GteTimer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char const* argv[])
+{
+    // ConvexHull2Benchmark [numPoints [numThreads]]
+    int numPoints = (argc > 1 ? std::atoi(argv[1]) : 10000000);
+    unsigned int numThreads = (argc > 2 ?
+        static_cast<unsigned int>(std::atoi(argv[2])) : 1);
+
+    ConvexHull2Benchmark benchmark(numThreads);
+    std::printf("%d points, %u threads\n", numPoints, std::max(numThreads, 1u));
+    std::printf("%-9s %9s %10s %7s %11s %9s\n", "input", "prefilter",
+        "time (ms)", "hull", "kept", "kept (%)");
+
+    int numDifferent = 0;
+    std::vector<Vector2<float>> points;
+    for (auto const& name : { "square", "disk", "gauss", "clusters", "ring" })
+    {
+        benchmark.CreatePoints(name, numPoints, points);
+        numDifferent += benchmark.Run(name, points);
+    }
+    return (numDifferent == 0 ? 0 : 1);
+}
+
+ConvexHull2Benchmark::ConvexHull2Benchmark(unsigned int numThreads)
+    :
+    mNumThreads(std::max(numThreads, 1u)),
+    mGenerator(11)
+{
+}
+
+int ConvexHull2Benchmark::Run(std::string const& name,
+    std::vector<Vector2<float>> const& points)
+{
+    int const numPoints = static_cast<int>(points.size());
+    std::vector<int> reference;
+    bool same = true;
+    Timer timer;
+    for (auto usePrefilter : { false, true })
+    {
+        Hull hull(mNumThreads, usePrefilter);
+        timer.Reset();
+        hull(numPoints, points.data(), 0.0f);
+        double time = 1e-6 * timer.GetNanoseconds();
+
+        // The first vertex of the counterclockwise list is not unique, so
+        // the hulls are compared as sets of vertices.
+        std::vector<int> vertices = hull.GetHull();
+        std::sort(vertices.begin(), vertices.end());
+        if (!usePrefilter)
+        {
+            reference = vertices;
+        }
+        else
+        {
+            same = (vertices == reference);
+        }
+
+        int numKept = hull.GetNumUniquePoints();
+        std::printf("%-9s %9s %10.1f %7d %11d %9.4f%s\n", name.c_str(),
+            usePrefilter ? "on" : "off", time, static_cast<int>(vertices.size()),
+            numKept, 100.0 * numKept / numPoints, same ? "" : "  different hull");
+        std::fflush(stdout);
+    }
+    return (same ? 0 : 1);
+}
+
+void ConvexHull2Benchmark::CreatePoints(std::string const& name,
+    int numPoints, std::vector<Vector2<float>>& points)
+{
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    points.resize(numPoints);
+    for (auto& point : points)
+    {
+        if (name == "square")
+        {
+            point = { uniform(mGenerator), uniform(mGenerator) };
+        }
+        else if (name == "disk")
+        {
+            do
+            {
+                point = { uniform(mGenerator), uniform(mGenerator) };
+            } while (Dot(point, point) > 1.0f);
+        }
+        else if (name == "gauss")
+        {
+            point = { normal(mGenerator), normal(mGenerator) };
+        }
+        else if (name == "clusters")
+        {
+            int c = static_cast<int>(mGenerator() % 16);
+            float x = 3.0f * (c % 4) + (c == 5 ? 6.0f : 0.0f);
+            float y = 3.0f * (c / 4);
+            point = { x + 0.2f * normal(mGenerator), y + 0.2f * normal(mGenerator) };
+        }
+        else  // ring
+        {
+            float angle = static_cast<float>(GTE_C_PI) * uniform(mGenerator);
+            float radius = 1.0f - 0.001f * std::fabs(uniform(mGenerator));
+            point = { radius * std::cos(angle), radius * std::sin(angle) };
+        }
+    }
+}
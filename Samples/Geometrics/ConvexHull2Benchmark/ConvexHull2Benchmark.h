@@ -0,0 +1,44 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteArbitraryPrecision.h>
+#include <Mathematics/GteConvexHull2.h>
+#include <random>
+#include <string>
+using namespace gte;
+
+// A headless benchmark of ConvexHull2 with and without the Akl-Toussaint
+// prefilter.  The inputs are float points with exact BSNumber arithmetic.
+//   square    uniform in [-1,1]^2
+//   disk      uniform in the unit disk
+//   gauss     standard normal in each coordinate
+//   clusters  16 gaussian clusters on a grid, one of them displaced
+//   ring      uniform on a thin annulus, so many points are near the hull
+// For each input the hull is computed without and then with the prefilter,
+// and the two hulls are compared as vertex sets.
+
+class ConvexHull2Benchmark
+{
+public:
+    ConvexHull2Benchmark(unsigned int numThreads);
+
+    // The return value is 1 when the hulls with and without the prefilter
+    // differ, 0 otherwise.
+    int Run(std::string const& name, std::vector<Vector2<float>> const& points);
+
+    void CreatePoints(std::string const& name, int numPoints,
+        std::vector<Vector2<float>>& points);
+
+private:
+    typedef BSNumber<UIntegerFP32<18>> Rational;
+    typedef ConvexHull2<float, Rational> Hull;
+
+    unsigned int mNumThreads;
+    std::mt19937 mGenerator;
+};
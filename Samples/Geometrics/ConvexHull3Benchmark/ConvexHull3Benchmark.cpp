@@ -0,0 +1,113 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "ConvexHull3Benchmark.h"
+#include <LowLevel/GteTimer.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+int main(int argc, char const* argv[])
+{
+    // ConvexHull3Benchmark [numPoints [maxThreads]]
+    int numPoints = (argc > 1 ? std::atoi(argv[1]) : 200000);
+    unsigned int maxThreads = (argc > 2 ?
+        static_cast<unsigned int>(std::atoi(argv[2])) :
+        std::max(std::thread::hardware_concurrency(), 1u));
+
+    ConvexHull3Benchmark benchmark(maxThreads);
+    std::printf("%d points, %u hardware threads\n", numPoints,
+        std::thread::hardware_concurrency());
+    std::printf("%-8s %8s %8s %10s %8s\n", "input", "threads", "faces",
+        "time (ms)", "speedup");
+
+    int numDifferent = 0;
+    std::vector<Vector3<float>> points;
+    for (auto const& name : { "cube", "ball", "sphere", "gauss" })
+    {
+        benchmark.CreatePoints(name, numPoints, points);
+        numDifferent += benchmark.Run(name, points);
+    }
+    return (numDifferent == 0 ? 0 : 1);
+}
+
+ConvexHull3Benchmark::ConvexHull3Benchmark(unsigned int maxThreads)
+    :
+    mMaxThreads(std::max(maxThreads, 1u)),
+    mGenerator(5)
+{
+}
+
+int ConvexHull3Benchmark::Run(std::string const& name,
+    std::vector<Vector3<float>> const& points)
+{
+    int const numPoints = static_cast<int>(points.size());
+    std::vector<TriangleKey<true>> reference;
+    double referenceTime = 0.0;
+    int numDifferent = 0;
+    Timer timer;
+    for (unsigned int numThreads = 1; numThreads <= mMaxThreads; numThreads *= 2)
+    {
+        Hull hull(numThreads);
+        timer.Reset();
+        hull(numPoints, points.data(), 0.0f);
+        double time = 1e-6 * timer.GetNanoseconds();
+
+        // The hull is unique, but the order of its faces is not.
+        std::vector<TriangleKey<true>> faces = hull.GetHullUnordered();
+        std::sort(faces.begin(), faces.end());
+        if (numThreads == 1)
+        {
+            reference = faces;
+            referenceTime = time;
+        }
+        else if (faces != reference)
+        {
+            ++numDifferent;
+        }
+
+        std::printf("%-8s %8u %8d %10.1f %8.2f%s\n", name.c_str(), numThreads,
+            static_cast<int>(faces.size()), time, referenceTime / time,
+            faces == reference ? "" : "  different hull");
+        std::fflush(stdout);
+    }
+    return numDifferent;
+}
+
+void ConvexHull3Benchmark::CreatePoints(std::string const& name,
+    int numPoints, std::vector<Vector3<float>>& points)
+{
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    points.resize(numPoints);
+    for (auto& point : points)
+    {
+        if (name == "cube")
+        {
+            point = { uniform(mGenerator), uniform(mGenerator), uniform(mGenerator) };
+        }
+        else if (name == "ball")
+        {
+            do
+            {
+                point = { uniform(mGenerator), uniform(mGenerator), uniform(mGenerator) };
+            } while (Dot(point, point) > 1.0f);
+        }
+        else if (name == "sphere")
+        {
+            do
+            {
+                point = { normal(mGenerator), normal(mGenerator), normal(mGenerator) };
+            } while (Normalize(point) == 0.0f);
+        }
+        else
+        {
+            point = { normal(mGenerator), normal(mGenerator), normal(mGenerator) };
+        }
+    }
+}
@@ -0,0 +1,43 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteArbitraryPrecision.h>
+#include <Mathematics/GteConvexHull3.h>
+#include <random>
+#include <string>
+using namespace gte;
+
+// A headless benchmark of ConvexHull3 for several numbers of threads.  The
+// inputs are float points with exact BSNumber arithmetic.
+//   cube    uniform in [-1,1]^3
+//   ball    uniform in the unit ball
+//   sphere  on the unit sphere, so every point is a hull vertex
+//   gauss   standard normal in each coordinate
+// For each input the hull is computed with 1, 2, 4, ... threads, and the
+// hull of every run is compared to the hull of the 1-thread run.
+
+class ConvexHull3Benchmark
+{
+public:
+    ConvexHull3Benchmark(unsigned int maxThreads);
+
+    // The return value is the number of runs whose hull differs from the
+    // 1-thread hull.
+    int Run(std::string const& name, std::vector<Vector3<float>> const& points);
+
+    void CreatePoints(std::string const& name, int numPoints,
+        std::vector<Vector3<float>>& points);
+
+private:
+    typedef BSNumber<UIntegerFP32<27>> Rational;
+    typedef ConvexHull3<float, Rational> Hull;
+
+    unsigned int mMaxThreads;
+    std::mt19937 mGenerator;
+};
@@ -0,0 +1,216 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "PointInMeshBenchmark.h"
+#include <Applications/GteEnvironment.h>
+#include <LowLevel/GteTimer.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+
+int main(int argc, char const* argv[])
+{
+    // PointInMeshBenchmark [maxLevel]
+    int maxLevel = (argc > 1 ? std::atoi(argv[1]) : 8);
+
+    PointInMeshBenchmark benchmark;
+    std::printf("1 thread, millions of points per second\n");
+    std::printf("%-8s %7s %5s %8s %8s %9s %9s %11s %9s\n", "mesh", "tris",
+        "grid", "build ms", "grid ms", "grid", "Contains", "Polyhedron",
+        "disagree");
+
+    int numDisagree = 0;
+    std::vector<Vector3<double>> vertices;
+    std::vector<int> indices;
+
+    Environment environment;
+    std::string path = environment.GetVariable("GTE_PATH");
+    if (path != "")
+    {
+        environment.Insert(path + "/Samples/Data/");
+        path = environment.GetPath("Brain_V4098_T8192.binary");
+    }
+    if (path != "")
+    {
+        int const numVertices = 4098, numTriangles = 8192;
+        std::vector<Vector3<float>> positions(numVertices);
+        indices.resize(3 * numTriangles);
+        std::ifstream input(path, std::ios::binary);
+        input.read((char*)positions.data(), positions.size() * sizeof(positions[0]));
+        input.read((char*)indices.data(), indices.size() * sizeof(indices[0]));
+        input.close();
+        vertices.resize(numVertices);
+        for (int i = 0; i < numVertices; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                vertices[i][j] = positions[i][j];
+            }
+        }
+        numDisagree += benchmark.Run("brain", vertices, indices, { 64, 128, 256 });
+    }
+    else
+    {
+        std::printf("brain    skipped, set GTE_PATH to the GTEngine folder\n");
+    }
+
+    if (maxLevel >= 6)
+    {
+        PointInMeshBenchmark::CreateSphere(6, vertices, indices);
+        numDisagree += benchmark.Run("sphere6", vertices, indices, { 64, 128, 256 });
+    }
+
+    if (maxLevel >= 8)
+    {
+        // PointInPolyhedron3 tests every face, so the sampled rows alone
+        // take minutes at this size.
+        PointInMeshBenchmark::CreateSphere(8, vertices, indices);
+        numDisagree += benchmark.Run("sphere8", vertices, indices, { 64 });
+    }
+
+    return (numDisagree == 0 ? 0 : 1);
+}
+
+int PointInMeshBenchmark::Run(std::string const& name,
+    std::vector<Vector3<double>> const& vertices,
+    std::vector<int> const& indices, std::vector<int> const& gridSizes)
+{
+    int const numVertices = static_cast<int>(vertices.size());
+    int const numTriangles = static_cast<int>(indices.size() / 3);
+
+    std::vector<PointInPolyhedron3<double>::TriangleFace> faces(numTriangles);
+    for (int t = 0; t < numTriangles; ++t)
+    {
+        Vector3<double> const& v0 = vertices[indices[3 * t]];
+        Vector3<double> const& v1 = vertices[indices[3 * t + 1]];
+        Vector3<double> const& v2 = vertices[indices[3 * t + 2]];
+        for (int j = 0; j < 3; ++j)
+        {
+            faces[t].indices[j] = indices[3 * t + j];
+        }
+        faces[t].plane = Plane3<double>(UnitCross(v1 - v0, v2 - v0), v0);
+    }
+
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::vector<Vector3<double>> directions(5);
+    for (auto& direction : directions)
+    {
+        direction = { uniform(generator), uniform(generator), uniform(generator) };
+        Normalize(direction);
+    }
+    PointInPolyhedron3<double> polyhedron(numVertices, vertices.data(),
+        numTriangles, faces.data(), 5, directions.data());
+
+    Timer timer;
+    PointInTriangleMesh3<double> mesh(numVertices, vertices.data(),
+        numTriangles, indices.data(), 1);
+    double buildTime = 1e-9 * timer.GetNanoseconds();
+
+    Vector3<double> vmin = vertices[0], vmax = vertices[0];
+    for (auto const& v : vertices)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            vmin[j] = std::min(vmin[j], v[j]);
+            vmax[j] = std::max(vmax[j], v[j]);
+        }
+    }
+
+    int numDisagree = 0;
+    for (int n : gridSizes)
+    {
+        size_t const numNodes = static_cast<size_t>(n) * n * n;
+        std::vector<uint8_t> grid(numNodes);
+        Vector3<double> spacing = (vmax - vmin) / static_cast<double>(n - 1);
+        timer.Reset();
+        mesh.ContainsGrid(vmin, spacing, { n, n, n }, grid.data());
+        double gridTime = 1e-9 * timer.GetNanoseconds();
+
+        double meshTime = 0.0, polyhedronTime = 0.0;
+        size_t numSamples = 0;
+        for (int k = 0; k < n; k += n / 16)
+        {
+            for (int j = 0; j < n; j += n / 16)
+            {
+                for (int i = 0; i < n; ++i)
+                {
+                    Vector3<double> point{ vmin[0] + spacing[0] * i,
+                        vmin[1] + spacing[1] * j, vmin[2] + spacing[2] * k };
+                    bool inside = (grid[i + n * (j + static_cast<size_t>(n) * k)] != 0);
+
+                    timer.Reset();
+                    bool meshInside = mesh.Contains(point);
+                    meshTime += 1e-9 * timer.GetNanoseconds();
+
+                    timer.Reset();
+                    bool polyhedronInside = polyhedron.Contains(point);
+                    polyhedronTime += 1e-9 * timer.GetNanoseconds();
+
+                    numDisagree += (meshInside != inside ? 1 : 0);
+                    numDisagree += (polyhedronInside != inside ? 1 : 0);
+                    ++numSamples;
+                }
+            }
+        }
+
+        double const samples = 1e-6 * static_cast<double>(numSamples);
+        std::printf("%-8s %7d %4d^3 %8.1f %8.1f %9.1f %9.2f %11.4f %9d\n",
+            name.c_str(), numTriangles, n, 1000.0 * buildTime,
+            1000.0 * gridTime, 1e-6 * static_cast<double>(numNodes) / gridTime,
+            samples / meshTime, samples / polyhedronTime, numDisagree);
+        std::fflush(stdout);
+    }
+    return numDisagree;
+}
+
+void PointInMeshBenchmark::CreateSphere(int level,
+    std::vector<Vector3<double>>& vertices, std::vector<int>& indices)
+{
+    vertices = { { 1.0, 0.0, 0.0 }, { -1.0, 0.0, 0.0 }, { 0.0, 1.0, 0.0 },
+        { 0.0, -1.0, 0.0 }, { 0.0, 0.0, 1.0 }, { 0.0, 0.0, -1.0 } };
+    indices = { 0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4, 2, 0, 5, 1, 2, 5, 3, 1, 5,
+        0, 3, 5 };
+
+    for (int l = 0; l < level; ++l)
+    {
+        std::map<std::pair<int, int>, int> midpoints;
+        auto Midpoint = [&vertices, &midpoints](int v0, int v1)
+        {
+            auto key = std::make_pair(std::min(v0, v1), std::max(v0, v1));
+            auto iter = midpoints.find(key);
+            if (iter != midpoints.end())
+            {
+                return iter->second;
+            }
+            Vector3<double> midpoint = vertices[v0] + vertices[v1];
+            Normalize(midpoint);
+            vertices.push_back(midpoint);
+            return midpoints[key] = static_cast<int>(vertices.size()) - 1;
+        };
+
+        std::vector<int> subdivided;
+        for (size_t t = 0; t < indices.size(); t += 3)
+        {
+            int v0 = indices[t], v1 = indices[t + 1], v2 = indices[t + 2];
+            int m01 = Midpoint(v0, v1), m12 = Midpoint(v1, v2);
+            int m20 = Midpoint(v2, v0);
+            subdivided.insert(subdivided.end(), { v0, m01, m20, m01, v1, m12,
+                m20, m12, v2, m01, m12, m20 });
+        }
+        indices.swap(subdivided);
+    }
+
+    for (auto& v : vertices)
+    {
+        v[0] *= 1.0 + 0.3 * v[1] * v[1];
+        v[2] *= 0.7;
+    }
+}
@@ -0,0 +1,37 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteContPointInTriangleMesh3.h>
+#include <Mathematics/GteContPointInPolyhedron3.h>
+#include <string>
+using namespace gte;
+
+// A headless comparison of the point-in-mesh queries on n^3 grids that
+// span the mesh bounding box.
+//   ContainsGrid        PointInTriangleMesh3::ContainsGrid on the grid
+//   Contains            PointInTriangleMesh3::Contains per point
+//   PointInPolyhedron3  the TriangleFace constructor with 5 random ray
+//                       directions, per point
+// The per-point queries are timed on every node of 16x16 sampled rows and
+// compared to ContainsGrid.  The meshes are
+//   brain      Samples/Data/Brain_V4098_T8192.binary (requires GTE_PATH)
+//   sphere<L>  an octahedron subdivided L times onto the unit sphere and
+//              stretched to x*(1 + 0.3*y^2), y, 0.7*z
+
+class PointInMeshBenchmark
+{
+public:
+    // The return value is the number of sampled points for which a
+    // per-point query disagrees with ContainsGrid.
+    int Run(std::string const& name, std::vector<Vector3<double>> const& vertices,
+        std::vector<int> const& indices, std::vector<int> const& gridSizes);
+
+    static void CreateSphere(int level, std::vector<Vector3<double>>& vertices,
+        std::vector<int>& indices);
+};
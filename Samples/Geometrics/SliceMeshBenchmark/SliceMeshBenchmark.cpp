@@ -0,0 +1,148 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "SliceMeshBenchmark.h"
+#include <LowLevel/GteTimer.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char const* argv[])
+{
+    // SliceMeshBenchmark [numPlanes [numThreads]]
+    int numPlanes = (argc > 1 ? std::atoi(argv[1]) : 1000);
+    unsigned int numThreads = (argc > 2 ?
+        static_cast<unsigned int>(std::atoi(argv[2])) : 1);
+
+    SliceMeshBenchmark benchmark(numThreads);
+    std::printf("%d planes, %u threads for SliceMeshByPlanes\n", numPlanes,
+        std::max(numThreads, 1u));
+    std::printf("%-12s %-6s %8s %8s %9s %10s %8s %8s %8s\n", "mesh", "planes",
+        "tris", "setup ms", "slice ms", "split ms", "speedup", "open",
+        "mismatch");
+
+    int numErrors = 0;
+    benchmark.CreateTorus(400, 200);
+    numErrors += benchmark.Run("torus160k", numPlanes, true);
+    numErrors += benchmark.Run("torus160k", numPlanes, false);
+    benchmark.CreateTorus(1000, 500);
+    numErrors += benchmark.Run("torus1M", numPlanes, true);
+    numErrors += benchmark.Run("torus1M", numPlanes, false);
+    return (numErrors == 0 ? 0 : 1);
+}
+
+SliceMeshBenchmark::SliceMeshBenchmark(unsigned int numThreads)
+    :
+    mNumThreads(std::max(numThreads, 1u)),
+    mNumSegments(0)
+{
+}
+
+int SliceMeshBenchmark::Run(std::string const& name, int numPlanes, bool tilted)
+{
+    Vector3<double> normal = (tilted ? Vector3<double>{ 0.3, 0.1, 1.0 } :
+        Vector3<double>{ 0.0, 0.0, 1.0 });
+
+    std::vector<double> constants(numPlanes);
+    if (tilted)
+    {
+        double hmin = Dot(normal, mVertices[0]), hmax = hmin;
+        for (auto const& vertex : mVertices)
+        {
+            double h = Dot(normal, vertex);
+            hmin = std::min(hmin, h);
+            hmax = std::max(hmax, h);
+        }
+        for (int i = 0; i < numPlanes; ++i)
+        {
+            constants[i] = hmin + (hmax - hmin) * (i + 0.5) / numPlanes;
+        }
+    }
+    else
+    {
+        for (int i = 0; i < numPlanes; ++i)
+        {
+            constants[i] = Dot(normal, mVertices[i % mNumSegments]);
+        }
+    }
+
+    Timer timer;
+    SliceMeshByPlanes<double> slicer(mNumThreads);
+    slicer.SetMesh(mVertices, mIndices, normal);
+    double setupTime = 1e-6 * timer.GetNanoseconds();
+    timer.Reset();
+    std::vector<std::vector<Polyline>> contours;
+    slicer(constants, contours);
+    double sliceTime = 1e-6 * timer.GetNanoseconds();
+
+    // The reference is one SplitMeshByPlane call per plane.
+    int const numVertices = static_cast<int>(mVertices.size());
+    int numMismatches = 0, numOpen = 0;
+    double splitTime = 0.0;
+    SplitMeshByPlane<double> splitter;
+    std::vector<Vector3<double>> clipVertices;
+    std::vector<int> negIndices, posIndices;
+    for (int i = 0; i < numPlanes; ++i)
+    {
+        // SplitMeshByPlane appends to the index arrays.
+        negIndices.clear();
+        posIndices.clear();
+        timer.Reset();
+        splitter(mVertices, mIndices, Plane3<double>(normal, constants[i]),
+            clipVertices, negIndices, posIndices);
+        splitTime += 1e-6 * timer.GetNanoseconds();
+
+        int numPoints = 0;
+        for (auto const& polyline : contours[i])
+        {
+            numPoints += static_cast<int>(polyline.vertices.size());
+            numOpen += (polyline.closed ? 0 : 1);
+        }
+        if (tilted && numPoints != static_cast<int>(clipVertices.size()) - numVertices)
+        {
+            ++numMismatches;
+        }
+    }
+
+    std::printf("%-12s %-6s %8d %8.1f %9.1f %10.1f %8.1f %8d %8d\n",
+        name.c_str(), tilted ? "tilted" : "axis",
+        static_cast<int>(mIndices.size() / 3), setupTime, sliceTime,
+        splitTime, splitTime / (setupTime + sliceTime), numOpen,
+        numMismatches);
+    std::fflush(stdout);
+    return numMismatches + numOpen;
+}
+
+void SliceMeshBenchmark::CreateTorus(int numRings, int numSegments)
+{
+    mNumSegments = numSegments;
+    mVertices.resize(static_cast<size_t>(numRings) * numSegments);
+    for (int i = 0, v = 0; i < numRings; ++i)
+    {
+        double u = GTE_C_TWO_PI * i / numRings;
+        for (int j = 0; j < numSegments; ++j, ++v)
+        {
+            double w = GTE_C_TWO_PI * j / numSegments;
+            double r = 2.0 + std::cos(w);
+            mVertices[v] = { r * std::cos(u), r * std::sin(u), std::sin(w) };
+        }
+    }
+
+    mIndices.clear();
+    mIndices.reserve(6 * mVertices.size());
+    for (int i0 = 0; i0 < numRings; ++i0)
+    {
+        int i1 = (i0 + 1) % numRings;
+        for (int j0 = 0; j0 < numSegments; ++j0)
+        {
+            int j1 = (j0 + 1) % numSegments;
+            int v00 = i0 * numSegments + j0, v10 = i1 * numSegments + j0;
+            int v11 = i1 * numSegments + j1, v01 = i0 * numSegments + j1;
+            mIndices.insert(mIndices.end(), { v00, v10, v11, v00, v11, v01 });
+        }
+    }
+}
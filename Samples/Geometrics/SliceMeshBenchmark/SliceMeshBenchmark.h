@@ -0,0 +1,43 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteSliceMeshByPlanes.h>
+#include <string>
+using namespace gte;
+
+// A headless benchmark of SliceMeshByPlanes against a loop of
+// SplitMeshByPlane calls, one per plane, for torus meshes cut by 1000
+// parallel planes.  Two families of planes are used.
+//   tilted  normal (0.3,0.1,1), planes at the centers of 1000 equal
+//           subintervals of the height range, so no vertex is on a plane
+//   axis    normal (0,0,1), each plane containing a ring of vertices
+// For the tilted planes, the number of contour points of each plane is
+// compared to the number of edge-plane intersections computed by
+// SplitMeshByPlane.  The contours of a torus are closed, so the number of
+// open polylines is reported for both families.
+
+class SliceMeshBenchmark
+{
+public:
+    SliceMeshBenchmark(unsigned int numThreads);
+
+    // The return value is the number of planes whose contours do not match
+    // SplitMeshByPlane plus the number of open polylines.
+    int Run(std::string const& name, int numPlanes, bool tilted);
+
+    void CreateTorus(int numRings, int numSegments);
+
+private:
+    typedef SliceMeshByPlanes<double>::Polyline Polyline;
+
+    unsigned int mNumThreads;
+    int mNumSegments;
+    std::vector<Vector3<double>> mVertices;
+    std::vector<int> mIndices;
+};
@@ -0,0 +1,160 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "LCPBatchBenchmark.h"
+#include <LowLevel/GteTimer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char const* argv[])
+{
+    // LCPBatchBenchmark [numProblems [numThreads]]
+    int numProblems = (argc > 1 ? std::atoi(argv[1]) : 10000);
+    unsigned int numThreads = (argc > 2 ?
+        static_cast<unsigned int>(std::atoi(argv[2])) : 1);
+
+    LCPBatchBenchmark benchmark(numProblems, numThreads);
+    std::printf("%d problems per size, %u threads, microseconds per problem\n",
+        numProblems, numThreads);
+    std::printf("%3s %10s %8s %8s %8s %9s %10s\n", "n", "LCPSolver", "cold",
+        "eps", "warm", "hit rate", "residual");
+    for (int n : { 4, 8, 12 })
+    {
+        benchmark.Run(n);
+    }
+    return 0;
+}
+
+LCPBatchBenchmark::LCPBatchBenchmark(int numProblems, unsigned int numThreads)
+    :
+    mNumProblems(numProblems),
+    mNumThreads(numThreads),
+    mGenerator(3),
+    mUniform(-1.0, 1.0)
+{
+}
+
+void LCPBatchBenchmark::Run(int n)
+{
+    CreateProblems(n);
+    double const invNumProblems = 1.0 / static_cast<double>(mNumProblems);
+    Timer timer;
+
+    // One LCPSolver call per problem.
+    LCPSolver<double> single(n);
+    std::vector<double> q(n), M(n * n), w(n), z(n);
+    timer.Reset();
+    for (int p = 0; p < mNumProblems; ++p)
+    {
+        std::copy(mQ.begin() + p * n, mQ.begin() + (p + 1) * n, q.begin());
+        std::copy(mM.begin() + p * n * n, mM.begin() + (p + 1) * n * n,
+            M.begin());
+        single.Solve(q, M, w, z);
+    }
+    double singleTime = static_cast<double>(timer.GetNanoseconds()) *
+        1e-3 * invNumProblems;
+
+    // The batch solver from an all-zero basis.
+    LCPBatchSolver<double> batch(n, mNumThreads);
+    std::vector<uint8_t> basis(mQ.size(), 0);
+    timer.Reset();
+    batch.Solve(mNumProblems, mQ.data(), mM.data(), mW.data(), mZ.data(),
+        nullptr, basis.data());
+    double coldTime = static_cast<double>(timer.GetNanoseconds()) *
+        1e-3 * invNumProblems;
+
+    // Warm starts after perturbations of q.
+    std::vector<double> q0 = mQ;
+    bool first = true;
+    for (double eps : { 0.0, 1e-3, 1e-2, 1e-1, 1.0 })
+    {
+        std::vector<uint8_t> warmBasis = basis;
+        for (size_t i = 0; i < mQ.size(); ++i)
+        {
+            mQ[i] = q0[i] + eps * mUniform(mGenerator);
+        }
+        timer.Reset();
+        batch.Solve(mNumProblems, mQ.data(), mM.data(), mW.data(),
+            mZ.data(), nullptr, warmBasis.data());
+        double warmTime = static_cast<double>(timer.GetNanoseconds()) *
+            1e-3 * invNumProblems;
+        double hitRate = 100.0 * static_cast<double>(
+            batch.GetNumWarmStarts()) * invNumProblems;
+
+        if (first)
+        {
+            std::printf("%3d %10.2f %8.2f", n, singleTime, coldTime);
+            first = false;
+        }
+        else
+        {
+            std::printf("%3s %10s %8s", "", "", "");
+        }
+        std::printf(" %8g %8.2f %8.1f%% %10.1e\n", eps, warmTime, hitRate,
+            GetResidual(n));
+    }
+}
+
+void LCPBatchBenchmark::CreateProblems(int n)
+{
+    mQ.resize(mNumProblems * n);
+    mM.resize(mNumProblems * n * n);
+    mW.resize(mNumProblems * n);
+    mZ.resize(mNumProblems * n);
+
+    std::vector<double> A(n * n);
+    for (int p = 0; p < mNumProblems; ++p)
+    {
+        for (auto& a : A)
+        {
+            a = mUniform(mGenerator);
+        }
+
+        double* M = &mM[p * n * n];
+        for (int r = 0; r < n; ++r)
+        {
+            for (int c = 0; c < n; ++c)
+            {
+                double sum = (r == c ? 0.5 : 0.0);
+                for (int k = 0; k < n; ++k)
+                {
+                    sum += A[r * n + k] * A[c * n + k];
+                }
+                M[r * n + c] = sum;
+            }
+        }
+
+        for (int r = 0; r < n; ++r)
+        {
+            mQ[p * n + r] = mUniform(mGenerator);
+        }
+    }
+}
+
+double LCPBatchBenchmark::GetResidual(int n) const
+{
+    double residual = 0.0;
+    for (int p = 0; p < mNumProblems; ++p)
+    {
+        double const* M = &mM[p * n * n];
+        double const* w = &mW[p * n];
+        double const* z = &mZ[p * n];
+        for (int r = 0; r < n; ++r)
+        {
+            double sum = mQ[p * n + r];
+            for (int c = 0; c < n; ++c)
+            {
+                sum += M[r * n + c] * z[c];
+            }
+            residual = std::max(residual, std::fabs(sum - w[r]));
+            residual = std::max(residual, std::max(-w[r], -z[r]));
+        }
+    }
+    return residual;
+}
@@ -0,0 +1,40 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteLCPBatchSolver.h>
+#include <random>
+using namespace gte;
+
+// A headless comparison of LCPSolver and LCPBatchSolver.  The problems
+// have M = A*A^T + 0.5*I with A uniform in [-1,1] and q uniform in [-1,1].
+// The table lists the microseconds per problem for
+//   LCPSolver  the single-problem solver called once per problem
+//   cold       LCPBatchSolver with an all-zero basis array
+//   warm       LCPBatchSolver started from the bases of the cold solve,
+//              after each q[i] is perturbed by a uniform value in [-eps,eps]
+// The hit rate is the percentage of problems for which the warm start was
+// accepted.  The residual is the largest of |q + M*z - w|, -w and -z.
+
+class LCPBatchBenchmark
+{
+public:
+    LCPBatchBenchmark(int numProblems, unsigned int numThreads);
+
+    void Run(int n);
+
+private:
+    void CreateProblems(int n);
+    double GetResidual(int n) const;
+
+    int mNumProblems;
+    unsigned int mNumThreads;
+    std::mt19937 mGenerator;
+    std::uniform_real_distribution<double> mUniform;
+    std::vector<double> mQ, mM, mW, mZ;
+};
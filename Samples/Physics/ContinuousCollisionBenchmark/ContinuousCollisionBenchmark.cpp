@@ -0,0 +1,259 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "ContinuousCollisionBenchmark.h"
+#include <LowLevel/GteTimer.h>
+#include <Mathematics/GteRotation.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+int main(int argc, char const* argv[])
+{
+    // ContinuousCollisionBenchmark [numPairs [numThreads]]
+    int numPairs = (argc > 1 ? std::atoi(argv[1]) : 100000);
+    unsigned int numThreads = (argc > 2 ?
+        static_cast<unsigned int>(std::atoi(argv[2])) :
+        std::max(std::thread::hardware_concurrency(), 1u));
+
+    // 36000 objects in a cube of size 40 have about 105000 overlapping
+    // swept boxes.
+    ContinuousCollisionBenchmark benchmark(36000, 40.0f);
+    return (benchmark.Run(numPairs, numThreads, 100) == 0 ? 0 : 1);
+}
+
+ContinuousCollisionBenchmark::ContinuousCollisionBenchmark(int numObjects,
+    float cubeSize)
+    :
+    mObjects(numObjects)
+{
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    for (int i = 0; i < numObjects; ++i)
+    {
+        Object& object = mObjects[i];
+        Vector3<float> center{ cubeSize * uniform(generator),
+            cubeSize * uniform(generator), cubeSize * uniform(generator) };
+        object.velocity = { 10.0f * uniform(generator) - 5.0f,
+            10.0f * uniform(generator) - 5.0f, 10.0f * uniform(generator) - 5.0f };
+        if (i % 5 < 3)
+        {
+            object.type = Collision::SPHERE;
+            object.sphere = Sphere3<float>(center, 0.2f + 0.3f * uniform(generator));
+        }
+        else if (i % 5 == 3)
+        {
+            object.type = Collision::BOX;
+            Quaternion<float> q{ uniform(generator) - 0.5f,
+                uniform(generator) - 0.5f, uniform(generator) - 0.5f,
+                uniform(generator) - 0.5f };
+            Normalize(q);
+            Matrix<3, 3, float> rotate = Rotation<3, float>(q);
+            object.box.center = center;
+            for (int k = 0; k < 3; ++k)
+            {
+                object.box.axis[k] = rotate.GetCol(k);
+            }
+            object.box.extent = { 0.3f, 0.2f, 0.4f };
+        }
+        else
+        {
+            object.type = Collision::TRIANGLE;
+            for (int k = 0; k < 3; ++k)
+            {
+                object.triangle.v[k] = center + Vector3<float>{
+                    uniform(generator) - 0.5f, uniform(generator) - 0.5f,
+                    uniform(generator) - 0.5f };
+            }
+        }
+    }
+}
+
+int ContinuousCollisionBenchmark::Run(int maxPairs, unsigned int numThreads,
+    int numRepetitions)
+{
+    float const tMax = 0.1f;
+    Collision collision1(1), collisionN(std::max(numThreads, 1u));
+    for (auto const& object : mObjects)
+    {
+        for (auto collision : { &collision1, &collisionN })
+        {
+            if (object.type == Collision::SPHERE)
+            {
+                collision->AddSphere(object.sphere, object.velocity);
+            }
+            else if (object.type == Collision::BOX)
+            {
+                collision->AddBox(object.box, object.velocity);
+            }
+            else
+            {
+                collision->AddTriangle(object.triangle, object.velocity);
+            }
+        }
+    }
+
+    int const numObjects = static_cast<int>(mObjects.size());
+    std::vector<AlignedBox3<float>> boxes(numObjects);
+    for (int i = 0; i < numObjects; ++i)
+    {
+        boxes[i] = collision1.GetSweptBox(i, tMax);
+    }
+    BoxManager<float> manager(boxes);
+    std::vector<EdgeKey<false>> pairs = manager.GetOverlapArray();
+    if (static_cast<int>(pairs.size()) > maxPairs)
+    {
+        pairs.resize(maxPairs);
+    }
+
+    Timer timer;
+    std::vector<Collision::Contact> reference;
+    for (int r = 0; r < numRepetitions; ++r)
+    {
+        FindContacts(pairs, tMax, reference);
+    }
+    double referenceTime = 1e-6 * timer.GetNanoseconds() / numRepetitions;
+
+    timer.Reset();
+    for (int r = 0; r < numRepetitions; ++r)
+    {
+        collision1.Update(pairs, tMax);
+    }
+    double time1 = 1e-6 * timer.GetNanoseconds() / numRepetitions;
+
+    timer.Reset();
+    for (int r = 0; r < numRepetitions; ++r)
+    {
+        collisionN.Update(pairs, tMax);
+    }
+    double timeN = 1e-6 * timer.GetNanoseconds() / numRepetitions;
+
+    bool equal1 = Equal(collision1.GetContacts(), reference);
+    bool equalN = Equal(collisionN.GetContacts(), reference);
+
+    std::printf("%d objects, %d pairs, %d contacts, %d pairs unsupported\n",
+        numObjects, static_cast<int>(pairs.size()),
+        static_cast<int>(reference.size()),
+        static_cast<int>(collision1.GetNumUnsupported()));
+    std::printf("%-22s %8s %9s %8s %8s\n", "method", "threads", "time (ms)",
+        "speedup", "contacts");
+    std::printf("%-22s %8d %9.2f %8s %8s\n", "per-pair queries", 1,
+        referenceTime, "1.00", "-");
+    std::printf("%-22s %8d %9.2f %8.2f %8s\n", "ContinuousCollision", 1,
+        time1, referenceTime / time1, equal1 ? "equal" : "differ");
+    std::printf("%-22s %8u %9.2f %8.2f %8s\n", "ContinuousCollision",
+        std::max(numThreads, 1u), timeN, referenceTime / timeN,
+        equalN ? "equal" : "differ");
+    return (equal1 ? 0 : 1) + (equalN ? 0 : 1);
+}
+
+void ContinuousCollisionBenchmark::FindContacts(
+    std::vector<EdgeKey<false>> const& pairs, float tMax,
+    std::vector<Collision::Contact>& contacts) const
+{
+    contacts.clear();
+    for (auto const& pair : pairs)
+    {
+        Collision::Contact contact;
+        contact.object0 = pair.V[0];
+        contact.object1 = pair.V[1];
+        contact.intersectionType = 0;
+        Object const* object0 = &mObjects[pair.V[0]];
+        Object const* object1 = &mObjects[pair.V[1]];
+        if (object0->type > object1->type)
+        {
+            std::swap(object0, object1);
+        }
+
+        if (object0->type == Collision::SPHERE
+            && object1->type == Collision::SPHERE)
+        {
+            Sphere3<float> const& sphere0 = object0->sphere;
+            Sphere3<float> const& sphere1 = object1->sphere;
+            Vector3<float> D = sphere1.center - sphere0.center;
+            Vector3<float> V = object1->velocity - object0->velocity;
+            float radiusSum = sphere0.radius + sphere1.radius;
+            float c = Dot(D, D) - radiusSum * radiusSum;
+            if (c <= 0.0f)
+            {
+                contact.intersectionType = -1;
+                contact.time = 0.0f;
+            }
+            else
+            {
+                float b = Dot(D, V), discr = b * b - Dot(V, V) * c;
+                if (b < 0.0f && discr >= 0.0f)
+                {
+                    contact.intersectionType = +1;
+                    contact.time = c / (std::sqrt(discr) - b);
+                }
+            }
+        }
+        else if (object0->type == Collision::SPHERE
+            && object1->type == Collision::BOX)
+        {
+            FIQuery<float, OrientedBox3<float>, Sphere3<float>> query;
+            auto result = query(object1->box, object1->velocity,
+                object0->sphere, object0->velocity);
+            contact.time = result.contactTime;
+            contact.intersectionType = result.intersectionType;
+        }
+        else if (object0->type == Collision::SPHERE
+            && object1->type == Collision::TRIANGLE)
+        {
+            FIQuery<float, Sphere3<float>, Triangle3<float>> query;
+            auto result = query(object0->sphere, object0->velocity,
+                object1->triangle, object1->velocity);
+            contact.time = result.contactTime;
+            contact.intersectionType = result.intersectionType;
+        }
+
+        if (contact.intersectionType != 0 && contact.time >= 0.0f
+            && contact.time <= tMax)
+        {
+            contacts.push_back(contact);
+        }
+    }
+
+    std::sort(contacts.begin(), contacts.end(),
+        [](Collision::Contact const& contact0, Collision::Contact const& contact1)
+        {
+            if (contact0.time != contact1.time)
+            {
+                return contact0.time < contact1.time;
+            }
+            if (contact0.object0 != contact1.object0)
+            {
+                return contact0.object0 < contact1.object0;
+            }
+            return contact0.object1 < contact1.object1;
+        });
+}
+
+bool ContinuousCollisionBenchmark::Equal(
+    std::vector<Collision::Contact> const& contacts0,
+    std::vector<Collision::Contact> const& contacts1)
+{
+    if (contacts0.size() != contacts1.size())
+    {
+        return false;
+    }
+    for (size_t k = 0; k < contacts0.size(); ++k)
+    {
+        Collision::Contact const& c0 = contacts0[k];
+        Collision::Contact const& c1 = contacts1[k];
+        if (c0.time != c1.time || c0.object0 != c1.object0
+            || c0.object1 != c1.object1
+            || c0.intersectionType != c1.intersectionType)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,53 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Physics/GteBoxManager.h>
+#include <Physics/GteContinuousCollision.h>
+#include <random>
+using namespace gte;
+
+// A headless benchmark of ContinuousCollision for 100000 candidate pairs.
+// Random spheres, oriented boxes and triangles (3:1:1) move with random
+// velocities in a cube, and the candidate pairs are the overlapping swept
+// boxes reported by BoxManager.  The reference is a loop that calls the
+// dynamic FIQuery of each pair, solves the quadratic for two spheres and
+// sorts the contacts by time, which is what an application does without
+// ContinuousCollision.  The contacts of ContinuousCollision are compared
+// to the reference for 1 thread and for the specified number of threads.
+
+class ContinuousCollisionBenchmark
+{
+public:
+    ContinuousCollisionBenchmark(int numObjects, float cubeSize);
+
+    // The return value is the number of runs whose contacts differ from
+    // the reference.
+    int Run(int maxPairs, unsigned int numThreads, int numRepetitions);
+
+private:
+    typedef ContinuousCollision<float> Collision;
+
+    struct Object
+    {
+        Collision::ObjectType type;
+        Sphere3<float> sphere;
+        OrientedBox3<float> box;
+        Triangle3<float> triangle;
+        Vector3<float> velocity;
+    };
+
+    // The per-pair queries.
+    void FindContacts(std::vector<EdgeKey<false>> const& pairs, float tMax,
+        std::vector<Collision::Contact>& contacts) const;
+
+    static bool Equal(std::vector<Collision::Contact> const& contacts0,
+        std::vector<Collision::Contact> const& contacts1);
+
+    std::vector<Object> mObjects;
+};
@@ -0,0 +1,272 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "MassSpringBenchmark.h"
+#include <LowLevel/GteTimer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+
+int main(int argc, char const* argv[])
+{
+    // MassSpringBenchmark [numThreads]
+    unsigned int numThreads = (argc > 1 ?
+        static_cast<unsigned int>(std::atoi(argv[1])) : 1);
+
+    MassSpringBenchmark benchmark(numThreads);
+    std::printf("1 second of simulated time, %u threads\n",
+        std::max(numThreads, 1u));
+    std::printf("%-6s %-9s %7s %6s %10s %9s %10s %12s\n", "system", "method",
+        "step", "steps", "time (ms)", "CG iters", "state", "max distance");
+
+    // The first run of each system is the reference.
+    int numFailures = 0;
+    numFailures += benchmark.Run("cloth", false, 0.0005f, true);
+    numFailures += benchmark.Run("cloth", false, 0.01f, false);
+    numFailures += benchmark.Run("cloth", true, 0.01f, true);
+    numFailures += benchmark.Run("cloth", true, 0.05f, true);
+    numFailures += benchmark.Run("gel", false, 0.002f, true);
+    numFailures += benchmark.Run("gel", false, 0.05f, false);
+    numFailures += benchmark.Run("gel", true, 0.05f, true);
+    numFailures += benchmark.Run("gel", true, 0.1f, true);
+    return (numFailures == 0 ? 0 : 1);
+}
+
+MassSpringBenchmark::MassSpringBenchmark(unsigned int numThreads)
+    :
+    mNumThreads(std::max(numThreads, 1u))
+{
+}
+
+int MassSpringBenchmark::Run(std::string const& name, bool implicit,
+    float step, bool expectStable)
+{
+    double time = 0.0;
+    int numIterations = 0;
+    bool stable = false;
+    std::vector<Vector<3, float>> positions;
+    int const which = (name == "cloth" ? 0 : 1);
+    if (which == 0)
+    {
+        Cloth cloth(32, 64, step, mNumThreads);
+        cloth.SetImplicit(implicit);
+        stable = Simulate(cloth, step, time, numIterations, positions);
+    }
+    else
+    {
+        Gel gel(20, step, mNumThreads);
+        gel.SetImplicit(implicit);
+        stable = Simulate(gel, step, time, numIterations, positions);
+    }
+
+    std::vector<Vector<3, float>>& reference = mReference[which];
+    bool isReference = reference.empty();
+    if (isReference)
+    {
+        reference = positions;
+    }
+
+    float maxDistance = 0.0f;
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        maxDistance = std::max(maxDistance, Length(positions[i] - reference[i]));
+    }
+
+    int const numSteps = static_cast<int>(std::lround(1.0f / step));
+    std::printf("%-6s %-9s %7.4f %6d %10.1f %9.1f %10s ", name.c_str(),
+        implicit ? "implicit" : "RK4", step, numSteps, time,
+        static_cast<double>(numIterations) / numSteps,
+        stable ? "stable" : "diverged");
+    if (isReference)
+    {
+        std::printf("%12s\n", "reference");
+    }
+    else if (stable)
+    {
+        std::printf("%12.2g\n", maxDistance);
+    }
+    else
+    {
+        std::printf("%12s\n", "-");
+    }
+    std::fflush(stdout);
+    return (stable || !expectStable ? 0 : 1);
+}
+
+template <typename System>
+bool MassSpringBenchmark::Simulate(System& system, float step, double& time,
+    int& numIterations, std::vector<Vector<3, float>>& positions)
+{
+    int const numSteps = static_cast<int>(std::lround(1.0f / step));
+    numIterations = 0;
+    Timer timer;
+    for (int k = 0; k < numSteps; ++k)
+    {
+        system.Update(k * step);
+        if (system.GetImplicit())
+        {
+            numIterations += system.GetImplicitSolver().GetNumIterations();
+        }
+    }
+    time = 1e-6 * timer.GetNanoseconds();
+
+    int const numParticles = system.GetNumParticles();
+    positions.resize(numParticles);
+    bool stable = true;
+    for (int i = 0; i < numParticles; ++i)
+    {
+        positions[i] = system.ParticleSystem<3, float>::GetPosition(i);
+        float speed = Length(system.ParticleSystem<3, float>::GetVelocity(i));
+        if (!(speed <= 1e6f))
+        {
+            stable = false;
+        }
+    }
+    return stable;
+}
+
+MassSpringBenchmark::Cloth::Cloth(int numRows, int numCols, float step,
+    unsigned int numThreads)
+    :
+    MassSpringSurface<3, float>(numRows, numCols, step, numThreads)
+{
+    // The top row is immovable.
+    for (int c = 0; c < numCols; ++c)
+    {
+        SetMass(numRows - 1, c, std::numeric_limits<float>::max());
+    }
+    for (int r = 0; r < numRows - 1; ++r)
+    {
+        for (int c = 0; c < numCols; ++c)
+        {
+            SetMass(r, c, 1.0f);
+        }
+    }
+
+    for (int r = 0; r < numRows; ++r)
+    {
+        for (int c = 0; c < numCols; ++c)
+        {
+            SetPosition(r, c, { c / (numCols - 1.0f), 0.0f, r / (numRows - 1.0f) });
+        }
+    }
+
+    for (int r = 0; r < numRows; ++r)
+    {
+        for (int c = 0; c < numCols - 1; ++c)
+        {
+            SetConstantC(r, c, 1e+5f);
+            SetLengthC(r, c, Length(GetPosition(r, c + 1) - GetPosition(r, c)));
+        }
+    }
+    for (int r = 0; r < numRows - 1; ++r)
+    {
+        for (int c = 0; c < numCols; ++c)
+        {
+            SetConstantR(r, c, 1e+4f);
+            SetLengthR(r, c, Length(GetPosition(r + 1, c) - GetPosition(r, c)));
+        }
+    }
+}
+
+Vector<3, float> MassSpringBenchmark::Cloth::ExternalAcceleration(int i,
+    float, std::vector<Vector<3, float>> const&,
+    std::vector<Vector<3, float>> const& velocity)
+{
+    // Gravity, wind and viscous drag.
+    return Vector<3, float>{ 0.5f, 0.0f, -1.0f } - 10.0f * velocity[i];
+}
+
+void MassSpringBenchmark::Cloth::ExternalAccelerations(int imin, int imax,
+    float time, std::vector<Vector<3, float>> const& position,
+    std::vector<Vector<3, float>> const& velocity,
+    std::vector<Vector<3, float>>& acceleration)
+{
+    for (int i = imin; i < imax; ++i)
+    {
+        acceleration[i] = Cloth::ExternalAcceleration(i, time, position, velocity);
+    }
+}
+
+MassSpringBenchmark::Gel::Gel(int size, float step, unsigned int numThreads)
+    :
+    MassSpringVolume<3, float>(size, size, size, step, numThreads)
+{
+    // The boundary particles are immovable and the interior particles
+    // start with random velocities.
+    std::mt19937 generator;
+    std::uniform_real_distribution<float> rnd(-0.1f, 0.1f);
+    float const spacing = 1.0f / (size - 1);
+    for (int s = 0; s < size; ++s)
+    {
+        for (int r = 0; r < size; ++r)
+        {
+            for (int c = 0; c < size; ++c)
+            {
+                SetPosition(s, r, c, { c * spacing, r * spacing, s * spacing });
+                if (0 < s && s < size - 1 && 0 < r && r < size - 1
+                    && 0 < c && c < size - 1)
+                {
+                    SetMass(s, r, c, 1.0f);
+                    SetVelocity(s, r, c, { rnd(generator), rnd(generator),
+                        rnd(generator) });
+                }
+                else
+                {
+                    SetMass(s, r, c, std::numeric_limits<float>::max());
+                }
+            }
+        }
+    }
+
+    for (int s = 0; s < size; ++s)
+    {
+        for (int r = 0; r < size; ++r)
+        {
+            for (int c = 0; c < size; ++c)
+            {
+                if (s < size - 1)
+                {
+                    SetConstantS(s, r, c, 1000.0f);
+                    SetLengthS(s, r, c, spacing);
+                }
+                if (r < size - 1)
+                {
+                    SetConstantR(s, r, c, 1000.0f);
+                    SetLengthR(s, r, c, spacing);
+                }
+                if (c < size - 1)
+                {
+                    SetConstantC(s, r, c, 1000.0f);
+                    SetLengthC(s, r, c, spacing);
+                }
+            }
+        }
+    }
+}
+
+Vector<3, float> MassSpringBenchmark::Gel::ExternalAcceleration(int i,
+    float, std::vector<Vector<3, float>> const&,
+    std::vector<Vector<3, float>> const& velocity)
+{
+    // Viscous drag.
+    return -0.01f * velocity[i];
+}
+
+void MassSpringBenchmark::Gel::ExternalAccelerations(int imin, int imax,
+    float time, std::vector<Vector<3, float>> const& position,
+    std::vector<Vector<3, float>> const& velocity,
+    std::vector<Vector<3, float>>& acceleration)
+{
+    for (int i = imin; i < imax; ++i)
+    {
+        acceleration[i] = Gel::ExternalAcceleration(i, time, position, velocity);
+    }
+}
@@ -0,0 +1,77 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Physics/GteMassSpringSurface.h>
+#include <Physics/GteMassSpringVolume.h>
+#include <string>
+using namespace gte;
+
+// A headless benchmark of the RK4 and implicit (backward Euler) integration
+// of stiff mass-spring systems.
+//   cloth  a 32x64 MassSpringSurface hanging from its top row, with spring
+//          constants 1e5 (rows) and 1e4 (columns), gravity, wind and
+//          viscous drag
+//   gel    a 20^3 MassSpringVolume with immovable boundary particles,
+//          spring constant 1000 and random initial velocities
+// Each system is simulated for one second.  The reference is RK4 with a
+// small step.  For the other runs the table shows whether the simulation
+// diverged and the maximum distance of the final positions from the
+// reference positions.
+
+class MassSpringBenchmark
+{
+public:
+    MassSpringBenchmark(unsigned int numThreads);
+
+    // The return value is 1 when the run is expected to be stable but
+    // diverged, 0 otherwise.
+    int Run(std::string const& name, bool implicit, float step,
+        bool expectStable);
+
+private:
+    class Cloth : public MassSpringSurface<3, float>
+    {
+    public:
+        Cloth(int numRows, int numCols, float step, unsigned int numThreads);
+
+        virtual Vector<3, float> ExternalAcceleration(int i, float time,
+            std::vector<Vector<3, float>> const& position,
+            std::vector<Vector<3, float>> const& velocity) override;
+
+        virtual void ExternalAccelerations(int imin, int imax, float time,
+            std::vector<Vector<3, float>> const& position,
+            std::vector<Vector<3, float>> const& velocity,
+            std::vector<Vector<3, float>>& acceleration) override;
+    };
+
+    class Gel : public MassSpringVolume<3, float>
+    {
+    public:
+        Gel(int size, float step, unsigned int numThreads);
+
+        virtual Vector<3, float> ExternalAcceleration(int i, float time,
+            std::vector<Vector<3, float>> const& position,
+            std::vector<Vector<3, float>> const& velocity) override;
+
+        virtual void ExternalAccelerations(int imin, int imax, float time,
+            std::vector<Vector<3, float>> const& position,
+            std::vector<Vector<3, float>> const& velocity,
+            std::vector<Vector<3, float>>& acceleration) override;
+    };
+
+    // Simulate the system for one second and store the final positions.
+    // The return value is 'true' when the velocities remain finite and
+    // bounded.
+    template <typename System>
+    bool Simulate(System& system, float step, double& time,
+        int& numIterations, std::vector<Vector<3, float>>& positions);
+
+    unsigned int mNumThreads;
+    std::vector<Vector<3, float>> mReference[2];
+};
@@ -0,0 +1,105 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "PoissonBenchmark.h"
+#include <LowLevel/GteTimer.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char const* argv[])
+{
+    // PoissonBenchmark [size [numThreads]]
+    int size = (argc > 1 ? std::max(std::atoi(argv[1]), 3) : 256);
+    unsigned int numThreads = (argc > 2 ?
+        static_cast<unsigned int>(std::atoi(argv[2])) : 1);
+
+    PoissonBenchmark benchmark(size, numThreads);
+    std::printf("%d^3 grid, %u threads, first simulation step\n", size,
+        std::max(numThreads, 1u));
+    std::printf("%-9s %10s %12s %12s %8s\n", "solver", "iterations",
+        "residual", "Poisson ms", "speedup");
+
+    int numFailures = 0;
+    for (int numJacobiIterations : { 32, 128, 512 })
+    {
+        numFailures += benchmark.Run(numJacobiIterations);
+    }
+    return (numFailures == 0 ? 0 : 1);
+}
+
+PoissonBenchmark::PoissonBenchmark(int size, unsigned int numThreads)
+    :
+    mSize(size),
+    mNumThreads(std::max(numThreads, 1u)),
+    mResidualTime(0.0)
+{
+    // The time of one residual evaluation does not depend on the data.
+    float const delta = 1.0f / static_cast<float>(size);
+    PoissonMultigrid multigrid(size, size, size, delta, delta, delta,
+        mNumThreads);
+    size_t const numCells = static_cast<size_t>(size) * size * size;
+    std::vector<float> f(numCells, 0.0f), p(numCells, 0.0f);
+    int const numEvaluations = 4;
+    Timer timer;
+    for (int i = 0; i < numEvaluations; ++i)
+    {
+        multigrid.GetResidual(f.data(), p.data());
+    }
+    mResidualTime = 1e-9 * timer.GetNanoseconds() / numEvaluations;
+}
+
+int PoissonBenchmark::Run(int numJacobiIterations)
+{
+    int jacobiIterations = numJacobiIterations;
+    float jacobiResidual = 0.0f;
+    double jacobiTime = Solve(false, 0.0f, jacobiIterations, jacobiResidual);
+    std::printf("%-9s %10d %12.3e %12.1f\n", "Jacobi", jacobiIterations,
+        jacobiResidual, 1000.0 * jacobiTime);
+    std::fflush(stdout);
+
+    int numCycles = 0;
+    float multigridResidual = 0.0f;
+    double multigridTime = Solve(true, jacobiResidual, numCycles,
+        multigridResidual);
+    std::printf("%-9s %10d %12.3e %12.1f %8.1f\n", "multigrid", numCycles,
+        multigridResidual, 1000.0 * multigridTime, jacobiTime / multigridTime);
+    std::fflush(stdout);
+
+    return (multigridResidual <= jacobiResidual ? 0 : 1);
+}
+
+double PoissonBenchmark::Solve(bool multigrid, float tolerance,
+    int& numIterations, float& residual)
+{
+    // The cycle limit is large enough that the tolerance stops the cycles.
+    int const maxCycles = 64;
+    Fluid3CPU fluid(mSize, mSize, mSize, 0.001f, mNumThreads);
+    if (multigrid)
+    {
+        fluid.SetMultigridSolver(tolerance, maxCycles);
+    }
+    else
+    {
+        fluid.SetJacobiSolver(numIterations);
+    }
+    fluid.Initialize();
+    fluid.SetInstrumentation(true);
+    fluid.DoSimulationStep();
+
+    Fluid3CPU::Statistics const& statistics = fluid.GetStatistics();
+    std::vector<float> const& residuals = statistics.residuals;
+    numIterations = static_cast<int>(residuals.size()) - 1;
+    residual = residuals.back() / residuals.front();
+
+    double time = statistics.solvePoisson;
+    if (!multigrid)
+    {
+        time -= residuals.size() * mResidualTime;
+    }
+    return time;
+}
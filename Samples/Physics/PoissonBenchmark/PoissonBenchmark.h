@@ -0,0 +1,49 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Physics/GteFluid3CPU.h>
+using namespace gte;
+
+// A headless benchmark of the Poisson stage of Fluid3CPU on a 256^3 grid,
+// comparing the Jacobi iteration of the shader to the V-cycles of
+// PoissonMultigrid at equal residual.  For each number of Jacobi
+// iterations, the first simulation step is run with the Jacobi solver and
+// then with the multigrid solver whose tolerance is the relative residual
+// reached by the Jacobi iterations.  Both solvers see the same right-hand
+// side, the divergence of the initial state.
+//
+// The steps are instrumented to obtain the residuals and the time of the
+// Poisson stage.  The multigrid solver evaluates the residual after each
+// cycle for its stopping test, but the Jacobi solver does so only for the
+// instrumentation.  That cost, measured with PoissonMultigrid::GetResidual,
+// is subtracted from the Jacobi times.
+
+class PoissonBenchmark
+{
+public:
+    PoissonBenchmark(int size, unsigned int numThreads);
+
+    // Run the Jacobi solver and then the multigrid solver at the same
+    // relative residual.  The return value is 1 when the multigrid solver
+    // does not reach that residual, 0 otherwise.
+    int Run(int numJacobiIterations);
+
+private:
+    // Run the first simulation step and return the time of the Poisson
+    // stage in seconds and the relative residual.  For the Jacobi solver
+    // 'numIterations' is the number of iterations.  For the multigrid
+    // solver 'tolerance' is the relative residual at which the V-cycles
+    // stop, and 'numIterations' is set to the number of cycles.
+    double Solve(bool multigrid, float tolerance, int& numIterations,
+        float& residual);
+
+    int mSize;
+    unsigned int mNumThreads;
+    double mResidualTime;
+};
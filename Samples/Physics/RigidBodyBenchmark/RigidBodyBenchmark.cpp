@@ -0,0 +1,155 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "RigidBodyBenchmark.h"
+#include <LowLevel/GteTimer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+int main(int argc, char const* argv[])
+{
+    // RigidBodyBenchmark [numThreads]
+    unsigned int numThreads = (argc > 1 ?
+        static_cast<unsigned int>(std::atoi(argv[1])) : 1);
+
+    RigidBodyBenchmark benchmark(numThreads);
+    std::printf("%u threads for RigidBodyWorld\n", std::max(numThreads, 1u));
+    std::printf("%8s %6s %13s %10s %8s %10s\n", "bodies", "steps",
+        "RigidBody ms", "world ms", "speedup", "different");
+
+    int numDifferent = 0;
+    numDifferent += benchmark.Run(1000, 1000);
+    numDifferent += benchmark.Run(10000, 100);
+    numDifferent += benchmark.Run(100000, 100);
+    return (numDifferent == 0 ? 0 : 1);
+}
+
+RigidBodyBenchmark::RigidBodyBenchmark(unsigned int numThreads)
+    :
+    mNumThreads(std::max(numThreads, 1u))
+{
+}
+
+int RigidBodyBenchmark::Run(int numBodies, int numSteps)
+{
+    std::vector<RigidBody<Real>> bodies;
+    CreateBodies(numBodies, bodies);
+
+    RigidBodyWorld<Real> world(numBodies, mNumThreads);
+    for (int i = 0; i < numBodies; ++i)
+    {
+        world.SetBody(i, bodies[i]);
+    }
+    world.mForceTorque = [](Real, int imin, int imax,
+        RigidBodyWorld<Real>::State const& state, Real* const* force,
+        Real* const* torque)
+    {
+        Real const drag = (Real)0.1;
+        for (int j = 0; j < imax - imin; ++j)
+        {
+            Real mass = state.mass[j];
+            Real weight = (Real)9.8 * (mass < (Real)1000 ? mass : (Real)0);
+            force[0][j] = -drag * state.linearVelocity[0][j];
+            force[1][j] = -drag * state.linearVelocity[1][j];
+            force[2][j] = -weight - drag * state.linearVelocity[2][j];
+            torque[0][j] = -drag * state.angularVelocity[0][j];
+            torque[1][j] = -drag * state.angularVelocity[1][j];
+            torque[2][j] = -drag * state.angularVelocity[2][j];
+        }
+    };
+
+    Real const dt = (Real)0.01;
+    Timer timer;
+    for (int s = 0; s < numSteps; ++s)
+    {
+        for (auto& body : bodies)
+        {
+            body.Update(s * dt, dt);
+        }
+    }
+    double bodiesTime = 1e-6 * timer.GetNanoseconds();
+
+    timer.Reset();
+    for (int s = 0; s < numSteps; ++s)
+    {
+        world.Update(s * dt, dt);
+    }
+    double worldTime = 1e-6 * timer.GetNanoseconds();
+
+    int numDifferent = 0;
+    for (int i = 0; i < numBodies; ++i)
+    {
+        RigidBodyWorld<Real>::Body body = world.GetBody(i);
+        if (body.GetPosition() != bodies[i].GetPosition()
+            || body.GetQOrientation() != bodies[i].GetQOrientation()
+            || body.GetLinearMomentum() != bodies[i].GetLinearMomentum()
+            || body.GetAngularMomentum() != bodies[i].GetAngularMomentum())
+        {
+            ++numDifferent;
+        }
+    }
+
+    std::printf("%8d %6d %13.1f %10.1f %8.2f %10d\n", numBodies, numSteps,
+        bodiesTime, worldTime, bodiesTime / worldTime, numDifferent);
+    std::fflush(stdout);
+    return numDifferent;
+}
+
+void RigidBodyBenchmark::CreateBodies(int numBodies,
+    std::vector<RigidBody<Real>>& bodies)
+{
+    std::uniform_real_distribution<Real> rnd((Real)-1, (Real)1);
+    bodies.resize(numBodies);
+    for (int i = 0; i < numBodies; ++i)
+    {
+        RigidBody<Real>& body = bodies[i];
+        if (i % 97 == 0)
+        {
+            body.SetMass(std::numeric_limits<Real>::max());
+        }
+        else
+        {
+            body.SetMass((Real)1 + std::fabs(rnd(mGenerator)));
+            Matrix3x3<Real> inertia;
+            inertia(0, 0) = (Real)1 + std::fabs(rnd(mGenerator));
+            inertia(1, 1) = (Real)1 + std::fabs(rnd(mGenerator));
+            inertia(2, 2) = (Real)1 + std::fabs(rnd(mGenerator));
+            inertia(0, 1) = (Real)0.1 * rnd(mGenerator);
+            inertia(1, 0) = inertia(0, 1);
+            body.SetBodyInertia(inertia);
+        }
+
+        body.SetPosition({ rnd(mGenerator), rnd(mGenerator), rnd(mGenerator) });
+        Quaternion<Real> q(rnd(mGenerator), rnd(mGenerator), rnd(mGenerator),
+            rnd(mGenerator));
+        Normalize(q);
+        body.SetQOrientation(q);
+        body.SetLinearVelocity({ rnd(mGenerator), rnd(mGenerator), rnd(mGenerator) });
+        body.SetAngularVelocity({ rnd(mGenerator), rnd(mGenerator), rnd(mGenerator) });
+
+        body.mForce = [](Real, Real mass, Vector3<Real> const&,
+            Quaternion<Real> const&, Vector3<Real> const&,
+            Vector3<Real> const&, Matrix3x3<Real> const&,
+            Vector3<Real> const& linearVelocity, Vector3<Real> const&)
+        {
+            Real const drag = (Real)0.1;
+            Real weight = (Real)9.8 * (mass < (Real)1000 ? mass : (Real)0);
+            return Vector3<Real>{ (Real)0, (Real)0, -weight } - drag * linearVelocity;
+        };
+
+        body.mTorque = [](Real, Real, Vector3<Real> const&,
+            Quaternion<Real> const&, Vector3<Real> const&,
+            Vector3<Real> const&, Matrix3x3<Real> const&,
+            Vector3<Real> const&, Vector3<Real> const& angularVelocity)
+        {
+            return -(Real)0.1 * angularVelocity;
+        };
+    }
+}
@@ -0,0 +1,38 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Physics/GteRigidBodyWorld.h>
+#include <random>
+using namespace gte;
+
+// A headless benchmark of RigidBodyWorld against a loop that calls
+// RigidBody::Update for each body.  The bodies have random masses, inertia
+// tensors, positions, orientations and velocities, and every 97th body is
+// immovable.  The force is gravity with linear drag and the torque is
+// angular drag, evaluated by the std::function members of RigidBody and
+// by the block function of RigidBodyWorld.  After the simulation, the
+// states of the two are compared.  The solvers perform the same
+// operations in the same order, so the states are expected to be equal.
+
+class RigidBodyBenchmark
+{
+public:
+    RigidBodyBenchmark(unsigned int numThreads);
+
+    // The return value is the number of bodies whose states differ.
+    int Run(int numBodies, int numSteps);
+
+private:
+    typedef float Real;
+
+    void CreateBodies(int numBodies, std::vector<RigidBody<Real>>& bodies);
+
+    unsigned int mNumThreads;
+    std::mt19937 mGenerator;
+};
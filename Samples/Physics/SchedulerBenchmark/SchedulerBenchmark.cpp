@@ -0,0 +1,309 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include "SchedulerBenchmark.h"
+#include <Mathematics/GteIntrSphere3Sphere3.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+int main(int argc, char const* argv[])
+{
+    // SchedulerBenchmark [numBodies [numSteps [numThreads]]]
+    int numBodies = (argc > 1 ? std::atoi(argv[1]) : 4000);
+    int numSteps = (argc > 2 ? std::atoi(argv[2]) : 600);
+    unsigned int numThreads = (argc > 3 ?
+        static_cast<unsigned int>(std::atoi(argv[3])) :
+        std::max(std::thread::hardware_concurrency(), 1u));
+
+    SchedulerBenchmark benchmark(numBodies, numThreads);
+    benchmark.Run(numSteps);
+
+    PhysicsScheduler const& scheduler = benchmark.GetScheduler();
+    double const invSteps = 1.0 / static_cast<double>(numSteps);
+    std::printf("%d bodies, %d steps, %u threads, %d contacts at the end\n",
+        numBodies, numSteps, scheduler.GetNumThreads(),
+        static_cast<int>(benchmark.GetNumContacts()));
+    std::printf("%-14s %12s %12s\n", "stage", "mean (us)", "max (us)");
+    for (auto const& timing : scheduler.GetTimings())
+    {
+        std::printf("%-14s %12.1f %12lld\n", timing.name.c_str(),
+            static_cast<double>(timing.totalMicroseconds) * invSteps,
+            static_cast<long long>(timing.maxMicroseconds));
+    }
+    PhysicsScheduler::Timing const& step = scheduler.GetStepTiming();
+    std::printf("%-14s %12.1f %12lld\n", step.name.c_str(),
+        static_cast<double>(step.totalMicroseconds) * invSteps,
+        static_cast<long long>(step.maxMicroseconds));
+
+    // The same scene with one thread must produce the same state.
+    uint64_t checksum = benchmark.GetChecksum();
+    std::printf("checksum %016llx\n",
+        static_cast<unsigned long long>(checksum));
+    if (numThreads > 1)
+    {
+        SchedulerBenchmark reference(numBodies, 1);
+        reference.Run(numSteps);
+        bool same = (reference.GetChecksum() == checksum);
+        std::printf("same state with 1 thread: %s\n", same ? "yes" : "no");
+        return (same ? 0 : 1);
+    }
+    return 0;
+}
+
+SchedulerBenchmark::SchedulerBenchmark(int numBodies,
+    unsigned int numThreads)
+    :
+    mSize(0.0),
+    mRestitution(0.5),
+    mGravity{ 0.0, 0.0, -9.8 }
+{
+    CreateBodies(numBodies);
+    mBoxManager = std::make_unique<BoxManager<double>>(mBoxes, numThreads);
+    mSolver = std::make_unique<LCPBatchSolver<double>>(1, numThreads);
+    mScheduler = std::make_unique<PhysicsScheduler>(1.0 / 120.0, numThreads);
+    CreatePipeline();
+}
+
+void SchedulerBenchmark::Run(int numSteps)
+{
+    for (int i = 0; i < numSteps; ++i)
+    {
+        mScheduler->Step();
+    }
+}
+
+uint64_t SchedulerBenchmark::GetChecksum() const
+{
+    // FNV-1a on the bits of the state.
+    uint64_t checksum = 14695981039346656037ull;
+    auto update = [&checksum](std::vector<Vector3<double>> const& values)
+    {
+        for (auto const& value : values)
+        {
+            for (int d = 0; d < 3; ++d)
+            {
+                uint64_t bits;
+                std::memcpy(&bits, &value[d], sizeof(bits));
+                for (int b = 0; b < 8; ++b)
+                {
+                    checksum ^= (bits >> (8 * b)) & 0xFF;
+                    checksum *= 1099511628211ull;
+                }
+            }
+        }
+    };
+    update(mPosition);
+    update(mVelocity);
+    return checksum;
+}
+
+void SchedulerBenchmark::CreateBodies(int numBodies)
+{
+    // The container is a cube whose volume is about 8 times the volume of
+    // the spheres.
+    std::mt19937 mte;
+    std::uniform_real_distribution<double> rnd(0.0, 1.0);
+    mRadius.resize(numBodies);
+    mInvMass.resize(numBodies);
+    double volume = 0.0;
+    for (int i = 0; i < numBodies; ++i)
+    {
+        double r = 0.3 + 0.3 * rnd(mte);
+        mRadius[i] = r;
+        mInvMass[i] = 1.0 / (r * r * r);
+        volume += 4.0 * r * r * r;
+    }
+    mSize = std::cbrt(8.0 * volume);
+
+    mPosition.resize(numBodies);
+    mVelocity.resize(numBodies);
+    mBoxes.resize(numBodies);
+    for (int i = 0; i < numBodies; ++i)
+    {
+        for (int d = 0; d < 3; ++d)
+        {
+            double r = mRadius[i];
+            mPosition[i][d] = r + (mSize - 2.0 * r) * rnd(mte);
+            mVelocity[i][d] = 4.0 * rnd(mte) - 2.0;
+        }
+        mBoxes[i].min = mPosition[i] - Vector3<double>{ mRadius[i],
+            mRadius[i], mRadius[i] };
+        mBoxes[i].max = mPosition[i] + Vector3<double>{ mRadius[i],
+            mRadius[i], mRadius[i] };
+    }
+}
+
+void SchedulerBenchmark::CreatePipeline()
+{
+    PhysicsScheduler& scheduler = *mScheduler;
+
+    scheduler.AddParallelStage("bounds", BOUNDS_GRAIN,
+        [this]() { return static_cast<int>(mPosition.size()); },
+        [this](double, double, int, int imin, int imax)
+        {
+            ComputeBounds(imin, imax);
+        });
+
+    scheduler.AddSerialStage("broad phase",
+        [this](double, double) { mBoxManager->Update(); });
+
+    // The count function is called by the thread that runs the step before
+    // the tasks start, so it can allocate the per-task contact arrays.
+    scheduler.AddParallelStage("narrow phase", PAIRS_GRAIN,
+        [this]()
+        {
+            int numPairs =
+                static_cast<int>(mBoxManager->GetOverlapArray().size());
+            mTaskContacts.resize(
+                PhysicsScheduler::GetNumTasks(numPairs, PAIRS_GRAIN));
+            return numPairs;
+        },
+        [this](double, double, int task, int imin, int imax)
+        {
+            FindContacts(task, imin, imax);
+        });
+
+    scheduler.AddSerialStage("contacts",
+        [this](double, double) { MergeContacts(); });
+
+    scheduler.AddSerialStage("solve",
+        [this](double, double)
+        {
+            int numContacts = static_cast<int>(mContacts.size());
+            mSolver->Solve(numContacts, mQ.data(), mM.data(), mW.data(),
+                mZ.data());
+        });
+
+    scheduler.AddSerialStage("impulses",
+        [this](double, double) { ApplyImpulses(); });
+
+    scheduler.AddParallelStage("integrate", INTEGRATE_GRAIN,
+        [this]() { return static_cast<int>(mPosition.size()); },
+        [this](double, double step, int, int imin, int imax)
+        {
+            Integrate(step, imin, imax);
+        });
+}
+
+void SchedulerBenchmark::ComputeBounds(int imin, int imax)
+{
+    for (int i = imin; i < imax; ++i)
+    {
+        Vector3<double> extent{ mRadius[i], mRadius[i], mRadius[i] };
+        mBoxManager->SetBox(i, AlignedBox3<double>(mPosition[i] - extent,
+            mPosition[i] + extent));
+    }
+}
+
+void SchedulerBenchmark::FindContacts(int task, int imin, int imax)
+{
+    std::vector<EdgeKey<false>> const& pairs =
+        mBoxManager->GetOverlapArray();
+    std::vector<Contact>& contacts = mTaskContacts[task];
+    contacts.clear();
+
+    TIQuery<double, Sphere3<double>, Sphere3<double>> query;
+    for (int p = imin; p < imax; ++p)
+    {
+        int i0 = pairs[p].V[0], i1 = pairs[p].V[1];
+        Sphere3<double> sphere0(mPosition[i0], mRadius[i0]);
+        Sphere3<double> sphere1(mPosition[i1], mRadius[i1]);
+        if (query(sphere0, sphere1).intersect)
+        {
+            Vector3<double> diff = mPosition[i1] - mPosition[i0];
+            double length = Normalize(diff);
+            if (length > 0.0)
+            {
+                Contact contact;
+                contact.body0 = i0;
+                contact.body1 = i1;
+                contact.normal = diff;
+                contact.depth = mRadius[i0] + mRadius[i1] - length;
+                contacts.push_back(contact);
+            }
+        }
+    }
+}
+
+void SchedulerBenchmark::MergeContacts()
+{
+    // The tasks are merged in task order, so the contact order does not
+    // depend on the number of threads.
+    mContacts.clear();
+    for (auto const& contacts : mTaskContacts)
+    {
+        mContacts.insert(mContacts.end(), contacts.begin(), contacts.end());
+    }
+
+    // The LCP of a contact is w = q + M*z, where z is the normal impulse and
+    // w is the separating speed after the impulse plus the restitution term.
+    size_t const numContacts = mContacts.size();
+    mQ.resize(numContacts);
+    mM.resize(numContacts);
+    mW.resize(numContacts);
+    mZ.resize(numContacts);
+    for (size_t c = 0; c < numContacts; ++c)
+    {
+        Contact const& contact = mContacts[c];
+        Vector3<double> relative =
+            mVelocity[contact.body1] - mVelocity[contact.body0];
+        mQ[c] = (1.0 + mRestitution) * Dot(relative, contact.normal);
+        mM[c] = mInvMass[contact.body0] + mInvMass[contact.body1];
+    }
+}
+
+void SchedulerBenchmark::ApplyImpulses()
+{
+    // Apply the impulses and separate the spheres by a fraction of the
+    // penetration depth, distributed by inverse mass.
+    double const correction = 0.2;
+    size_t const numContacts = mContacts.size();
+    for (size_t c = 0; c < numContacts; ++c)
+    {
+        Contact const& contact = mContacts[c];
+        int i0 = contact.body0, i1 = contact.body1;
+        double invMass0 = mInvMass[i0], invMass1 = mInvMass[i1];
+        Vector3<double> impulse = mZ[c] * contact.normal;
+        mVelocity[i0] -= invMass0 * impulse;
+        mVelocity[i1] += invMass1 * impulse;
+
+        double push = correction * contact.depth / (invMass0 + invMass1);
+        mPosition[i0] -= (push * invMass0) * contact.normal;
+        mPosition[i1] += (push * invMass1) * contact.normal;
+    }
+}
+
+void SchedulerBenchmark::Integrate(double step, int imin, int imax)
+{
+    for (int i = imin; i < imax; ++i)
+    {
+        Vector3<double>& position = mPosition[i];
+        Vector3<double>& velocity = mVelocity[i];
+        velocity += step * mGravity;
+        position += step * velocity;
+
+        double const r = mRadius[i];
+        for (int d = 0; d < 3; ++d)
+        {
+            if (position[d] < r)
+            {
+                position[d] = r;
+                velocity[d] = std::fabs(velocity[d]) * mRestitution;
+            }
+            else if (position[d] > mSize - r)
+            {
+                position[d] = mSize - r;
+                velocity[d] = -std::fabs(velocity[d]) * mRestitution;
+            }
+        }
+    }
+}
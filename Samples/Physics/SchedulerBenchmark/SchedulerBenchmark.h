@@ -0,0 +1,84 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#pragma once
+
+#include <Mathematics/GteLCPBatchSolver.h>
+#include <Mathematics/GteVector3.h>
+#include <Physics/GteBoxManager.h>
+#include <Physics/GtePhysicsScheduler.h>
+#include <memory>
+using namespace gte;
+
+// A headless scene of spheres that fall under gravity in a box and collide
+// with each other and with the walls.  A step is the pipeline
+//   bounds      (parallel)  axis-aligned boxes of the spheres
+//   broad phase (serial)    BoxManager
+//   narrow phase (parallel) sphere-sphere tests of the overlapping boxes
+//   contacts    (serial)    merge the contacts of the tasks, set up LCPs
+//   solve       (serial)    LCPBatchSolver for the normal impulses
+//   impulses    (serial)    apply the impulses in contact order
+//   integrate   (parallel)  semi-implicit Euler and the walls
+
+class SchedulerBenchmark
+{
+public:
+    SchedulerBenchmark(int numBodies, unsigned int numThreads);
+
+    void Run(int numSteps);
+
+    // A checksum of the positions and velocities.  It is the same for all
+    // numbers of threads.
+    uint64_t GetChecksum() const;
+
+    inline PhysicsScheduler const& GetScheduler() const;
+    inline size_t GetNumContacts() const;
+
+private:
+    struct Contact
+    {
+        int body0, body1;
+        Vector3<double> normal;
+        double depth;
+    };
+
+    void CreateBodies(int numBodies);
+    void CreatePipeline();
+
+    void ComputeBounds(int imin, int imax);
+    void FindContacts(int task, int imin, int imax);
+    void MergeContacts();
+    void ApplyImpulses();
+    void Integrate(double step, int imin, int imax);
+
+    enum { BOUNDS_GRAIN = 1024, PAIRS_GRAIN = 4096, INTEGRATE_GRAIN = 1024 };
+
+    double mSize, mRestitution;
+    Vector3<double> mGravity;
+    std::vector<Vector3<double>> mPosition, mVelocity;
+    std::vector<double> mRadius, mInvMass;
+
+    std::vector<AlignedBox3<double>> mBoxes;
+    std::unique_ptr<BoxManager<double>> mBoxManager;
+
+    std::vector<std::vector<Contact>> mTaskContacts;
+    std::vector<Contact> mContacts;
+    std::vector<double> mQ, mM, mW, mZ;
+    std::unique_ptr<LCPBatchSolver<double>> mSolver;
+
+    std::unique_ptr<PhysicsScheduler> mScheduler;
+};
+
+inline PhysicsScheduler const& SchedulerBenchmark::GetScheduler() const
+{
+    return *mScheduler;
+}
+
+inline size_t SchedulerBenchmark::GetNumContacts() const
+{
+    return mContacts.size();
+}
@@ -0,0 +1,342 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/14)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteParallelFor.h>
+#include <Mathematics/GteHalfEdgeMesh.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+using namespace gte;
+
+HalfEdgeMesh::HalfEdgeMesh(unsigned int numThreads)
+    :
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mNumVertices(0)
+{
+}
+
+bool HalfEdgeMesh::Create(int numVertices, int numTriangles, int const* indices)
+{
+    Clear();
+    if (numVertices <= 0 || numTriangles <= 0 || !indices)
+    {
+        return false;
+    }
+
+    int const numHalfEdges = 3 * numTriangles;
+    mIndices.assign(indices, indices + numHalfEdges);
+
+    // Each thread has its own status so that no synchronization is needed.
+    // The status is stored as an int to avoid the bit packing of
+    // std::vector<bool>.
+    std::vector<int> valid(mNumThreads, 1);
+    auto allValid = [&valid]()
+    {
+        return std::find(valid.begin(), valid.end(), 0) == valid.end();
+    };
+
+    ParallelFor(mNumThreads, numTriangles, [this, numVertices, &valid](
+        unsigned int t, int tmin, int tmax)
+    {
+        for (int i = tmin; i < tmax; ++i)
+        {
+            int const* v = &mIndices[3 * i];
+            if (v[0] < 0 || v[0] >= numVertices
+                || v[1] < 0 || v[1] >= numVertices
+                || v[2] < 0 || v[2] >= numVertices
+                || v[0] == v[1] || v[1] == v[2] || v[2] == v[0])
+            {
+                valid[t] = 0;
+                return;
+            }
+        }
+    });
+    if (!allValid())
+    {
+        Clear();
+        return false;
+    }
+
+    // Bucket the half-edges by their smaller vertex index using a counting
+    // sort.  The half-edges of bucket k are bucket[first[k]] through
+    // bucket[first[k+1]-1].  The order within a bucket depends on the
+    // thread scheduling, so each bucket is sorted before it is searched.
+    std::unique_ptr<std::atomic<int>[]> counter(new std::atomic<int>[numVertices]);
+    ParallelFor(mNumThreads, numVertices, [&counter](unsigned int, int vmin, int vmax)
+    {
+        for (int v = vmin; v < vmax; ++v)
+        {
+            counter[v].store(0, std::memory_order_relaxed);
+        }
+    });
+
+    ParallelFor(mNumThreads, numHalfEdges, [this, &counter](unsigned int, int hmin, int hmax)
+    {
+        for (int h = hmin; h < hmax; ++h)
+        {
+            int key = std::min(mIndices[h], mIndices[GetNext(h)]);
+            counter[key].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    std::vector<int> first(numVertices + 1);
+    first[0] = 0;
+    for (int v = 0; v < numVertices; ++v)
+    {
+        first[v + 1] = first[v] + counter[v].load(std::memory_order_relaxed);
+        counter[v].store(first[v], std::memory_order_relaxed);
+    }
+
+    std::vector<int> bucket(numHalfEdges);
+    ParallelFor(mNumThreads, numHalfEdges, [this, &counter, &bucket](unsigned int, int hmin, int hmax)
+    {
+        for (int h = hmin; h < hmax; ++h)
+        {
+            int key = std::min(mIndices[h], mIndices[GetNext(h)]);
+            bucket[counter[key].fetch_add(1, std::memory_order_relaxed)] = h;
+        }
+    });
+    counter = nullptr;
+
+    // Match the twins in each bucket.  The half-edges with the same larger
+    // vertex index are adjacent after sorting.  A single half-edge is on
+    // the boundary.  A pair of half-edges must have opposite directions.
+    mTwin.resize(numHalfEdges);
+    ParallelFor(mNumThreads, numVertices, [this, &first, &bucket, &valid](
+        unsigned int t, int vmin, int vmax)
+    {
+        for (int v = vmin; v < vmax; ++v)
+        {
+            auto begin = bucket.begin() + first[v];
+            auto end = bucket.begin() + first[v + 1];
+            std::sort(begin, end, [this](int h0, int h1)
+            {
+                int other0 = std::max(mIndices[h0], mIndices[GetNext(h0)]);
+                int other1 = std::max(mIndices[h1], mIndices[GetNext(h1)]);
+                return other0 < other1 || (other0 == other1 && h0 < h1);
+            });
+
+            for (auto current = begin; current != end; /**/)
+            {
+                int h0 = *current;
+                int other = std::max(mIndices[h0], mIndices[GetNext(h0)]);
+                auto next = current + 1;
+                while (next != end && std::max(mIndices[*next], mIndices[GetNext(*next)]) == other)
+                {
+                    ++next;
+                }
+
+                auto const numShared = next - current;
+                if (numShared == 1)
+                {
+                    mTwin[h0] = -1;
+                }
+                else if (numShared == 2 && mIndices[h0] != mIndices[*(current + 1)])
+                {
+                    int h1 = *(current + 1);
+                    mTwin[h0] = h1;
+                    mTwin[h1] = h0;
+                }
+                else
+                {
+                    // The edge is shared by more than two triangles or by
+                    // two triangles with inconsistent orientations.
+                    valid[t] = 0;
+                    return;
+                }
+                current = next;
+            }
+        }
+    });
+    if (!allValid())
+    {
+        Clear();
+        return false;
+    }
+
+    // Number the edges in the order of their representative half-edges,
+    // which are the boundary half-edges and the twins with the smaller
+    // index.  Each thread counts the edges in its range of half-edges, and
+    // the counts are converted to offsets for numbering.
+    std::vector<int> numThreadEdges(mNumThreads + 1, 0);
+    ParallelFor(mNumThreads, numHalfEdges, [this, &numThreadEdges](unsigned int t, int hmin, int hmax)
+    {
+        int numEdges = 0;
+        for (int h = hmin; h < hmax; ++h)
+        {
+            int twin = mTwin[h];
+            if (twin < 0 || h < twin)
+            {
+                ++numEdges;
+            }
+        }
+        numThreadEdges[t + 1] = numEdges;
+    });
+    for (unsigned int t = 0; t < mNumThreads; ++t)
+    {
+        numThreadEdges[t + 1] += numThreadEdges[t];
+    }
+
+    mEdges.resize(numThreadEdges[mNumThreads]);
+    mHalfEdgeToEdge.resize(numHalfEdges);
+    ParallelFor(mNumThreads, numHalfEdges, [this, &numThreadEdges](unsigned int t, int hmin, int hmax)
+    {
+        int e = numThreadEdges[t];
+        for (int h = hmin; h < hmax; ++h)
+        {
+            int twin = mTwin[h];
+            if (twin < 0 || h < twin)
+            {
+                mEdges[e] = h;
+                mHalfEdgeToEdge[h] = e;
+                if (twin >= 0)
+                {
+                    mHalfEdgeToEdge[twin] = e;
+                }
+                ++e;
+            }
+        }
+    });
+
+    mNumVertices = numVertices;
+
+    // Choose the outgoing half-edges of the vertices.  A boundary half-edge
+    // is preferred so that the counterclockwise traversal of the triangles
+    // sharing a boundary vertex starts at the boundary.
+    mVertexHalfEdge.assign(numVertices, -1);
+    for (int h = 0; h < numHalfEdges; ++h)
+    {
+        int& vertexHalfEdge = mVertexHalfEdge[mIndices[h]];
+        if (vertexHalfEdge < 0 || (mTwin[h] < 0 && mTwin[vertexHalfEdge] >= 0))
+        {
+            vertexHalfEdge = h;
+        }
+    }
+    return true;
+}
+
+void HalfEdgeMesh::Clear()
+{
+    mNumVertices = 0;
+    mIndices.clear();
+    mTwin.clear();
+    mHalfEdgeToEdge.clear();
+    mEdges.clear();
+    mVertexHalfEdge.clear();
+}
+
+std::array<int, 2> HalfEdgeMesh::GetEdgeVertices(int e) const
+{
+    int h = mEdges[e];
+    return std::array<int, 2>{ mIndices[h], mIndices[GetNext(h)] };
+}
+
+std::array<int, 2> HalfEdgeMesh::GetEdgeTriangles(int e) const
+{
+    int h = mEdges[e];
+    int twin = mTwin[h];
+    return std::array<int, 2>{ h / 3, (twin >= 0 ? twin / 3 : -1) };
+}
+
+std::array<int, 3> HalfEdgeMesh::GetTriangle(int t) const
+{
+    int const* v = &mIndices[3 * t];
+    return std::array<int, 3>{ v[0], v[1], v[2] };
+}
+
+bool HalfEdgeMesh::IsBoundaryVertex(int v) const
+{
+    int h = mVertexHalfEdge[v];
+    return h >= 0 && mTwin[h] < 0;
+}
+
+void HalfEdgeMesh::GetVertexTriangles(int v, std::vector<int>& triangles) const
+{
+    // The rotation from an outgoing half-edge h of triangle t to the
+    // outgoing half-edge of the next counterclockwise triangle is
+    // Twin(Prev(h)).  The rotation terminates at the starting half-edge
+    // or at the boundary.
+    triangles.clear();
+    int const hStart = mVertexHalfEdge[v];
+    int h = hStart;
+    while (h >= 0)
+    {
+        triangles.push_back(h / 3);
+        h = mTwin[GetPrev(h)];
+        if (h == hStart)
+        {
+            break;
+        }
+    }
+}
+
+void HalfEdgeMesh::GetVertexNeighbors(int v, std::vector<int>& neighbors) const
+{
+    neighbors.clear();
+    int const hStart = mVertexHalfEdge[v];
+    int h = hStart;
+    while (h >= 0)
+    {
+        neighbors.push_back(mIndices[GetNext(h)]);
+        int prev = GetPrev(h);
+        h = mTwin[prev];
+        if (h < 0)
+        {
+            // The last neighbor of a boundary vertex is the origin of the
+            // incoming boundary half-edge.
+            neighbors.push_back(mIndices[prev]);
+        }
+        else if (h == hStart)
+        {
+            break;
+        }
+    }
+}
+
+bool HalfEdgeMesh::IsClosed() const
+{
+    return std::find(mTwin.begin(), mTwin.end(), -1) == mTwin.end();
+}
+
+void HalfEdgeMesh::GetComponents(std::vector<std::vector<int>>& components) const
+{
+    // This is a depth-first search of the graph that uses a preallocated
+    // stack rather than a recursive function that could possibly overflow
+    // the call stack.
+    components.clear();
+    int const numTriangles = GetNumTriangles();
+    std::vector<char> visited(numTriangles, 0);
+    std::vector<int> tStack(numTriangles);
+    for (int tInitial = 0; tInitial < numTriangles; ++tInitial)
+    {
+        if (visited[tInitial])
+        {
+            continue;
+        }
+
+        std::vector<int> component;
+        int top = -1;
+        tStack[++top] = tInitial;
+        visited[tInitial] = 1;
+        while (top >= 0)
+        {
+            int t = tStack[top--];
+            component.push_back(t);
+            for (int i = 0; i < 3; ++i)
+            {
+                int adj = GetAdjacentTriangle(t, i);
+                if (adj >= 0 && !visited[adj])
+                {
+                    visited[adj] = 1;
+                    tStack[++top] = adj;
+                }
+            }
+        }
+        components.push_back(std::move(component));
+    }
+}
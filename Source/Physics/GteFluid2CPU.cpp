@@ -0,0 +1,477 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.1 (2019/09/16)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <LowLevel/GteTimer.h>
+#include <Physics/GteFluid2CPU.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+using namespace gte;
+
+Fluid2CPU::Fluid2CPU(int xSize, int ySize, float dt, float densityViscosity,
+    float velocityViscosity, unsigned int numThreads)
+    :
+    mXSize(xSize),
+    mYSize(ySize),
+    mDt(dt),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mTime(0.0f),
+    mPoissonSolver(POISSON_JACOBI),
+    mNumJacobiIterations(NUM_POISSON_ITERATIONS),
+    mMultigridTolerance(0.0f),
+    mMultigridMaxCycles(0),
+    mInstrumentation(false)
+{
+    LogAssert(xSize >= 3 && ySize >= 3, "Invalid grid size.");
+
+    // The parameters are those computed by Fluid2.
+    float dx = 1.0f/static_cast<float>(mXSize);
+    float dy = 1.0f/static_cast<float>(mYSize);
+    float dtDivDxDx = (dt/dx)/dx;
+    float dtDivDyDy = (dt/dy)/dy;
+    float ratio = dx/dy;
+    float ratioSqr = ratio*ratio;
+    float factor = 0.5f/(1.0f + ratioSqr);
+    float epsilonX = factor;
+    float epsilonY = ratioSqr*factor;
+    float epsilon0 = dx*dx*factor;
+    float denVX = densityViscosity*dtDivDxDx;
+    float denVY = densityViscosity*dtDivDyDy;
+    float velVX = velocityViscosity*dtDivDxDx;
+    float velVY = velocityViscosity*dtDivDyDy;
+
+    Fluid2Parameters& p = mParameters;
+    p.spaceDelta = { dx, dy, 0.0f, 0.0f };
+    p.halfDivDelta = { 0.5f / dx, 0.5f / dy, 0.0f, 0.0f };
+    p.timeDelta = { dt / dx, dt / dy, 0.0f, dt };
+    p.viscosityX = { velVX, velVX, 0.0f, denVX };
+    p.viscosityY = { velVY, velVY, 0.0f, denVY };
+    p.epsilon = { epsilonX, epsilonY, 0.0f, epsilon0 };
+
+    // The external inputs are those of Fluid2InitializeSource.
+    External& e = mExternal;
+    e.densityProducer = { 0.25f, 0.75f, 0.01f, 2.0f };
+    e.densityConsumer = { 0.75f, 0.25f, 0.01f, 2.0f };
+    e.gravity = { 0.0f, 0.0f, 0.0f, 0.0f };
+    e.wind = { 0.0f, 0.5f, 0.001f, 32.0f };
+
+    size_t const numPixels = static_cast<size_t>(mXSize) * mYSize;
+    mSource.resize(4 * numPixels);
+    mStateTm1.resize(4 * numPixels);
+    mStateT.resize(4 * numPixels);
+    mStateTp1.resize(4 * numPixels);
+    mDivergence.resize(numPixels);
+    mPoisson0.resize(numPixels);
+    mPoisson1.resize(numPixels);
+
+    mStatistics.updateState = 0.0;
+    mStatistics.enforceStateBoundary = 0.0;
+    mStatistics.computeDivergence = 0.0;
+    mStatistics.solvePoisson = 0.0;
+    mStatistics.adjustVelocity = 0.0;
+}
+
+void Fluid2CPU::Initialize()
+{
+    InitializeSource();
+    InitializeState();
+    EnforceStateBoundary(mStateTm1);
+    EnforceStateBoundary(mStateT);
+}
+
+void Fluid2CPU::DoSimulationStep()
+{
+    // The stage times are measured only with instrumentation enabled.
+    Timer timer;
+    auto record = [this, &timer](double& seconds)
+    {
+        if (mInstrumentation)
+        {
+            seconds += timer.GetSeconds();
+            timer.Reset();
+        }
+    };
+
+    if (mInstrumentation)
+    {
+        mStatistics.updateState = 0.0;
+        mStatistics.enforceStateBoundary = 0.0;
+        mStatistics.computeDivergence = 0.0;
+        mStatistics.solvePoisson = 0.0;
+        mStatistics.adjustVelocity = 0.0;
+        timer.Reset();
+    }
+
+    UpdateState();
+    record(mStatistics.updateState);
+    EnforceStateBoundary(mStateTp1);
+    record(mStatistics.enforceStateBoundary);
+    ComputeDivergence();
+    record(mStatistics.computeDivergence);
+    SolvePoisson();
+    record(mStatistics.solvePoisson);
+    AdjustVelocity();
+    record(mStatistics.adjustVelocity);
+    EnforceStateBoundary(mStateTm1);
+    record(mStatistics.enforceStateBoundary);
+    std::swap(mStateTm1, mStateT);
+
+    mTime += mDt;
+}
+
+void Fluid2CPU::SetJacobiSolver(int numIterations)
+{
+    mPoissonSolver = POISSON_JACOBI;
+    mNumJacobiIterations = std::max(numIterations, 0);
+}
+
+void Fluid2CPU::SetMultigridSolver(float tolerance, int maxCycles)
+{
+    mPoissonSolver = POISSON_MULTIGRID;
+    mMultigridTolerance = tolerance;
+    mMultigridMaxCycles = std::max(maxCycles, 0);
+    CreateMultigrid();
+}
+
+void Fluid2CPU::SetInstrumentation(bool enable)
+{
+    mInstrumentation = enable;
+    if (mInstrumentation)
+    {
+        CreateMultigrid();
+    }
+}
+
+void Fluid2CPU::CreateMultigrid()
+{
+    if (!mMultigrid)
+    {
+        Vector4<float> const& delta = mParameters.spaceDelta;
+        mMultigrid = std::make_unique<PoissonMultigrid>(mXSize, mYSize, 1,
+            delta[0], delta[1], 1.0f, mNumThreads);
+    }
+}
+
+void Fluid2CPU::InitializeSource()
+{
+    // Use a Mersenne twister engine for random numbers.  The vortices are
+    // generated in the order of Fluid2InitializeSource.  Each vortex is
+    // (x, y, variance, amplitude).
+    std::mt19937 mte;
+    std::uniform_real_distribution<float> unirnd(0.0f, 1.0f);
+    std::uniform_real_distribution<float> symrnd(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> posrnd0(0.001f, 0.01f);
+    std::uniform_real_distribution<float> posrnd1(128.0f, 256.0f);
+
+    std::vector<Vector4<float>> vortices(NUM_VORTICES);
+    for (auto& v : vortices)
+    {
+        v[0] = unirnd(mte);
+        v[1] = unirnd(mte);
+        v[2] = posrnd0(mte);
+        v[3] = posrnd1(mte);
+        if (symrnd(mte) < 0.0f)
+        {
+            v[3] = -v[3];
+        }
+    }
+
+    // The impulses of the vortices are culled as in Fluid3CPU.  Each vortex
+    // is added to the interval of a row where arg >= minArgument, in the
+    // order of the vortices.
+    float const minArgument = -16.0f;
+    ParallelFor(mNumThreads, mYSize, [this, &vortices, minArgument](unsigned int, int ymin, int ymax)
+    {
+        Vector4<float> const& spaceDelta = mParameters.spaceDelta;
+        External const& e = mExternal;
+        std::vector<float> vortexVelocity(2 * mXSize);
+        for (int y = ymin; y < ymax; ++y)
+        {
+            float ly = spaceDelta[1] * (static_cast<float>(y) + 0.5f);
+
+            // Compute the velocity from the vortices.
+            std::fill(vortexVelocity.begin(), vortexVelocity.end(), 0.0f);
+            for (auto const& v : vortices)
+            {
+                float diff1 = ly - v[1];
+                float sqrRadius = -minArgument * v[2] - diff1 * diff1;
+                if (sqrRadius < 0.0f)
+                {
+                    continue;
+                }
+
+                float radius = std::sqrt(sqrRadius);
+                int xmin = std::max(static_cast<int>(std::ceil(
+                    (v[0] - radius) / spaceDelta[0] - 0.5f)), 0);
+                int xmax = std::min(static_cast<int>(std::floor(
+                    (v[0] + radius) / spaceDelta[0] - 0.5f)), mXSize - 1);
+                for (int x = xmin; x <= xmax; ++x)
+                {
+                    float* velocity = &vortexVelocity[2 * x];
+                    float diff0 = spaceDelta[0] * (static_cast<float>(x) + 0.5f) - v[0];
+                    float arg = -(diff0 * diff0 + diff1 * diff1) / v[2];
+                    float magnitude = v[3] * std::exp(arg);
+                    velocity[0] += magnitude * diff1;
+                    velocity[1] -= magnitude * diff0;
+                }
+            }
+
+            float* source = &mSource[4 * GetIndex(0, y)];
+            float const* velocity = vortexVelocity.data();
+            for (int x = 0; x < mXSize; ++x, source += 4, velocity += 2)
+            {
+                float lx = spaceDelta[0] * (static_cast<float>(x) + 0.5f);
+
+                // Compute an input to the fluid simulation consisting of a
+                // producer of density and a consumer of density.
+                float diff0 = lx - e.densityProducer[0];
+                float diff1 = ly - e.densityProducer[1];
+                float arg = -(diff0 * diff0 + diff1 * diff1) / e.densityProducer[2];
+                float density = e.densityProducer[3] * std::exp(arg);
+                diff0 = lx - e.densityConsumer[0];
+                diff1 = ly - e.densityConsumer[1];
+                arg = -(diff0 * diff0 + diff1 * diff1) / e.densityConsumer[2];
+                density -= e.densityConsumer[3] * std::exp(arg);
+
+                // Compute an input to the fluid simulation consisting of
+                // gravity, a single wind source, and vortex impulses.
+                float windDiff = ly - e.wind[1];
+                float windArg = -windDiff * windDiff / e.wind[2];
+                float windVelocity = e.wind[3] * std::exp(windArg);
+                source[0] = e.gravity[0] + windVelocity + velocity[0];
+                source[1] = e.gravity[1] + velocity[1];
+                source[2] = 0.0f;
+                source[3] = density;
+            }
+        }
+    });
+}
+
+void Fluid2CPU::InitializeState()
+{
+    // Use a Mersenne twister engine for random numbers.  The densities are
+    // generated in the order of Fluid2InitializeState.  The initial
+    // velocities are zero.
+    std::mt19937 mte;
+    std::uniform_real_distribution<float> unirnd(0.0f, 1.0f);
+
+    size_t const numPixels = mDivergence.size();
+    for (size_t i = 0, j = 0; i < numPixels; ++i, j += 4)
+    {
+        mStateT[j] = 0.0f;
+        mStateT[j + 1] = 0.0f;
+        mStateT[j + 2] = 0.0f;
+        mStateT[j + 3] = unirnd(mte);
+    }
+    mStateTm1 = mStateT;
+}
+
+void Fluid2CPU::EnforceStateBoundary(std::vector<float>& state)
+{
+    // The x-edges are processed before the y-edges, as on the GPU, so the
+    // corners have the same values.
+    ParallelFor(mNumThreads, mYSize, [this, &state](unsigned int, int ymin, int ymax)
+    {
+        for (int y = ymin; y < ymax; ++y)
+        {
+            float* s = &state[4 * GetIndex(0, y)];
+            s[0] = 0.0f;
+            s[1] = s[5];
+            s[2] = 0.0f;
+            s[3] = 0.0f;
+            s = &state[4 * GetIndex(mXSize - 1, y)];
+            s[0] = 0.0f;
+            s[1] = s[-3];
+            s[2] = 0.0f;
+            s[3] = 0.0f;
+        }
+    });
+
+    int const yStride = 4 * mXSize;
+    for (int x = 0; x < mXSize; ++x)
+    {
+        float* s = &state[4 * GetIndex(x, 0)];
+        s[0] = s[yStride];
+        s[1] = 0.0f;
+        s[2] = 0.0f;
+        s[3] = 0.0f;
+        s = &state[4 * GetIndex(x, mYSize - 1)];
+        s[0] = s[-yStride];
+        s[1] = 0.0f;
+        s[2] = 0.0f;
+        s[3] = 0.0f;
+    }
+}
+
+void Fluid2CPU::UpdateState()
+{
+    int const yStride = 4 * mXSize;
+    ParallelFor(mNumThreads, mYSize - 2, [this, yStride](unsigned int, int ymin, int ymax)
+    {
+        Fluid2Parameters const& p = mParameters;
+        float advection[4];
+        for (int y = ymin + 1; y <= ymax; ++y)
+        {
+            int i = 4 * GetIndex(1, y);
+            for (int x = 1; x < mXSize - 1; ++x, i += 4)
+            {
+                float const* stateZZ = &mStateT[i];
+                float const* src = &mSource[i];
+                float* update = &mStateTp1[i];
+
+                // Compute advection.  The shader samples at the texture
+                // coordinates spaceDelta*(c - timeDelta*velocity + 1/2).
+                Sample(mStateTm1,
+                    static_cast<float>(x) - p.timeDelta[0] * stateZZ[0],
+                    static_cast<float>(y) - p.timeDelta[1] * stateZZ[1],
+                    advection);
+
+                // Estimate second-order derivatives of state at (x,y) and
+                // update the state.
+                for (int j = 0; j < 4; ++j)
+                {
+                    float twoZZ = 2.0f * stateZZ[j];
+                    float stateDXX = stateZZ[j + 4] - twoZZ + stateZZ[j - 4];
+                    float stateDYY = stateZZ[j + yStride] - twoZZ + stateZZ[j - yStride];
+                    update[j] = advection[j] + (p.viscosityX[j] * stateDXX +
+                        p.viscosityY[j] * stateDYY + p.timeDelta[3] * src[j]);
+                }
+            }
+        }
+    });
+}
+
+void Fluid2CPU::ComputeDivergence()
+{
+    int const yStride = 4 * mXSize;
+    ParallelFor(mNumThreads, mYSize - 2, [this, yStride](unsigned int, int ymin, int ymax)
+    {
+        Vector4<float> const& halfDivDelta = mParameters.halfDivDelta;
+        for (int y = ymin + 1; y <= ymax; ++y)
+        {
+            int i = GetIndex(1, y);
+            float const* state = &mStateTp1[4 * i];
+            float* divergence = &mDivergence[i];
+            for (int x = 1; x < mXSize - 1; ++x, state += 4, ++divergence)
+            {
+                *divergence =
+                    halfDivDelta[0] * (state[4] - state[-4]) +
+                    halfDivDelta[1] * (state[yStride + 1] - state[-yStride + 1]);
+            }
+        }
+    });
+}
+
+void Fluid2CPU::SolvePoisson()
+{
+    // Both solvers leave the pressure in mPoisson0, which has a zero
+    // boundary.
+    std::fill(mPoisson0.begin(), mPoisson0.end(), 0.0f);
+    if (mPoissonSolver == POISSON_MULTIGRID)
+    {
+        mMultigrid->Solve(mDivergence.data(), mPoisson0.data(), mMultigridTolerance,
+            mMultigridMaxCycles, mInstrumentation ? &mStatistics.residuals : nullptr);
+    }
+    else
+    {
+        SolvePoissonJacobi();
+    }
+}
+
+void Fluid2CPU::SolvePoissonJacobi()
+{
+    // The boundary pixels of mPoisson1 are never written, so they are zero.
+    // This is the boundary condition that the GPU enforces after each
+    // iteration.
+    if (mInstrumentation)
+    {
+        mStatistics.residuals.clear();
+        mStatistics.residuals.push_back(mMultigrid->GetResidual(
+            mDivergence.data(), mPoisson0.data()));
+    }
+
+    int const yStride = mXSize;
+    for (int iteration = 0; iteration < mNumJacobiIterations; ++iteration)
+    {
+        ParallelFor(mNumThreads, mYSize - 2, [this, yStride](unsigned int, int ymin, int ymax)
+        {
+            Vector4<float> const& epsilon = mParameters.epsilon;
+            float const epsilonX = epsilon[0];
+            float const epsilonY = epsilon[1];
+            float const epsilon0 = epsilon[3];
+            for (int y = ymin + 1; y <= ymax; ++y)
+            {
+                int i = GetIndex(0, y);
+                float const* poisson = &mPoisson0[i];
+                float const* divergence = &mDivergence[i];
+                float* outPoisson = &mPoisson1[i];
+                for (int x = 1; x < mXSize - 1; ++x)
+                {
+                    outPoisson[x] =
+                        epsilonX * (poisson[x + 1] + poisson[x - 1]) +
+                        epsilonY * (poisson[x + yStride] + poisson[x - yStride]) +
+                        epsilon0 * divergence[x];
+                }
+            }
+        });
+
+        std::swap(mPoisson0, mPoisson1);
+        if (mInstrumentation)
+        {
+            mStatistics.residuals.push_back(mMultigrid->GetResidual(
+                mDivergence.data(), mPoisson0.data()));
+        }
+    }
+}
+
+void Fluid2CPU::AdjustVelocity()
+{
+    int const yStride = mXSize;
+    ParallelFor(mNumThreads, mYSize - 2, [this, yStride](unsigned int, int ymin, int ymax)
+    {
+        Vector4<float> const& halfDivDelta = mParameters.halfDivDelta;
+        for (int y = ymin + 1; y <= ymax; ++y)
+        {
+            int i = GetIndex(1, y);
+            float const* poisson = &mPoisson0[i];
+            float const* inState = &mStateTp1[4 * i];
+            float* outState = &mStateTm1[4 * i];
+            for (int x = 1; x < mXSize - 1; ++x, ++poisson, inState += 4, outState += 4)
+            {
+                outState[0] = inState[0] + halfDivDelta[0] * (poisson[1] - poisson[-1]);
+                outState[1] = inState[1] + halfDivDelta[1] * (poisson[yStride] - poisson[-yStride]);
+                outState[2] = inState[2];
+                outState[3] = inState[3];
+            }
+        }
+    });
+}
+
+void Fluid2CPU::Sample(std::vector<float> const& state, float x, float y,
+    float* result) const
+{
+    // Clamp to the texel centers of the boundary.  The clamped value is
+    // between pixels i0 and i0+1 with i0 in {0..size-2}.
+    x = std::min(std::max(0.0f, x), static_cast<float>(mXSize - 1));
+    y = std::min(std::max(0.0f, y), static_cast<float>(mYSize - 1));
+    int x0 = std::min(static_cast<int>(x), mXSize - 2);
+    int y0 = std::min(static_cast<int>(y), mYSize - 2);
+    float tx1 = x - static_cast<float>(x0), tx0 = 1.0f - tx1;
+    float ty1 = y - static_cast<float>(y0), ty0 = 1.0f - ty1;
+
+    float const* s00 = &state[4 * GetIndex(x0, y0)];
+    float const* s01 = s00 + 4 * mXSize;
+    for (int j = 0; j < 4; ++j)
+    {
+        float s0 = tx0 * s00[j] + tx1 * s00[j + 4];
+        float s1 = tx0 * s01[j] + tx1 * s01[j + 4];
+        result[j] = ty0 * s0 + ty1 * s1;
+    }
+}
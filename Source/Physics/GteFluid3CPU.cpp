@@ -0,0 +1,578 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.1 (2019/09/16)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <LowLevel/GteTimer.h>
+#include <Physics/GteFluid3CPU.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+using namespace gte;
+
+Fluid3CPU::Fluid3CPU(int xSize, int ySize, int zSize, float dt, unsigned int numThreads)
+    :
+    mXSize(xSize),
+    mYSize(ySize),
+    mZSize(zSize),
+    mDt(dt),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mTime(0.0f),
+    mPoissonSolver(POISSON_JACOBI),
+    mNumJacobiIterations(NUM_POISSON_ITERATIONS),
+    mMultigridTolerance(0.0f),
+    mMultigridMaxCycles(0),
+    mInstrumentation(false)
+{
+    LogAssert(xSize >= 3 && ySize >= 3 && zSize >= 3, "Invalid grid size.");
+
+    // The parameters are those computed by Fluid3.
+    float dx = 1.0f/static_cast<float>(mXSize);
+    float dy = 1.0f/static_cast<float>(mYSize);
+    float dz = 1.0f/static_cast<float>(mZSize);
+    float dtDivDxDx = (dt/dx)/dx;
+    float dtDivDyDy = (dt/dy)/dy;
+    float dtDivDzDz = (dt/dz)/dz;
+    float ratio0 = dx/dy;
+    float ratio1 = dx/dz;
+    float ratio0Sqr = ratio0*ratio0;
+    float ratio1Sqr = ratio1*ratio1;
+    float factor = 0.5f/(1.0f + ratio0Sqr + ratio1Sqr);
+    float epsilonX = factor;
+    float epsilonY = ratio0Sqr*factor;
+    float epsilonZ = ratio1Sqr*factor;
+    float epsilon0 = dx*dx*factor;
+    float const denViscosity = 0.0001f;
+    float const velViscosity = 0.0001f;
+    float denVX = denViscosity*dtDivDxDx;
+    float denVY = denViscosity*dtDivDyDy;
+    float denVZ = denViscosity*dtDivDzDz;
+    float velVX = velViscosity*dtDivDxDx;
+    float velVY = velViscosity*dtDivDyDy;
+    float velVZ = velViscosity*dtDivDzDz;
+
+    Fluid3Parameters& p = mParameters;
+    p.spaceDelta = { dx, dy, dz, 0.0f };
+    p.halfDivDelta = { 0.5f / dx, 0.5f / dy, 0.5f / dz, 0.0f };
+    p.timeDelta = { dt / dx, dt / dy, dt / dz, dt };
+    p.viscosityX = { velVX, velVX, velVX, denVX };
+    p.viscosityY = { velVY, velVY, velVY, denVY };
+    p.viscosityZ = { velVZ, velVZ, velVZ, denVZ };
+    p.epsilon = { epsilonX, epsilonY, epsilonZ, epsilon0 };
+
+    // The external inputs are those of Fluid3InitializeSource.
+    External& e = mExternal;
+    e.densityProducer = { 0.5f, 0.5f, 0.5f, 0.0f };
+    e.densityPData = { 0.01f, 16.0f, 0.0f, 0.0f };
+    e.densityConsumer = { 0.75f, 0.75f, 0.75f, 0.0f };
+    e.densityCData = { 0.01f, 0.0f, 0.0f, 0.0f };
+    e.gravity = { 0.0f, 0.0f, 0.0f, 0.0f };
+    e.windData = { 0.001f, 0.0f, 0.0f, 0.0f };
+
+    size_t const numVoxels = static_cast<size_t>(mXSize) * mYSize * mZSize;
+    mSource.resize(4 * numVoxels);
+    mStateTm1.resize(4 * numVoxels);
+    mStateT.resize(4 * numVoxels);
+    mStateTp1.resize(4 * numVoxels);
+    mDivergence.resize(numVoxels);
+    mPoisson0.resize(numVoxels);
+    mPoisson1.resize(numVoxels);
+
+    mStatistics.updateState = 0.0;
+    mStatistics.enforceStateBoundary = 0.0;
+    mStatistics.computeDivergence = 0.0;
+    mStatistics.solvePoisson = 0.0;
+    mStatistics.adjustVelocity = 0.0;
+}
+
+void Fluid3CPU::Initialize()
+{
+    InitializeSource();
+    InitializeState();
+    EnforceStateBoundary(mStateTm1);
+    EnforceStateBoundary(mStateT);
+}
+
+void Fluid3CPU::DoSimulationStep()
+{
+    // The stage times are measured only with instrumentation enabled.
+    Timer timer;
+    auto record = [this, &timer](double& seconds)
+    {
+        if (mInstrumentation)
+        {
+            seconds += timer.GetSeconds();
+            timer.Reset();
+        }
+    };
+
+    if (mInstrumentation)
+    {
+        mStatistics.updateState = 0.0;
+        mStatistics.enforceStateBoundary = 0.0;
+        mStatistics.computeDivergence = 0.0;
+        mStatistics.solvePoisson = 0.0;
+        mStatistics.adjustVelocity = 0.0;
+        timer.Reset();
+    }
+
+    UpdateState();
+    record(mStatistics.updateState);
+    EnforceStateBoundary(mStateTp1);
+    record(mStatistics.enforceStateBoundary);
+    ComputeDivergence();
+    record(mStatistics.computeDivergence);
+    SolvePoisson();
+    record(mStatistics.solvePoisson);
+    AdjustVelocity();
+    record(mStatistics.adjustVelocity);
+    EnforceStateBoundary(mStateTm1);
+    record(mStatistics.enforceStateBoundary);
+    std::swap(mStateTm1, mStateT);
+
+    mTime += mDt;
+}
+
+void Fluid3CPU::SetJacobiSolver(int numIterations)
+{
+    mPoissonSolver = POISSON_JACOBI;
+    mNumJacobiIterations = std::max(numIterations, 0);
+}
+
+void Fluid3CPU::SetMultigridSolver(float tolerance, int maxCycles)
+{
+    mPoissonSolver = POISSON_MULTIGRID;
+    mMultigridTolerance = tolerance;
+    mMultigridMaxCycles = std::max(maxCycles, 0);
+    CreateMultigrid();
+}
+
+void Fluid3CPU::SetInstrumentation(bool enable)
+{
+    mInstrumentation = enable;
+    if (mInstrumentation)
+    {
+        CreateMultigrid();
+    }
+}
+
+void Fluid3CPU::CreateMultigrid()
+{
+    if (!mMultigrid)
+    {
+        Vector4<float> const& delta = mParameters.spaceDelta;
+        mMultigrid = std::make_unique<PoissonMultigrid>(mXSize, mYSize, mZSize,
+            delta[0], delta[1], delta[2], mNumThreads);
+    }
+}
+
+void Fluid3CPU::InitializeSource()
+{
+    // Use a Mersenne twister engine for random numbers.  The vortices are
+    // generated in the order of Fluid3InitializeSource.
+    std::mt19937 mte;
+    std::uniform_real_distribution<float> unirnd(0.0f, 1.0f);
+    std::uniform_real_distribution<float> symrnd(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> posrnd0(0.001f, 0.01f);
+    std::uniform_real_distribution<float> posrnd1(64.0f, 128.0f);
+
+    std::vector<Vortex> vortices(NUM_VORTICES);
+    for (auto& v : vortices)
+    {
+        v.position[0] = unirnd(mte);
+        v.position[1] = unirnd(mte);
+        v.position[2] = unirnd(mte);
+        v.position[3] = 0.0f;
+        v.normal[0] = symrnd(mte);
+        v.normal[1] = symrnd(mte);
+        v.normal[2] = symrnd(mte);
+        v.normal[3] = 0.0f;
+        Normalize(v.normal);
+        v.data[0] = posrnd0(mte);
+        v.data[1] = posrnd1(mte);
+        v.data[2] = 0.0f;
+        v.data[3] = 0.0f;
+    }
+
+    // The GPU adds the impulses of all vortices at all voxels.  The impulse
+    // of a vortex at a voxel is amplitude*exp(arg)*cross(normal,diff), where
+    // arg = -|diff|^2/variance.  For arg < minArgument, the impulse is less
+    // than 1e-6 times the maximum impulse of the vortex, so it is skipped.
+    // The vortices are culled per slice, and each remaining vortex is added
+    // to the interval of a row where arg >= minArgument.  The impulses are
+    // accumulated in the order of the vortices, as on the GPU.
+    float const minArgument = -16.0f;
+    ParallelFor(mNumThreads, mZSize, [this, &vortices, minArgument](unsigned int, int zmin, int zmax)
+    {
+        Vector4<float> const& spaceDelta = mParameters.spaceDelta;
+        External const& e = mExternal;
+        std::vector<int> zActive;
+        zActive.reserve(NUM_VORTICES);
+        std::vector<float> vortexVelocity(3 * mXSize);
+        for (int z = zmin; z < zmax; ++z)
+        {
+            float lz = spaceDelta[2] * (static_cast<float>(z) + 0.5f);
+            zActive.clear();
+            for (int k = 0; k < NUM_VORTICES; ++k)
+            {
+                float diff = lz - vortices[k].position[2];
+                if (-diff * diff / vortices[k].data[0] >= minArgument)
+                {
+                    zActive.push_back(k);
+                }
+            }
+
+            for (int y = 0; y < mYSize; ++y)
+            {
+                float ly = spaceDelta[1] * (static_cast<float>(y) + 0.5f);
+
+                // Compute the velocity from the vortices.
+                std::fill(vortexVelocity.begin(), vortexVelocity.end(), 0.0f);
+                for (auto k : zActive)
+                {
+                    Vortex const& v = vortices[k];
+                    float diff1 = ly - v.position[1];
+                    float diff2 = lz - v.position[2];
+                    float sqrRadius = -minArgument * v.data[0] - (diff1 * diff1 + diff2 * diff2);
+                    if (sqrRadius < 0.0f)
+                    {
+                        continue;
+                    }
+
+                    float radius = std::sqrt(sqrRadius);
+                    int xmin = std::max(static_cast<int>(std::ceil(
+                        (v.position[0] - radius) / spaceDelta[0] - 0.5f)), 0);
+                    int xmax = std::min(static_cast<int>(std::floor(
+                        (v.position[0] + radius) / spaceDelta[0] - 0.5f)), mXSize - 1);
+                    for (int x = xmin; x <= xmax; ++x)
+                    {
+                        float* velocity = &vortexVelocity[3 * x];
+                        float diff0 = spaceDelta[0] * (static_cast<float>(x) + 0.5f) - v.position[0];
+                        float arg = -(diff0 * diff0 + diff1 * diff1 + diff2 * diff2) / v.data[0];
+                        float magnitude = v.data[1] * std::exp(arg);
+                        velocity[0] += magnitude * (v.normal[1] * diff2 - v.normal[2] * diff1);
+                        velocity[1] += magnitude * (v.normal[2] * diff0 - v.normal[0] * diff2);
+                        velocity[2] += magnitude * (v.normal[0] * diff1 - v.normal[1] * diff0);
+                    }
+                }
+
+                float* source = &mSource[4 * GetIndex(0, y, z)];
+                float const* velocity = vortexVelocity.data();
+                for (int x = 0; x < mXSize; ++x, source += 4, velocity += 3)
+                {
+                    float lx = spaceDelta[0] * (static_cast<float>(x) + 0.5f);
+
+                    // Compute an input to the fluid simulation consisting of
+                    // a producer of density and a consumer of density.
+                    float diff[3] =
+                    {
+                        lx - e.densityProducer[0],
+                        ly - e.densityProducer[1],
+                        lz - e.densityProducer[2]
+                    };
+                    float arg = -(diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2]) / e.densityPData[0];
+                    float density = e.densityPData[1] * std::exp(arg);
+                    diff[0] = lx - e.densityConsumer[0];
+                    diff[1] = ly - e.densityConsumer[1];
+                    diff[2] = lz - e.densityConsumer[2];
+                    arg = -(diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2]) / e.densityCData[0];
+                    density -= e.densityCData[1] * std::exp(arg);
+
+                    // Compute an input to the fluid simulation consisting of
+                    // gravity, a single wind source, and vortex impulses.
+                    float windArg = -(lx * lx + lz * lz) / e.windData[0];
+                    float windVelocity = e.windData[1] * std::exp(windArg);
+                    source[0] = e.gravity[0] + velocity[0];
+                    source[1] = e.gravity[1] + windVelocity + velocity[1];
+                    source[2] = e.gravity[2] + velocity[2];
+                    source[3] = density;
+                }
+            }
+        }
+    });
+}
+
+void Fluid3CPU::InitializeState()
+{
+    // Use a Mersenne twister engine for random numbers.  The densities are
+    // generated in the order of Fluid3InitializeState.  The initial
+    // velocities are zero.
+    std::mt19937 mte;
+    std::uniform_real_distribution<float> unirnd(0.0f, 1.0f);
+
+    size_t const numVoxels = mDivergence.size();
+    for (size_t i = 0, j = 0; i < numVoxels; ++i, j += 4)
+    {
+        mStateT[j] = 0.0f;
+        mStateT[j + 1] = 0.0f;
+        mStateT[j + 2] = 0.0f;
+        mStateT[j + 3] = unirnd(mte);
+    }
+    mStateTm1 = mStateT;
+}
+
+void Fluid3CPU::EnforceStateBoundary(std::vector<float>& state)
+{
+    // The faces are processed in the order x, y, z, as on the GPU, so the
+    // edges and corners have the same values.  The x-faces and y-faces of a
+    // z-slice depend only on that slice.
+    int const yStride = 4 * mXSize;
+    int const zStride = 4 * mXSize * mYSize;
+    ParallelFor(mNumThreads, mZSize, [this, &state, yStride](unsigned int, int zmin, int zmax)
+    {
+        for (int z = zmin; z < zmax; ++z)
+        {
+            for (int y = 0; y < mYSize; ++y)
+            {
+                float* s = &state[4 * GetIndex(0, y, z)];
+                s[0] = 0.0f;
+                s[1] = s[5];
+                s[2] = s[6];
+                s[3] = 0.0f;
+                s = &state[4 * GetIndex(mXSize - 1, y, z)];
+                s[0] = 0.0f;
+                s[1] = s[-3];
+                s[2] = s[-2];
+                s[3] = 0.0f;
+            }
+
+            for (int x = 0; x < mXSize; ++x)
+            {
+                float* s = &state[4 * GetIndex(x, 0, z)];
+                s[0] = s[yStride];
+                s[1] = 0.0f;
+                s[2] = s[yStride + 2];
+                s[3] = 0.0f;
+                s = &state[4 * GetIndex(x, mYSize - 1, z)];
+                s[0] = s[-yStride];
+                s[1] = 0.0f;
+                s[2] = s[-yStride + 2];
+                s[3] = 0.0f;
+            }
+        }
+    });
+
+    ParallelFor(mNumThreads, mYSize, [this, &state, zStride](unsigned int, int ymin, int ymax)
+    {
+        for (int y = ymin; y < ymax; ++y)
+        {
+            for (int x = 0; x < mXSize; ++x)
+            {
+                float* s = &state[4 * GetIndex(x, y, 0)];
+                s[0] = s[zStride];
+                s[1] = s[zStride + 1];
+                s[2] = 0.0f;
+                s[3] = 0.0f;
+                s = &state[4 * GetIndex(x, y, mZSize - 1)];
+                s[0] = s[-zStride];
+                s[1] = s[-zStride + 1];
+                s[2] = 0.0f;
+                s[3] = 0.0f;
+            }
+        }
+    });
+}
+
+void Fluid3CPU::UpdateState()
+{
+    int const yStride = 4 * mXSize;
+    int const zStride = 4 * mXSize * mYSize;
+    ParallelFor(mNumThreads, mZSize - 2, [this, yStride, zStride](unsigned int, int zmin, int zmax)
+    {
+        Fluid3Parameters const& p = mParameters;
+        float advection[4];
+        for (int z = zmin + 1; z <= zmax; ++z)
+        {
+            for (int y = 1; y < mYSize - 1; ++y)
+            {
+                int i = 4 * GetIndex(1, y, z);
+                for (int x = 1; x < mXSize - 1; ++x, i += 4)
+                {
+                    float const* stateZZZ = &mStateT[i];
+                    float const* src = &mSource[i];
+                    float* update = &mStateTp1[i];
+
+                    // Compute advection.  The shader samples at the texture
+                    // coordinates spaceDelta*(c - timeDelta*velocity + 1/2).
+                    Sample(mStateTm1,
+                        static_cast<float>(x) - p.timeDelta[0] * stateZZZ[0],
+                        static_cast<float>(y) - p.timeDelta[1] * stateZZZ[1],
+                        static_cast<float>(z) - p.timeDelta[2] * stateZZZ[2],
+                        advection);
+
+                    // Estimate second-order derivatives of state at (x,y,z)
+                    // and update the state.
+                    for (int j = 0; j < 4; ++j)
+                    {
+                        float twoZZZ = 2.0f * stateZZZ[j];
+                        float stateDXX = stateZZZ[j + 4] - twoZZZ + stateZZZ[j - 4];
+                        float stateDYY = stateZZZ[j + yStride] - twoZZZ + stateZZZ[j - yStride];
+                        float stateDZZ = stateZZZ[j + zStride] - twoZZZ + stateZZZ[j - zStride];
+                        update[j] = advection[j] + (p.viscosityX[j] * stateDXX +
+                            p.viscosityY[j] * stateDYY + p.viscosityZ[j] * stateDZZ +
+                            p.timeDelta[3] * src[j]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+void Fluid3CPU::ComputeDivergence()
+{
+    int const yStride = 4 * mXSize;
+    int const zStride = 4 * mXSize * mYSize;
+    ParallelFor(mNumThreads, mZSize - 2, [this, yStride, zStride](unsigned int, int zmin, int zmax)
+    {
+        Vector4<float> const& halfDivDelta = mParameters.halfDivDelta;
+        for (int z = zmin + 1; z <= zmax; ++z)
+        {
+            for (int y = 1; y < mYSize - 1; ++y)
+            {
+                int i = GetIndex(1, y, z);
+                float const* state = &mStateTp1[4 * i];
+                float* divergence = &mDivergence[i];
+                for (int x = 1; x < mXSize - 1; ++x, state += 4, ++divergence)
+                {
+                    *divergence =
+                        halfDivDelta[0] * (state[4] - state[-4]) +
+                        halfDivDelta[1] * (state[yStride + 1] - state[-yStride + 1]) +
+                        halfDivDelta[2] * (state[zStride + 2] - state[-zStride + 2]);
+                }
+            }
+        }
+    });
+}
+
+void Fluid3CPU::SolvePoisson()
+{
+    // Both solvers leave the pressure in mPoisson0, which has a zero
+    // boundary.
+    std::fill(mPoisson0.begin(), mPoisson0.end(), 0.0f);
+    if (mPoissonSolver == POISSON_MULTIGRID)
+    {
+        mMultigrid->Solve(mDivergence.data(), mPoisson0.data(), mMultigridTolerance,
+            mMultigridMaxCycles, mInstrumentation ? &mStatistics.residuals : nullptr);
+    }
+    else
+    {
+        SolvePoissonJacobi();
+    }
+}
+
+void Fluid3CPU::SolvePoissonJacobi()
+{
+    // The boundary voxels of mPoisson1 are never written, so they are zero.
+    // This is the boundary condition that the GPU enforces after each
+    // iteration.  The x-loop is a stencil on contiguous arrays.
+    if (mInstrumentation)
+    {
+        mStatistics.residuals.clear();
+        mStatistics.residuals.push_back(mMultigrid->GetResidual(
+            mDivergence.data(), mPoisson0.data()));
+    }
+
+    int const yStride = mXSize;
+    int const zStride = mXSize * mYSize;
+    for (int iteration = 0; iteration < mNumJacobiIterations; ++iteration)
+    {
+        ParallelFor(mNumThreads, mZSize - 2, [this, yStride, zStride](unsigned int, int zmin, int zmax)
+        {
+            Vector4<float> const& epsilon = mParameters.epsilon;
+            float const epsilonX = epsilon[0];
+            float const epsilonY = epsilon[1];
+            float const epsilonZ = epsilon[2];
+            float const epsilon0 = epsilon[3];
+            for (int z = zmin + 1; z <= zmax; ++z)
+            {
+                for (int y = 1; y < mYSize - 1; ++y)
+                {
+                    int i = GetIndex(0, y, z);
+                    float const* poisson = &mPoisson0[i];
+                    float const* divergence = &mDivergence[i];
+                    float* outPoisson = &mPoisson1[i];
+                    for (int x = 1; x < mXSize - 1; ++x)
+                    {
+                        outPoisson[x] =
+                            epsilonX * (poisson[x + 1] + poisson[x - 1]) +
+                            epsilonY * (poisson[x + yStride] + poisson[x - yStride]) +
+                            epsilonZ * (poisson[x + zStride] + poisson[x - zStride]) +
+                            epsilon0 * divergence[x];
+                    }
+                }
+            }
+        });
+
+        std::swap(mPoisson0, mPoisson1);
+        if (mInstrumentation)
+        {
+            mStatistics.residuals.push_back(mMultigrid->GetResidual(
+                mDivergence.data(), mPoisson0.data()));
+        }
+    }
+}
+
+void Fluid3CPU::AdjustVelocity()
+{
+    int const yStride = mXSize;
+    int const zStride = mXSize * mYSize;
+    ParallelFor(mNumThreads, mZSize - 2, [this, yStride, zStride](unsigned int, int zmin, int zmax)
+    {
+        Vector4<float> const& halfDivDelta = mParameters.halfDivDelta;
+        for (int z = zmin + 1; z <= zmax; ++z)
+        {
+            for (int y = 1; y < mYSize - 1; ++y)
+            {
+                int i = GetIndex(1, y, z);
+                float const* poisson = &mPoisson0[i];
+                float const* inState = &mStateTp1[4 * i];
+                float* outState = &mStateTm1[4 * i];
+                for (int x = 1; x < mXSize - 1; ++x, ++poisson, inState += 4, outState += 4)
+                {
+                    outState[0] = inState[0] + halfDivDelta[0] * (poisson[1] - poisson[-1]);
+                    outState[1] = inState[1] + halfDivDelta[1] * (poisson[yStride] - poisson[-yStride]);
+                    outState[2] = inState[2] + halfDivDelta[2] * (poisson[zStride] - poisson[-zStride]);
+                    outState[3] = inState[3];
+                }
+            }
+        }
+    });
+}
+
+void Fluid3CPU::Sample(std::vector<float> const& state, float x, float y, float z,
+    float* result) const
+{
+    // Clamp to the texel centers of the boundary.  The clamped value is
+    // between voxels i0 and i0+1 with i0 in {0..size-2}.
+    x = std::min(std::max(0.0f, x), static_cast<float>(mXSize - 1));
+    y = std::min(std::max(0.0f, y), static_cast<float>(mYSize - 1));
+    z = std::min(std::max(0.0f, z), static_cast<float>(mZSize - 1));
+    int x0 = std::min(static_cast<int>(x), mXSize - 2);
+    int y0 = std::min(static_cast<int>(y), mYSize - 2);
+    int z0 = std::min(static_cast<int>(z), mZSize - 2);
+    float tx1 = x - static_cast<float>(x0), tx0 = 1.0f - tx1;
+    float ty1 = y - static_cast<float>(y0), ty0 = 1.0f - ty1;
+    float tz1 = z - static_cast<float>(z0), tz0 = 1.0f - tz1;
+
+    int const yStride = 4 * mXSize;
+    int const zStride = 4 * mXSize * mYSize;
+    float const* s000 = &state[4 * GetIndex(x0, y0, z0)];
+    float const* s010 = s000 + yStride;
+    float const* s001 = s000 + zStride;
+    float const* s011 = s001 + yStride;
+    for (int j = 0; j < 4; ++j)
+    {
+        float s00 = tx0 * s000[j] + tx1 * s000[j + 4];
+        float s10 = tx0 * s010[j] + tx1 * s010[j + 4];
+        float s01 = tx0 * s001[j] + tx1 * s001[j + 4];
+        float s11 = tx0 * s011[j] + tx1 * s011[j + 4];
+        float s0 = ty0 * s00 + ty1 * s10;
+        float s1 = ty0 * s01 + ty1 * s11;
+        result[j] = tz0 * s0 + tz1 * s1;
+    }
+}
@@ -0,0 +1,218 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteTimer.h>
+#include <Physics/GtePhysicsScheduler.h>
+#include <algorithm>
+#include <cmath>
+using namespace gte;
+
+PhysicsScheduler::~PhysicsScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mStart.notify_all();
+    for (auto& worker : mWorkers)
+    {
+        worker.join();
+    }
+}
+
+PhysicsScheduler::PhysicsScheduler(double step, unsigned int numThreads)
+    :
+    mStep(step),
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mNumSteps(0),
+    mUnsimulated(0.0),
+    mGeneration(0),
+    mNumBusy(0),
+    mExit(false),
+    mCurrent(nullptr),
+    mCurrentTime(0.0),
+    mNumItems(0),
+    mNumTasks(0),
+    mNextTask(0)
+{
+    LogAssert(step > 0.0, "The step must be positive.");
+
+    mStepTiming.name = "step";
+    ResetTimings();
+
+    // The calling thread executes tasks, so mNumThreads-1 workers are
+    // needed.
+    mWorkers.resize(mNumThreads - 1);
+    for (auto& worker : mWorkers)
+    {
+        worker = std::thread([this]() { Work(); });
+    }
+}
+
+int PhysicsScheduler::AddSerialStage(std::string const& name,
+    SerialFunction const& function)
+{
+    Stage stage;
+    stage.serial = function;
+    stage.grainSize = 0;
+    mStages.push_back(stage);
+    mTimings.push_back(Timing{ name, 0, 0, 0 });
+    return static_cast<int>(mStages.size()) - 1;
+}
+
+int PhysicsScheduler::AddParallelStage(std::string const& name,
+    int grainSize, CountFunction const& numItems,
+    ParallelFunction const& function)
+{
+    LogAssert(grainSize > 0, "The grain size must be positive.");
+
+    Stage stage;
+    stage.numItems = numItems;
+    stage.parallel = function;
+    stage.grainSize = grainSize;
+    mStages.push_back(stage);
+    mTimings.push_back(Timing{ name, 0, 0, 0 });
+    return static_cast<int>(mStages.size()) - 1;
+}
+
+int PhysicsScheduler::GetNumTasks(int numItems, int grainSize)
+{
+    return (numItems > 0 ? (numItems + grainSize - 1) / grainSize : 0);
+}
+
+void PhysicsScheduler::Step()
+{
+    double const time = GetTime();
+    Timer stepTimer, stageTimer;
+    for (size_t s = 0; s < mStages.size(); ++s)
+    {
+        Stage const& stage = mStages[s];
+        stageTimer.Reset();
+        if (stage.serial)
+        {
+            stage.serial(time, mStep);
+        }
+        else
+        {
+            RunParallel(stage, time);
+        }
+        UpdateTiming(mTimings[s], stageTimer.GetMicroseconds());
+    }
+    ++mNumSteps;
+    UpdateTiming(mStepTiming, stepTimer.GetMicroseconds());
+}
+
+int PhysicsScheduler::Advance(double elapsed, int maxSteps)
+{
+    mUnsimulated += elapsed;
+    int numSteps = 0;
+    while (mUnsimulated >= mStep && numSteps < maxSteps)
+    {
+        Step();
+        mUnsimulated -= mStep;
+        ++numSteps;
+    }
+    if (mUnsimulated >= mStep)
+    {
+        mUnsimulated = std::fmod(mUnsimulated, mStep);
+    }
+    return numSteps;
+}
+
+void PhysicsScheduler::ResetTimings()
+{
+    for (auto& timing : mTimings)
+    {
+        timing.lastMicroseconds = 0;
+        timing.maxMicroseconds = 0;
+        timing.totalMicroseconds = 0;
+    }
+    mStepTiming.lastMicroseconds = 0;
+    mStepTiming.maxMicroseconds = 0;
+    mStepTiming.totalMicroseconds = 0;
+}
+
+void PhysicsScheduler::UpdateTiming(Timing& timing, int64_t microseconds)
+{
+    timing.lastMicroseconds = microseconds;
+    timing.maxMicroseconds = std::max(timing.maxMicroseconds, microseconds);
+    timing.totalMicroseconds += microseconds;
+}
+
+void PhysicsScheduler::RunParallel(Stage const& stage, double time)
+{
+    mCurrent = &stage;
+    mCurrentTime = time;
+    mNumItems = std::max(stage.numItems(), 0);
+    mNumTasks = GetNumTasks(mNumItems, stage.grainSize);
+    mNextTask = 0;
+
+    if (mWorkers.size() == 0 || mNumTasks <= 1)
+    {
+        RunTasks();
+        return;
+    }
+
+    // Wake the workers, execute tasks on this thread and wait until the
+    // workers have finished their tasks.
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNumBusy = static_cast<unsigned int>(mWorkers.size());
+        ++mGeneration;
+    }
+    mStart.notify_all();
+    RunTasks();
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFinish.wait(lock, [this]() { return mNumBusy == 0; });
+}
+
+void PhysicsScheduler::RunTasks()
+{
+    Stage const& stage = *mCurrent;
+    int const grainSize = stage.grainSize;
+    for (;;)
+    {
+        int task = mNextTask.fetch_add(1);
+        if (task >= mNumTasks)
+        {
+            break;
+        }
+        int imin = task * grainSize;
+        int imax = std::min(imin + grainSize, mNumItems);
+        stage.parallel(mCurrentTime, mStep, task, imin, imax);
+    }
+}
+
+void PhysicsScheduler::Work()
+{
+    uint64_t generation = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStart.wait(lock, [this, generation]()
+            {
+                return mExit || mGeneration != generation;
+            });
+            if (mExit)
+            {
+                return;
+            }
+            generation = mGeneration;
+        }
+
+        RunTasks();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (--mNumBusy == 0)
+        {
+            mFinish.notify_one();
+        }
+    }
+}
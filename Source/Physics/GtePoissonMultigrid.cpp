@@ -0,0 +1,455 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2019
+// Distributed under the Boost Software License, Version 1.0.
+// http://www.boost.org/LICENSE_1_0.txt
+// http://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// File Version: 3.0.0 (2019/09/16)
+
+#include <GTEnginePCH.h>
+#include <LowLevel/GteLogger.h>
+#include <LowLevel/GteParallelFor.h>
+#include <Physics/GtePoissonMultigrid.h>
+#include <algorithm>
+#include <cmath>
+using namespace gte;
+
+PoissonMultigrid::PoissonMultigrid(int xSize, int ySize, int zSize, float dx,
+    float dy, float dz, unsigned int numThreads)
+    :
+    mNumThreads(numThreads > 0 ? numThreads : 1),
+    mNumPreSweeps(2),
+    mNumPostSweeps(2),
+    mNumCoarsestSweeps(0),
+    mNumInterior(0),
+    mThreadSums(mNumThreads)
+{
+    LogAssert(xSize >= 3 && ySize >= 3 && (zSize == 1 || zSize >= 3), "Invalid grid size.");
+
+    bool const is3D = (zSize > 1);
+    int const size[3] = { xSize, ySize, zSize };
+    float const delta[3] = { dx, dy, dz };
+    mNumInterior = (xSize - 2) * (ySize - 2) * (is3D ? zSize - 2 : 1);
+
+    mLevels.resize(1);
+    for (int d = 0; d < 3; ++d)
+    {
+        Axis& axis = mLevels[0].axis[d];
+        axis.size = size[d];
+        axis.position.resize(size[d]);
+        for (int i = 0; i < size[d]; ++i)
+        {
+            axis.position[i] = i;
+        }
+        SetCoefficients(delta[d], axis);
+    }
+
+    for (;;)
+    {
+        // Coarsen while every dimension of the grid has at least 3 interior
+        // nodes.  The coarsest level is solved by Gauss-Seidel sweeps, the
+        // number of sweeps proportional to its largest dimension.
+        Axis const* axis = mLevels.back().axis;
+        int const numX = axis[0].size - 2, numY = axis[1].size - 2;
+        int const numZ = (is3D ? axis[2].size - 2 : 3);
+        if (numX < 3 || numY < 3 || numZ < 3)
+        {
+            mNumCoarsestSweeps = std::max(2 * std::max(std::max(numX, numY), numZ), 8);
+            break;
+        }
+
+        mLevels.push_back(Level());
+        Level& fine = mLevels[mLevels.size() - 2];
+        Level& coarse = mLevels.back();
+        for (int d = 0; d < 3; ++d)
+        {
+            CreateCoarseAxis(fine.axis[d], coarse.axis[d]);
+            SetCoefficients(delta[d], coarse.axis[d]);
+        }
+    }
+
+    for (size_t l = 0; l < mLevels.size(); ++l)
+    {
+        Level& level = mLevels[l];
+        int const nx = level.axis[0].size, ny = level.axis[1].size;
+        size_t const numCells = static_cast<size_t>(nx) * ny * level.axis[2].size;
+        level.yStride = nx;
+        level.zStride = (is3D ? nx * ny : 0);
+        if (l > 0)
+        {
+            level.uStorage.resize(numCells);
+            level.fStorage.resize(numCells);
+            level.u = level.uStorage.data();
+            level.f = level.fStorage.data();
+        }
+        else
+        {
+            level.u = nullptr;
+            level.f = nullptr;
+        }
+        level.r.resize(numCells);
+    }
+}
+
+void PoissonMultigrid::SetNumSmoothingSweeps(int numPreSweeps, int numPostSweeps)
+{
+    mNumPreSweeps = std::max(numPreSweeps, 0);
+    mNumPostSweeps = std::max(numPostSweeps, 0);
+}
+
+int PoissonMultigrid::Solve(float const* f, float* p, float tolerance, int maxCycles,
+    std::vector<float>* residuals)
+{
+    Level& fine = mLevels[0];
+    fine.u = p;
+    fine.f = f;
+
+    float residual = static_cast<float>(std::sqrt(ComputeResidual(fine) / mNumInterior));
+    float const target = tolerance * residual;
+    if (residuals)
+    {
+        residuals->clear();
+        residuals->push_back(residual);
+    }
+
+    int cycle = 0;
+    while (cycle < maxCycles && residual > target)
+    {
+        VCycle(0);
+        ++cycle;
+        residual = static_cast<float>(std::sqrt(ComputeResidual(fine) / mNumInterior));
+        if (residuals)
+        {
+            residuals->push_back(residual);
+        }
+    }
+
+    fine.u = nullptr;
+    fine.f = nullptr;
+    return cycle;
+}
+
+float PoissonMultigrid::GetResidual(float const* f, float const* p)
+{
+    // ComputeResidual reads but does not write the unknowns.
+    Level& fine = mLevels[0];
+    fine.u = const_cast<float*>(p);
+    fine.f = f;
+    float residual = static_cast<float>(std::sqrt(ComputeResidual(fine) / mNumInterior));
+    fine.u = nullptr;
+    fine.f = nullptr;
+    return residual;
+}
+
+void PoissonMultigrid::SetCoefficients(float delta, Axis& axis)
+{
+    // The second difference at node i with spacings hm = x[i] - x[i-1] and
+    // hp = x[i+1] - x[i] is
+    //   2*(u[i-1]/hm - u[i]*(1/hm + 1/hp) + u[i+1]/hp)/(hm + hp)
+    // which is the usual (u[i-1] - 2*u[i] + u[i+1])/h^2 when hm = hp = h.
+    // A degenerate axis (the z-axis of a 2D grid) has zero coefficients.
+    axis.cMinus.assign(axis.size, 0.0f);
+    axis.cPlus.assign(axis.size, 0.0f);
+    if (axis.size == 1)
+    {
+        axis.imin = 0;
+        axis.imax = 1;
+        return;
+    }
+
+    axis.imin = 1;
+    axis.imax = axis.size - 1;
+    for (int i = axis.imin; i < axis.imax; ++i)
+    {
+        float hm = delta * static_cast<float>(axis.position[i] - axis.position[i - 1]);
+        float hp = delta * static_cast<float>(axis.position[i + 1] - axis.position[i]);
+        axis.cMinus[i] = 2.0f / (hm * (hm + hp));
+        axis.cPlus[i] = 2.0f / (hp * (hm + hp));
+    }
+}
+
+void PoissonMultigrid::CreateCoarseAxis(Axis& fine, Axis& coarse)
+{
+    if (fine.size == 1)
+    {
+        coarse.size = 1;
+        coarse.position = fine.position;
+        fine.pIndex = { { { 0, 0 } } };
+        fine.pWeight = { { { 1.0f, 0.0f } } };
+        fine.rIndex = { { { 0, 0, 0 } } };
+        fine.rWeight = { { { 1.0f, 0.0f, 0.0f } } };
+        return;
+    }
+
+    // The coarse nodes are the even fine nodes and the last fine node.
+    int const last = fine.size - 1;
+    std::vector<int> fineIndex;
+    for (int i = 0; i <= last; i += 2)
+    {
+        fineIndex.push_back(i);
+    }
+    if (fineIndex.back() != last)
+    {
+        fineIndex.push_back(last);
+    }
+    coarse.size = static_cast<int>(fineIndex.size());
+    coarse.position.resize(coarse.size);
+    for (int j = 0; j < coarse.size; ++j)
+    {
+        coarse.position[j] = fine.position[fineIndex[j]];
+    }
+
+    // A fine node is a coarse node or is between the coarse nodes j and
+    // j+1, where it is interpolated linearly in position.
+    fine.pIndex.resize(fine.size);
+    fine.pWeight.resize(fine.size);
+    for (int i = 0, j = 0; i <= last; ++i)
+    {
+        if (fineIndex[j] == i)
+        {
+            fine.pIndex[i] = { { j, j } };
+            fine.pWeight[i] = { { 1.0f, 0.0f } };
+            if (j + 1 < coarse.size)
+            {
+                ++j;
+            }
+        }
+        else
+        {
+            float x0 = static_cast<float>(coarse.position[j - 1]);
+            float x1 = static_cast<float>(coarse.position[j]);
+            float t = (static_cast<float>(fine.position[i]) - x0) / (x1 - x0);
+            fine.pIndex[i] = { { j - 1, j } };
+            fine.pWeight[i] = { { 1.0f - t, t } };
+        }
+    }
+
+    // The restriction is the transpose of the prolongation, normalized so
+    // that the weights of a coarse node sum to 1.
+    fine.rIndex.resize(coarse.size);
+    fine.rWeight.resize(coarse.size);
+    for (int j = 0; j < coarse.size; ++j)
+    {
+        int const i = fineIndex[j];
+        float sum = 0.0f;
+        for (int k = 0; k < 3; ++k)
+        {
+            int const n = std::min(std::max(i + k - 1, 0), last);
+            float w = 0.0f;
+            if (n == i + k - 1)
+            {
+                for (int m = 0; m < 2; ++m)
+                {
+                    if (fine.pIndex[n][m] == j)
+                    {
+                        w = fine.pWeight[n][m];
+                        break;
+                    }
+                }
+            }
+            fine.rIndex[j][k] = n;
+            fine.rWeight[j][k] = w;
+            sum += w;
+        }
+        for (int k = 0; k < 3; ++k)
+        {
+            fine.rWeight[j][k] /= sum;
+        }
+    }
+}
+
+template <typename Function>
+void PoissonMultigrid::ForEachRow(Level const& level, Function const& function)
+{
+    Axis const& yAxis = level.axis[1];
+    Axis const& zAxis = level.axis[2];
+    int const numY = yAxis.imax - yAxis.imin;
+    int const numZ = zAxis.imax - zAxis.imin;
+    ParallelFor(mNumThreads, numY * numZ, [&level, &function, &yAxis, &zAxis, numY](
+        unsigned int t, int rmin, int rmax)
+    {
+        for (int row = rmin; row < rmax; ++row)
+        {
+            int y = yAxis.imin + row % numY;
+            int z = zAxis.imin + row / numY;
+            function(t, y, z, level.yStride * y + level.zStride * z);
+        }
+    });
+}
+
+void PoissonMultigrid::Smooth(Level& level, int numSweeps)
+{
+    // Red-black Gauss-Seidel.  The nodes of one color depend only on the
+    // nodes of the other color, so the rows can be processed in parallel.
+    for (int sweep = 0; sweep < numSweeps; ++sweep)
+    {
+        for (int color = 0; color < 2; ++color)
+        {
+            ForEachRow(level, [&level, color](unsigned int, int y, int z, int i)
+            {
+                Axis const& xAxis = level.axis[0];
+                int const ys = level.yStride, zs = level.zStride;
+                float const cmy = level.axis[1].cMinus[y], cpy = level.axis[1].cPlus[y];
+                float const cmz = level.axis[2].cMinus[z], cpz = level.axis[2].cPlus[z];
+                float const* cmx = xAxis.cMinus.data();
+                float const* cpx = xAxis.cPlus.data();
+                float* u = level.u + i;
+                float const* f = level.f + i;
+                for (int x = 1 + ((1 + y + z + color) & 1); x < xAxis.imax; x += 2)
+                {
+                    u[x] = (cmx[x] * u[x - 1] + cpx[x] * u[x + 1] +
+                        cmy * u[x - ys] + cpy * u[x + ys] +
+                        cmz * u[x - zs] + cpz * u[x + zs] + f[x]) /
+                        (cmx[x] + cpx[x] + cmy + cpy + cmz + cpz);
+                }
+            });
+        }
+    }
+}
+
+double PoissonMultigrid::ComputeResidual(Level& level)
+{
+    std::fill(mThreadSums.begin(), mThreadSums.end(), 0.0);
+    ForEachRow(level, [this, &level](unsigned int t, int y, int z, int i)
+    {
+        Axis const& xAxis = level.axis[0];
+        int const ys = level.yStride, zs = level.zStride;
+        float const cmy = level.axis[1].cMinus[y], cpy = level.axis[1].cPlus[y];
+        float const cmz = level.axis[2].cMinus[z], cpz = level.axis[2].cPlus[z];
+        float const* cmx = xAxis.cMinus.data();
+        float const* cpx = xAxis.cPlus.data();
+        float const* u = level.u + i;
+        float const* f = level.f + i;
+        float* r = level.r.data() + i;
+        float sum = 0.0f;
+        for (int x = 1; x < xAxis.imax; ++x)
+        {
+            float diagonal = cmx[x] + cpx[x] + cmy + cpy + cmz + cpz;
+            r[x] = f[x] - (diagonal * u[x] - cmx[x] * u[x - 1] - cpx[x] * u[x + 1] -
+                cmy * u[x - ys] - cpy * u[x + ys] - cmz * u[x - zs] - cpz * u[x + zs]);
+            sum += r[x] * r[x];
+        }
+        mThreadSums[t] += sum;
+    });
+
+    double sum = 0.0;
+    for (auto const& threadSum : mThreadSums)
+    {
+        sum += threadSum;
+    }
+    return sum;
+}
+
+void PoissonMultigrid::Restrict(Level const& fine, Level& coarse)
+{
+    // The right-hand side of a coarse node is the full-weighting average of
+    // the residuals at the fine nodes around it.  The residual is zero at
+    // the boundary nodes.  The coarse unknowns are initialized to zero.
+    Axis const* fAxis = fine.axis;
+    ForEachRow(coarse, [&fine, &coarse, fAxis](unsigned int, int y, int z, int i)
+    {
+        float const* r[9];
+        float w[9];
+        int numRows = 0;
+        for (int kz = 0; kz < 3; ++kz)
+        {
+            float wz = fAxis[2].rWeight[z][kz];
+            if (wz == 0.0f)
+            {
+                continue;
+            }
+            for (int ky = 0; ky < 3; ++ky)
+            {
+                float wy = fAxis[1].rWeight[y][ky];
+                if (wy == 0.0f)
+                {
+                    continue;
+                }
+                r[numRows] = fine.r.data() + fine.yStride * fAxis[1].rIndex[y][ky] +
+                    fine.zStride * fAxis[2].rIndex[z][kz];
+                w[numRows] = wy * wz;
+                ++numRows;
+            }
+        }
+
+        float* u = coarse.u + i;
+        float* f = coarse.fStorage.data() + i;
+        for (int x = 1; x < coarse.axis[0].imax; ++x)
+        {
+            auto const& index = fAxis[0].rIndex[x];
+            auto const& weight = fAxis[0].rWeight[x];
+            float sum = 0.0f;
+            for (int k = 0; k < numRows; ++k)
+            {
+                float const* row = r[k];
+                sum += w[k] * (weight[0] * row[index[0]] + weight[1] * row[index[1]] +
+                    weight[2] * row[index[2]]);
+            }
+            f[x] = sum;
+            u[x] = 0.0f;
+        }
+    });
+}
+
+void PoissonMultigrid::Prolong(Level const& coarse, Level& fine)
+{
+    // Multilinear interpolation of the coarse correction at the fine nodes.
+    // The boundary nodes of the coarse level are zero.
+    Axis const* fAxis = fine.axis;
+    ForEachRow(fine, [&fine, &coarse, fAxis](unsigned int, int y, int z, int i)
+    {
+        float const* e[4];
+        float w[4];
+        int numRows = 0;
+        for (int kz = 0; kz < 2; ++kz)
+        {
+            float wz = fAxis[2].pWeight[z][kz];
+            if (wz == 0.0f)
+            {
+                continue;
+            }
+            for (int ky = 0; ky < 2; ++ky)
+            {
+                float wy = fAxis[1].pWeight[y][ky];
+                if (wy == 0.0f)
+                {
+                    continue;
+                }
+                e[numRows] = coarse.u + coarse.yStride * fAxis[1].pIndex[y][ky] +
+                    coarse.zStride * fAxis[2].pIndex[z][kz];
+                w[numRows] = wy * wz;
+                ++numRows;
+            }
+        }
+
+        float* u = fine.u + i;
+        for (int x = 1; x < fAxis[0].imax; ++x)
+        {
+            auto const& index = fAxis[0].pIndex[x];
+            auto const& weight = fAxis[0].pWeight[x];
+            float sum = 0.0f;
+            for (int k = 0; k < numRows; ++k)
+            {
+                sum += w[k] * (weight[0] * e[k][index[0]] + weight[1] * e[k][index[1]]);
+            }
+            u[x] += sum;
+        }
+    });
+}
+
+void PoissonMultigrid::VCycle(int l)
+{
+    Level& level = mLevels[l];
+    if (l + 1 == static_cast<int>(mLevels.size()))
+    {
+        Smooth(level, mNumCoarsestSweeps);
+        return;
+    }
+
+    Level& coarse = mLevels[l + 1];
+    Smooth(level, mNumPreSweeps);
+    ComputeResidual(level);
+    Restrict(level, coarse);
+    VCycle(l + 1);
+    Prolong(coarse, level);
+    Smooth(level, mNumPostSweeps);
+}